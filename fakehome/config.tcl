@@ -17,6 +17,22 @@
 set escdelay 2000
 
 ::config::bind . <C-x><C-f> { ::actions::find }
+
+# Limits of copy/move operations: bytes and files per second
+# (zero means no limit) and usage of idle I/O priority
+# ::config::throttle -bytes 10485760 -files 0 -idle yes
+
+# Process entries of directories in order of inodes in recursive
+# operations (faster on cold cache), or alphabetically
+# ::config::inode_order yes
+
+# Do not descend into directories on other filesystems (like /proc
+# or network mounts) in find and recursive scanning
+# ::config::one_filesystem no
+
+# Keep index of file names of these directories, so find answers
+# searches by name without scanning (empty list disables index)
+# ::config::find_index [list $env(HOME) /usr/share]
 # ::config::bind . <F1> {
 #     ::iface::message_box -title "Exit" -message "A u ready?" -type yesno
 # }
@@ -0,0 +1,347 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Searching of several substrings at once in binary buffers
+ *
+ * Patterns are compiled to deterministic Aho-Corasick automaton, so
+ * buffer is scanned only once and each character costs one lookup in
+ * table of transitions, no matter how many patterns are searched.
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "acsearch.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+
+/********
+ * Constants and macro definitions
+ */
+
+/* Initial state of automaton */
+#define ROOT 0
+
+/* Mark of transitions to states at which some patterns end */
+#define OUTPUT_FLAG 0x80000000u
+
+#define DELTA(__self, __state, __class) \
+  ((__self)->delta[(__state) * (__self)->classes_count + (__class)])
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Build map of characters to classes
+ *
+ * @param __self - automaton to build map for
+ * @param __patterns - patterns to search
+ * @param __lens - lengths of patterns
+ * @param __case_insens - search case-insensitively
+ */
+static void
+build_classes (acsearch_t *__self, const char **__patterns,
+               const size_t *__lens, int __case_insens)
+{
+  size_t i, j;
+  int ch;
+
+  /* Class zero is used for characters which are not used in patterns */
+  __self->classes_count = 1;
+
+  for (i = 0; i < __self->count; ++i)
+    {
+      for (j = 0; j < __lens[i]; ++j)
+        {
+          ch = (unsigned char)__patterns[i][j];
+
+          if (__case_insens)
+            {
+              ch = tolower (ch);
+            }
+
+          if (!__self->classes[ch])
+            {
+              __self->classes[ch] = __self->classes_count++;
+            }
+        }
+    }
+
+  if (__case_insens)
+    {
+      for (ch = 0; ch < 256; ++ch)
+        {
+          __self->classes[ch] = __self->classes[tolower (ch)];
+        }
+    }
+}
+
+/**
+ * Build trie of patterns
+ *
+ * @param __self - automaton to build trie for
+ * @param __patterns - patterns to search
+ * @param __lens - lengths of patterns
+ */
+static void
+build_trie (acsearch_t *__self, const char **__patterns,
+            const size_t *__lens)
+{
+  size_t i, j, max_states = 1;
+  unsigned int state, cls;
+
+  for (i = 0; i < __self->count; ++i)
+    {
+      max_states += __lens[i];
+    }
+
+  __self->delta = calloc (max_states * __self->classes_count,
+                          sizeof (unsigned int));
+  __self->output = malloc (max_states * sizeof (int));
+  __self->output_link = malloc (max_states * sizeof (int));
+  __self->same = malloc (__self->count * sizeof (int));
+  __self->states_count = 1;
+
+  for (i = 0; i < max_states; ++i)
+    {
+      __self->output[i] = __self->output_link[i] = -1;
+    }
+
+  /* Transitions to the root are not distinguished from absent ones */
+  /* while building trie, because nothing returns to the root */
+  for (i = 0; i < __self->count; ++i)
+    {
+      __self->same[i] = -1;
+
+      if (!__lens[i])
+        {
+          /* Empty pattern is never reported */
+          continue;
+        }
+
+      ++__self->nonempty;
+      state = ROOT;
+
+      for (j = 0; j < __lens[i]; ++j)
+        {
+          cls = __self->classes[(unsigned char)__patterns[i][j]];
+
+          if (!DELTA (__self, state, cls))
+            {
+              DELTA (__self, state, cls) = __self->states_count++;
+            }
+
+          state = DELTA (__self, state, cls);
+        }
+
+      __self->same[i] = __self->output[state];
+      __self->output[state] = i;
+    }
+}
+
+/**
+ * Turn trie into deterministic automaton
+ *
+ * @param __self - automaton with built trie
+ */
+static void
+build_automaton (acsearch_t *__self)
+{
+  unsigned int *queue, *fail, head = 0, tail = 0;
+  unsigned int state, child, cls;
+
+  queue = malloc (__self->states_count * sizeof (unsigned int));
+  fail = calloc (__self->states_count, sizeof (unsigned int));
+
+  /* Children of root fail to the root */
+  for (cls = 0; cls < __self->classes_count; ++cls)
+    {
+      if (DELTA (__self, ROOT, cls))
+        {
+          queue[tail++] = DELTA (__self, ROOT, cls);
+        }
+    }
+
+  /* States are visited in order of their depth, so failure links */
+  /* and transitions of shallower states are known already */
+  while (head < tail)
+    {
+      state = queue[head++];
+
+      for (cls = 0; cls < __self->classes_count; ++cls)
+        {
+          child = DELTA (__self, state, cls);
+
+          if (child)
+            {
+              fail[child] = DELTA (__self, fail[state], cls);
+
+              __self->output_link[child] =
+                __self->output[fail[child]] >= 0 ?
+                  (int)fail[child] : __self->output_link[fail[child]];
+
+              queue[tail++] = child;
+            }
+          else
+            {
+              DELTA (__self, state, cls) = DELTA (__self, fail[state], cls);
+            }
+        }
+    }
+
+  free (queue);
+  free (fail);
+}
+
+/**
+ * Convert table of transitions to the form used for scanning
+ *
+ * Numbers of target states are replaced with offsets of their rows
+ * and transitions to states with output are marked, so scanning
+ * needs neither multiplication nor lookup of output for most characters.
+ *
+ * @param __self - built automaton
+ */
+static void
+finalize_delta (acsearch_t *__self)
+{
+  unsigned int i, count, state;
+
+  count = __self->states_count * __self->classes_count;
+
+  for (i = 0; i < count; ++i)
+    {
+      state = __self->delta[i];
+      __self->delta[i] = state * __self->classes_count;
+
+      if (__self->output[state] >= 0 || __self->output_link[state] >= 0)
+        {
+          __self->delta[i] |= OUTPUT_FLAG;
+        }
+    }
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Compile patterns to automaton
+ *
+ * @param __patterns - patterns to search
+ * @param __lens - lengths of patterns
+ * @param __count - count of patterns
+ * @param __case_insens - search case-insensitively
+ * @return compiled automaton. Use acsearch_free() to free it.
+ */
+acsearch_t*
+acsearch_compile (const char **__patterns, const size_t *__lens,
+                  size_t __count, int __case_insens)
+{
+  acsearch_t *res;
+
+  res = calloc (1, sizeof (acsearch_t));
+  res->count = __count;
+
+  build_classes (res, __patterns, __lens, __case_insens);
+  build_trie (res, __patterns, __lens);
+  build_automaton (res);
+  finalize_delta (res);
+
+  return res;
+}
+
+/**
+ * Free automaton
+ *
+ * @param __self - automaton to free
+ */
+void
+acsearch_free (acsearch_t *__self)
+{
+  if (!__self)
+    {
+      return;
+    }
+
+  free (__self->delta);
+  free (__self->output);
+  free (__self->output_link);
+  free (__self->same);
+  free (__self);
+}
+
+/**
+ * Scan buffer and mark patterns occurred in it
+ *
+ * Buffers of stream are scanned one after another with the same state,
+ * so occurrences crossing boundaries of buffers are found as well.
+ * Scanning stops when all non-empty patterns have been occurred.
+ *
+ * @param __self - compiled automaton
+ * @param __state - state of automaton, should be zero before scanning
+ * of the first buffer of stream
+ * @param __buf - buffer to scan
+ * @param __len - length of buffer
+ * @param __hits - array of marks of patterns, non-zero for occurred ones
+ * @param __hit_count - count of occurred patterns
+ */
+void
+acsearch_scan (const acsearch_t *__self, unsigned int *__state,
+               const char *__buf, size_t __len,
+               char *__hits, size_t *__hit_count)
+{
+  const unsigned char *buf = (const unsigned char*)__buf;
+  const unsigned short *classes = __self->classes;
+  const unsigned int *delta = __self->delta;
+  unsigned int row = *__state * __self->classes_count, next;
+  size_t i;
+  int s, p;
+
+  if (*__hit_count >= __self->nonempty)
+    {
+      return;
+    }
+
+  for (i = 0; i < __len; ++i)
+    {
+      next = delta[row + classes[buf[i]]];
+      row = next & ~OUTPUT_FLAG;
+
+      if (!(next & OUTPUT_FLAG))
+        {
+          continue;
+        }
+
+      /* Report all patterns which end at this character */
+      s = row / __self->classes_count;
+      if (__self->output[s] < 0)
+        {
+          s = __self->output_link[s];
+        }
+
+      for (; s >= 0; s = __self->output_link[s])
+        {
+          for (p = __self->output[s]; p >= 0; p = __self->same[p])
+            {
+              if (!__hits[p])
+                {
+                  __hits[p] = 1;
+                  ++*__hit_count;
+                }
+            }
+        }
+
+      if (*__hit_count >= __self->nonempty)
+        {
+          break;
+        }
+    }
+
+  *__state = row / __self->classes_count;
+}
@@ -0,0 +1,76 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Searching of several substrings at once in binary buffers
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _acsearch_h_
+#define _acsearch_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include <stddef.h>
+
+/********
+ * Type definitions
+ */
+
+/* Aho-Corasick automaton */
+typedef struct
+{
+  /* Count of patterns and count of non-empty ones */
+  size_t count, nonempty;
+
+  /* Characters are mapped to classes, so there are as many columns */
+  /* in table of transitions as different characters in patterns */
+  /* (plus one for all the rest characters, so there could be 257 */
+  /* classes, which don't fit into byte) */
+  unsigned short classes[256];
+  unsigned int classes_count;
+
+  /* Table of transitions (states_count rows by classes_count columns). */
+  /* Transitions are stored as offsets of rows of target states. */
+  unsigned int *delta;
+  unsigned int states_count;
+
+  /* The first pattern ending at state, or -1 */
+  int *output;
+
+  /* The nearest state reachable by failure links with non-empty */
+  /* output, or -1 */
+  int *output_link;
+
+  /* Next pattern equal to this one, or -1 */
+  int *same;
+} acsearch_t;
+
+/********
+ *
+ */
+
+/* Compile patterns to automaton */
+acsearch_t*
+acsearch_compile (const char **__patterns, const size_t *__lens,
+                  size_t __count, int __case_insens);
+
+/* Free automaton */
+void
+acsearch_free (acsearch_t *__self);
+
+/* Scan buffer and mark patterns occurred in it */
+void
+acsearch_scan (const acsearch_t *__self, unsigned int *__state,
+               const char *__buf, size_t __len,
+               char *__hits, size_t *__hit_count);
+
+END_HEADER
+
+#endif
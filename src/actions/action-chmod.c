@@ -110,6 +110,22 @@ chmod_operation (const wchar_t *__full_name, vfs_stat_t __stat,
   return res;
 }
 
+/**
+ * Chmod operation for action_operate_trees
+ *
+ * @param __url - URL of item to change mode of with all its children
+ * @param __state - state of changing
+ * @param __masks - descriptor of bitmasks
+ * @return zero on success, non-zero otherwise
+ */
+static int
+chmod_tree_operation (const wchar_t *__url, vfs_tree_state_t *__state,
+                      op_data_t *__masks)
+{
+  return vfs_chmod_tree (__url, __masks->mask, __masks->unknown_mask,
+                         __state);
+}
+
 /********
  * User's backend
  */
@@ -159,12 +175,24 @@ action_chmod (file_panel_t *__panel)
   res = action_chmod_show_dialog (&op_data.mask, &op_data.unknown_mask,
                                   &recursively);
 
-  if (res == ACTION_OK)
+  if (res == ACTION_OK && recursively)
+    {
+      /* Subtrees are changed by VFS plugins in parallel */
+      res = action_operate_trees (_(L"Permissions"),
+                                  _(L"Changing permissions of file "
+                                    L"or directory"),
+                                  __panel, cwd, list, count, scan, TRUE,
+                                  (action_tree_operator_t)chmod_tree_operation,
+                                  (action_operator_t)chmod_operation,
+                                  NULL, (action_operator_t)chmod_operation,
+                                  &op_data);
+    }
+  else if (res == ACTION_OK)
     {
       res = action_operate (_(L"Permissions"),
                             _(L"Changing permissions of file or directory"),
                             __panel, cwd, (const file_panel_item_t**)list,
-                            count, recursively, scan, TRUE,
+                            count, FALSE, scan, TRUE,
                             (action_operator_t)chmod_operation,
                             NULL, (action_operator_t)chmod_operation,
                             &op_data);
@@ -147,6 +147,20 @@ chown_operation (const wchar_t *__path, vfs_stat_t __stat,
   return ACTION_OK;
 }
 
+/**
+ * Chown operation for action_operate_trees
+ *
+ * @param __url - URL of item to change owner of with all its children
+ * @param __state - state of changing
+ * @param __data - data collected from user to use
+ * @return zero on success, non-zero otherwise
+ */
+static int
+chown_tree_operation (const wchar_t *__url, vfs_tree_state_t *__state,
+                      op_data_t *__data)
+{
+  return vfs_chown_tree (__url, __data->uid, __data->gid, __state);
+}
 
 /********
  * User's backend
@@ -204,13 +218,32 @@ action_chown (file_panel_t *__panel)
                                &recursively) == ACTION_OK)
         {
           op_data.multiselect = count > 1;
-          res = action_operate (_(L"Change owner"),
-                                _(L"Changing owner of file or directory:"),
-                                __panel, cwd, (const file_panel_item_t**)list,
-                                count, recursively, scan, TRUE,
-                                (action_operator_t)chown_operation,
-                                NULL, (action_operator_t)chown_operation,
-                                &op_data);
+
+          if (recursively)
+            {
+              /* Subtrees are changed by VFS plugins in parallel */
+              action_tree_operator_t tree_op;
+
+              tree_op = (action_tree_operator_t)chown_tree_operation;
+              res = action_operate_trees (_(L"Change owner"),
+                                    _(L"Changing owner of file or directory:"),
+                                    __panel, cwd, list, count, scan, TRUE,
+                                    tree_op,
+                                    (action_operator_t)chown_operation,
+                                    NULL, (action_operator_t)chown_operation,
+                                    &op_data);
+            }
+          else
+            {
+              res = action_operate (_(L"Change owner"),
+                                    _(L"Changing owner of file or directory:"),
+                                    __panel, cwd,
+                                    (const file_panel_item_t**)list,
+                                    count, FALSE, scan, TRUE,
+                                    (action_operator_t)chown_operation,
+                                    NULL, (action_operator_t)chown_operation,
+                                    &op_data);
+            }
         }
     }
 
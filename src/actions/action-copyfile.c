@@ -0,0 +1,392 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Copying of files shared by interactive and background operations
+ *
+ * Interactive operation asks user about errors and displays progress
+ * in its window, while background job registers errors and counts
+ * progress in its worker. So both of them pass callbacks here.
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "action-copyfile.h"
+#include "action-copymove-iface.h"
+#include "action-walk.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+/********
+ * Constants
+ */
+
+/* Size of buffer in copying operation */
+#define BUF_SIZE 65536
+
+/* Length of map of hard-linked files */
+#define HARDLINKS_MAP_LENGTH 16411
+
+/********
+ * User's backend
+ */
+
+/**
+ * Check if target is source itself or is located inside source
+ *
+ * NOTE: Names are compared without reading of symbolic links,
+ *       otherwise symbolic link to parent directory would be
+ *       considered as copied to itself.
+ *
+ * @param __src - URL of source
+ * @param __dst - URL of target
+ * @return non-zero if source would be copied to itself, zero otherwise
+ */
+BOOL
+action_copyfile_to_itself (const wchar_t *__src, const wchar_t *__dst)
+{
+  wchar_t *src, *dst;
+  size_t len;
+  BOOL res;
+
+  src = vfs_normalize_full (__src, FALSE);
+  dst = vfs_normalize_full (__dst, FALSE);
+  len = wcslen (src);
+
+  /* Name of root directory already ends with delimiter */
+  res = !wcsncmp (src, dst, len) &&
+        (!dst[len] || dst[len] == '/' || (len && src[len - 1] == '/'));
+
+  free (src);
+  free (dst);
+
+  return res;
+}
+
+/**
+ * Decide what to do with existing target by user's answer
+ * Answers which are applied to all existing targets are saved
+ * to the rule.
+ *
+ * @param __answer - answer of user or saved rule
+ * @param __src - stat information of source
+ * @param __dst - stat information of existing target
+ * @param __owr_all_rule - rule for all existing targets (could be NULL)
+ * @param __append - set to TRUE if source should be appended to target.
+ * Appending of not regular files is equal to their replacement.
+ * @return ACTION_OK if target should be replaced, ACTION_SKIP if item
+ * should be skipped, ACTION_ABORT if operation should be stopped
+ */
+int
+action_copyfile_resolve (int __answer, const vfs_stat_t *__src,
+                         const vfs_stat_t *__dst, int *__owr_all_rule,
+                         BOOL *__append)
+{
+  *__append = FALSE;
+
+  if (__owr_all_rule &&
+      (__answer == MR_COPY_REPLACE_ALL || __answer == MR_COPY_UPDATE ||
+       __answer == MR_COPY_NONE || __answer == MR_COPY_SIZE_DIFFERS))
+    {
+      *__owr_all_rule = __answer;
+    }
+
+  switch (__answer)
+    {
+    case MR_YES:
+    case MR_COPY_REPLACE_ALL:
+      return ACTION_OK;
+
+    case MR_COPY_APPEND:
+      *__append = S_ISREG (__src->st_mode) && S_ISREG (__dst->st_mode);
+      return ACTION_OK;
+
+    case MR_COPY_UPDATE:
+      return __src->st_mtime > __dst->st_mtime ? ACTION_OK : ACTION_SKIP;
+
+    case MR_COPY_SIZE_DIFFERS:
+      return __src->st_size != __dst->st_size ? ACTION_OK : ACTION_SKIP;
+
+    case MR_CANCEL:
+    case MR_ABORT:
+      return ACTION_ABORT;
+
+    default:
+      return ACTION_SKIP;
+    }
+}
+
+/**
+ * Copy content of opened source file to opened target
+ *
+ * @param __src - descriptor of source file
+ * @param __dst - descriptor of target file
+ * @param __src_url - URL of source file
+ * @param __dst_url - URL of target file
+ * @param __size - count of bytes to copy
+ * @param __sum - checksum which is fed by copied data (could be NULL)
+ * @param __callbacks - callbacks for errors and progress
+ * @param __copied - count of copied bytes. It is less than size if
+ * copying has been stopped or source has been truncated.
+ * @return ACTION_OK if copying has been finished, ACTION_ABORT if it
+ * has been stopped by progress callback, otherwise value returned
+ * by error callback
+ */
+int
+action_copyfile_data (vfs_file_t __src, vfs_file_t __dst,
+                      const wchar_t *__src_url, const wchar_t *__dst_url,
+                      vfs_size_t __size, checksum_t *__sum,
+                      const action_copyfile_callbacks_t *__callbacks,
+                      vfs_size_t *__copied)
+{
+  vfs_size_t len, written, count;
+  char *buf;
+  int res = ACTION_OK;
+
+  *__copied = 0;
+  buf = malloc (BUF_SIZE);
+
+  while (*__copied < __size)
+    {
+      len = vfs_read (__src, buf, MIN (__size - *__copied, BUF_SIZE));
+
+      if (len < 0)
+        {
+          res = __callbacks->error (__src_url, ACF_READ, len,
+                                    __callbacks->user_data);
+          if (res != ACTION_OK)
+            {
+              break;
+            }
+          continue;
+        }
+
+      if (len == 0)
+        {
+          /* Source has been truncated */
+          break;
+        }
+
+      /* Hash data while it is in buffer to avoid re-reading of source */
+      if (__sum)
+        {
+          checksum_update (__sum, buf, len);
+        }
+
+      for (written = 0; written < len; written += count)
+        {
+          count = vfs_write (__dst, buf + written, len - written);
+
+          if (count <= 0)
+            {
+              res = __callbacks->error (__dst_url, ACF_WRITE,
+                                        count ? count : -EIO,
+                                        __callbacks->user_data);
+              if (res != ACTION_OK)
+                {
+                  break;
+                }
+              count = 0;
+            }
+        }
+
+      if (res != ACTION_OK)
+        {
+          break;
+        }
+
+      *__copied += len;
+
+      if (__callbacks->progress &&
+          __callbacks->progress (len, *__copied, __callbacks->user_data))
+        {
+          res = ACTION_ABORT;
+          break;
+        }
+    }
+
+  free (buf);
+
+  return res;
+}
+
+/**
+ * Re-read target file and compare it's checksum with checksum
+ * evaluated while copying
+ * Verification is started from the beginning when error callback
+ * asks to retry.
+ *
+ * @param __dst - URL of target file
+ * @param __sum - checksum of data which has been read from source
+ * @param __callbacks - callbacks for errors and progress
+ * @return ACTION_OK if checksums are equal, ACTION_ABORT if verification
+ * has been stopped by progress callback, otherwise value returned
+ * by error callback
+ */
+int
+action_copyfile_verify (const wchar_t *__dst, checksum_t *__sum,
+                        const action_copyfile_callbacks_t *__callbacks)
+{
+  vfs_file_t fd;
+  vfs_size_t len = 0, verified;
+  checksum_t dst_sum;
+  char *buf;
+  int res, op;
+  BOOL stopped = FALSE;
+
+  checksum_final (__sum);
+  buf = malloc (BUF_SIZE);
+
+  for (;;)
+    {
+      res = 0;
+      op = ACF_REOPEN;
+
+      fd = vfs_open (__dst, O_RDONLY, &res, 0);
+      if (fd)
+        {
+          /* Target has been just written, so it's pages are most */
+          /* likely still cached. Drop them to make sure data is read */
+          /* back from the media. */
+          vfs_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+
+          checksum_init (&dst_sum, __sum->type);
+          op = ACF_REREAD;
+          verified = 0;
+
+          while (!stopped && (len = vfs_read (fd, buf, BUF_SIZE)) > 0)
+            {
+              checksum_update (&dst_sum, buf, len);
+              verified += len;
+
+              stopped = __callbacks->progress &&
+                        __callbacks->progress (len, verified,
+                                               __callbacks->user_data);
+            }
+
+          vfs_close (fd);
+
+          if (stopped)
+            {
+              res = ACTION_ABORT;
+              break;
+            }
+
+          res = len < 0 ? len : 0;
+
+          if (!res)
+            {
+              checksum_final (&dst_sum);
+
+              if (!checksum_compare (__sum, &dst_sum))
+                {
+                  break;
+                }
+
+              op = ACF_VERIFY;
+              res = -EIO;
+            }
+        }
+
+      res = __callbacks->error (__dst, op, res, __callbacks->user_data);
+      if (res != ACTION_OK)
+        {
+          break;
+        }
+    }
+
+  free (buf);
+
+  return res;
+}
+
+/**
+ * Create target as hard link to the first copied name of source
+ * Source should be regular file with several hard links.
+ *
+ * NOTE: Target may already exist or target filesystem may not
+ *       support hard links. Content of file should be copied
+ *       in this case.
+ *
+ * @param __links - map of first targets of hard-linked sources,
+ * created if it doesn't exist yet
+ * @param __stat - stat information of source
+ * @param __dst - URL of target
+ * @return non-zero if hard link has been created, zero otherwise
+ */
+BOOL
+action_copyfile_link (hashmap_t **__links, const vfs_stat_t *__stat,
+                      const wchar_t *__dst)
+{
+  action_inode_key_t key;
+  wchar_t *first_dst;
+
+  if (!*__links)
+    {
+      *__links = action_inode_map_create (free, HARDLINKS_MAP_LENGTH);
+    }
+
+  key.dev = __stat->st_dev;
+  key.ino = __stat->st_ino;
+
+  first_dst = hashmap_get (*__links, &key);
+
+  return first_dst && vfs_link (first_dst, __dst) == VFS_OK;
+}
+
+/**
+ * Remember target as the first copied name of source
+ * Other names are linked only to exact copy of file, so target
+ * shouldn't be remembered if it has been appended or copied partly.
+ *
+ * @param __links - map of first targets of hard-linked sources
+ * @param __stat - stat information of source
+ * @param __dst - URL of target
+ */
+void
+action_copyfile_remember_link (hashmap_t **__links, const vfs_stat_t *__stat,
+                               const wchar_t *__dst)
+{
+  action_inode_key_t key;
+
+  if (!*__links)
+    {
+      *__links = action_inode_map_create (free, HARDLINKS_MAP_LENGTH);
+    }
+
+  key.dev = __stat->st_dev;
+  key.ino = __stat->st_ino;
+
+  if (!hashmap_get (*__links, &key))
+    {
+      hashmap_set (*__links, &key, wcsdup (__dst));
+    }
+}
+
+/**
+ * Keep owner of copied item
+ * Owner could be changed by superuser only, so it's kept when
+ * file manager is run by superuser. Errors are ignored.
+ *
+ * @param __dst - URL of target
+ * @param __stat - stat information of source
+ */
+void
+action_copyfile_keep_owner (const wchar_t *__dst, const vfs_stat_t *__stat)
+{
+  if (geteuid () || S_ISLNK (__stat->st_mode))
+    {
+      return;
+    }
+
+  /* Changing of owner may drop set-user-ID and set-group-ID bits */
+  if (!vfs_chown (__dst, __stat->st_uid, __stat->st_gid))
+    {
+      vfs_chmod (__dst, __stat->st_mode & 07777);
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Copying of files shared by interactive and background operations
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _action_copyfile_h_
+#define _action_copyfile_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include "actions.h"
+#include "hashmap.h"
+#include "checksum.h"
+
+/********
+ * Constants
+ */
+
+/* Operations which could fail while copying content of file */
+#define ACF_READ   0 /* Reading of source */
+#define ACF_WRITE  1 /* Writing of target */
+#define ACF_REOPEN 2 /* Opening of target for verification */
+#define ACF_REREAD 3 /* Reading of target for verification */
+#define ACF_VERIFY 4 /* Checksums of source and target are different */
+
+/********
+ * Type definitions
+ */
+
+/* Callback for failed operation */
+/* Returns ACTION_OK to retry operation, otherwise copying is stopped */
+/* and returned value is passed to caller */
+typedef int (*action_copyfile_error_proc) (const wchar_t *__url, int __op,
+                                           int __error, void *__user_data);
+
+/* Callback for processed buffer of data */
+/* Returns non-zero to stop copying */
+typedef int (*action_copyfile_progress_proc) (vfs_size_t __count,
+                                              vfs_size_t __done,
+                                              void *__user_data);
+
+typedef struct
+{
+  action_copyfile_error_proc error;
+  action_copyfile_progress_proc progress;
+  void *user_data;
+} action_copyfile_callbacks_t;
+
+/********
+ *
+ */
+
+/* Check if target is source itself or is located inside source */
+BOOL
+action_copyfile_to_itself (const wchar_t *__src, const wchar_t *__dst);
+
+/* Decide what to do with existing target by user's answer */
+int
+action_copyfile_resolve (int __answer, const vfs_stat_t *__src,
+                         const vfs_stat_t *__dst, int *__owr_all_rule,
+                         BOOL *__append);
+
+/* Copy content of opened source file to opened target */
+int
+action_copyfile_data (vfs_file_t __src, vfs_file_t __dst,
+                      const wchar_t *__src_url, const wchar_t *__dst_url,
+                      vfs_size_t __size, checksum_t *__sum,
+                      const action_copyfile_callbacks_t *__callbacks,
+                      vfs_size_t *__copied);
+
+/* Re-read target file and compare it's checksum with checksum */
+/* evaluated while copying */
+int
+action_copyfile_verify (const wchar_t *__dst, checksum_t *__sum,
+                        const action_copyfile_callbacks_t *__callbacks);
+
+/* Create target as hard link to the first copied name of source */
+BOOL
+action_copyfile_link (hashmap_t **__links, const vfs_stat_t *__stat,
+                      const wchar_t *__dst);
+
+/* Remember target as the first copied name of source */
+void
+action_copyfile_remember_link (hashmap_t **__links, const vfs_stat_t *__stat,
+                               const wchar_t *__dst);
+
+/* Keep owner of copied item */
+void
+action_copyfile_keep_owner (const wchar_t *__dst, const vfs_stat_t *__stat);
+
+END_HEADER
+
+#endif
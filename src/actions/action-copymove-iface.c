@@ -93,6 +93,25 @@ abort_button_clicked (w_button_t *__button)
   return TRUE;
 }
 
+/**
+ * Handler of clicking button 'limit' on process window
+ *
+ * @param __button - sender button
+ * @return non-zero if action has been handled, zero otherwise
+ */
+static int
+limit_button_clicked (w_button_t *__button)
+{
+  if (!__button || !WIDGET_USER_DATA (__button))
+    {
+      return 0;
+    }
+
+  action_copy_throttle_dialog (WIDGET_USER_DATA (__button));
+
+  return TRUE;
+}
+
 /**
  * Handler of keydown message for buttons on process window
  *
@@ -222,13 +241,12 @@ get_to_field_caption (BOOL __move, const file_panel_item_t **__src_list,
  * Create file copy process window
  *
  * @param __move - are files will be moved?
- * @param __total_progress - is total progress information avaliable
- * @param __listing - listing to get summary information
+ * @param __listing - listing which counts summary information.
+ * If it is NULL, total progress information is not displayed.
  * @return created window
  */
 copy_process_window_t*
-action_copy_create_proc_wnd (BOOL __move, BOOL __total_progress,
-                             const action_listing_t *__listing)
+action_copy_create_proc_wnd (BOOL __move, action_shared_listing_t *__listing)
 {
   copy_process_window_t *res;
   w_container_t *cnt;
@@ -238,7 +256,7 @@ action_copy_create_proc_wnd (BOOL __move, BOOL __total_progress,
 
   MALLOC_ZERO (res, sizeof (copy_process_window_t))
 
-  if (__total_progress)
+  if (__listing)
     {
       height = 13;
     }
@@ -274,35 +292,33 @@ action_copy_create_proc_wnd (BOOL __move, BOOL __total_progress,
                                    6);
 
   /* Create progess bars for displaying total progress */
-  if (__total_progress)
+  if (__listing)
     {
-      wchar_t text[1024];
+      res->listing = __listing;
+      res->estimating = TRUE;
 
-      swprintf (text, BUF_LEN (text), _(L"(%lldKb of %lldKb)"),
-                res->bytes_copied, __listing->size / 1024);
       widget_create_text (NULL, cnt, _(L"Bytes"), 1, 8);
-      res->bytes_digit = widget_create_text (NULL, cnt, text,
+      res->bytes_digit = widget_create_text (NULL, cnt, L"",
                                              2 + wcslen (_(L"Bytes")), 8);
-      res->bytes_progress = widget_create_progress (NULL, cnt, __listing->size,
+      res->bytes_progress = widget_create_progress (NULL, cnt, 0,
                                                     1, 9, 28,
                                                     WPBS_NOPERCENT);
-      res->bytes_total = __listing->size;
 
-      swprintf (text, BUF_LEN (text), _(L"(%lld of %lld)"), res->files_copied,
-                __listing->count);
       widget_create_text (NULL, cnt, _(L"Count"), 30, 8);
-      res->count_digit = widget_create_text (NULL, cnt, text,
+      res->count_digit = widget_create_text (NULL, cnt, L"",
                                              31 + wcslen (_(L"Count")), 8);
-      res->count_progress = widget_create_progress (NULL, cnt,
-                                                    __listing->count,
+      res->count_progress = widget_create_progress (NULL, cnt, 0,
                                                     30, 9, 28,
                                                     WPBS_NOPERCENT);
-      res->files_total = __listing->count;
+
+      /* Totals are counted in background */
+      action_copy_update_totals (res);
     }
 
   /* Create buttons */
   left = (cnt->position.width - widget_shortcut_length (_(L"_Skip")) -
-                  widget_shortcut_length (_(L"_Abort")) - 9) / 2;
+                  widget_shortcut_length (_(L"_Limit")) -
+                  widget_shortcut_length (_(L"_Abort")) - 14) / 2;
 
   btn = widget_create_button (NULL, cnt, _(L"_Skip"), left,
                               cnt->position.height - 2, 0);
@@ -312,6 +328,14 @@ action_copy_create_proc_wnd (BOOL __move, BOOL __total_progress,
   WIDGET_USER_CALLBACK (btn, keydown) = (widget_keydown_proc)button_keydown;
 
   left += widget_shortcut_length (_(L"_Skip")) + 5;
+  btn = widget_create_button (NULL, cnt, _(L"_Limit"), left,
+                              cnt->position.height - 2, 0);
+
+  WIDGET_USER_DATA (btn) = res;
+  WIDGET_USER_CALLBACK (btn, clicked) = (widget_action)limit_button_clicked;
+  WIDGET_USER_CALLBACK (btn, keydown) = (widget_keydown_proc)button_keydown;
+
+  left += widget_shortcut_length (_(L"_Limit")) + 5;
   btn = widget_create_button (NULL, cnt, _(L"_Abort"), left,
                               cnt->position.height - 2, 0);
 
@@ -324,7 +348,7 @@ action_copy_create_proc_wnd (BOOL __move, BOOL __total_progress,
   res->move_strategy = MOVE_STRATEGY_UNDEFINED;
   if (__move)
     {
-      res->unlink_list = deque_create ();
+      res->unlink_list = action_unlink_list_create ();
     }
 
   return res;
@@ -346,14 +370,26 @@ action_copy_destroy_proc_wnd (copy_process_window_t *__window)
   widget_destroy (WIDGET (__window->window));
 
   /* Free list of items to unlink */
-  if (__window->unlink_list)
+  action_unlink_list_destroy (__window->unlink_list);
+
+  /* Free map of hard links */
+  if (__window->hardlinks)
     {
-      void deleter (void *__data)
-      {
-        free (__data);
-      }
+      hashmap_destroy (__window->hardlinks);
+    }
+
+  /* Free deferred files which haven't been copied */
+  if (__window->deferred)
+    {
+      unsigned long i;
+
+      for (i = 0; i < __window->deferred_count; ++i)
+        {
+          SAFE_FREE (__window->deferred[i].src);
+          SAFE_FREE (__window->deferred[i].dst);
+        }
 
-      deque_destroy (__window->unlink_list, deleter);
+      free (__window->deferred);
     }
 
   free (__window);
@@ -433,17 +469,194 @@ action_copy_eval_speed (copy_process_window_t *__proc_wnd)
 
       elapsed = t.tv_sec + t.tv_usec / 1000000;
 
-      eta = elapsed * ((double)bytes_total / bytes_copied - 1);
-      swprintf (msg, BUF_LEN (msg), L"%02ld:%02ld:%02ld", eta / 3600,
-                eta / 60 % 60, eta % 60);
-      w_text_set (__proc_wnd->eta_text, msg);
+      if (__proc_wnd->estimating && __proc_wnd->bytes_progress != NULL)
+        {
+          /* Total size is unknown yet */
+          w_text_set (__proc_wnd->eta_text, L"--:--:--");
+        }
+      else
+        {
+          eta = elapsed * ((double)bytes_total / bytes_copied - 1);
+          swprintf (msg, BUF_LEN (msg), L"%02ld:%02ld:%02ld", eta / 3600,
+                    eta / 60 % 60, eta % 60);
+          w_text_set (__proc_wnd->eta_text, msg);
+        }
     }
 
+  /* Totals could be changed since last evaluation */
+  action_copy_update_totals (__proc_wnd);
+
   /* Re-new stored information  */
   __proc_wnd->prev_timestamp = __proc_wnd->speed_timestamp;
   __proc_wnd->prev_copied = __proc_wnd->bytes_copied;
 }
 
+/**
+ * Set caption with count of copied and total bytes
+ *
+ * @param __proc_wnd - descriptor of a process window
+ */
+void
+action_copy_set_bytes_caption (copy_process_window_t *__proc_wnd)
+{
+  __u64_t copied, total;
+  wchar_t cs, ts, text[1024];
+
+  if (!__proc_wnd->bytes_digit)
+    {
+      return;
+    }
+
+  copied = fsizetohuman (__proc_wnd->bytes_copied, &cs);
+  cs = !cs ? 'b' : cs;
+
+  if (__proc_wnd->estimating)
+    {
+      swprintf (text, BUF_LEN (text), _(L"(%lld%c of estimating...)"),
+                copied, cs);
+    }
+  else
+    {
+      total = fsizetohuman (__proc_wnd->bytes_total, &ts);
+      ts = !ts ? 'b' : ts;
+
+      swprintf (text, BUF_LEN (text), _(L"(%lld%c of %lld%c)"),
+                copied, cs, total, ts);
+    }
+
+  w_text_set (__proc_wnd->bytes_digit, text);
+}
+
+/**
+ * Set caption with count of copied and total files
+ *
+ * @param __proc_wnd - descriptor of a process window
+ */
+void
+action_copy_set_count_caption (copy_process_window_t *__proc_wnd)
+{
+  wchar_t text[1024];
+
+  if (!__proc_wnd->count_digit)
+    {
+      return;
+    }
+
+  if (__proc_wnd->estimating)
+    {
+      swprintf (text, BUF_LEN (text), _(L"(%lld of estimating...)"),
+                __proc_wnd->files_copied);
+    }
+  else
+    {
+      swprintf (text, BUF_LEN (text), _(L"(%lld of %lld)"),
+                __proc_wnd->files_copied, __proc_wnd->files_total);
+    }
+
+  w_text_set (__proc_wnd->count_digit, text);
+}
+
+/**
+ * Update totals from counter which works in background
+ * Maximums of total progress bars grow while counter finds new items.
+ *
+ * @param __proc_wnd - descriptor of a process window
+ */
+void
+action_copy_update_totals (copy_process_window_t *__proc_wnd)
+{
+  action_shared_listing_t *listing = __proc_wnd->listing;
+  BOOL done;
+  __u64_t size;
+
+  if (!listing || !__proc_wnd->estimating)
+    {
+      return;
+    }
+
+  /* Totals are final if counter has been finished before reading them */
+  done = listing->done;
+  __sync_synchronize ();
+
+  size = listing->size;
+  __proc_wnd->bytes_total = size > __proc_wnd->bytes_reduced ?
+                              size - __proc_wnd->bytes_reduced : 0;
+  __proc_wnd->files_total = listing->count;
+
+  w_progress_set_max (__proc_wnd->bytes_progress, __proc_wnd->bytes_total);
+  w_progress_set_max (__proc_wnd->count_progress, __proc_wnd->files_total);
+
+  /* Positions could be ignored while they were greater than maximums */
+  w_progress_set_pos (__proc_wnd->bytes_progress, __proc_wnd->bytes_copied);
+  w_progress_set_pos (__proc_wnd->count_progress, __proc_wnd->files_copied);
+
+  if (done)
+    {
+      __proc_wnd->estimating = FALSE;
+    }
+
+  action_copy_set_bytes_caption (__proc_wnd);
+  action_copy_set_count_caption (__proc_wnd);
+}
+
+/**
+ * Show dialog to change limits of copying speed
+ * New limits are applied to running operation immediately
+ *
+ * @param __proc_wnd - descriptor of a process window
+ * @return modal result of dialog
+ */
+int
+action_copy_throttle_dialog (copy_process_window_t *__proc_wnd)
+{
+  w_window_t *wnd;
+  w_container_t *cnt;
+  w_edit_t *bytes, *files;
+  wchar_t buf[64], *end;
+  __u64_t value;
+  int res;
+
+  wnd = widget_create_window (NULL, _(L"Limit speed"), 0, 0, 40, 8,
+                              WMS_CENTERED);
+  cnt = WIDGET_CONTAINER (wnd);
+
+  widget_create_text (NULL, cnt, _(L"Kilobytes per second:"), 1, 1);
+  bytes = widget_create_edit (NULL, cnt, 1, 2, wnd->position.width - 2);
+  swprintf (buf, BUF_LEN (buf), L"%lld",
+            __proc_wnd->bytes_throttle.rate / 1024);
+  w_edit_set_text (bytes, buf);
+
+  widget_create_text (NULL, cnt, _(L"Files per second:"), 1, 3);
+  files = widget_create_edit (NULL, cnt, 1, 4, wnd->position.width - 2);
+  swprintf (buf, BUF_LEN (buf), L"%lld", __proc_wnd->files_throttle.rate);
+  w_edit_set_text (files, buf);
+
+  /* Create buttons */
+  action_create_ok_cancel_btns (wnd);
+
+  res = w_window_show_modal (wnd);
+
+  if (res == MR_OK)
+    {
+      /* Zero means no limit, invalid values are ignored */
+      value = wcstoull (w_edit_get_text (bytes), &end, 10);
+      if (!*end)
+        {
+          throttle_set_rate (&__proc_wnd->bytes_throttle, value * 1024);
+        }
+
+      value = wcstoull (w_edit_get_text (files), &end, 10);
+      if (!*end)
+        {
+          throttle_set_rate (&__proc_wnd->files_throttle, value);
+        }
+    }
+
+  widget_destroy (WIDGET (wnd));
+
+  return res;
+}
+
 /**
  * Show question when destination file already exists
  *
@@ -528,22 +741,35 @@ action_copy_exists_dialog (const wchar_t *__src, const wchar_t *__dst,
  * @param __src_list - list of source items
  * @param __count - count of items to be copied
  * @param __dst - default destination
- * @return MR_CANCEL if user canceled copying, MR_OK otherwise
+ * @param __options - options of operation. Used as default values
+ * and replaced with values from dialog.
+ * @return MR_CANCEL if user canceled copying, MR_COPY_ENQUEUE if
+ * operation should be added to queue, MR_OK otherwise
  */
 int
 action_copy_show_dialog (BOOL __move, const file_panel_item_t **__src_list,
-                         unsigned long __count, wchar_t **__dst)
+                         unsigned long __count, wchar_t **__dst,
+                         copy_options_t *__options)
 {
-  int res;
+  int res, middle;
   w_window_t *wnd;
-  w_edit_t *to;
+  w_edit_t *to, *manifest;
+  w_checkbox_t *cb_verify, *cb_sha256, *cb_physical = NULL;
   w_container_t *cnt;
   wchar_t msg[1024];
 
+  static action_button_t buttons[] = {
+    {L"_Ok",      MR_OK,           TRUE},
+    {L"En_queue", MR_COPY_ENQUEUE, FALSE},
+    {L"_Cancel",  MR_CANCEL,       FALSE}
+  };
+
   wnd = widget_create_window (NULL, __move?_(L"Move"):_(L"Copy"),
-                              0, 0, 50, 6, WMS_CENTERED);
+                              0, 0, 50, __move ? 10 : 11, WMS_CENTERED);
   cnt = WIDGET_CONTAINER (wnd);
 
+  middle = wnd->position.width / 2;
+
   /* Create caption for 'To' field */
   get_to_field_caption (__move, __src_list, __count, msg, BUF_LEN (msg));
   widget_create_text (NULL, cnt, msg, 1, 1);
@@ -553,14 +779,52 @@ action_copy_show_dialog (BOOL __move, const file_panel_item_t **__src_list,
   w_edit_set_text (to, *__dst);
   w_edit_set_shaded (to, TRUE);
 
+  /* Widgets for verification of copied files */
+  cb_verify = widget_create_checkbox (NULL, cnt, _(L"_Verify copied files"),
+                                      1, 4, __options->verify, 0);
+  cb_sha256 = widget_create_checkbox (NULL, cnt, _(L"Use SHA-_256"),
+                                      middle, 4,
+                                      __options->checksum == CHECKSUM_SHA256,
+                                      0);
+
+  widget_create_text (NULL, cnt, _(L"Write digests to manifest:"), 1, 5);
+  manifest = widget_create_edit (NULL, cnt, 1, 6, wnd->position.width - 2);
+  w_edit_set_text (manifest, __options->manifest ? __options->manifest : L"");
+  w_edit_set_shaded (manifest, TRUE);
+
+  if (!__move)
+    {
+      /* Reduce seeking over source disk */
+      cb_physical = widget_create_checkbox (NULL, cnt,
+                                            _(L"Copy files in _disk order"),
+                                            1, 7, __options->physical_order,
+                                            0);
+    }
+
   /* Create buttons */
-  action_create_ok_cancel_btns (wnd);
+  action_create_buttons (wnd, buttons, sizeof (buttons) /
+                                       sizeof (action_button_t), NULL);
 
   res = w_window_show_modal (wnd);
 
   /* Return values from dialog */
   *__dst = wcsdup (w_edit_get_text (to));
 
+  if (res == MR_OK || res == MR_COPY_ENQUEUE)
+    {
+      __options->verify = w_checkbox_get (cb_verify);
+      __options->checksum = w_checkbox_get (cb_sha256) ?
+                              CHECKSUM_SHA256 : CHECKSUM_CRC32C;
+
+      SAFE_FREE (__options->manifest);
+      __options->manifest = wcsdup (w_edit_get_text (manifest));
+
+      if (cb_physical)
+        {
+          __options->physical_order = w_checkbox_get (cb_physical);
+        }
+    }
+
   widget_destroy (WIDGET (wnd));
 
   return res;
@@ -23,6 +23,10 @@ BEGIN_HEADER
 #include <wchar.h>
 
 #include "deque.h"
+#include "hashmap.h"
+#include "checksum.h"
+#include "throttle.h"
+#include "action-unlink.h"
 
 /********
  * Constants
@@ -35,12 +39,48 @@ BEGIN_HEADER
 #define MR_COPY_SIZE_DIFFERS (MR_CUSTOM+4)
 #define MR_COPY_NONE         (MR_CUSTOM+5)
 
+/* Modal result for adding operation to queue */
+#define MR_COPY_ENQUEUE      (MR_CUSTOM+6)
+
 #define MOVE_STRATEGY_UNDEFINED (-1)
 
 /********
  * Type definitions
  */
 
+/* Options of copy/move operation, which could be changed in copy dialog */
+typedef struct
+{
+  /* Verify copied files by re-reading of targets */
+  BOOL verify;
+
+  /* Algorithm of checksum used for verification */
+  int checksum;
+
+  /* Name of file where digests of copied files will be written */
+  wchar_t *manifest;
+
+  /* Copy regular files in order of their places on source device */
+  BOOL physical_order;
+} copy_options_t;
+
+/* Regular file which copying is deferred */
+typedef struct
+{
+  /* URLs of source and target */
+  wchar_t *src;
+  wchar_t *dst;
+
+  /* Physical offset of file's data on device */
+  vfs_offset_t offset;
+
+  /* Number of file in order of walking */
+  unsigned long index;
+
+  /* Stat information of source */
+  action_listing_stat_t stat;
+} copy_deferred_file_t;
+
 typedef struct
 {
   /* Widget of window */
@@ -88,6 +128,15 @@ typedef struct
   __u64_t bytes_copied;
   __u64_t files_copied;
 
+  /* Listing shared with counter of totals */
+  action_shared_listing_t *listing;
+
+  /* Totals are still being counted */
+  BOOL estimating;
+
+  /* Count of bytes excluded from total while estimating */
+  __u64_t bytes_reduced;
+
   /* Timestamp for evaluting speed and ETA */
   timeval_t timestamp;
 
@@ -101,8 +150,31 @@ typedef struct
   BOOL move_strategy;
 
   /* List of items (files/directories) to be unlinked after moving */
-  deque_t *unlink_list;
-  __u64_t unlink_count;
+  action_unlink_list_t *unlink_list;
+
+  /* Data for verification of copied files */
+  BOOL verify;
+  int checksum;
+
+  /* Manifest file where digests of verified files are written */
+  vfs_file_t manifest;
+
+  /* Targets of already copied files with several hard links */
+  /* Keys are pairs (device, inode) of sources */
+  hashmap_t *hardlinks;
+
+  /* Limiters of copied bytes and file operations per second */
+  throttle_t bytes_throttle;
+  throttle_t files_throttle;
+
+  /* Regular files are deferred while tree is walked and */
+  /* copied afterwards in order of their places on device */
+  BOOL physical_order;
+
+  /* Deferred regular files */
+  copy_deferred_file_t *deferred;
+  unsigned long deferred_count;
+  unsigned long deferred_allocated;
 } copy_process_window_t;
 
 typedef struct
@@ -118,8 +190,7 @@ typedef struct
 
 /* Create file copy process window */
 copy_process_window_t*
-action_copy_create_proc_wnd (BOOL __move, BOOL __total_progress,
-                             const action_listing_t *__listing);
+action_copy_create_proc_wnd (BOOL __move, action_shared_listing_t *__listing);
 
 /* Destroy file copy process window */
 void
@@ -129,6 +200,22 @@ action_copy_destroy_proc_wnd (copy_process_window_t *__window);
 void
 action_copy_eval_speed (copy_process_window_t *__proc_wnd);
 
+/* Set caption with count of copied and total bytes */
+void
+action_copy_set_bytes_caption (copy_process_window_t *__proc_wnd);
+
+/* Set caption with count of copied and total files */
+void
+action_copy_set_count_caption (copy_process_window_t *__proc_wnd);
+
+/* Update totals from counter which works in background */
+void
+action_copy_update_totals (copy_process_window_t *__proc_wnd);
+
+/* Show dialog to change limits of copying speed */
+int
+action_copy_throttle_dialog (copy_process_window_t *__proc_wnd);
+
 /* Show question when destination file already exists */
 int
 action_copy_exists_dialog (const wchar_t *__src, const wchar_t *__dst,
@@ -138,7 +225,8 @@ action_copy_exists_dialog (const wchar_t *__src, const wchar_t *__dst,
 /* and other additional information */
 int
 action_copy_show_dialog (BOOL __move, const file_panel_item_t **__src_list,
-                         unsigned long __count, wchar_t **__dst);
+                         unsigned long __count, wchar_t **__dst,
+                         copy_options_t *__options);
 
 /* Create a post-move information window */
 post_move_window_t*
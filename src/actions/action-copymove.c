@@ -11,7 +11,11 @@
  */
 
 #include "actions.h"
+#include "action-copymove.h"
 #include "action-copymove-iface.h"
+#include "action-copyfile.h"
+#include "action-queue.h"
+#include "action-walk.h"
 #include "messages.h"
 #include "i18n.h"
 #include "dir.h"
@@ -21,21 +25,23 @@
 
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <wchar.h>
+#include <unistd.h>
 
 /********
  * Constants and other definitions
  */
 
-/* Size of buffer in copying operation */
-#define BUF_SIZE 65536
-
 /* Maximal size of content of symbolic link */
 #define MAX_SYMLINK_CONTENT 4096
 
 /* Period to evalute speed and ETA */
 #define EVAL_SPEED_PERIOD 1.05 * 1000 * 1000
 
+/* Maximal period of sleeping while waiting for throttle */
+#define THROTTLE_SLICE (50 * 1000)
+
 /**
  * Close file descriptors in copy_file()
  */
@@ -117,12 +123,6 @@
     (*__owr_all_rule): \
     (action_copy_exists_dialog (__src, __dst, _use_lstat)))
 
-/**
- * Save answer about overwriting all existent targets
- */
-#define SAVE_OWR_ALL_RULE(_a) \
-  if (__owr_all_rule) (*__owr_all_rule)=_a;
-
 /*
  * Unlink target file
  */
@@ -167,30 +167,22 @@
         int j; \
         for (j = i; j < count; j++) \
           { \
-            vfs_free_dirent (eps[i]); \
+            vfs_free_dirent (eps[j]); \
           } \
       } \
   }
 
 /* Update position of progress bar which shows total progress */
+/* Position is set absolutely because while totals are estimating */
+/* it could be greater than maximal position of bar */
 #define UPDATE_TOTAL_PROGRESS(_progress, _value) \
   { \
     if (__proc_wnd->_progress) \
       { \
-        w_progress_set_pos (__proc_wnd->_progress, \
-                            w_progress_get_pos (__proc_wnd->_progress) + \
-                                    _value); \
+        w_progress_set_pos (__proc_wnd->_progress, _value); \
       } \
   }
 
-/* Set caption of text widget, which shows a digital summary information */
-#define SET_DIGIT_CAPTION(_caption, _format, _args...) \
-  { \
-    wchar_t text[1024]; \
-    swprintf (text, BUF_LEN (text), _format, _args); \
-    w_text_set (__proc_wnd->_caption, text); \
-  }
-
 /* Evalute speed and ETA */
 #define EVAL_SPEED() \
   { \
@@ -199,23 +191,7 @@
   }
 
 #define SET_TOTAL_BYTES_CAPTION() \
-  { \
-    if (__proc_wnd->bytes_digit) \
-      { \
-        static wchar_t *format = NULL; \
-        if (format == NULL) \
-          { \
-            format = _(L"(%lld%c of %lld%c)"); \
-          } \
-        __u64_t copied, total; \
-        wchar_t cs, ts; \
-        copied = fsizetohuman (__proc_wnd->bytes_copied, &cs); \
-        total = fsizetohuman (__proc_wnd->bytes_total, &ts); \
-        cs = !cs ? 'b' : cs; \
-        ts = !ts ? 'b' : ts; \
-        SET_DIGIT_CAPTION (bytes_digit, format, copied, cs, total, ts); \
-    } \
-  }
+  action_copy_set_bytes_caption (__proc_wnd)
 
 /* Next buffer of file was copied */
 
@@ -247,15 +223,9 @@
 /* The while file was copied */
 #define FILE_COPIED() \
   { \
-    static wchar_t *format = NULL; \
-    if (format == NULL) \
-      { \
-        format = _(L"(%lld of %lld)"); \
-      } \
-    UPDATE_TOTAL_PROGRESS (count_progress, 1); \
     ++__proc_wnd->files_copied; \
-    SET_DIGIT_CAPTION (count_digit, format, \
-        __proc_wnd->files_copied, __proc_wnd->files_total); \
+    UPDATE_TOTAL_PROGRESS (count_progress, __proc_wnd->files_copied); \
+    action_copy_set_count_caption (__proc_wnd); \
     /* Evalute speed and ETA */ \
     EVAL_SPEED (); \
   }
@@ -272,12 +242,20 @@
           * TODO: Or bytes_total may be without bytes_progress? \
           */ \
          __proc_wnd->bytes_total -= _size; \
+         __proc_wnd->bytes_reduced += _size; \
  \
           /* Update information at text widget */ \
           SET_TOTAL_BYTES_CAPTION (); \
       } \
   }
 
+/* Take tokens from throttle and wait until they will be available */
+#define THROTTLE(_throttle, _count) \
+  { \
+    throttle_consume (&__proc_wnd->_throttle, _count); \
+    throttle_wait (&__proc_wnd->_throttle, __proc_wnd); \
+  }
+
 #define CAN_USE_RENAME() \
   (__proc_wnd->move && __proc_wnd->move_strategy == VFS_MS_RENAME)
 
@@ -301,6 +279,12 @@
 /* Recursively scanning before copying */
 static BOOL scan = TRUE;
 
+/* Options from copy dialog, which are remembered between operations */
+static copy_options_t copy_options = {FALSE, CHECKSUM_CRC32C, NULL, FALSE};
+
+/* Default limits of copying speed */
+static action_copy_throttle_t copy_throttle = {0, 0, FALSE};
+
 /********
  * Internal stuff
  */
@@ -322,49 +306,40 @@ get_real_dst (const wchar_t *__src, const wchar_t *__dst)
 }
 
 /**
- * Compare sizes of two files
- *
- * @param __src - URL of source file
- * @param __dst - URL of destination file
- * @return zero if sizes are equal, non-zero otherwise
- */
-static BOOL
-is_size_differs (const wchar_t *__src, const wchar_t *__dst)
-{
-  vfs_stat_t s1, s2;
-
-  vfs_lstat (__src, &s1);
-  vfs_lstat (__dst, &s2);
-
-  return s1.st_size != s2.st_size;
-}
-
-/**
- * Compare modification times of two files
+ * Decide what to do with existing target
  *
- * @param __src - URL of source file
- * @param __dst - URL of destination file
- * @return zero if source is older than destination, non-zero otherwise
+ * @param __src - URL of source
+ * @param __dst - URL of existing target
+ * @param __use_lstat - do not follow symbolic links
+ * @param __answer - answer of user or rule for overwriting
+ * @param __owr_all_rule - Rule for overwriting existing files
+ * @param __append - set to TRUE if source should be appended to target
+ * @return ACTION_OK if target should be replaced, ACTION_SKIP if item
+ * should be skipped, ACTION_ABORT if copying should be stopped
  */
-static BOOL
-is_newer (const wchar_t *__src, const wchar_t *__dst)
+static int
+resolve_existing (const wchar_t *__src, const wchar_t *__dst,
+                  BOOL __use_lstat, int __answer, int *__owr_all_rule,
+                  BOOL *__append)
 {
   vfs_stat_t s1, s2;
 
-  vfs_lstat (__src, &s1);
-  vfs_lstat (__dst, &s2);
+  memset (&s1, 0, sizeof (s1));
+  memset (&s2, 0, sizeof (s2));
 
-  if (s1.st_mtime > s2.st_mtime)
+  if (__use_lstat)
     {
-      return TRUE;
+      vfs_lstat (__src, &s1);
+      vfs_lstat (__dst, &s2);
     }
-
-  if (s1.st_mtime < s2.st_mtime)
+  else
     {
-      return FALSE;
+      vfs_stat (__src, &s1);
+      vfs_stat (__dst, &s2);
     }
 
-  return s1.st_mtime > s2.st_mtime;
+  return action_copyfile_resolve (__answer, &s1, &s2, __owr_all_rule,
+                                  __append);
 }
 
 /**
@@ -391,6 +366,34 @@ total_progress_available (const file_panel_item_t **__src_list,
   return S_ISDIR (__src_list[0]->file->lstat.st_mode);
 }
 
+/**
+ * Wait until debt of throttle will be paid off
+ * Queue of characters is processed while waiting, so limits
+ * could be changed or operation could be aborted.
+ *
+ * @param __throttle - throttle to wait for
+ * @param __proc_wnd - window with different current information
+ */
+static void
+throttle_wait (throttle_t *__throttle, copy_process_window_t *__proc_wnd)
+{
+  __u64_t delay;
+
+  while ((delay = throttle_delay (__throttle)) > 0)
+    {
+      usleep (MIN (delay, THROTTLE_SLICE));
+
+      /* Speed should be updated even if nothing is copying */
+      EVAL_SPEED ();
+
+      hook_call (L"switch-task-hook", NULL);
+      if (PROCESS_ABORTED ())
+        {
+          break;
+        }
+    }
+}
+
 /**
  * Makes a vfs_rename() operation
  *
@@ -421,6 +424,177 @@ make_rename (const wchar_t *__src, const wchar_t *__dst,
   return ACTION_OK;
 }
 
+/**
+ * Write digest of verified file to manifest
+ *
+ * Lines are written in tagged format `ALGORITHM (file) = digest',
+ * so manifest names algorithm of every digest. Manifests of SHA-256
+ * digests could be checked by sha256sum(1).
+ *
+ * @param __dst - URL of verified file
+ * @param __sum - finished checksum of file
+ * @param __proc_wnd - window with different current information
+ * @return zero on success, non-zero otherwise
+ */
+static int
+write_manifest (const wchar_t *__dst, const checksum_t *__sum,
+                copy_process_window_t *__proc_wnd)
+{
+  char hex[CHECKSUM_MAX_DIGEST_LEN * 2 + 1], *mbs_dst, *line;
+  const char *name;
+  size_t len, written = 0;
+  vfs_size_t count = 0;
+  int res = 0;
+
+  if (!__proc_wnd->manifest)
+    {
+      return ACTION_OK;
+    }
+
+  checksum_to_hex (__sum, hex, sizeof (hex));
+  name = checksum_name (__sum->type);
+
+  if (wcs2mbs (&mbs_dst, __dst) == (size_t)-1)
+    {
+      return ACTION_OK;
+    }
+
+  len = strlen (name) + strlen (mbs_dst) + strlen (hex) + 8;
+  line = malloc (len);
+  snprintf (line, len, "%s (%s) = %s\n", name, mbs_dst, hex);
+  len = strlen (line);
+
+  while (written < len)
+    {
+      ACTION_REPEAT (count = vfs_write (__proc_wnd->manifest,
+                                        line + written, len - written);
+                     res = count < 0 ? count : (count ? 0 : -EIO),
+                     action_error_retryskipcancel_ign,
+                     free (line);
+                     free (mbs_dst);
+                     return ACTION_CANCEL_TO_ABORT (__dlg_res_),
+                     _(L"Cannot write digest of \"%ls\" to manifest:\n%ls"),
+                     __dst, vfs_get_error (res));
+
+      if (res)
+        {
+          /* Error has been ignored */
+          break;
+        }
+
+      written += count;
+    }
+
+  free (line);
+  free (mbs_dst);
+
+  return ACTION_OK;
+}
+
+/**
+ * Re-read target file and compare it's checksum with checksum
+ * evaluated while copying
+ *
+ * @param __dst - URL of target file
+ * @param __sum - checksum of data which has been read from source
+ * @param __proc_wnd - window with different current information
+ * @return zero on success, non-zero otherwise
+ */
+static int
+verify_target (const wchar_t *__dst, checksum_t *__sum,
+               copy_process_window_t *__proc_wnd)
+{
+  action_copyfile_callbacks_t callbacks;
+  wchar_t msg[1024], fn[1024];
+  int res;
+
+  /* Ask user what to do with failed verification */
+  int verify_error (const wchar_t *__url, int __op, int __error,
+                    void *__user_data ATTR_UNUSED)
+    {
+      int answer;
+
+      switch (__op)
+        {
+        case ACF_REOPEN:
+          answer = action_error_retryskipcancel (_(L"Cannot open target "
+                                                   L"file \"%ls\":\n%ls"),
+                                                 __url,
+                                                 vfs_get_error (__error));
+          break;
+
+        case ACF_REREAD:
+          answer = action_error_retryskipcancel (_(L"Cannot read target "
+                                                   L"file \"%ls\":\n%ls"),
+                                                 __url,
+                                                 vfs_get_error (__error));
+          break;
+
+        default:
+          answer = action_error_retryskipcancel (_(L"Verification of "
+                                                   L"target file \"%ls\" "
+                                                   L"failed:\n%ls"),
+                                                 __url,
+                                                 _(L"Checksums of source "
+                                                   L"and target are "
+                                                   L"different"));
+          break;
+        }
+
+      /* Review user's answer */
+      switch (answer)
+        {
+        case MR_RETRY:
+          w_progress_set_pos (__proc_wnd->file_progress, 0);
+          return ACTION_OK;
+
+        case MR_SKIP:
+          return ACTION_SKIP;
+
+        default:
+          return ACTION_ABORT;
+        }
+    }
+
+  /* Display progress of verification */
+  int verify_progress (vfs_size_t __count, vfs_size_t __done,
+                       void *__user_data ATTR_UNUSED)
+    {
+      w_progress_set_pos (__proc_wnd->file_progress, __done);
+
+      /* Re-reading of target is limited by the same throttle */
+      THROTTLE (bytes_throttle, __count);
+
+      hook_call (L"switch-task-hook", NULL);
+
+      return PROCESS_ABORTED ();
+    }
+
+  COPY_SET_FN (__dst, target, L"Verify");
+  w_progress_set_pos (__proc_wnd->file_progress, 0);
+
+  callbacks.error = verify_error;
+  callbacks.progress = verify_progress;
+  callbacks.user_data = NULL;
+
+  res = action_copyfile_verify (__dst, __sum, &callbacks);
+
+  if (PROCESS_ABORTED ())
+    {
+      /* Reset skip flag */
+      __proc_wnd->skip = FALSE;
+
+      return __proc_wnd->abort ? ACTION_ABORT : ACTION_SKIP;
+    }
+
+  if (res != ACTION_OK)
+    {
+      return res;
+    }
+
+  return write_manifest (__dst, __sum, __proc_wnd);
+}
+
 /**
  * Copy a regular file
  *
@@ -428,63 +602,89 @@ make_rename (const wchar_t *__src, const wchar_t *__dst,
  * @param __dst - URL of destination
  * @param __owr_all_rule - Rule for overwriting existing files
  * @param __proc_wnd - window with different current information
+ * @param __complete - set to TRUE if target has been created from
+ * the whole content of source (could be NULL)
  * @return zero on success, non-zero otherwise
  */
 static int
 copy_regular_file (const wchar_t *__src, const wchar_t *__dst,
-                   int *__owr_all_rule, copy_process_window_t *__proc_wnd)
+                   int *__owr_all_rule, copy_process_window_t *__proc_wnd,
+                   BOOL *__complete)
 {
   vfs_file_t fd_src = 0, fd_dst = 0;
   int res, create_flags = O_WRONLY | O_CREAT | O_TRUNC;
   vfs_stat_t stat;
-  char buffer[BUF_SIZE];
-  vfs_size_t remain, copied, read, written;
+  vfs_size_t remain, copied;
   struct utimbuf times;
   __u64_t iteration = 0;
-  BOOL append = FALSE, target_exists = FALSE;
+  BOOL append = FALSE, target_exists = FALSE, verify;
+  checksum_t sum;
+  action_copyfile_callbacks_t callbacks;
+
+  /* Ask user what to do with failed reading or writing */
+  int copy_error (const wchar_t *__url, int __op, int __error,
+                  void *__user_data ATTR_UNUSED)
+    {
+      int answer;
+
+      if (__op == ACF_READ)
+        {
+          answer = action_error_retryskipcancel (_(L"Cannot read source "
+                                                   L"file \"%ls\":\n%ls"),
+                                                 __url,
+                                                 vfs_get_error (__error));
+        }
+      else
+        {
+          answer = action_error_retryskipcancel (_(L"Cannot write target "
+                                                   L"file \"%ls\":\n%ls"),
+                                                 __url,
+                                                 vfs_get_error (__error));
+        }
+
+      return answer == MR_RETRY ? ACTION_OK : answer;
+    }
+
+  /* Display progress of copying and wait if copying is too fast */
+  int copy_progress (vfs_size_t __count, vfs_size_t __done,
+                     void *__user_data ATTR_UNUSED)
+    {
+      copied = __done;
+      remain = stat.st_size - __done;
+
+      BUFFER_COPIED (__count);
+
+      /* Wait if copying is too fast */
+      THROTTLE (bytes_throttle, __count);
+
+      /* Process accumulated queue of characters */
+      hook_call (L"switch-task-hook", NULL);
+
+      ++iteration;
+
+      return PROCESS_ABORTED ();
+    }
+
+  if (__complete)
+    {
+      *__complete = FALSE;
+    }
 
   /* Check is file already exists */
   if (!vfs_stat (__dst, &stat))
     {
-      res = GET_OWR_RULE (FALSE);
       target_exists = TRUE;
 
-      switch (res)
+      res = resolve_existing (__src, __dst, FALSE, GET_OWR_RULE (FALSE),
+                              __owr_all_rule, &append);
+      if (res != ACTION_OK)
         {
-        case MR_NO:
-          return ACTION_SKIP;
-          break;
-        case MR_COPY_APPEND:
-          append = TRUE;
-          create_flags = O_WRONLY | O_APPEND;
-          break;
-
-        case MR_COPY_REPLACE_ALL:
-          SAVE_OWR_ALL_RULE (MR_COPY_REPLACE_ALL);
-          break;
-        case MR_COPY_UPDATE:
-          SAVE_OWR_ALL_RULE (MR_COPY_UPDATE);
-          if (!is_newer (__src, __dst))
-            {
-              return ACTION_SKIP;
-            }
-          break;
-        case MR_COPY_NONE:
-          SAVE_OWR_ALL_RULE (MR_COPY_NONE);
-          return ACTION_SKIP;
-          break;
-        case MR_COPY_SIZE_DIFFERS:
-          SAVE_OWR_ALL_RULE (MR_COPY_SIZE_DIFFERS);
-          if (!is_size_differs (__src, __dst))
-            {
-              return ACTION_SKIP;
-            }
-          break;
+          return res;
+        }
 
-        case MR_CANCEL:
-        case MR_ABORT:
-          return ACTION_ABORT;
-          break;
+      if (append)
+        {
+          create_flags = O_WRONLY | O_APPEND;
         }
     }
 
@@ -541,45 +741,40 @@ copy_regular_file (const wchar_t *__src, const wchar_t *__dst,
   copied = 0;
   w_progress_set_max (__proc_wnd->file_progress, remain);
 
-  /* Copy content of file */
-  while (remain > 0)
+  /*
+   * NOTE: When file is appended only tail of target came from source,
+   *       so there is nothing to compare with.
+   */
+  verify = __proc_wnd->verify && !append;
+  if (verify)
     {
-      /* Read buffer from source file */
-      COPY_FILE_REP (read = vfs_read (fd_src, buffer, MIN (remain, BUF_SIZE));
-                     res = read < 0 ? read : 0;,
-                     action_error_retryskipcancel,
-                     _(L"Cannot read source file \"%ls\":\n%ls"),
-                     __src, vfs_get_error (res));
-
-     /*
-      * NOTE: Reading of buffer and it's writting may be long.
-      *       So, need to process after both of this operations.
-      */
-
-      /* Process accumulated queue of characters */
-      COPY_PROCESS_QUEUE ();
-
-      /* Write buffer to destination file */
-      COPY_FILE_REP (written = vfs_write (fd_dst, buffer, read);
-                     res = written < 0 ? written : 0;,
-                     action_error_retryskipcancel,
-                     _(L"Cannot write target file \"%ls\":\n%ls"),
-                     __dst, vfs_get_error (res));
-
-      copied += written;
-      remain -= read;
+      checksum_init (&sum, __proc_wnd->checksum);
+    }
 
-      BUFFER_COPIED (written);
+  /* Copy content of file */
+  callbacks.error = copy_error;
+  callbacks.progress = copy_progress;
+  callbacks.user_data = NULL;
 
-      /* Process accumulated queue of characters */
-      COPY_PROCESS_QUEUE ();
+  res = action_copyfile_data (fd_src, fd_dst, __src, __dst, stat.st_size,
+                              verify ? &sum : NULL, &callbacks, &copied);
+  remain = stat.st_size - copied;
 
-      ++iteration;
+  /* User doesn't want to retry failed operation */
+  if (res != ACTION_OK && res != ACTION_ABORT)
+    {
+      COPY_RETERR (res);
     }
 
   /* Set access and modification time of new file */
   vfs_utime (__dst, &times);
 
+  /* Target should be flushed to the media before it will be re-read */
+  if (verify && remain == 0)
+    {
+      vfs_fsync (fd_dst);
+    }
+
   /* Close descriptors  */
   CLOSE_FD ();
 
@@ -608,6 +803,18 @@ copy_regular_file (const wchar_t *__src, const wchar_t *__dst,
         }
     }
 
+  /* Compare target with data read from source */
+  if (verify && remain == 0)
+    {
+      res = verify_target (__dst, &sum, __proc_wnd);
+
+      /* Source of unverified file shouldn't be unlinked */
+      if (res != ACTION_OK)
+        {
+          return res;
+        }
+    }
+
   /* Unlink source file only if file will be moved, it will moved by */
   /* copy+unlink strategy and it was _fully_ moved */
   if (__proc_wnd->move && remain == 0 &&
@@ -617,13 +824,66 @@ copy_regular_file (const wchar_t *__src, const wchar_t *__dst,
       /* This may be helpful if user canceled moving */
       /* Just add this file to list of items to be unlinked */
 
-      deque_push_back (__proc_wnd->unlink_list, wcsdup (__src));
-      ++__proc_wnd->unlink_count;
+      action_unlink_list_add (__proc_wnd->unlink_list, __src, FALSE);
+    }
+
+  /* Appended target or target which has been kept incomplete */
+  /* differs from source */
+  if (__complete)
+    {
+      *__complete = !append && remain == 0;
     }
 
   return ACTION_OK;
 }
 
+/**
+ * Copy a regular file which has several hard links
+ *
+ * The first name of such file is copied as usual, all other names
+ * are created as hard links to the first target.
+ *
+ * @param __src - URL of source
+ * @param __dst - URL of destination
+ * @param __stat - status of source
+ * @param __owr_all_rule - Rule for overwriting existing files
+ * @param __proc_wnd - window with different current information
+ * @return zero on success, non-zero otherwise
+ */
+static int
+copy_hardlinked_file (const wchar_t *__src, const wchar_t *__dst,
+                      const vfs_stat_t *__stat, int *__owr_all_rule,
+                      copy_process_window_t *__proc_wnd)
+{
+  int res;
+  BOOL complete;
+
+  /* Another name of this file may have been already copied */
+  if (action_copyfile_link (&__proc_wnd->hardlinks, __stat, __dst))
+    {
+      /* Content of file will not be copied */
+      REDUCE_TOTAL_BYTES (__stat->st_size);
+
+      if (__proc_wnd->move && __proc_wnd->move_strategy == VFS_MS_COPY)
+        {
+          action_unlink_list_add (__proc_wnd->unlink_list, __src, FALSE);
+        }
+
+      return ACTION_OK;
+    }
+
+  res = copy_regular_file (__src, __dst, __owr_all_rule, __proc_wnd,
+                           &complete);
+
+  /* Other names are linked only to exact copy of file */
+  if (res == ACTION_OK && complete)
+    {
+      action_copyfile_remember_link (&__proc_wnd->hardlinks, __stat, __dst);
+    }
+
+  return res;
+}
+
 /**
  * Copy a symbolic link
  *
@@ -640,6 +900,7 @@ copy_symlink (const wchar_t *__src, const wchar_t *__dst,
   vfs_stat_t stat;
   wchar_t content[MAX_SYMLINK_CONTENT];
   int res;
+  BOOL append;
 
   /* Read content of source symbolic link */
   vfs_readlink (__src, content, BUF_LEN (content));
@@ -669,53 +930,18 @@ copy_symlink (const wchar_t *__src, const wchar_t *__dst,
             }
 
           /* Symlinks are different or target is not a symlink */
-          res = GET_OWR_RULE (TRUE);
-
-          /* Review user's answer */
-          switch (res)
+          res = resolve_existing (__src, __dst, TRUE, GET_OWR_RULE (TRUE),
+                                  __owr_all_rule, &append);
+          if (res != ACTION_OK)
             {
-            case MR_YES:
-            case MR_COPY_APPEND:
-              /*
-               * NOTE: Appending of symlinks is equal
-               *       to it's replacement.
-               */
-              UNLINK_TARGET ();
-              break;
-
-            case MR_NO:
-              return ACTION_SKIP;
-
-            case MR_COPY_REPLACE_ALL:
-              SAVE_OWR_ALL_RULE (MR_COPY_REPLACE_ALL);
-              UNLINK_TARGET ();
-              break;
-
-            case MR_COPY_UPDATE:
-              SAVE_OWR_ALL_RULE (MR_COPY_UPDATE);
-              if (!is_newer (__src, __dst))
-                {
-                  return ACTION_SKIP;
-                }
-              UNLINK_TARGET ();
-              break;
-
-            case MR_COPY_NONE:
-              SAVE_OWR_ALL_RULE (MR_COPY_NONE);
-              return ACTION_SKIP;
-
-            case MR_COPY_SIZE_DIFFERS:
-              SAVE_OWR_ALL_RULE (MR_COPY_SIZE_DIFFERS);
-              if (!is_size_differs (__src, __dst))
-                {
-                  return ACTION_SKIP;
-                }
-              UNLINK_TARGET ();
-              break;
-
-            case MR_ABORT:
-              return ACTION_ABORT;
+              return res;
             }
+
+          /*
+           * NOTE: Appending of symlinks is equal
+           *       to it's replacement.
+           */
+          UNLINK_TARGET ();
         }
       else
         {
@@ -766,8 +992,7 @@ copy_symlink (const wchar_t *__src, const wchar_t *__dst,
         {
           /* Symlinks (like files) shouldn't be unlimked immediately */
 
-          deque_push_back (__proc_wnd->unlink_list, wcsdup (__src));
-          ++__proc_wnd->unlink_count;
+          action_unlink_list_add (__proc_wnd->unlink_list, __src, FALSE);
         }
     }
 
@@ -789,6 +1014,7 @@ copy_special_file (const wchar_t *__src, const wchar_t *__dst,
 {
   vfs_stat_t stat, dst_stat;
   int res;
+  BOOL append;
 
   /* Stat source file */
   ACTION_REPEAT (res = vfs_stat (__src, &stat), action_error_retryskipcancel,
@@ -804,56 +1030,19 @@ copy_special_file (const wchar_t *__src, const wchar_t *__dst,
           /* Check if file already exists */
           if ((res = vfs_stat (__dst, &dst_stat)) == VFS_OK)
             {
-              res = GET_OWR_RULE (FALSE);
-
-              /* Review user's answer */
-              switch (res)
+              res = resolve_existing (__src, __dst, FALSE,
+                                      GET_OWR_RULE (FALSE), __owr_all_rule,
+                                      &append);
+              if (res != ACTION_OK)
                 {
-                case MR_YES:
-                case MR_COPY_APPEND:
-                  /*
-                   * NOTE: Appending of special files is equal
-                   *       to it's replacement.
-                   */
-                  UNLINK_TARGET ();
-                  break;
-
-                case MR_NO:
-                  return ACTION_SKIP;
-
-                case MR_COPY_REPLACE_ALL:
-                  SAVE_OWR_ALL_RULE (MR_COPY_REPLACE_ALL);
-                  UNLINK_TARGET ();
-                  break;
-
-                case MR_COPY_UPDATE:
-                  SAVE_OWR_ALL_RULE (MR_COPY_UPDATE);
-                  if (!is_newer (__src, __dst))
-                    {
-                      return ACTION_SKIP;
-                    }
-                  UNLINK_TARGET ();
-                  break;
-
-                case MR_COPY_NONE:
-                  SAVE_OWR_ALL_RULE (MR_COPY_NONE);
-                  return ACTION_SKIP;
-
-                case MR_COPY_SIZE_DIFFERS:
-                  SAVE_OWR_ALL_RULE (MR_COPY_SIZE_DIFFERS);
-                  /*
-                   * TODO: But does it work properly?
-                   */
-                  if (!is_size_differs (__src, __dst))
-                    {
-                      return ACTION_SKIP;
-                    }
-                  UNLINK_TARGET ();
-                  break;
-
-                case MR_ABORT:
-                  return ACTION_ABORT;
+                  return res;
                 }
+
+              /*
+               * NOTE: Appending of special files is equal
+               *       to it's replacement.
+               */
+              UNLINK_TARGET ();
             }
           else
             {
@@ -906,8 +1095,7 @@ copy_special_file (const wchar_t *__src, const wchar_t *__dst,
               /* Special files (like regular files) shouldn't be */
               /* unlimked immediately */
 
-              deque_push_back (__proc_wnd->unlink_list, wcsdup (__src));
-              ++__proc_wnd->unlink_count;
+              action_unlink_list_add (__proc_wnd->unlink_list, __src, FALSE);
             }
         }
     }
@@ -925,17 +1113,58 @@ copy_special_file (const wchar_t *__src, const wchar_t *__dst,
   return ACTION_OK;
 }
 
+/**
+ * Defer copying of regular file until the whole tree is walked
+ *
+ * @param __src - URL of source
+ * @param __dst - URL of destination
+ * @param __stat - stat information of source
+ * @param __proc_wnd - window with different current information
+ */
+static void
+defer_file (const wchar_t *__src, const wchar_t *__dst,
+            const vfs_stat_t *__stat, copy_process_window_t *__proc_wnd)
+{
+  copy_deferred_file_t *file;
+
+  if (__proc_wnd->deferred_count == __proc_wnd->deferred_allocated)
+    {
+      __proc_wnd->deferred_allocated =
+        MAX (__proc_wnd->deferred_allocated * 2, 256);
+      __proc_wnd->deferred = realloc (__proc_wnd->deferred,
+                                      __proc_wnd->deferred_allocated *
+                                        sizeof (copy_deferred_file_t));
+    }
+
+  file = &__proc_wnd->deferred[__proc_wnd->deferred_count];
+
+  file->src = wcsdup (__src);
+  file->dst = wcsdup (__dst);
+  file->index = __proc_wnd->deferred_count;
+  action_listing_stat_set (&file->stat, __stat);
+
+  /* Files which place is unknown are copied last in order of walking */
+  if (vfs_physical_offset (__src, &file->offset))
+    {
+      file->offset = LLONG_MAX;
+    }
+
+  ++__proc_wnd->deferred_count;
+}
+
 /**
  * Copy a single file
  *
  * @param __src - URL of source
  * @param __dst - URL of destination
+ * @param __rec - stat information of source stored in listing (may be NULL)
  * @param __owr_all_rule - Rule for overwriting existing files
  * @param __proc_wnd - window with different current information
  * @return zero on success, non-zero otherwise
  */
 static int
 copy_file (const wchar_t *__src, const wchar_t *__dst,
+           const action_listing_stat_t *__rec,
            int *__owr_all_rule, copy_process_window_t *__proc_wnd)
 {
   int res;
@@ -956,14 +1185,37 @@ copy_file (const wchar_t *__src, const wchar_t *__dst,
   CHECK_THE_SAME ();
 
   /* Stat source file to determine it's type */
-  ACTION_REPEAT (res = vfs_lstat (__src, &stat), action_error_retryskipcancel,
-                 return ACTION_CANCEL_TO_ABORT (__dlg_res_),
-                 _(L"Cannot stat source file \"%ls\":\n%ls"),
-                 __src, vfs_get_error (res));
+  /* Listing already knows it, source is re-validated when it is opened */
+  if (!action_listing_stat_get (__rec, &stat))
+    {
+      ACTION_REPEAT (res = vfs_lstat (__src, &stat),
+                     action_error_retryskipcancel,
+                     return ACTION_CANCEL_TO_ABORT (__dlg_res_),
+                     _(L"Cannot stat source file \"%ls\":\n%ls"),
+                     __src, vfs_get_error (res));
+    }
+
+  if (S_ISREG (stat.st_mode) && __proc_wnd->physical_order)
+    {
+      /* Directories are created now, but files are copied */
+      /* when places of all of them on device are known */
+      defer_file (__src, __dst, &stat, __proc_wnd);
+      return ACTION_OK;
+    }
 
   if (S_ISREG (stat.st_mode))
     {
-      res = copy_regular_file (__src, __dst, __owr_all_rule, __proc_wnd);
+      if (stat.st_nlink > 1 && !CAN_USE_RENAME ())
+        {
+          /* Preserve hard links between copied files */
+          res = copy_hardlinked_file (__src, __dst, &stat,
+                                      __owr_all_rule, __proc_wnd);
+        }
+      else
+        {
+          res = copy_regular_file (__src, __dst, __owr_all_rule, __proc_wnd,
+                                   NULL);
+        }
       FILE_COPIED ();
     }
   else
@@ -978,6 +1230,9 @@ copy_file (const wchar_t *__src, const wchar_t *__dst,
       FILE_COPIED ();
     }
 
+  /* Wait if too many files are copying per second */
+  THROTTLE (files_throttle, 1);
+
   /* Process accamulated queue of characters */
   hook_call (L"switch-task-hook", NULL);
   if (__proc_wnd->abort)
@@ -988,6 +1243,60 @@ copy_file (const wchar_t *__src, const wchar_t *__dst,
   return res;
 }
 
+/**
+ * Copy deferred regular files in order of their places on device
+ *
+ * @param __owr_all_rule - Rule for overwriting existing files
+ * @param __proc_wnd - window with different current information
+ * @return zero on success, non-zero otherwise
+ */
+static int
+copy_deferred_files (int *__owr_all_rule, copy_process_window_t *__proc_wnd)
+{
+  unsigned long i;
+  copy_deferred_file_t *file;
+  int res = ACTION_OK;
+
+  /* Compare files by their places on device */
+  int compar_offset (const void *__a, const void *__b)
+    {
+      const copy_deferred_file_t *a = __a, *b = __b;
+
+      if (a->offset != b->offset)
+        {
+          return a->offset < b->offset ? -1 : 1;
+        }
+
+      /* Keep order of walking for files without known place */
+      return a->index < b->index ? -1 : a->index > b->index;
+    }
+
+  qsort (__proc_wnd->deferred, __proc_wnd->deferred_count,
+         sizeof (copy_deferred_file_t), compar_offset);
+
+  /* Files are copied for real now */
+  __proc_wnd->physical_order = FALSE;
+
+  for (i = 0; i < __proc_wnd->deferred_count; ++i)
+    {
+      file = &__proc_wnd->deferred[i];
+
+      res = copy_file (file->src, file->dst, &file->stat,
+                       __owr_all_rule, __proc_wnd);
+
+      SAFE_FREE (file->src);
+      SAFE_FREE (file->dst);
+
+      if (res == ACTION_ABORT || __proc_wnd->abort)
+        {
+          res = ACTION_ABORT;
+          break;
+        }
+    }
+
+  return res;
+}
+
 /**
  * Recursively copy directory
  *
@@ -995,20 +1304,19 @@ copy_file (const wchar_t *__src, const wchar_t *__dst,
  * @param __dst - URL of destination
  * @param __owr_all_rule - Rule for overwriting existing files
  * @param __proc_wnd - window with different current information
- * @param __tree - prescanned tree
  * @return zero on success, non-zero otherwise
  */
 static int
 copy_dir (const wchar_t *__src, const wchar_t *__dst,
-          int *__owr_all_rule, copy_process_window_t *__proc_wnd,
-          const action_listing_tree_t *__tree)
+          int *__owr_all_rule, copy_process_window_t *__proc_wnd)
 {
   vfs_dirent_t **eps = NULL;
+  action_shared_dir_t *shared = NULL;
   vfs_stat_t stat;
   int count, i, res, global_res, ignored_items = 0;
   wchar_t *full_name, *full_dst;
   size_t fn_len, dst_len;
-  BOOL prescanned = FALSE;
+  BOOL prescanned = FALSE, is_dir;
   int move_strategy = MOVE_STRATEGY_UNDEFINED;
 
   /* Check is file copying to itself */
@@ -1056,24 +1364,33 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
                 __src, vfs_get_error (res));
 
   /* Get listing of a directory */
-  if (__tree)
+  if (__proc_wnd->listing)
     {
-      /* Get listing from prescanned data */
-      count = __tree->count;
-      eps = __tree->dirent;
+      /* Listing is shared with counter of totals, so */
+      /* directory is scanned only once */
+      COPY_DIR_REP (shared = action_shared_listing_scandir (
+                                 __proc_wnd->listing, __src, &res);
+                    if (shared) res = 0;,
+                    action_error_retryskipcancel,
+                    _(L"Cannot listing source directory \"%ls\":\n%ls"),
+                    __src, vfs_get_error (res));
+
+      count = shared->count;
+      eps = shared->dirent;
 
       prescanned = TRUE;
 
       /*
-       * NOTE: If we use prescanned data, we shouldn't free()
-       *       directory entries from it. They will be freed while
-       *       the whole prescanned tree will be destroying
+       * NOTE: If we use shared listing, we shouldn't free()
+       *       directory entries from it. They will be freed when
+       *       all passes will release this listing
        */
     }
   else
     {
       /* Scan directory */
-      COPY_DIR_REP (count = vfs_scandir (__src, &eps, 0, vfs_alphasort);
+      COPY_DIR_REP (count = vfs_scandir (__src, &eps, 0,
+                                        action_walk_compar ());
                     res = count < 0 ? count : 0,
                     action_error_retryskipcancel,
                     _(L"Cannot listing source directory \"%ls\":\n%ls"),
@@ -1092,6 +1409,9 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
                 _(L"Cannot create target directory \"%ls\":\n%ls"),
                 __dst, vfs_get_error (res));
 
+  /* Creation of directory is a file operation too */
+  THROTTLE (files_throttle, 1);
+
   /* Set mode of destination directory */
   COPY_DIR_REP (res = vfs_chmod (__dst, stat.st_mode),
                 action_error_retryskipcancel,
@@ -1118,7 +1438,16 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
                     eps[i]->name);
 
           /* Make copying/moving */
-          if (!isdir (full_name, FALSE))
+          if (prescanned && shared->stat[i].mode)
+            {
+              is_dir = S_ISDIR (shared->stat[i].mode);
+            }
+          else
+            {
+              is_dir = isdir (full_name, FALSE);
+            }
+
+          if (!is_dir)
             {
               int s_strategy;
 
@@ -1142,6 +1471,7 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
                 }
 
               res = copy_file (full_name, full_dst,
+                               prescanned ? &shared->stat[i] : NULL,
                                __owr_all_rule, __proc_wnd);
 
               if (__proc_wnd->move)
@@ -1152,8 +1482,7 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
           else
             {
               res = copy_dir (full_name, full_dst, __owr_all_rule,
-                             __proc_wnd,
-                             prescanned ? __tree->items[i] : NULL);
+                              __proc_wnd);
 
             }
 
@@ -1188,7 +1517,7 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
           break;
         }
 
-      if (prescanned)
+      if (!prescanned)
         {
           vfs_free_dirent (eps[i]);
         }
@@ -1201,8 +1530,7 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
 
       if (global_res == ACTION_OK && ignored_items == 0)
         {
-          deque_push_back (__proc_wnd->unlink_list, wcsdup (__src));
-          ++__proc_wnd->unlink_count;
+          action_unlink_list_add (__proc_wnd->unlink_list, __src, TRUE);
         }
     }
 
@@ -1211,6 +1539,10 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
     {
       SAFE_FREE (eps);
     }
+  else
+    {
+      action_shared_listing_release (__proc_wnd->listing, shared);
+    }
 
   free (full_name);
   free (full_dst);
@@ -1225,14 +1557,11 @@ copy_dir (const wchar_t *__src, const wchar_t *__dst,
  * @param __dst - full destination URL
  * @param __owr_all_rule - Rule for overwriting existing files
  * @param __proc_wnd - window with different current information
- * @param __tree - prescanned tree of items. This tree will be
- * send to copy_dir().
  * @return zero on success, non-zero otherwise
  */
 static int
 make_copy_iter (const wchar_t *__src, const wchar_t *__dst,
-                int *__owr_all_rule, copy_process_window_t *__proc_wnd,
-                const action_listing_tree_t *__tree)
+                int *__owr_all_rule, copy_process_window_t *__proc_wnd)
 {
   int res = ACTION_ERR;
   wchar_t *rdst = NULL; /* Real destination */
@@ -1273,7 +1602,7 @@ make_copy_iter (const wchar_t *__src, const wchar_t *__dst,
         }
 
       /* Copy directory */
-      res = copy_dir (__src, rdst, __owr_all_rule, __proc_wnd, __tree);
+      res = copy_dir (__src, rdst, __owr_all_rule, __proc_wnd);
     }
   else
     {
@@ -1288,7 +1617,7 @@ make_copy_iter (const wchar_t *__src, const wchar_t *__dst,
         }
 
       /* Copy/move single file */
-      res = copy_file (__src, rdst, __owr_all_rule, __proc_wnd);
+      res = copy_file (__src, rdst, NULL, __owr_all_rule, __proc_wnd);
     }
 
   SAFE_FREE (rdst);
@@ -1296,6 +1625,67 @@ make_copy_iter (const wchar_t *__src, const wchar_t *__dst,
   return res;
 }
 
+/**
+ * Handle error of deferred unlinking of item
+ * Item is tried once more by full name, so actual error is displayed.
+ *
+ * @param __url - URL of item which couldn't be unlinked
+ * @param __is_dir - item is a directory
+ * @param __error - code of error
+ * @param __wnd - post-move window
+ * @return ACTION_ABORT if user canceled unlinking, ACTION_OK otherwise
+ */
+static int
+unlink_error (const wchar_t *__url, BOOL __is_dir, int __error ATTR_UNUSED,
+              post_move_window_t *__wnd ATTR_UNUSED)
+{
+  wchar_t *format;
+  int res;
+  int (*proc) (const wchar_t *);
+
+  /* Get format for error and unlinking function */
+  if (__is_dir)
+    {
+      format = _(L"Cannot unlink source directory \"%ls\":\n%ls");
+      proc = vfs_rmdir;
+    }
+  else
+    {
+      format = _(L"Cannot unlink source file \"%ls\":\n%ls");
+      proc = vfs_unlink;
+    }
+
+  ACTION_REPEAT (res = proc (__url), action_error_retryskipcancel_ign,
+                 return ACTION_CANCEL_TO_ABORT (__dlg_res_),
+                 format, __url, vfs_get_error (res));
+
+  return ACTION_OK;
+}
+
+/**
+ * Display progress of deferred unlinking
+ *
+ * @param __dir - directory of last unlinked batch
+ * @param __done - count of unlinked items
+ * @param __wnd - post-move window
+ */
+static void
+unlink_progress (const wchar_t *__dir, unsigned long __done,
+                 post_move_window_t *__wnd)
+{
+  wchar_t fit_path[1024];
+  int fit_width;
+
+  fit_width = __wnd->window->position.width - __wnd->file->position.x - 1;
+
+  fit_dirname (__dir, MIN (fit_width, BUF_LEN (fit_path)), fit_path);
+  w_text_set (__wnd->file, fit_path);
+
+  w_progress_set_pos (__wnd->progress, __done);
+
+  hook_call (L"switch-task-hook", NULL);
+}
+
 /**
  * Unlink all items from list of items to be unlinked
  *
@@ -1306,11 +1696,7 @@ static int
 make_unlink (copy_process_window_t *__proc_wnd)
 {
   post_move_window_t *wnd;
-  wchar_t *path, fit_path[1024], *format;
-  int fit_width, res;
-  __int64_t count = 0;
-
-  int (*proc) (const wchar_t *);
+  int res;
 
   if (!__proc_wnd || !__proc_wnd->unlink_list)
     {
@@ -1324,42 +1710,67 @@ make_unlink (copy_process_window_t *__proc_wnd)
   wnd = action_post_move_create_window ();
   w_window_show (wnd->window);
 
-  w_progress_set_max (wnd->progress, __proc_wnd->unlink_count);
-
-  fit_width = wnd->window->position.width - wnd->file->position.x - 1;
-
-  /* Unlink each item from list */
-  deque_foreach (__proc_wnd->unlink_list, path);
-    fit_dirname (path, fit_width, fit_path);
-    w_text_set (wnd->file, fit_path);
-
-    /* Get format for error and unlinking function */
-    if (isdir (path, FALSE))
-      {
-        format = _(L"Cannot unlink source directory \"%ls\":\n%ls");
-        proc = vfs_rmdir;
-      }
-    else
-      {
-        format = _(L"Cannot unlink source file \"%ls\":\n%ls");
-        proc = vfs_unlink;
-      }
-
-    ACTION_REPEAT (res = proc (path), action_error_retryskipcancel_ign,
-                   action_post_move_desstroy_window (wnd);
-                   if (ACTION_CANCEL_TO_ABORT (__dlg_res_) == ACTION_ABORT)
-                     {
-                       return ACTION_ABORT;
-                     },
-                   format, path, vfs_get_error (res))
-
-    w_progress_set_pos (wnd->progress, ++count);
-  deque_foreach_done
+  w_progress_set_max (wnd->progress, __proc_wnd->unlink_list->count);
+
+  /* Items are unlinked in batches relative to their directories */
+  res = action_unlink_list_run (__proc_wnd->unlink_list,
+                                (action_unlink_error_proc)unlink_error,
+                                (action_unlink_progress_proc)unlink_progress,
+                                wnd);
 
    /* Free used memory */
   action_post_move_desstroy_window (wnd);
 
-  return ACTION_OK;
+  return res;
+}
+
+/**
+ * Check that items are not copied to themselves before queuing
+ * Destinations are expanded in the same way as queue expands them.
+ *
+ * @param __base_dir - base directory
+ * @param __src_list - list of source items
+ * @param __count - count of items
+ * @param __dst - absolute URL of destination
+ * @return zero if some item would be copied to itself, non-zero otherwise
+ */
+static BOOL
+check_queued_targets (const wchar_t *__base_dir,
+                      const file_panel_item_t **__src_list,
+                      unsigned long __count, const wchar_t *__dst)
+{
+  unsigned long i;
+  const wchar_t *name;
+  wchar_t *src, *dst, *rdst, msg[4096];
+  BOOL res = TRUE;
+
+  for (i = 0; i < __count && res; ++i)
+    {
+      name = __src_list[i]->file->name;
+
+      src = wcdircatsubdir (__base_dir, name);
+      dst = pattern_rename (__dst, name);
+
+      if (isdir (dst, TRUE))
+        {
+          rdst = wcdircatsubdir (dst, name);
+          free (dst);
+          dst = rdst;
+        }
+
+      if (action_copyfile_to_itself (src, dst))
+        {
+          swprintf (msg, BUF_LEN (msg), _(L"Cannot copy \"%ls\" to itself"),
+                    src);
+          MESSAGE_ERROR (msg);
+          res = FALSE;
+        }
+
+      free (src);
+      free (dst);
+    }
+
+  return res;
 }
 
 /**
@@ -1379,25 +1790,22 @@ make_copy (BOOL __move, const wchar_t *__base_dir,
            const wchar_t *__dst)
 {
   copy_process_window_t *wnd;
-  int res, owr_all_rule = 0;
-  wchar_t *dst, *src, *dummy = (wchar_t*) __dst, *item_name;
-  unsigned long i, j, count = 0, source_count;
+  vfs_file_t manifest = NULL;
+  int res, owr_all_rule = 0, io_priority = 0;
+  BOOL io_priority_changed = FALSE;
+  wchar_t *dst, *src, *dummy = (wchar_t*) __dst;
+  unsigned long i, count = 0;
   file_panel_item_t *item;
-  BOOL scan_allowed;
-  action_listing_t listing;
+  action_shared_listing_t *listing = NULL;
 
   if (!__base_dir || !*__src_list || !__dst)
     {
       return 0;
     }
 
-  memset (&listing, 0, sizeof (listing));
-
   /* Get customized settings from user */
-  res = action_copy_show_dialog (__move, __src_list, __count, &dummy);
-
-  /* Count of source items */
-  source_count = __count;
+  res = action_copy_show_dialog (__move, __src_list, __count, &dummy,
+                                 &copy_options);
 
   /*
    * TODO: Should we normalize destination?
@@ -1410,79 +1818,95 @@ make_copy (BOOL __move, const wchar_t *__base_dir,
       return 0;
     }
 
-  scan_allowed = total_progress_available (__src_list, __count);
+  /* Get absolute destination path */
+  dst = vfs_abs_path (dummy, __base_dir);
+  free (dummy);
 
-  /* Get listing of items */
-  if (scan_allowed)
+  /* Operation will be made in background */
+  if (res == MR_COPY_ENQUEUE)
     {
-      ACTION_REPEAT (res = action_get_listing (__base_dir, __src_list,
-                                               __count, &listing,
-                                               __move, FALSE);
-                     if (res == ACTION_ABORT)
-                       {
-                         return 0;
-                       },
-                     action_error_retryskipcancel_ign,
-                     /* There was an error getting full listing of items */
-                     /* If user will answer Cancel to error dialog, none */
-                     /* of files will be copied/moved */
-                     /* But if user will answer Ignore prescanning will be */
-                     /* disabled and some items will be copied/moved */
-                     return 0,
-                     _(L"Cannot get listing of items:\n%ls"),
-                     vfs_get_error (res));
+      action_queue_options_t options;
 
-      if (res)
-        {
-          /* res may be non-zero here only in case */
-          /* user hit an Ignore button */
-          scan_allowed = FALSE;
-        }
-      else
+      if (!check_queued_targets (__base_dir, __src_list, __count, dst))
         {
-          /* User can ignore some subtrees, so we need */
-          /* get count of source elements from prescanned data */
-          source_count = listing.tree->count;
+          free (dst);
+          return 0;
         }
+
+      /*
+       * NOTE: Manifest is written by interactive operation only,
+       *       background job verifies targets without it.
+       */
+      options.verify = copy_options.verify;
+      options.checksum = copy_options.checksum;
+      options.bytes_rate = copy_throttle.bytes_rate;
+      options.files_rate = copy_throttle.files_rate;
+      options.idle_priority = copy_throttle.idle_priority;
+
+      action_queue_add (__move ? AQ_MOVE : AQ_COPY, __base_dir,
+                        __src_list, __count, dst, &options);
+      free (dst);
+      return 0;
     }
 
-  /* Get absolute destination path */
-  dst = vfs_abs_path (dummy, __base_dir);
-  free (dummy);
+  /* Create manifest for digests of verified files */
+  if (copy_options.verify && copy_options.manifest && *copy_options.manifest)
+    {
+      wchar_t *manifest_url = vfs_abs_path (copy_options.manifest,
+                                            __base_dir);
+
+      ACTION_REPEAT (manifest = vfs_open (manifest_url,
+                                          O_WRONLY | O_CREAT | O_TRUNC,
+                                          &res, 0644),
+                     action_error_retryskipcancel_ign,
+                     free (manifest_url);
+                     free (dst);
+                     return 0,
+                     _(L"Cannot create manifest file \"%ls\":\n%ls"),
+                     manifest_url, vfs_get_error (res));
+
+      free (manifest_url);
+    }
+
+  /* Count totals in background while items are being copied */
+  if (total_progress_available (__src_list, __count))
+    {
+      listing = action_shared_listing_start (__base_dir, __src_list,
+                                             __count, FALSE);
+    }
+
+  wnd = action_copy_create_proc_wnd (__move, listing);
 
-  wnd = action_copy_create_proc_wnd (__move, scan_allowed, &listing);
+  wnd->verify = copy_options.verify;
+  wnd->checksum = copy_options.checksum;
+  wnd->manifest = manifest;
+
+  /* Placement of files matters only when their data is copied */
+  wnd->physical_order = copy_options.physical_order && !__move;
+
+  /* Initialize limits of copying speed */
+  throttle_init (&wnd->bytes_throttle, copy_throttle.bytes_rate);
+  throttle_init (&wnd->files_throttle, copy_throttle.files_rate);
+
+  /* Let other processes use disk in the first place */
+  if (copy_throttle.idle_priority)
+    {
+      io_priority_changed = !io_priority_set_idle (&io_priority);
+    }
 
   wnd->abs_path_prefix = (wchar_t*)__base_dir;
   w_window_show (wnd->window);
 
-  item = NULL;
-  j = 0;
-  for (i = 0; i < source_count; ++i)
+  for (i = 0; i < __count; ++i)
     {
-      if (scan_allowed)
-        {
-          item_name = listing.tree->dirent[i]->name;
-
-          /* Need this to cast deselecting of copied items */
-          item = (file_panel_item_t*)__src_list[j++];
-          while ((wcscmp (item->file->name, item_name) != 0) && j < __count)
-            {
-              item = (file_panel_item_t*)__src_list[j++];
-            }
-        }
-      else
-        {
-          item = (file_panel_item_t*)__src_list[i];
-          item_name = item->file->name;
-        }
+      item = (file_panel_item_t*)__src_list[i];
 
       /* Expand posibile '*' characters */
-      dummy = pattern_rename (dst, item_name);
+      dummy = pattern_rename (dst, item->file->name);
 
       /* Make copy iteration */
-      src = wcdircatsubdir (__base_dir, item_name);
-      res = make_copy_iter (src, dummy, &owr_all_rule, wnd,
-                            scan_allowed ? listing.tree->items[i] : NULL);
+      src = wcdircatsubdir (__base_dir, item->file->name);
+      res = make_copy_iter (src, dummy, &owr_all_rule, wnd);
       res = 0;
       free (src);
       free (dummy);
@@ -1491,12 +1915,8 @@ make_copy (BOOL __move, const wchar_t *__base_dir,
         {
           /* In case of successful copying */
           /* we need free selection from copied item */
-          if (item != NULL)
-            {
-              /* item may be NULL only in case prescanning is disabled */
-              item->selected = FALSE;
-              count++;
-            }
+          item->selected = FALSE;
+          count++;
         }
       else
         {
@@ -1514,19 +1934,32 @@ make_copy (BOOL __move, const wchar_t *__base_dir,
         }
     }
 
+  /* Copy files which were deferred while walking */
+  if (wnd->deferred_count && !wnd->abort)
+    {
+      copy_deferred_files (&owr_all_rule, wnd);
+    }
+
   if (__move)
     {
       make_unlink (wnd);
     }
 
-  action_copy_destroy_proc_wnd (wnd);
+  if (manifest)
+    {
+      vfs_close (manifest);
+    }
 
-  /* Free listing information */
-  if (scan_allowed)
+  if (io_priority_changed)
     {
-      action_free_listing (&listing);
+      io_priority_restore (io_priority);
     }
 
+  /* Stop counting of totals and free shared listings */
+  action_shared_listing_stop (listing);
+
+  action_copy_destroy_proc_wnd (wnd);
+
   free (dst);
 
   return count;
@@ -1536,6 +1969,19 @@ make_copy (BOOL __move, const wchar_t *__base_dir,
  * User's backend
  */
 
+/**
+ * Get settings of throttling of copy/move operations
+ * Returned settings could be changed and they will be used
+ * for further operations.
+ *
+ * @return pointer to settings
+ */
+action_copy_throttle_t*
+action_copy_get_throttle (void)
+{
+  return &copy_throttle;
+}
+
 /**
  * Copy/move list of files from specified panel
  *
@@ -17,10 +17,27 @@ BEGIN_HEADER
 
 #include "file_panel.h"
 
+/* Settings of throttling of copy/move operations */
+typedef struct
+{
+  /* Limit of copying speed in bytes per second (zero means no limit) */
+  __u64_t bytes_rate;
+
+  /* Limit of file operations per second (zero means no limit) */
+  __u64_t files_rate;
+
+  /* Use idle I/O scheduling class while copying */
+  BOOL idle_priority;
+} action_copy_throttle_t;
+
 /* Copy/move list of files from specified panel */
 int
 action_copymove (file_panel_t *__panel, BOOL __move);
 
+/* Get settings of throttling of copy/move operations */
+action_copy_throttle_t*
+action_copy_get_throttle (void);
+
 END_HEADER
 
 #endif
@@ -97,6 +97,21 @@ delete_operation (const wchar_t *__full_name, vfs_stat_t __stat,
   return ACTION_OK;
 }
 
+/**
+ * Delete operation for action_operate_parallel
+ *
+ * @param __url - URL of item to delete with all its children
+ * @param __state - state of deletion
+ * @param __user_data - user's data (unused)
+ * @return zero on success, non-zero otherwise
+ */
+static int
+delete_tree_operation (const wchar_t *__url, vfs_tree_state_t *__state,
+                       void *__user_data ATTR_UNUSED)
+{
+  return vfs_remove_tree (__url, __state);
+}
+
 /********
  * User's backend
  */
@@ -137,12 +152,12 @@ action_delete (file_panel_t *__panel)
       cwd = file_panel_get_full_cwd (__panel);
 
       /* ...make deletion */
-      res = action_operate (_(L"Delete"),
-                            _(L"Deleting"),
-                            __panel, cwd, (const file_panel_item_t**)list,
-                            count, TRUE, scan, FALSE,
-                            (action_operator_t)delete_operation,
-                            NULL, (action_operator_t)delete_operation, NULL);
+      res = action_operate_trees (_(L"Delete"), _(L"Deleting"),
+                                  __panel, cwd, list, count, scan, FALSE,
+                                  delete_tree_operation,
+                                  (action_operator_t)delete_operation,
+                                  NULL, (action_operator_t)delete_operation,
+                                  NULL);
 
       /* Free used memory */
       free (cwd);
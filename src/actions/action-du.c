@@ -0,0 +1,853 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Computing sizes of directories
+ *
+ * Sizes are computed by worker threads in background, so user could
+ * keep working with panels. Computed sizes are cached by device, inode
+ * and modification time of directories, and panels show them in column
+ * of sizes instead of directory caption.
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "actions.h"
+#include "action-walk.h"
+#include "messages.h"
+#include "i18n.h"
+#include "dir.h"
+#include "hook.h"
+#include "dynstruct.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+/********
+ * Constants
+ */
+
+/* Maximal count of workers */
+#define DU_MAX_WORKERS 8
+
+/* Length of cache of sizes */
+#define DU_CACHE_LENGTH 1021
+
+/* Maximal count of cached sizes, the oldest ones are dropped */
+#define DU_CACHE_MAX_COUNT 4096
+
+/* Length of map of files with several hard links */
+#define DU_LINKS_LENGTH 1021
+
+/********
+ * Type definitions
+ */
+
+/* Directory which size is being computed */
+typedef struct du_dir
+{
+  wchar_t *url;
+
+  /* Key and modification time of directory at the moment */
+  /* of request, computed size is cached for them */
+  action_inode_key_t key;
+  time_t mtime;
+
+  /* Do not descend into directories on other filesystems */
+  BOOL one_fs;
+
+  /* Size counted so far */
+  __u64_t size;
+
+  /* Files with several hard links which have been counted, */
+  /* shared by all workers counting this directory */
+  hashmap_t *links;
+
+  /* Count of units of directory which aren't processed yet */
+  unsigned long pending;
+
+  struct du_dir *next;
+} du_dir_t;
+
+/* Unit of work of workers */
+typedef struct
+{
+  du_dir_t *dir;
+  wchar_t *url;
+
+  /* Only top level of directory is processed by this unit, */
+  /* subdirectories are split to separate units */
+  BOOL split;
+} du_unit_t;
+
+/* Cached size of directory */
+typedef struct
+{
+  time_t mtime;
+  __u64_t size;
+} du_cached_t;
+
+typedef struct
+{
+  pthread_t thread;
+  BOOL started;
+  volatile BOOL done;
+
+  vfs_tree_state_t state;
+} du_worker_t;
+
+/********
+ * Global variables
+ */
+
+/* Computed sizes, keys are device and inode of directories */
+static hashmap_t *cache = NULL;
+
+/* Keys of cached sizes in order of caching */
+static deque_t *cache_order = NULL;
+static unsigned long cache_count = 0;
+
+/* Directories which sizes are being computed */
+static du_dir_t *dirs = NULL;
+
+/* Units which aren't taken by workers yet */
+static deque_t *units = NULL;
+
+/* Count of units which are being split by workers */
+static unsigned long splitting = 0;
+
+static du_worker_t workers[DU_MAX_WORKERS];
+
+/* Computing should be stopped */
+static volatile BOOL aborted = FALSE;
+
+static BOOL hooks_registered = FALSE;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Check if file with several hard links has been counted already
+ *
+ * @param __state - state of walking, its data is directory
+ * which size is computed
+ * @param __dev - device of file
+ * @param __ino - inode of file
+ * @return non-zero if file has been counted, zero otherwise
+ */
+static BOOL
+du_link_seen (vfs_tree_state_t *__state, vfs_dev_t __dev, ino_t __ino)
+{
+  du_dir_t *dir = __state->link_data;
+  action_inode_key_t key;
+  BOOL res;
+
+  key.dev = __dev;
+  key.ino = __ino;
+
+  pthread_mutex_lock (&mutex);
+
+  if (!dir->links)
+    {
+      dir->links = action_inode_map_create (NULL, DU_LINKS_LENGTH);
+    }
+
+  res = hashmap_isset (dir->links, &key);
+
+  if (!res)
+    {
+      hashmap_set (dir->links, &key, NULL);
+    }
+
+  pthread_mutex_unlock (&mutex);
+
+  return res;
+}
+
+/**
+ * Get count of bytes occupied by item on disk
+ *
+ * @param __stat - status of item
+ * @param __state - state of walking
+ * @return count of bytes, zero for the second and further names
+ * of file with several hard links
+ */
+static __u64_t
+occupied_size (const vfs_stat_t *__stat, vfs_tree_state_t *__state)
+{
+  if (!S_ISDIR (__stat->st_mode) && __stat->st_nlink > 1 &&
+      __state->link_seen &&
+      __state->link_seen (__state, __stat->st_dev, __stat->st_ino))
+    {
+      return 0;
+    }
+
+  return (__u64_t)__stat->st_blocks * 512;
+}
+
+/**
+ * Put computed size to cache
+ *
+ * The oldest sizes are dropped, so cache doesn't grow without bound.
+ *
+ * @param __dir - directory which size has been computed
+ */
+static void
+cache_size (const du_dir_t *__dir)
+{
+  du_cached_t *cached;
+  action_inode_key_t *key;
+
+  MALLOC_ZERO (cached, sizeof (du_cached_t));
+  cached->mtime = __dir->mtime;
+  cached->size = __dir->size;
+
+  if (!hashmap_isset (cache, &__dir->key))
+    {
+      key = malloc (sizeof (action_inode_key_t));
+      *key = __dir->key;
+      deque_push_back (cache_order, key);
+      ++cache_count;
+    }
+
+  hashmap_set (cache, &__dir->key, cached);
+
+  while (cache_count > DU_CACHE_MAX_COUNT)
+    {
+      key = deque_pop_front (cache_order);
+      hashmap_unset (cache, key);
+      free (key);
+      --cache_count;
+    }
+}
+
+/**
+ * Count item and all its children without help of VFS plugin
+ *
+ * @param __url - URL of item
+ * @param __guard - guard against crossing filesystems
+ * @param __state - state of walking
+ * @param __size - counter of bytes occupied on disk
+ */
+static void
+disk_usage_iter (const wchar_t *__url, action_walk_guard_t *__guard,
+                 vfs_tree_state_t *__state, __u64_t *__size)
+{
+  vfs_stat_t stat;
+  vfs_dirent_t **eps;
+  wchar_t *cur;
+  int res;
+  long i, count;
+
+  if (__state->abort)
+    {
+      return;
+    }
+
+  if ((res = vfs_lstat (__url, &stat)))
+    {
+      ++__state->errors;
+      __state->last_error = res;
+      return;
+    }
+
+  *__size += occupied_size (&stat, __state);
+  ++__state->processed;
+
+  if (!S_ISDIR (stat.st_mode) || !action_walk_guard_enter (__guard, &stat))
+    {
+      return;
+    }
+
+  count = vfs_scandir (__url, &eps, 0, action_walk_compar ());
+  if (count < 0)
+    {
+      ++__state->errors;
+      __state->last_error = count;
+      return;
+    }
+
+  for (i = 0; i < count; ++i)
+    {
+      if (!IS_PSEUDODIR (eps[i]->name))
+        {
+          cur = wcdircatsubdir (__url, eps[i]->name);
+          disk_usage_iter (cur, __guard, __state, __size);
+          free (cur);
+        }
+
+      vfs_free_dirent (eps[i]);
+    }
+
+  free (eps);
+}
+
+/**
+ * Count subtree of item
+ *
+ * @param __url - URL of item
+ * @param __one_fs - do not descend into directories on other filesystems
+ * @param __state - state of walking
+ * @param __size - counter of bytes occupied on disk
+ */
+static void
+disk_usage (const wchar_t *__url, BOOL __one_fs,
+            vfs_tree_state_t *__state, __u64_t *__size)
+{
+  action_walk_guard_t guard;
+
+  if (vfs_disk_usage (__url, __one_fs, __state, __size) !=
+      VFS_METHOD_NOT_FOUND)
+    {
+      return;
+    }
+
+  action_walk_guard_init (&guard, __one_fs, FALSE);
+  disk_usage_iter (__url, &guard, __state, __size);
+  action_walk_guard_free (&guard);
+}
+
+/**
+ * Count top level of directory and split its subdirectories
+ * to separate units, so they are counted by all workers
+ *
+ * @param __unit - unit to split
+ * @param __state - state of walking
+ * @param __size - counter of bytes occupied on disk
+ */
+static void
+split_unit (const du_unit_t *__unit, vfs_tree_state_t *__state,
+            __u64_t *__size)
+{
+  action_walk_guard_t guard;
+  vfs_stat_t stat;
+  vfs_dirent_t **eps;
+  du_unit_t *unit;
+  wchar_t *cur;
+  long i, count;
+  int res;
+
+  if ((res = vfs_lstat (__unit->url, &stat)))
+    {
+      ++__state->errors;
+      __state->last_error = res;
+      return;
+    }
+
+  *__size += (__u64_t)stat.st_blocks * 512;
+  ++__state->processed;
+
+  count = vfs_scandir (__unit->url, &eps, 0, action_walk_compar ());
+  if (count < 0)
+    {
+      ++__state->errors;
+      __state->last_error = count;
+      return;
+    }
+
+  action_walk_guard_init (&guard, __unit->dir->one_fs, FALSE);
+  action_walk_guard_enter (&guard, &stat);
+
+  for (i = 0; i < count; ++i)
+    {
+      if (!IS_PSEUDODIR (eps[i]->name) && !__state->abort)
+        {
+          cur = wcdircatsubdir (__unit->url, eps[i]->name);
+
+          if ((res = vfs_lstat (cur, &stat)))
+            {
+              ++__state->errors;
+              __state->last_error = res;
+              free (cur);
+            }
+          else if (S_ISDIR (stat.st_mode) &&
+                   action_walk_guard_enter (&guard, &stat))
+            {
+              /* Subdirectory is counted with its own blocks */
+              MALLOC_ZERO (unit, sizeof (du_unit_t));
+              unit->dir = __unit->dir;
+              unit->url = cur;
+
+              pthread_mutex_lock (&mutex);
+              ++__unit->dir->pending;
+              deque_push_back (units, unit);
+              pthread_cond_signal (&cond);
+              pthread_mutex_unlock (&mutex);
+            }
+          else
+            {
+              *__size += occupied_size (&stat, __state);
+              ++__state->processed;
+              free (cur);
+            }
+        }
+
+      vfs_free_dirent (eps[i]);
+    }
+
+  free (eps);
+
+  action_walk_guard_free (&guard);
+}
+
+/**
+ * Worker which counts units
+ *
+ * @param __arg - descriptor of worker
+ * @return NULL
+ */
+static void*
+du_worker (void *__arg)
+{
+  du_worker_t *worker = __arg;
+  du_unit_t *unit;
+  __u64_t size;
+  sigset_t set;
+
+  /* All signals are handled by the main thread */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+  pthread_mutex_lock (&mutex);
+
+  while (!aborted)
+    {
+      unit = deque_pop_front (units);
+
+      if (!unit)
+        {
+          /* Units could be still added by splitting */
+          if (!splitting)
+            {
+              break;
+            }
+
+          pthread_cond_wait (&cond, &mutex);
+          continue;
+        }
+
+      if (unit->split)
+        {
+          ++splitting;
+        }
+
+      pthread_mutex_unlock (&mutex);
+
+      /* Hard links are counted once per computed directory */
+      worker->state.link_seen = du_link_seen;
+      worker->state.link_data = unit->dir;
+
+      size = 0;
+      if (unit->split)
+        {
+          split_unit (unit, &worker->state, &size);
+        }
+      else
+        {
+          disk_usage (unit->url, unit->dir->one_fs, &worker->state, &size);
+        }
+
+      pthread_mutex_lock (&mutex);
+
+      if (unit->split)
+        {
+          --splitting;
+        }
+
+      unit->dir->size += size;
+      --unit->dir->pending;
+
+      /* Waiting workers should check whether there is any work */
+      pthread_cond_broadcast (&cond);
+
+      free (unit->url);
+      free (unit);
+    }
+
+  worker->done = TRUE;
+
+  pthread_mutex_unlock (&mutex);
+
+  return NULL;
+}
+
+/**
+ * Join finished workers
+ *
+ * NOTE: Mutex should be locked if workers are not waited for.
+ *
+ * @param __wait - wait for all workers to finish
+ * @return non-zero if there are no running workers, zero otherwise
+ */
+static BOOL
+join_workers (BOOL __wait)
+{
+  int i;
+  BOOL running = FALSE;
+
+  for (i = 0; i < DU_MAX_WORKERS; ++i)
+    {
+      if (workers[i].started && (workers[i].done || __wait))
+        {
+          pthread_join (workers[i].thread, NULL);
+          workers[i].started = FALSE;
+        }
+
+      running = running || workers[i].started;
+    }
+
+  return !running;
+}
+
+/**
+ * Start workers if there are free slots for them
+ *
+ * NOTE: Mutex should be locked.
+ */
+static void
+start_workers (void)
+{
+  long i, count, cpus;
+
+  /* Counting is mostly waiting for metadata, */
+  /* so at least two workers are useful even on single CPU */
+  cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  count = MIN (MAX (cpus, 2), DU_MAX_WORKERS);
+
+  /* Finished workers leave their slots to new ones */
+  join_workers (FALSE);
+
+  for (i = 0; i < count; ++i)
+    {
+      if (!workers[i].started)
+        {
+          memset (&workers[i], 0, sizeof (du_worker_t));
+          workers[i].started = !pthread_create (&workers[i].thread, NULL,
+                                                du_worker, &workers[i]);
+        }
+    }
+}
+
+/**
+ * Get count of items counted by running workers
+ *
+ * @return count of items
+ */
+static __u64_t
+get_processed (void)
+{
+  int i;
+  __u64_t res = 0;
+
+  for (i = 0; i < DU_MAX_WORKERS; ++i)
+    {
+      if (workers[i].started)
+        {
+          res += workers[i].state.processed;
+        }
+    }
+
+  return res;
+}
+
+/**
+ * Check if size of directory is being computed
+ *
+ * NOTE: Mutex should be locked.
+ *
+ * @param __stat - status of directory
+ * @return non-zero if directory is being computed, zero otherwise
+ */
+static BOOL
+is_computing (const vfs_stat_t *__stat)
+{
+  du_dir_t *dir;
+
+  for (dir = dirs; dir; dir = dir->next)
+    {
+      if (dir->key.dev == __stat->st_dev && dir->key.ino == __stat->st_ino)
+        {
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/**
+ * Make workers stop computing as soon as possible
+ */
+static void
+abort_computing (void)
+{
+  int i;
+
+  pthread_mutex_lock (&mutex);
+
+  aborted = TRUE;
+
+  for (i = 0; i < DU_MAX_WORKERS; ++i)
+    {
+      workers[i].state.abort = TRUE;
+    }
+
+  pthread_cond_broadcast (&cond);
+  pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Redraw all file panels
+ */
+static void
+redraw_panels (void)
+{
+  file_panel_t *panel;
+
+  deque_foreach (file_panel_get_list (), panel);
+    file_panel_redraw (panel);
+  deque_foreach_done
+}
+
+/**
+ * Handler for hook "idle-hook"
+ * Computed sizes are moved to cache and shown on panels.
+ *
+ * @param __call_data - calling context
+ * @return HOOK_SUCCESS
+ */
+static int
+du_idle_hook (dynstruct_t *__call_data ATTR_UNUSED)
+{
+  du_dir_t *dir, *next, *prev = NULL;
+  du_unit_t *unit;
+  BOOL finished, updated = FALSE;
+
+  if (!dirs)
+    {
+      return HOOK_SUCCESS;
+    }
+
+  pthread_mutex_lock (&mutex);
+
+  finished = join_workers (FALSE);
+
+  if (aborted && finished)
+    {
+      /* Drop all work which wasn't done */
+      while ((unit = deque_pop_front (units)))
+        {
+          free (unit->url);
+          free (unit);
+        }
+    }
+
+  for (dir = dirs; dir; dir = next)
+    {
+      next = dir->next;
+
+      if (dir->pending && !(aborted && finished))
+        {
+          prev = dir;
+          continue;
+        }
+
+      if (!dir->pending)
+        {
+          cache_size (dir);
+          updated = TRUE;
+        }
+
+      if (prev)
+        {
+          prev->next = next;
+        }
+      else
+        {
+          dirs = next;
+        }
+
+      if (dir->links)
+        {
+          hashmap_destroy (dir->links);
+        }
+
+      free (dir->url);
+      free (dir);
+    }
+
+  if (finished)
+    {
+      aborted = FALSE;
+    }
+
+  pthread_mutex_unlock (&mutex);
+
+  if (updated)
+    {
+      redraw_panels ();
+    }
+
+  return HOOK_SUCCESS;
+}
+
+/**
+ * Handler for hook "exit-hook"
+ *
+ * @param __call_data - calling context
+ * @return HOOK_SUCCESS
+ */
+static int
+du_exit_hook (dynstruct_t *__call_data ATTR_UNUSED)
+{
+  abort_computing ();
+  join_workers (TRUE);
+
+  return HOOK_SUCCESS;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Get computed size of directory
+ *
+ * @param __stat - status of directory (not following symbolic link)
+ * @param __size - pointer to buffer where size will be stored
+ * @return non-zero if size of directory is known and directory hasn't
+ * been changed since computing, zero otherwise
+ */
+BOOL
+action_du_get_cached (const vfs_stat_t *__stat, __u64_t *__size)
+{
+  action_inode_key_t key;
+  du_cached_t *cached;
+
+  if (!cache || !S_ISDIR (__stat->st_mode))
+    {
+      return FALSE;
+    }
+
+  key.dev = __stat->st_dev;
+  key.ino = __stat->st_ino;
+
+  cached = hashmap_get (cache, &key);
+
+  if (!cached || cached->mtime != __stat->st_mtime)
+    {
+      return FALSE;
+    }
+
+  *__size = cached->size;
+
+  return TRUE;
+}
+
+/**
+ * Compute sizes of selected directories of specified panel
+ *
+ * Sizes are computed in background and appear on panels when they are
+ * ready. Calling action again while there is nothing new to compute
+ * offers to stop computing.
+ *
+ * @param __panel - panel with directories
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_du (file_panel_t *__panel)
+{
+  unsigned long i, count, added = 0;
+  file_panel_item_t **list = NULL;
+  const vfs_stat_t *stat;
+  du_dir_t *dir;
+  du_unit_t *unit;
+  wchar_t *cwd, msg[1024];
+  __u64_t size;
+  BOOL one_fs;
+
+  if (!cache)
+    {
+      cache = action_inode_map_create (free, DU_CACHE_LENGTH);
+      cache_order = deque_create ();
+      units = deque_create ();
+    }
+
+  if (!hooks_registered)
+    {
+      hook_register (L"idle-hook", du_idle_hook, 0);
+      hook_register (L"exit-hook", du_exit_hook, 0);
+      hooks_registered = TRUE;
+    }
+
+  count = file_panel_get_selected_items (__panel, &list);
+  cwd = file_panel_get_full_cwd (__panel);
+  one_fs = action_get_one_filesystem ();
+
+  pthread_mutex_lock (&mutex);
+
+  for (i = 0; i < count && !aborted; ++i)
+    {
+      stat = &list[i]->file->lstat;
+
+      /* Symbolic links to directories are not followed */
+      if (!S_ISDIR (stat->st_mode) || IS_PSEUDODIR (list[i]->file->name) ||
+          action_du_get_cached (stat, &size) || is_computing (stat))
+        {
+          continue;
+        }
+
+      MALLOC_ZERO (dir, sizeof (du_dir_t));
+      dir->url = wcdircatsubdir (cwd, list[i]->file->name);
+      dir->key.dev = stat->st_dev;
+      dir->key.ino = stat->st_ino;
+      dir->mtime = stat->st_mtime;
+      dir->one_fs = one_fs;
+      dir->pending = 1;
+      dir->next = dirs;
+      dirs = dir;
+
+      MALLOC_ZERO (unit, sizeof (du_unit_t));
+      unit->dir = dir;
+      unit->url = wcsdup (dir->url);
+      unit->split = TRUE;
+      deque_push_back (units, unit);
+
+      ++added;
+    }
+
+  if (added)
+    {
+      start_workers ();
+      pthread_cond_broadcast (&cond);
+    }
+
+  pthread_mutex_unlock (&mutex);
+
+  free (cwd);
+  SAFE_FREE (list);
+
+  if (!added && dirs && !aborted)
+    {
+      swprintf (msg, BUF_LEN (msg),
+                _(L"Sizes of directories are being computed.\n"
+                  L"%llu items counted so far. Stop computing?"),
+                get_processed ());
+
+      if (message_box (_(L"Sizes"), msg,
+                       MB_YESNO | MB_DEFBUTTON_1) == MR_YES)
+        {
+          /* Workers are joined and their work is dropped */
+          /* by idle hook, so interface is not blocked */
+          abort_computing ();
+        }
+    }
+
+  return ACTION_OK;
+}
@@ -30,7 +30,8 @@
 
 typedef struct {
   w_edit_t *edt_mask, *edt_content;
-  w_checkbox_t *cb_re_mask, *cb_re_content;
+  w_edit_t *edt_size, *edt_mtime, *edt_ctime, *edt_owner;
+  w_checkbox_t *cb_re_mask, *cb_re_content, *cb_content_words;
 } opt_wnd_data_t;
 
 /**
@@ -68,6 +69,52 @@ check_regexp (const wchar_t *__regexp)
   return FALSE;
 }
 
+/**
+ * Check if pre-filters are valid
+ *
+ * @param __opts - widgets of options window
+ * @return zero if some pre-filter is invalid, non-zero otherwise
+ */
+static BOOL
+check_filters (opt_wnd_data_t *__opts)
+{
+  __s64_t min, max;
+  long uid;
+
+  if (!action_find_parse_size (w_edit_get_text (__opts->edt_size),
+                               &min, &max))
+    {
+      MESSAGE_ERROR (_(L"Invalid range of sizes"));
+      widget_set_focus (WIDGET (__opts->edt_size));
+      return FALSE;
+    }
+
+  if (!action_find_parse_age (w_edit_get_text (__opts->edt_mtime),
+                              &min, &max))
+    {
+      MESSAGE_ERROR (_(L"Invalid range of days of modification"));
+      widget_set_focus (WIDGET (__opts->edt_mtime));
+      return FALSE;
+    }
+
+  if (!action_find_parse_age (w_edit_get_text (__opts->edt_ctime),
+                              &min, &max))
+    {
+      MESSAGE_ERROR (_(L"Invalid range of days of change"));
+      widget_set_focus (WIDGET (__opts->edt_ctime));
+      return FALSE;
+    }
+
+  if (!action_find_parse_owner (w_edit_get_text (__opts->edt_owner), &uid))
+    {
+      MESSAGE_ERROR (_(L"Unknown owner of files"));
+      widget_set_focus (WIDGET (__opts->edt_owner));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 /**
  * Handler of property_changed() callback
  *
@@ -97,6 +144,15 @@ window_property_changed (void *__window, int __prop)
                 }
             }
 
+          if (w_checkbox_get (opts->cb_re_content) &&
+              w_checkbox_get (opts->cb_content_words))
+            {
+              MESSAGE_ERROR (_(L"Regular expression can't be used "
+                                "with list of words"));
+              widget_set_focus (WIDGET (opts->cb_content_words));
+              return 1;
+            }
+
           if (w_checkbox_get (opts->cb_re_content))
             {
               if (!check_regexp (w_edit_get_text (opts->edt_content)))
@@ -107,6 +163,11 @@ window_property_changed (void *__window, int __prop)
                   return 1;
                 }
             }
+
+          if (!check_filters (opts))
+            {
+              return 1;
+            }
         }
     }
 
@@ -204,13 +265,16 @@ action_find_show_dialog (action_find_options_t *__options)
   opt_wnd_data_t wnd_data;
 
   w_edit_t *edt_file_mask, *edt_file_content, *edt_start_at;
+  w_edit_t *edt_size, *edt_mtime, *edt_ctime, *edt_owner;
   w_checkbox_t *cb_file_mask_regexp, *cb_file_mask_case_sens;
   w_checkbox_t *cb_content_regexp, *cb_content_case_sens;
+  w_checkbox_t *cb_content_words;
   w_checkbox_t *cb_find_recursive, *cb_follow_symlinks;
-  w_checkbox_t *cb_find_directories;
+  w_checkbox_t *cb_find_directories, *cb_one_filesystem;
+  w_checkbox_t *cb_skip_binary;
 
   wnd = widget_create_window (NULL, _(L"Find file"),
-                              0, 0, 60, 15, WMS_CENTERED);
+                              0, 0, 60, 21, WMS_CENTERED);
   cnt = WIDGET_CONTAINER (wnd);
 
   middle = wnd->position.width / 2 - 2;
@@ -248,6 +312,12 @@ action_find_show_dialog (action_find_options_t *__options)
                                                  _(L"_Case sensitive"),
                                                  1, 8, checked, 0);
 
+  /* Several words separated by semicolons are searched at once */
+  checked = _GET_CHECKED (AFF_CONTENT_WORDS, FALSE);
+  cb_content_words = widget_create_checkbox (NULL, cnt,
+                                             _(L"Any of _words (w1;w2)"),
+                                             middle + 1, 8, checked, 0);
+
   w_edit_set_text (edt_file_content,
                    __options->content ? __options->content :  L"");
   w_edit_set_shaded (edt_file_content, TRUE);
@@ -277,6 +347,45 @@ action_find_show_dialog (action_find_options_t *__options)
                                                 _(L"F_ind directories"),
                                                 middle + 1, 11, checked, 0);
 
+  checked = _GET_CHECKED (AFF_ONE_FILESYSTEM, action_get_one_filesystem ());
+  cb_one_filesystem = widget_create_checkbox (NULL, cnt,
+                                              _(L"Sta_y on one filesystem"),
+                                              1, 12, checked, 0);
+
+  /* Pre-filters which are checked before opening of files */
+  widget_create_text (NULL, cnt,
+                      _(L"Filters (ranges as min-max, times in days ago):"),
+                      1, 14);
+
+  widget_create_text (NULL, cnt, _(L"Size:"), 1, 15);
+  edt_size = widget_create_edit (NULL, cnt, 11, 15, middle - 11);
+  w_edit_set_text (edt_size, __options->size ? __options->size : L"");
+  w_edit_set_shaded (edt_size, TRUE);
+
+  widget_create_text (NULL, cnt, _(L"Owner:"), middle + 1, 15);
+  edt_owner = widget_create_edit (NULL, cnt, middle + 11, 15,
+                                  wnd->position.width - middle - 12);
+  w_edit_set_text (edt_owner, __options->owner ? __options->owner : L"");
+  w_edit_set_shaded (edt_owner, TRUE);
+
+  widget_create_text (NULL, cnt, _(L"Modified:"), 1, 16);
+  edt_mtime = widget_create_edit (NULL, cnt, 11, 16, middle - 11);
+  w_edit_set_text (edt_mtime, __options->mtime ? __options->mtime : L"");
+  w_edit_set_shaded (edt_mtime, TRUE);
+
+  widget_create_text (NULL, cnt, _(L"Changed:"), middle + 1, 16);
+  edt_ctime = widget_create_edit (NULL, cnt, middle + 11, 16,
+                                  wnd->position.width - middle - 12);
+  w_edit_set_text (edt_ctime, __options->ctime ? __options->ctime : L"");
+  w_edit_set_shaded (edt_ctime, TRUE);
+
+  /* Binary files are detected by zero characters in the first block */
+  checked = _GET_CHECKED (AFF_SKIP_BINARY,
+                          TEST_FLAG (__options->flags, AFF_SKIP_BINARY));
+  cb_skip_binary = widget_create_checkbox (NULL, cnt,
+                                           _(L"Skip _binary files"),
+                                           1, 17, checked, 0);
+
   /* Create buttons */
   action_create_ok_cancel_btns (wnd);
 
@@ -284,6 +393,11 @@ action_find_show_dialog (action_find_options_t *__options)
   wnd_data.edt_content = edt_file_content;
   wnd_data.cb_re_mask = cb_file_mask_regexp;
   wnd_data.cb_re_content = cb_content_regexp;
+  wnd_data.cb_content_words = cb_content_words;
+  wnd_data.edt_size = edt_size;
+  wnd_data.edt_mtime = edt_mtime;
+  wnd_data.edt_ctime = edt_ctime;
+  wnd_data.edt_owner = edt_owner;
 
   /* Quite dangerous */
   WIDGET_USER_DATA(wnd) = &wnd_data;
@@ -299,19 +413,30 @@ action_find_show_dialog (action_find_options_t *__options)
       SAFE_FREE (__options->file_mask);
       SAFE_FREE (__options->content);
       SAFE_FREE (__options->start_at);
+      SAFE_FREE (__options->size);
+      SAFE_FREE (__options->mtime);
+      SAFE_FREE (__options->ctime);
+      SAFE_FREE (__options->owner);
 
       /* Store options to a structure */
       __options->file_mask = wcsdup (w_edit_get_text (edt_file_mask));
       __options->content   = wcsdup (w_edit_get_text (edt_file_content));
       __options->start_at  = wcsdup (w_edit_get_text (edt_start_at));
+      __options->size      = wcsdup (w_edit_get_text (edt_size));
+      __options->mtime     = wcsdup (w_edit_get_text (edt_mtime));
+      __options->ctime     = wcsdup (w_edit_get_text (edt_ctime));
+      __options->owner     = wcsdup (w_edit_get_text (edt_owner));
 
       _CHECK_CHECKBOX (cb_file_mask_regexp,    AFF_MASK_REGEXP);
       _CHECK_CHECKBOX (cb_file_mask_case_sens, AFF_MASK_CASE_SENSITIVE);
       _CHECK_CHECKBOX (cb_content_regexp,      AFF_CONTENT_REGEXP);
       _CHECK_CHECKBOX (cb_content_case_sens,   AFF_CONTENT_CASE_SENSITIVE);
+      _CHECK_CHECKBOX (cb_content_words,       AFF_CONTENT_WORDS);
       _CHECK_CHECKBOX (cb_follow_symlinks,     AFF_FOLLOW_SYMLINKS);
       _CHECK_CHECKBOX (cb_find_recursive,      AFF_FIND_RECURSIVELY);
       _CHECK_CHECKBOX (cb_find_directories,    AFF_FIND_DIRECTORIES);
+      _CHECK_CHECKBOX (cb_one_filesystem,      AFF_ONE_FILESYSTEM);
+      _CHECK_CHECKBOX (cb_skip_binary,         AFF_SKIP_BINARY);
 
       __options->flags = flags;
 
@@ -13,15 +13,25 @@
 #include "actions.h"
 #include "action-find.h"
 #include "action-find-iface.h"
+#include "action-index.h"
+#include "action-walk.h"
 #include "util.h"
 #include "dir.h"
 #include "i18n.h"
 #include "deque.h"
 #include "hook.h"
+#include "usergroup.h"
 
 #include <vfs/vfs.h>
 
-#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <wctype.h>
+
 
 #define FIND_RES_DIR  0
 #define FIND_RES_ITEM 1
@@ -32,6 +42,42 @@
 /* Size of buffer for regular expression matching of content */
 #define RE_BUF_SIZE 524288
 
+/* Size of files starting from which their content is mapped */
+/* into memory instead of reading */
+#define MMAP_THRESHOLD 4194304
+
+/* Maximal count of workers which scan content of files */
+#define FIND_MAX_WORKERS 32
+
+/* Maximal count of files waiting for workers */
+#define FIND_QUEUE_LENGTH 256
+
+/* Period of updating of interface while waiting for workers (in ms) */
+#define FIND_WAIT_PERIOD 100
+
+/* Size of the first block of file in which zero characters */
+/* are searched to detect binary files */
+#define BINARY_PROBE_SIZE 4096
+
+#define SECONDS_PER_DAY 86400
+
+/* Limit of range which is omitted or invalid */
+#define LIMIT_OMITTED -1
+#define LIMIT_INVALID -2
+
+#define IN_RANGE(__value, __min, __max) \
+  (((__min) < 0 || (__value) >= (__min)) && \
+   ((__max) < 0 || (__value) <= (__max)))
+
+/* Set guard against truncation of mapped file, which returns non-zero */
+/* when file has been truncated while scanning of mapped content */
+#define GUARD_MAPPED_SCAN(__guard) \
+  (sigsetjmp ((__guard), 1) ? (mapped_scan = NULL, 1) : \
+   (mapped_scan = &(__guard), 0))
+
+#define UNGUARD_MAPPED_SCAN() \
+  (mapped_scan = NULL)
+
 #define ACTION_PERFORMED(__wnd) \
   (__wnd->window->modal_result != 0)
 
@@ -45,6 +91,249 @@ typedef struct
   wchar_t *name;
 } list_item_value_t;
 
+/* Location of occurrence of content in file */
+typedef struct
+{
+  /* Number of line, starting from 1. Zero if location is unknown. */
+  __u64_t line;
+
+  /* Offset of occurrence in line, starting from 1 */
+  __u64_t column;
+
+  /* Words occurred in file separated by commas, */
+  /* NULL if content isn't searched in words mode */
+  wchar_t *words;
+} content_match_t;
+
+/* Entry found in directory */
+typedef struct
+{
+  /* Index of entry in alphabetically sorted listing */
+  int index;
+  vfs_stat_t stat;
+  content_match_t match;
+} found_entry_t;
+
+/* Entry of index which name matches */
+typedef struct
+{
+  wchar_t *rel_dir;
+  wchar_t *name;
+  wchar_t *full_name;
+} index_hit_t;
+
+/* Context of scanning of content, each thread has its own one */
+typedef struct
+{
+  /* Matcher of regular expression for content */
+  regexp_matcher_t *matcher;
+
+  /* Window with search results, NULL in workers */
+  action_find_res_wnd_t *res_wnd;
+
+  /* Scanning should be stopped (checked by workers) */
+  volatile BOOL *aborted;
+} scan_context_t;
+
+/* Results of directory, which content of files is scanned by workers. */
+/* Entries which are known to be found without scanning are put here */
+/* too, so all results of directory are shown together in order. */
+typedef struct
+{
+  wchar_t *rel_dir;
+
+  struct find_job **jobs;
+  int count, allocated;
+
+  /* Count of files which aren't scanned yet */
+  int pending;
+
+  /* All entries of directory have been walked */
+  BOOL closed;
+} find_batch_t;
+
+/* File which content is scanned by worker */
+typedef struct find_job
+{
+  find_batch_t *batch;
+
+  /* Index of file in alphabetically sorted listing */
+  int index;
+  wchar_t *name, *full_name;
+  vfs_stat_t stat;
+
+  BOOL matched;
+  content_match_t match;
+
+  /* Entry is found without scanning of content (directory or */
+  /* special file), and it's already counted in results */
+  BOOL found;
+} find_job_t;
+
+/* Engine of find */
+typedef struct
+{
+  const action_find_options_t *options;
+
+  /* Context of scanning in the main thread */
+  scan_context_t ctx;
+
+  /* Workers which scan content of files. If there are no workers, */
+  /* content is scanned by the main thread during walking. */
+  pthread_t workers[FIND_MAX_WORKERS];
+  int workers_count;
+
+  /* Files which aren't taken by workers yet */
+  deque_t *jobs;
+  int queued;
+
+  /* Batches in order of walking, results are shown in this order */
+  deque_t *batches;
+
+  /* Walking is finished, workers exit when there are no jobs */
+  BOOL walked;
+  volatile BOOL aborted;
+
+  pthread_mutex_t mutex;
+
+  /* Signaled when job is queued or walking is finished */
+  pthread_cond_t job_cond;
+
+  /* Signaled when job is done */
+  pthread_cond_t done_cond;
+
+  /* Action of SIGBUS which was set before finding */
+  struct sigaction old_sigbus;
+} find_engine_t;
+
+/* Guard of scanning of mapped content in current thread */
+static __thread sigjmp_buf *mapped_scan = NULL;
+
+/**
+ * Handler of SIGBUS, which is raised when mapped file is truncated
+ * while scanning of its content
+ *
+ * @param __signum - number of signal
+ */
+static void
+sigbus_handler (int __signum)
+{
+  if (mapped_scan)
+    {
+      siglongjmp (*mapped_scan, 1);
+    }
+
+  /* Not caused by scanning, so let it terminate the process */
+  signal (__signum, SIG_DFL);
+  raise (__signum);
+}
+
+/**
+ * Parse value of limit of range
+ *
+ * @param __str - pointer to string with value, advanced to the first
+ * character after value
+ * @param __size - value is a size and could be followed by multiplier
+ * @return parsed value, LIMIT_OMITTED if value is omitted or
+ * LIMIT_INVALID if value is too large
+ */
+static __s64_t
+parse_limit (const wchar_t **__str, BOOL __size)
+{
+  wchar_t *end;
+  __s64_t value, multiplier = 1;
+
+  while (iswspace (**__str))
+    {
+      ++*__str;
+    }
+
+  if (!iswdigit (**__str))
+    {
+      return LIMIT_OMITTED;
+    }
+
+  errno = 0;
+  value = wcstoll (*__str, &end, 10);
+
+  if (errno == ERANGE)
+    {
+      return LIMIT_INVALID;
+    }
+
+  if (__size)
+    {
+      switch (towupper (*end))
+        {
+        case L'G':
+          multiplier *= 1024;
+          /* Fall through */
+        case L'M':
+          multiplier *= 1024;
+          /* Fall through */
+        case L'K':
+          multiplier *= 1024;
+          ++end;
+          break;
+        }
+    }
+
+  if (value > LLONG_MAX / multiplier)
+    {
+      return LIMIT_INVALID;
+    }
+
+  value *= multiplier;
+
+  while (iswspace (*end))
+    {
+      ++end;
+    }
+
+  *__str = end;
+
+  return value;
+}
+
+/**
+ * Parse range of values of pre-filter
+ *
+ * Range is written as `min-max', `min-' or `-max'. Single value means
+ * range which consists of this value only. Empty string means absence
+ * of limits.
+ *
+ * @param __str - string to parse
+ * @param __size - values are sizes and could be followed by multipliers
+ * @param __min - pointer to variable where lower limit will be stored
+ * @param __max - pointer to variable where upper limit will be stored
+ * @return non-zero if string is a valid range, zero otherwise
+ */
+static BOOL
+parse_range (const wchar_t *__str, BOOL __size,
+             __s64_t *__min, __s64_t *__max)
+{
+  const wchar_t *ptr = __str ? __str : L"";
+
+  *__min = parse_limit (&ptr, __size);
+
+  if (*ptr == L'-')
+    {
+      ++ptr;
+      *__max = parse_limit (&ptr, __size);
+    }
+  else
+    {
+      *__max = *__min;
+    }
+
+  if (*ptr || *__min == LIMIT_INVALID || *__max == LIMIT_INVALID)
+    {
+      return FALSE;
+    }
+
+  return *__min < 0 || *__max < 0 || *__min <= *__max;
+}
+
 /**
  * Free find options
  *
@@ -58,17 +347,38 @@ free_find_options (action_find_options_t *__options)
   SAFE_FREE (__options->file_mask);
   SAFE_FREE (__options->content);
   SAFE_FREE (__options->start_at);
+  SAFE_FREE (__options->size);
+  SAFE_FREE (__options->mtime);
+  SAFE_FREE (__options->ctime);
+  SAFE_FREE (__options->owner);
 
   /* Destroy precompiled options */
   for (i = 0; i < __options->re_file_count; ++i)
     {
+      regexp_matcher_free (__options->file_matcher[i]);
       regexp_free (__options->re_file[i]);
     }
+  SAFE_FREE (__options->file_matcher);
   SAFE_FREE (__options->re_file);
 
+  wglob_free (__options->file_glob);
+  __options->file_glob = NULL;
+
+  regexp_matcher_free (__options->content_matcher);
+  __options->content_matcher = NULL;
   regexp_free (__options->re_content);
 
-  SAFE_FREE (__options->mb_content);
+  strsearch_free (__options->content_search);
+  __options->content_search = NULL;
+
+  acsearch_free (__options->content_automaton);
+  __options->content_automaton = NULL;
+
+  if (__options->content_words)
+    {
+      free_explode_array (__options->content_words);
+      __options->content_words = NULL;
+    }
 }
 
 /**
@@ -78,11 +388,12 @@ free_find_options (action_find_options_t *__options)
  *
  * @param __str - string to build regular expression from
  * @param __case_insens - append `case insensitive` modifier
+ * @param __multiline - append `multiple lines` modifier
  * @return regular expression string
  * @sideeffect allocate memory for output value
  */
 static wchar_t*
-build_regexp (const wchar_t *__str, BOOL __case_insens)
+build_regexp (const wchar_t *__str, BOOL __case_insens, BOOL __multiline)
 {
   wchar_t *regexp;
   wchar_t modifiers[8];
@@ -98,6 +409,12 @@ build_regexp (const wchar_t *__str, BOOL __case_insens)
       wcscat (modifiers, L"i");
     }
 
+  if (__multiline)
+    {
+      ++re_len;
+      wcscat (modifiers, L"m");
+    }
+
   regexp = malloc ((re_len + 1) * sizeof (wchar_t));
 
   swprintf (regexp, re_len, L"/%ls/%ls", __str, modifiers);
@@ -105,23 +422,6 @@ build_regexp (const wchar_t *__str, BOOL __case_insens)
   return regexp;
 }
 
-/**
- * Make buffer lowercase
- *
- * @param __buf - buffer to make lower-cased
- * @param __size - size of buffer
- */
-static void
-lowercase_buffer (char *__buf, size_t __size)
-{
-  size_t i;
-
-  for (i = 0; i < __size; ++i)
-    {
-      __buf[i] = tolower (__buf[i]);
-    }
-}
-
 /**
  * Precompile options for faster usage
  * (i.e. compile regular expressions, )
@@ -151,9 +451,12 @@ precompile_options (action_find_options_t *__options)
     {
       __options->re_file_count = 1;
       __options->re_file = malloc (sizeof (regexp_t*));
-      regexp = build_regexp (__options->file_mask, case_insens);
+      __options->file_matcher = malloc (sizeof (regexp_matcher_t*));
+      regexp = build_regexp (__options->file_mask, case_insens, FALSE);
 
       __options->re_file[0] = wregexp_compile (regexp);
+      __options->file_matcher[0] =
+        regexp_matcher_create (__options->re_file[0]);
 
       if (!__options->re_file[0])
         {
@@ -167,29 +470,14 @@ precompile_options (action_find_options_t *__options)
     }
   else
     {
+      /* All masks are matched at once by single pass over name */
       wchar_t **masks;
-      long i, count;
+      long count;
 
       count = explode (__options->file_mask, L";", &masks);
 
-      __options->re_file_count = count;
-      __options->re_file = malloc (count * sizeof (regexp_t*));
-
-      for (i = 0; i < count; ++i)
-        {
-          regexp = file_mask_to_regexp (masks[i], case_insens);
-
-          __options->re_file[i] = wregexp_compile (regexp);
-
-          if (!__options->re_file[i])
-            {
-              /*
-               * TODO: Add error handling here
-               */
-              result = ACTION_ERR;
-            }
-          free (regexp);
-        }
+      __options->file_glob = wglob_compile ((const wchar_t**)masks, count,
+                                            case_insens);
 
       free_explode_array (masks);
     }
@@ -203,10 +491,14 @@ precompile_options (action_find_options_t *__options)
       /* We should compile regular expression for content */
       if (TEST_FLAG (__options->flags, AFF_CONTENT_REGEXP))
         {
-          regexp = build_regexp (__options->content, case_insens);
+          /* Content is scanned by lines, so ^ and $ should match */
+          /* at boundaries of lines */
+          regexp = build_regexp (__options->content, case_insens, TRUE);
 
           /* Compile regexp */
           __options->re_content = wregexp_compile (regexp);
+          __options->content_matcher =
+            regexp_matcher_create (__options->re_content);
 
           if (!__options->re_content)
             {
@@ -218,6 +510,37 @@ precompile_options (action_find_options_t *__options)
 
           free (regexp);
         }
+      else if (TEST_FLAG (__options->flags, AFF_CONTENT_WORDS))
+        {
+          /* All words are searched at once by single pass over file */
+          char **mb_words;
+          size_t *lens;
+          long i, count;
+
+          count = explode (__options->content, L";",
+                           &__options->content_words);
+
+          mb_words = malloc (MAX (count, 1) * sizeof (char*));
+          lens = malloc (MAX (count, 1) * sizeof (size_t));
+
+          for (i = 0; i < count; ++i)
+            {
+              wcs2mbs (&mb_words[i], __options->content_words[i]);
+              lens[i] = strlen (mb_words[i]);
+            }
+
+          __options->content_automaton =
+            acsearch_compile ((const char**)mb_words, lens, count,
+                              case_insens);
+
+          for (i = 0; i < count; ++i)
+            {
+              free (mb_words[i]);
+            }
+
+          free (mb_words);
+          free (lens);
+        }
       else
         {
           /* For speed improvement we won't use regular expressions */
@@ -225,36 +548,54 @@ precompile_options (action_find_options_t *__options)
           /* But we'd better convert wide-char content string to */
           /* multi-byte string because we wouldn't convert file's content */
           /* to multi-byte string. */
-          wcs2mbs (&__options->mb_content, __options->content);
+          char *mb_content;
 
-          if (case_insens)
-            {
-              /* If searching is case-insensitive, we should */
-              /* compare buffers in the same cases. */
-              lowercase_buffer (__options->mb_content,
-                                strlen (__options->mb_content));
-            }
+          wcs2mbs (&mb_content, __options->content);
+
+          __options->content_search = strsearch_compile (mb_content,
+                                                         strlen (mb_content),
+                                                         case_insens);
+          free (mb_content);
         }
     }
 
+  /* Pre-filters are validated by dialog already */
+  if (!action_find_parse_size (__options->size, &__options->size_min,
+                               &__options->size_max) ||
+      !action_find_parse_age (__options->mtime, &__options->mtime_min,
+                              &__options->mtime_max) ||
+      !action_find_parse_age (__options->ctime, &__options->ctime_min,
+                              &__options->ctime_max) ||
+      !action_find_parse_owner (__options->owner, &__options->owner_uid))
+    {
+      result = ACTION_ERR;
+    }
+
+  __options->now = time (NULL);
+
   return result;
 }
 
 /**
- * Check any regexp from options matches file name
+ * Check any mask or regexp from options matches file name
  *
  * @param __name - name of file to operate with
  * @param __options - finding options
- * @return zero if no regexp matches file name, non-zero otherwise
+ * @return zero if no mask or regexp matches file name, non-zero otherwise
  */
 static BOOL
 check_name (const wchar_t *__name, const action_find_options_t *__options)
 {
   int i;
 
+  if (__options->file_glob)
+    {
+      return wglob_match (__options->file_glob, __name);
+    }
+
   for (i = 0; i < __options->re_file_count; ++i)
     {
-      if (wregexp_match (__options->re_file[i], __name))
+      if (wregexp_matcher_match (__options->file_matcher[i], __name))
         {
           /* File name matched by regular expression */
           return TRUE;
@@ -264,28 +605,157 @@ check_name (const wchar_t *__name, const action_find_options_t *__options)
   return FALSE;
 }
 
+/**
+ * Check status of file against pre-filters
+ *
+ * Pre-filters are checked before opening of file, so excluded files
+ * cost no reading at all.
+ *
+ * @param __stat - status of file
+ * @param __options - finding options
+ * @return zero if file is unwanted, non-zero otherwise
+ */
+static BOOL
+check_status (const vfs_stat_t *__stat,
+              const action_find_options_t *__options)
+{
+  __s64_t age;
+
+  if (__options->size_min >= 0 || __options->size_max >= 0)
+    {
+      /* Sizes of directories and special files are meaningless */
+      if (!S_ISREG (__stat->st_mode) ||
+          !IN_RANGE ((__s64_t)__stat->st_size,
+                     __options->size_min, __options->size_max))
+        {
+          return FALSE;
+        }
+    }
+
+  /* Files from the future are considered as just modified */
+  age = MAX (__options->now - __stat->st_mtime, 0) / SECONDS_PER_DAY;
+  if (!IN_RANGE (age, __options->mtime_min, __options->mtime_max))
+    {
+      return FALSE;
+    }
+
+  age = MAX (__options->now - __stat->st_ctime, 0) / SECONDS_PER_DAY;
+  if (!IN_RANGE (age, __options->ctime_min, __options->ctime_max))
+    {
+      return FALSE;
+    }
+
+  if (__options->owner_uid >= 0 && __stat->st_uid != __options->owner_uid)
+    {
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * Check if block is the first block of binary file
+ *
+ * @param __options - finding options
+ * @param __buf - the first block of file
+ * @param __len - length of block
+ * @return non-zero if binary files are skipped and block contains
+ * zero characters, zero otherwise
+ */
+static BOOL
+is_binary (const action_find_options_t *__options,
+           const char *__buf, size_t __len)
+{
+  return TEST_FLAG (__options->flags, AFF_SKIP_BINARY) &&
+    memchr (__buf, 0, MIN (__len, BINARY_PROBE_SIZE)) != NULL;
+}
+
+/**
+ * Check if scanning of content should be interrupted
+ *
+ * @param __ctx - context of scanning
+ * @return non-zero if scanning should be interrupted, zero otherwise
+ */
+static BOOL
+scan_interrupted (scan_context_t *__ctx)
+{
+  if (!__ctx->res_wnd)
+    {
+      /* Workers don't touch the interface */
+      return *__ctx->aborted;
+    }
+
+  hook_call (L"switch-task-hook", NULL);
+
+  return ACTION_PERFORMED (__ctx->res_wnd);
+}
+
+/**
+ * Map content of large file into memory
+ *
+ * Scanning of mapped content saves copying of every byte from page cache
+ * to buffer. Small files are read as usual because mapping costs more
+ * than copying of their content.
+ *
+ * Size is taken from opened file, because file could be changed since
+ * its status has been got. Scanning of mapped content should be guarded
+ * by GUARD_MAPPED_SCAN(), because file could be truncated while it is
+ * scanned.
+ *
+ * @param __file - descriptor of file
+ * @param __size - pointer to variable where size of mapped content
+ * will be stored
+ * @return address of mapped content, or NULL if file is small or
+ * it couldn't be mapped (so its content should be read)
+ */
+static const char*
+map_content (vfs_file_t __file, size_t *__size)
+{
+  vfs_stat_t stat;
+  void *addr;
+
+  if (vfs_fstat (__file, &stat) != VFS_OK ||
+      stat.st_size < MMAP_THRESHOLD ||
+      (__u64_t)stat.st_size > (vfs_size_t)-1)
+    {
+      return NULL;
+    }
+
+  if (vfs_mmap (__file, 0, stat.st_size, &addr) != VFS_OK)
+    {
+      /* Plugin doesn't support mapping or file is not mappable */
+      return NULL;
+    }
+
+  *__size = stat.st_size;
+
+  return addr;
+}
+
 /**
  * Check content of file in non-regexp mode
  *
  * @param __name - name of file to check
  * @param __full_name - full name of file
+ * @param __stat - status of file
  * @param __options - finding options
- * @param __res_wnd - window with search results
+ * @param __ctx - context of scanning
  * @return zero if file in unwanted, non-zero otherwise
  */
 static BOOL
 check_simple_content (const wchar_t *__name, const wchar_t *__full_name,
+                      const vfs_stat_t *__stat,
                       const action_find_options_t *__options,
-                      action_find_res_wnd_t *__res_wnd)
+                      scan_context_t *__ctx)
 {
-  int res;
-  BOOL matched = FALSE;
+  const strsearch_t *search = __options->content_search;
+  BOOL matched = FALSE, first = TRUE;
   vfs_file_t file;
+  sigjmp_buf guard;
+  const char *mapped;
   char *buf;
-  char read_buf[BUF_SIZE];
-  size_t content_len, content_hash;
-  size_t i, n, h, d;
-  size_t buf_len;
+  size_t keep, carry = 0, len, pos, size;
+  int res;
 
 #ifdef __FILE_OFFSET64
   file = vfs_open (__full_name, O_LAGEFILE, 0);
@@ -299,106 +769,313 @@ check_simple_content (const wchar_t *__name, const wchar_t *__full_name,
       return FALSE;
     }
 
-  content_len = strlen (__options->mb_content);
+  /* Occurrence could cross boundary of blocks, so the tail */
+  /* of previous block is kept before the new one */
+  keep = search->len ? search->len - 1 : 0;
+
+  if ((mapped = map_content (file, &size)))
+    {
+      /* Content disappeared while scanning isn't matched */
+      if (GUARD_MAPPED_SCAN (guard))
+        {
+          matched = FALSE;
+          goto unmap;
+        }
+
+      /* Blocks of mapped content just overlap */
+      for (pos = 0; pos < size; pos += BUF_SIZE)
+        {
+          len = MIN (BUF_SIZE + keep, size - pos);
+
+          if (!pos && is_binary (__options, mapped, len))
+            {
+              break;
+            }
+
+          if (strsearch_find (search, mapped + pos, len))
+            {
+              matched = TRUE;
+              break;
+            }
+
+          if (scan_interrupted (__ctx))
+            {
+              break;
+            }
+        }
+
+    unmap:
+      UNGUARD_MAPPED_SCAN ();
+      vfs_munmap (file, (void*)mapped, size);
+      vfs_close (file);
+
+      return matched;
+    }
+
+  buf = malloc (keep + BUF_SIZE);
+
+  for (;;)
+    {
+      res = vfs_read (file, buf + carry, BUF_SIZE);
+
+      /* There is no new data to search in */
+      if (res <= 0)
+        {
+          break;
+        }
+
+      len = carry + res;
+
+      if (first && is_binary (__options, buf, len))
+        {
+          break;
+        }
+      first = FALSE;
+
+      if (strsearch_find (search, buf, len))
+        {
+          matched = TRUE;
+          break;
+        }
+
+      carry = MIN (keep, len);
+      memmove (buf, buf + len - carry, carry);
+
+      if (scan_interrupted (__ctx))
+        {
+          break;
+        }
+    }
+
+  vfs_close (file);
+  free (buf);
+
+  return matched;
+}
+
+/**
+ * Count lines in buffer
+ *
+ * @param __buf - buffer to count lines in
+ * @param __len - length of buffer
+ * @param __last - pointer to variable where offset of character after
+ * the last newline will be stored (zero if there is no newlines)
+ * @return count of newline characters in buffer
+ */
+static __u64_t
+count_lines (const char *__buf, size_t __len, size_t *__last)
+{
+  const char *ptr = __buf, *end = __buf + __len;
+  __u64_t count = 0;
+
+  *__last = 0;
+
+  while ((ptr = memchr (ptr, '\n', end - ptr)))
+    {
+      ++ptr;
+      ++count;
+      *__last = ptr - __buf;
+    }
+
+  return count;
+}
 
-  buf = malloc (content_len + BUF_SIZE);
+/**
+ * Get end of the last complete line in block of content
+ *
+ * @param __buf - block of content
+ * @param __len - length of block
+ * @param __eof - block is the last one in file
+ * @return length of part of block with complete lines,
+ * zero if there is no complete lines
+ */
+static size_t
+get_lines_end (const char *__buf, size_t __len, BOOL __eof)
+{
+  const char *last_nl;
 
-  /* Calculate hash for content to search */
-  content_hash = 0;
-  for (i = 0; i < content_len; ++i)
+  if (__eof)
     {
-      content_hash += (unsigned char)__options->mb_content[i];
+      /* File is over, so the last line is complete */
+      return __len;
     }
 
-  /* Read initial buffer */
-  res = vfs_read (file, buf, content_len);
-  if (res == content_len)
+  last_nl = memrchr (__buf, '\n', __len);
+
+  if (!last_nl && __len == RE_BUF_SIZE)
     {
-      bool case_insens;
-      case_insens = !TEST_FLAG (__options->flags,
-                                AFF_CONTENT_CASE_SENSITIVE);
+      /* The whole block is occupied by one line */
+      return __len;
+    }
+
+  return last_nl ? last_nl - __buf + 1 : 0;
+}
 
-      /* If initial buffer less than content length */
-      /* we can't operate */
+/**
+ * Match regular expression against block of complete lines
+ *
+ * @param __ctx - context of scanning
+ * @param __buf - block of content
+ * @param __len - length of block
+ * @param __line - number of the first line of block,
+ * advanced to the number of the first line of the next block
+ * @param __line_offset - offset of the beginning of block in its first
+ * line, advanced to offset of the beginning of the next block
+ * @param __match - pointer to variable where location of occurrence
+ * will be stored
+ * @return non-zero if occurrence has been found, zero otherwise
+ */
+static BOOL
+match_lines (scan_context_t *__ctx, const char *__buf, size_t __len,
+             __u64_t *__line, __u64_t *__line_offset,
+             content_match_t *__match)
+{
+  size_t start, last;
+  __u64_t lines;
+
+  /* Length of block is passed explicitly, so zero characters */
+  /* don't stop matching */
+  if (__len && regexp_matcher_exec (__ctx->matcher,
+                                    __buf, __len, &start, NULL))
+    {
+      lines = count_lines (__buf, start, &last);
+      __match->line = *__line + lines;
+      __match->column = (lines ? 0 : *__line_offset) + start - last + 1;
+      return TRUE;
+    }
+
+  /* Line could be continued in the next block */
+  /* if it's longer than buffer */
+  lines = count_lines (__buf, __len, &last);
+  *__line += lines;
+  *__line_offset = (lines ? 0 : *__line_offset) + __len - last;
+
+  return FALSE;
+}
+
+/**
+ * Check content of file in regexp mode
+ *
+ * File is scanned by blocks of complete lines, so occurrences are never
+ * split by boundaries of read buffers. Incomplete last line of block is
+ * kept for the next reading. Only lines longer than buffer are split.
+ *
+ * @param __name - name of file to check
+ * @param __full_name - full name of file
+ * @param __stat - status of file
+ * @param __options - finding options
+ * @param __match - pointer to variable where location of occurrence
+ * will be stored
+ * @param __ctx - context of scanning
+ * @return zero if file in unwanted, non-zero otherwise
+ */
+static BOOL
+check_regexp_content (const wchar_t *__name, const wchar_t *__full_name,
+                      const vfs_stat_t *__stat,
+                      const action_find_options_t *__options,
+                      content_match_t *__match,
+                      scan_context_t *__ctx)
+{
+  vfs_file_t file;
+  sigjmp_buf guard;
+  const char *mapped;
+  char *buf;
+  int res;
+  size_t carry = 0, len, end, pos, size;
+  /* Number of current line and offset of the beginning */
+  /* of block in it */
+  __u64_t line = 1, line_offset = 0;
+  BOOL matched = FALSE, eof = FALSE, first = TRUE;
+
+#ifdef __FILE_OFFSET64
+  file = vfs_open (__full_name, O_LAGEFILE, 0);
+#else
+  file = vfs_open (__full_name, 0, 0);
+#endif
 
-      buf_len = content_len;
-      buf[buf_len] = 0;
+  if (file == NULL)
+    {
+      /* Error opening file */
+      return FALSE;
+    }
 
-      /* Calculate hash of initial buffer */
-      h = 0;
-      for (i = 0; i < buf_len; ++i)
+  if ((mapped = map_content (file, &size)))
+    {
+      /* Content disappeared while scanning isn't matched */
+      if (GUARD_MAPPED_SCAN (guard))
         {
-          if (case_insens)
-            {
-              buf[i] = tolower (buf[i]);
-            }
-          h += (unsigned char)buf[i];
+          matched = FALSE;
+          goto unmap;
         }
 
-      for (;;)
+      for (pos = 0; pos < size; pos += end)
         {
-          n = buf_len - content_len;
-          for (i = 0; i <= n; ++i)
-            {
-              /* IF hashes are equal, we can't guarantee strings are equal */
-              /* We should ensure in it */
-              if (h == content_hash)
-                {
-                  if (!strncmp (buf + i, __options->mb_content, content_len) )
-                    {
-                      matched = TRUE;
-                      break;
-                    }
-                }
-              else
-                {
-                  h -= (unsigned char)buf[i];
-                  h += (unsigned char)buf[i + content_len];
-                }
-            }
+          len = MIN (RE_BUF_SIZE, size - pos);
 
-          if (matched)
+          if (!pos && is_binary (__options, mapped, len))
             {
-              /* If file contains needed content, */
-              /* we can break this stupid cycle */
               break;
             }
 
-          hook_call (L"switch-task-hook", NULL);
+          end = get_lines_end (mapped + pos, len, pos + len == size);
 
-          if (ACTION_PERFORMED (__res_wnd))
+          if (match_lines (__ctx, mapped + pos, end,
+                           &line, &line_offset, __match))
             {
+              matched = TRUE;
               break;
             }
 
-          /* Read next buffer */
-          res = vfs_read (file, read_buf, BUF_SIZE);
-
-          /* There is no new buffer to use */
-          if (res <= 0)
+          if (scan_interrupted (__ctx))
             {
               break;
             }
+        }
 
-          read_buf[res] = 0;
+    unmap:
+      UNGUARD_MAPPED_SCAN ();
+      vfs_munmap (file, (void*)mapped, size);
+      vfs_close (file);
 
-          if (case_insens)
-            {
-              lowercase_buffer (read_buf, res);
-            }
+      return matched;
+    }
 
-          /* Shift overviewed buffer */
-          d = buf_len - content_len + 1;
-          for (i = 0; i < buf_len - d; ++i)
-            {
-              buf[i] = buf[i + d];
-            }
+  buf = malloc (RE_BUF_SIZE);
 
-          /* Append new data */
-          memcpy (buf + i, read_buf, res + 1);
+  while (!eof)
+    {
+      /* Read next buffer from file after incomplete line */
+      res = vfs_read (file, buf + carry, RE_BUF_SIZE - carry);
 
-          h += (unsigned char)buf[content_len - 1];
-          buf_len += res - d;
+      if (res <= 0)
+        {
+          /* Assume file is over, but its last line should be checked */
+          eof = TRUE;
+          res = 0;
+        }
+
+      len = carry + res;
+
+      if (first && is_binary (__options, buf, len))
+        {
+          break;
+        }
+      first = FALSE;
+
+      end = get_lines_end (buf, len, eof);
+
+      if (match_lines (__ctx, buf, end, &line, &line_offset, __match))
+        {
+          matched = TRUE;
+          break;
+        }
+
+      carry = len - end;
+      memmove (buf, buf + end, carry);
+
+      if (scan_interrupted (__ctx))
+        {
+          break;
         }
     }
 
@@ -409,24 +1086,33 @@ check_simple_content (const wchar_t *__name, const wchar_t *__full_name,
 }
 
 /**
- * Check content of file in regexp mode
+ * Check content of file in words mode
  *
  * @param __name - name of file to check
  * @param __full_name - full name of file
+ * @param __stat - status of file
  * @param __options - finding options
- * @param __res_wnd - window with search results
+ * @param __match - pointer to variable where list of occurred words
+ * will be stored
+ * @param __ctx - context of scanning
  * @return zero if file in unwanted, non-zero otherwise
  */
 static BOOL
-check_regexp_content (const wchar_t *__name, const wchar_t *__full_name,
-                      const action_find_options_t *__options,
-                      action_find_res_wnd_t *__res_wnd)
+check_words_content (const wchar_t *__name, const wchar_t *__full_name,
+                     const vfs_stat_t *__stat,
+                     const action_find_options_t *__options,
+                     content_match_t *__match,
+                     scan_context_t *__ctx)
 {
+  const acsearch_t *automaton = __options->content_automaton;
   vfs_file_t file;
-  char buf[RE_BUF_SIZE];
-  char *pchar;
-  int res, i;
-  BOOL matched = FALSE, finito = FALSE;
+  sigjmp_buf guard;
+  const char *mapped, *block;
+  char *buf = NULL, *hits;
+  int res;
+  unsigned int state = 0;
+  size_t i, hit_count = 0, len = 0, pos = 0, size = 0;
+  BOOL first = TRUE;
 
 #ifdef __FILE_OFFSET64
   file = vfs_open (__full_name, O_LAGEFILE, 0);
@@ -434,129 +1120,240 @@ check_regexp_content (const wchar_t *__name, const wchar_t *__full_name,
   file = vfs_open (__full_name, 0, 0);
 #endif
 
-  if (file == NULL)
+  if (!file)
     {
       /* Error opening file */
       return FALSE;
     }
 
-  for (;;)
+  MALLOC_ZERO (hits, MAX (automaton->count, 1));
+
+  if ((mapped = map_content (file, &size)))
+    {
+      /* Words are not reported from content disappeared */
+      /* while scanning */
+      if (GUARD_MAPPED_SCAN (guard))
+        {
+          hit_count = 0;
+          goto unmap;
+        }
+    }
+  else
     {
-      /* Read next buffer from file */
-      res = vfs_read (file, buf, RE_BUF_SIZE - 1);
+      buf = malloc (BUF_SIZE);
+    }
 
-      if (res <= 0)
+  /* Whole file is scanned to know all occurred words, */
+  /* unless all of them have been found */
+  while (hit_count < automaton->nonempty)
+    {
+      if (mapped)
+        {
+          /* State of automaton is kept between blocks, */
+          /* so mapped content is just split */
+          block = mapped + pos;
+          res = MIN (BUF_SIZE, size - pos);
+          pos += res;
+        }
+      else
+        {
+          block = buf;
+          res = vfs_read (file, buf, BUF_SIZE);
+        }
+
+      if (res <= 0 || (first && is_binary (__options, block, res)))
         {
-          /* Assume file is over and we should stop greping */
           break;
         }
+      first = FALSE;
 
-      buf[res] = 0;
-      pchar = buf;
-      i = 0;
+      acsearch_scan (automaton, &state, block, res, hits, &hit_count);
 
-      for (;;)
+      if (scan_interrupted (__ctx))
         {
-          /*
-           * TODO: Or we should split read buffer onto separate strings?
-           */
+          break;
+        }
+    }
 
-          if (regexp_match (__options->re_content, pchar))
+unmap:
+  if (mapped)
+    {
+      UNGUARD_MAPPED_SCAN ();
+      vfs_munmap (file, (void*)mapped, size);
+    }
+
+  vfs_close (file);
+  SAFE_FREE (buf);
+
+  if (hit_count)
+    {
+      /* Build list of occurred words */
+      for (i = 0; i < automaton->count; ++i)
+        {
+          if (hits[i])
             {
-              matched = TRUE;
-              break;
+              len += wcslen (__options->content_words[i]) + 2;
             }
+        }
+
+      __match->words = malloc ((len + 1) * sizeof (wchar_t));
+      __match->words[0] = 0;
 
-          /* Read buffer could contain zero characters */
-          /* We should overview all parts of buffer */
-          /* (between all pairs of zero characters ) */
-          for (; i < res; ++i)
+      for (i = 0; i < automaton->count; ++i)
+        {
+          if (hits[i])
             {
-              if (buf[i] == 0)
+              if (__match->words[0])
                 {
-                  break;
+                  wcscat (__match->words, L", ");
                 }
+              wcscat (__match->words, __options->content_words[i]);
             }
+        }
+    }
 
-          if (i >= res)
-            {
-              /* Buffer is over */
-              break;
-            }
+  free (hits);
+
+  return hit_count > 0;
+}
+
+/**
+ * Check if regular file is a text file
+ *
+ * Used when binary files should be skipped, but content
+ * isn't searched, so only the first block of file is read.
+ *
+ * @param __full_name - full name of file
+ * @return zero if file is binary or it couldn't be read,
+ * non-zero otherwise
+ */
+static BOOL
+check_text_file (const wchar_t *__full_name)
+{
+  vfs_file_t file;
+  char buf[BINARY_PROBE_SIZE];
+  int res;
+
+#ifdef __FILE_OFFSET64
+  file = vfs_open (__full_name, O_LAGEFILE, 0);
+#else
+  file = vfs_open (__full_name, 0, 0);
+#endif
 
-          ++i;
-          pchar = buf + i;
+  if (!file)
+    {
+      /* Error opening file */
+      return FALSE;
+    }
+
+  res = vfs_read (file, buf, BINARY_PROBE_SIZE);
+  vfs_close (file);
 
-          hook_call (L"switch-task-hook", NULL);
+  return res >= 0 && !memchr (buf, 0, res);
+}
 
-          if (ACTION_PERFORMED (__res_wnd))
-            {
-              finito = TRUE;
-              break;
-            }
-        }
+/**
+ * Check if content of regular files should be read
+ *
+ * @param __options - finding options
+ * @return non-zero if content should be read, zero otherwise
+ */
+static BOOL
+need_content (const action_find_options_t *__options)
+{
+  return wcscmp (__options->content, L"") ||
+    TEST_FLAG (__options->flags, AFF_SKIP_BINARY);
+}
 
-      if (finito)
-        {
-          break;
-        }
+/**
+ * Check content of regular file
+ *
+ * @param __name - name of file to check
+ * @param __full_name - full name of file
+ * @param __stat - status of file
+ * @param __options - finding options
+ * @param __match - pointer to variable where location of occurrence
+ * of content will be stored
+ * @param __ctx - context of scanning
+ * @return zero if file in unwanted, non-zero otherwise
+ */
+static BOOL
+check_content (const wchar_t *__name, const wchar_t *__full_name,
+               const vfs_stat_t *__stat,
+               const action_find_options_t *__options,
+               content_match_t *__match, scan_context_t *__ctx)
+{
+  if (!wcscmp (__options->content, L""))
+    {
+      /* Only binary files are filtered out */
+      return check_text_file (__full_name);
     }
 
-  vfs_close (file);
+  if (TEST_FLAG (__options->flags, AFF_CONTENT_REGEXP))
+    {
+      return check_regexp_content (__name, __full_name, __stat, __options,
+                                   __match, __ctx);
+    }
+  else if (TEST_FLAG (__options->flags, AFF_CONTENT_WORDS))
+    {
+      return check_words_content (__name, __full_name, __stat, __options,
+                                  __match, __ctx);
+    }
 
-  return matched;
+  return check_simple_content (__name, __full_name, __stat, __options,
+                               __ctx);
 }
 
 /**
  * Check is regular file satisfy needed parameters
  *
+ * Name of file is checked by caller before getting of its status.
+ *
  * @param __name - name of file to check
  * @param __full_name - full name of file
+ * @param __stat - status of file
  * @param __options - finding options
- * @param __res_wnd - window with search results
+ * @param __match - pointer to variable where location of occurrence
+ * of content will be stored
+ * @param __ctx - context of scanning
  * @return zero if file in unwanted, non-zero otherwise
  */
 static BOOL
 check_regular_file (const wchar_t *__name, const wchar_t *__full_name,
+                    const vfs_stat_t *__stat,
                     const action_find_options_t *__options,
-                    action_find_res_wnd_t *__res_wnd)
+                    content_match_t *__match, scan_context_t *__ctx)
 {
-  /* Check file name 'validness' */
-  if (!check_name (__name, __options))
+  /* Status is checked before opening of file */
+  if (!check_status (__stat, __options))
     {
-      /* File name is unwanted by user, so we need to */
-      /* do nothing else here */
       return FALSE;
     }
 
-  if (wcscmp (__options->content, L"") == 0)
+  if (!need_content (__options))
     {
       return TRUE;
     }
 
-  if (TEST_FLAG (__options->flags, AFF_CONTENT_REGEXP))
-    {
-      return check_regexp_content (__name, __full_name, __options, __res_wnd);
-    }
-  else
-    {
-      return check_simple_content (__name, __full_name, __options, __res_wnd);
-    }
-
-  return FALSE;
+  return check_content (__name, __full_name, __stat, __options,
+                        __match, __ctx);
 }
 
 /**
  * Check is special file satisfy needed parameters
  *
+ * Name of file is checked by caller before getting of its status.
+ *
  * @param __name - name of file to check
  * @param __full_name - full name of file
+ * @param __stat - status of file
  * @param __options - finding options
  * @param __res_wnd - window with search results
  * @return zero if special file in unwanted, non-zero otherwise
  */
 static BOOL
 check_special_file (const wchar_t *__name, const wchar_t *__full_name,
+                    const vfs_stat_t *__stat,
                     const action_find_options_t *__options,
                     action_find_res_wnd_t *__res_wnd)
 {
@@ -569,15 +1366,7 @@ check_special_file (const wchar_t *__name, const wchar_t *__full_name,
       return FALSE;
     }
 
-  /* Check directory name 'validness' */
-  if (!check_name (__name, __options))
-    {
-      /* Special file name is unwanted by user, so we need to */
-      /* do nothing else here */
-      return FALSE;
-    }
-
-  return TRUE;
+  return check_status (__stat, __options);
 }
 
 /**
@@ -585,17 +1374,20 @@ check_special_file (const wchar_t *__name, const wchar_t *__full_name,
  *
  * @param __name - name of directory to check
  * @param __full_name - full name of file
+ * @param __stat - status of directory
  * @param __options - finding options
  * @param __res_wnd - window with search results
  * @return zero if directory in unwanted, non-zero otherwise
  */
 static BOOL
 check_directory (const wchar_t *__name, const wchar_t *__full_name,
+                 const vfs_stat_t *__stat,
                  const action_find_options_t *__options,
                  action_find_res_wnd_t *__res_wnd)
 {
   /* Checking of directory is the same as checking of special file */
-  return check_special_file (__name, __full_name, __options, __res_wnd);
+  return check_special_file (__name, __full_name, __stat, __options,
+                             __res_wnd);
 }
 
 /**
@@ -699,13 +1491,15 @@ free_items_values (w_list_t *__list)
  * @param __dir - directory where item has been found
  * @param __name - name of item
  * @param __stat - stat information of item
+ * @param __match - location of occurrence of content in item
  * @param __res_wnd - window with results
  */
 static void
 append_result (const wchar_t *__dir, const wchar_t *__name, vfs_stat_t __stat,
+               const content_match_t *__match,
                action_find_res_wnd_t *__res_wnd)
 {
-  wchar_t *string, *dummy;
+  wchar_t *string, *dummy, *name;
   size_t len, tmp_len;
   wchar_t buf[128];
   wchar_t suffix;
@@ -743,9 +1537,30 @@ append_result (const wchar_t *__dir, const wchar_t *__name, vfs_stat_t __stat,
 
   prepare_row (string, len);
 
-  /* Name of file */
-  fit_dirname (__name, __res_wnd->list->position.width / 2, dummy);
+  /* Name of file followed by location of occurrence of content */
+  /* or by words occurred in file */
+  if (__match->words)
+    {
+      tmp_len = wcslen (__name) + wcslen (__match->words) + 4;
+      name = malloc ((tmp_len + 1) * sizeof (wchar_t));
+      swprintf (name, tmp_len, L"%ls [%ls]", __name, __match->words);
+    }
+  else if (__match->line)
+    {
+      tmp_len = wcslen (__name) + 42;
+      name = malloc ((tmp_len + 1) * sizeof (wchar_t));
+      swprintf (name, tmp_len, L"%ls:%llu:%llu", __name,
+                (unsigned long long)__match->line,
+                (unsigned long long)__match->column);
+    }
+  else
+    {
+      name = wcsdup (__name);
+    }
+
+  fit_dirname (name, __res_wnd->list->position.width / 2, dummy);
   print_cell (string, dummy, 4, len);
+  free (name);
 
   /* Mode of file */
   umasktowcs (__stat.st_mode, buf);
@@ -793,49 +1608,551 @@ set_status (action_find_res_wnd_t *__res_wnd, const wchar_t *__format, ...)
 {
   wchar_t buf[1024];
 
-  PACK_ARGS(__format, buf, BUF_LEN (buf));
+  PACK_ARGS(__format, buf, BUF_LEN (buf));
+
+  w_text_set (__res_wnd->status, buf);
+}
+
+static void
+set_searching_status (action_find_res_wnd_t *__res_wnd,
+                      const wchar_t *__action, const wchar_t *__path)
+{
+  wchar_t format[1024], path[1024];
+  size_t width;
+
+  swprintf (format, BUF_LEN (format), L"%ls: %%ls", __action);
+
+  width = wcswidth (format, wcslen (format));
+  fit_dirname (__path,
+               __res_wnd->window->position.width - 6 - width, path);
+
+  set_status (__res_wnd, _(format), path);
+}
+
+/**
+ * Wait for done jobs or for period of updating of interface
+ *
+ * NOTE: Mutex of engine should be locked.
+ *
+ * @param __engine - engine of find
+ */
+static void
+wait_done (find_engine_t *__engine)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+
+  ts.tv_nsec += FIND_WAIT_PERIOD * 1000000L;
+  if (ts.tv_nsec >= 1000000000L)
+    {
+      ++ts.tv_sec;
+      ts.tv_nsec -= 1000000000L;
+    }
+
+  pthread_cond_timedwait (&__engine->done_cond, &__engine->mutex, &ts);
+}
+
+/**
+ * Worker which scans content of files
+ *
+ * @param __arg - engine of find
+ * @return NULL
+ */
+static void*
+find_worker (void *__arg)
+{
+  find_engine_t *engine = __arg;
+  scan_context_t ctx;
+  find_job_t *job;
+  sigset_t set;
+
+  /* All signals are handled by the main thread */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+  /* ...except of SIGBUS raised by truncation of mapped file, */
+  /* which could be delivered only to the thread which scans it */
+  sigemptyset (&set);
+  sigaddset (&set, SIGBUS);
+  pthread_sigmask (SIG_UNBLOCK, &set, NULL);
+
+  /* Matchers of regular expressions can't be shared between threads */
+  ctx.matcher = regexp_matcher_create (engine->options->re_content);
+  ctx.res_wnd = NULL;
+  ctx.aborted = &engine->aborted;
+
+  pthread_mutex_lock (&engine->mutex);
+
+  for (;;)
+    {
+      job = deque_pop_front (engine->jobs);
+
+      if (!job)
+        {
+          if (engine->walked)
+            {
+              break;
+            }
+
+          pthread_cond_wait (&engine->job_cond, &engine->mutex);
+          continue;
+        }
+
+      --engine->queued;
+
+      pthread_mutex_unlock (&engine->mutex);
+
+      /* Rest of files are skipped quickly after aborting */
+      if (!engine->aborted)
+        {
+          job->matched = check_content (job->name, job->full_name,
+                                        &job->stat, engine->options,
+                                        &job->match, &ctx);
+        }
+
+      pthread_mutex_lock (&engine->mutex);
+
+      --job->batch->pending;
+      pthread_cond_signal (&engine->done_cond);
+    }
+
+  pthread_mutex_unlock (&engine->mutex);
+
+  regexp_matcher_free (ctx.matcher);
+
+  return NULL;
+}
+
+/**
+ * Initialize engine of find and start its workers
+ *
+ * @param __engine - engine to initialize
+ * @param __options - finding options
+ * @param __res_wnd - window with results
+ */
+static void
+init_engine (find_engine_t *__engine, const action_find_options_t *__options,
+             action_find_res_wnd_t *__res_wnd)
+{
+  long i, count, cpus;
+  struct sigaction action;
+
+  memset (__engine, 0, sizeof (find_engine_t));
+
+  __engine->options = __options;
+  __engine->ctx.matcher = __options->content_matcher;
+  __engine->ctx.res_wnd = __res_wnd;
+  __engine->ctx.aborted = &__engine->aborted;
+
+  /* Mapped files could be truncated while scanning their content */
+  memset (&action, 0, sizeof (action));
+  action.sa_handler = sigbus_handler;
+  sigemptyset (&action.sa_mask);
+  sigaction (SIGBUS, &action, &__engine->old_sigbus);
+
+  /* Only scanning of content is worth to be done in parallel, */
+  /* names and status are checked by walker. Detection of binary */
+  /* files reads just a small block, so it's done by walker too. */
+  if (!wcscmp (__options->content, L""))
+    {
+      return;
+    }
+
+  /* Workers wait for input/output as well, */
+  /* so at least two of them are useful even on single CPU */
+  cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  count = MIN (MAX (cpus, 2), FIND_MAX_WORKERS);
+
+  pthread_mutex_init (&__engine->mutex, NULL);
+  pthread_cond_init (&__engine->job_cond, NULL);
+  pthread_cond_init (&__engine->done_cond, NULL);
+
+  __engine->jobs = deque_create ();
+  __engine->batches = deque_create ();
+
+  for (i = 0; i < count; ++i)
+    {
+      if (!pthread_create (&__engine->workers[__engine->workers_count],
+                           NULL, find_worker, __engine))
+        {
+          ++__engine->workers_count;
+        }
+    }
+}
+
+/**
+ * Start batch of files of directory
+ *
+ * @param __engine - engine of find
+ * @param __rel_dir - relative name of directory
+ * @return started batch
+ */
+static find_batch_t*
+open_batch (find_engine_t *__engine, const wchar_t *__rel_dir)
+{
+  find_batch_t *batch;
+
+  MALLOC_ZERO (batch, sizeof (find_batch_t));
+  batch->rel_dir = wcsdup (__rel_dir);
+
+  pthread_mutex_lock (&__engine->mutex);
+  deque_push_back (__engine->batches, batch);
+  pthread_mutex_unlock (&__engine->mutex);
+
+  return batch;
+}
+
+/**
+ * Mark batch as complete, so its results could be shown
+ * when workers finish scanning of its files
+ *
+ * @param __engine - engine of find
+ * @param __batch - batch to close
+ */
+static void
+close_batch (find_engine_t *__engine, find_batch_t *__batch)
+{
+  pthread_mutex_lock (&__engine->mutex);
+  __batch->closed = TRUE;
+  pthread_mutex_unlock (&__engine->mutex);
+}
+
+/**
+ * Show results of finished batches
+ *
+ * Results are shown in order of walking, and results of each
+ * directory are shown in alphabetical order.
+ *
+ * @param __engine - engine of find
+ */
+static void
+flush_results (find_engine_t *__engine)
+{
+  action_find_res_wnd_t *res_wnd = __engine->ctx.res_wnd;
+  find_batch_t *batch;
+  find_job_t *job;
+  int i;
+
+  /* Compare jobs by places of files in listing */
+  int compar_index (const void *__a, const void *__b)
+    {
+      return (*(find_job_t**)__a)->index - (*(find_job_t**)__b)->index;
+    }
+
+  for (;;)
+    {
+      pthread_mutex_lock (&__engine->mutex);
+
+      batch = deque_head (__engine->batches) ?
+        deque_data (deque_head (__engine->batches)) : NULL;
+
+      if (!batch || !batch->closed || batch->pending)
+        {
+          pthread_mutex_unlock (&__engine->mutex);
+          break;
+        }
+
+      deque_pop_front (__engine->batches);
+
+      pthread_mutex_unlock (&__engine->mutex);
+
+      qsort (batch->jobs, batch->count, sizeof (find_job_t*), compar_index);
+
+      res_wnd->dir_opened = FALSE;
+
+      for (i = 0; i < batch->count; ++i)
+        {
+          job = batch->jobs[i];
+
+          if (job->matched)
+            {
+              append_result (batch->rel_dir, job->name, job->stat,
+                             &job->match, res_wnd);
+
+              if (!job->found)
+                {
+                  ++res_wnd->found_files;
+                }
+            }
+
+          SAFE_FREE (job->match.words);
+          free (job->name);
+          SAFE_FREE (job->full_name);
+          free (job);
+        }
+
+      SAFE_FREE (batch->jobs);
+      free (batch->rel_dir);
+      free (batch);
+    }
+}
+
+/**
+ * Append new job to batch
+ *
+ * NOTE: Mutex of engine should be locked.
+ *
+ * @param __batch - batch of directory of entry
+ * @param __index - index of entry in alphabetically sorted listing
+ * @param __name - name of entry
+ * @param __stat - status of entry
+ * @return appended job
+ */
+static find_job_t*
+append_job (find_batch_t *__batch, int __index, const wchar_t *__name,
+            const vfs_stat_t *__stat)
+{
+  find_job_t *job;
+
+  MALLOC_ZERO (job, sizeof (find_job_t));
+  job->batch = __batch;
+  job->index = __index;
+  job->name = wcsdup (__name);
+  job->stat = *__stat;
+
+  if (__batch->count == __batch->allocated)
+    {
+      __batch->allocated = MAX (__batch->allocated * 2, 16);
+      __batch->jobs = realloc (__batch->jobs,
+                               __batch->allocated * sizeof (find_job_t*));
+    }
+
+  __batch->jobs[__batch->count++] = job;
+
+  return job;
+}
+
+/**
+ * Put entry which is found without scanning of content to batch,
+ * so it's shown in order with the rest of results of directory
+ *
+ * @param __engine - engine of find
+ * @param __batch - batch of directory of entry
+ * @param __index - index of entry in alphabetically sorted listing
+ * @param __name - name of entry
+ * @param __stat - status of entry
+ * @param __match - location of occurrence of content, list of occurred
+ * words is taken over
+ */
+static void
+submit_found (find_engine_t *__engine, find_batch_t *__batch, int __index,
+              const wchar_t *__name, const vfs_stat_t *__stat,
+              content_match_t *__match)
+{
+  find_job_t *job;
+
+  pthread_mutex_lock (&__engine->mutex);
+
+  job = append_job (__batch, __index, __name, __stat);
+  job->matched = TRUE;
+  job->found = TRUE;
+  job->match = *__match;
+  __match->words = NULL;
+
+  pthread_mutex_unlock (&__engine->mutex);
+}
+
+/**
+ * Send file to workers for scanning of its content
+ *
+ * Walking waits while queue of workers is full.
+ *
+ * @param __engine - engine of find
+ * @param __batch - batch of directory of file
+ * @param __index - index of file in alphabetically sorted listing
+ * @param __name - name of file
+ * @param __full_name - full name of file
+ * @param __stat - status of file
+ */
+static void
+submit_job (find_engine_t *__engine, find_batch_t *__batch, int __index,
+            const wchar_t *__name, const wchar_t *__full_name,
+            const vfs_stat_t *__stat)
+{
+  find_job_t *job;
+
+  pthread_mutex_lock (&__engine->mutex);
+
+  while (__engine->queued >= FIND_QUEUE_LENGTH && !__engine->aborted)
+    {
+      wait_done (__engine);
+
+      /* Interface should be alive while waiting */
+      pthread_mutex_unlock (&__engine->mutex);
+
+      flush_results (__engine);
+
+      if (scan_interrupted (&__engine->ctx))
+        {
+          __engine->aborted = TRUE;
+        }
+
+      pthread_mutex_lock (&__engine->mutex);
+    }
+
+  if (__engine->aborted)
+    {
+      pthread_mutex_unlock (&__engine->mutex);
+      return;
+    }
+
+  job = append_job (__batch, __index, __name, __stat);
+  job->full_name = wcsdup (__full_name);
+  ++__batch->pending;
+
+  deque_push_back (__engine->jobs, job);
+  ++__engine->queued;
+
+  pthread_cond_signal (&__engine->job_cond);
+
+  pthread_mutex_unlock (&__engine->mutex);
+}
+
+/**
+ * Wait for workers to scan the rest of files and stop them
+ * Action of SIGBUS which was set before finding is restored.
+ *
+ * @param __engine - engine of find
+ */
+static void
+finish_engine (find_engine_t *__engine)
+{
+  int i;
+
+  if (!__engine->jobs)
+    {
+      /* Content has been scanned by the main thread */
+      sigaction (SIGBUS, &__engine->old_sigbus, NULL);
+      return;
+    }
+
+  pthread_mutex_lock (&__engine->mutex);
+  __engine->walked = TRUE;
+  pthread_cond_broadcast (&__engine->job_cond);
+  pthread_mutex_unlock (&__engine->mutex);
+
+  /* Results are shown while workers are scanning the rest of files */
+  for (;;)
+    {
+      flush_results (__engine);
+
+      pthread_mutex_lock (&__engine->mutex);
 
-  w_text_set (__res_wnd->status, buf);
-}
+      if (!deque_head (__engine->batches))
+        {
+          pthread_mutex_unlock (&__engine->mutex);
+          break;
+        }
 
-static void
-set_searching_status (action_find_res_wnd_t *__res_wnd,
-                      const wchar_t *__action, const wchar_t *__path)
-{
-  wchar_t format[1024], path[1024];
-  size_t width;
+      wait_done (__engine);
 
-  swprintf (format, BUF_LEN (format), L"%ls: %%ls", __action);
+      pthread_mutex_unlock (&__engine->mutex);
 
-  width = wcswidth (format, wcslen (format));
-  fit_dirname (__path,
-               __res_wnd->window->position.width - 6 - width, path);
+      if (scan_interrupted (&__engine->ctx))
+        {
+          __engine->aborted = TRUE;
+        }
+    }
 
-  set_status (__res_wnd, _(format), path);
+  for (i = 0; i < __engine->workers_count; ++i)
+    {
+      pthread_join (__engine->workers[i], NULL);
+    }
+
+  /* Nothing is mapped now, so handler of SIGBUS isn't needed */
+  sigaction (SIGBUS, &__engine->old_sigbus, NULL);
+
+  deque_destroy (__engine->jobs, 0);
+  deque_destroy (__engine->batches, 0);
+
+  pthread_cond_destroy (&__engine->job_cond);
+  pthread_cond_destroy (&__engine->done_cond);
+  pthread_mutex_destroy (&__engine->mutex);
 }
 
 /**
  * Recursive iteration for file finding
  *
+ * Entries of directory may be processed in order of their inodes
+ * (see action_walk_compar()), but results and subdirectories are
+ * always reported in alphabetical order.
+ *
  * @param __dir - directory to search file in
  * @param __rel_dir - relative director name to search file in
  * @param __options - finding options
+ * @param __guard - guard against cycles and crossing filesystems
+ * @param __engine - engine of find
  * @param __res_wnd - window with results
  * @return zero on success, non-zero otherwise
  */
 static int
 find_iteration (const wchar_t *__dir, const wchar_t *__rel_dir,
                 const action_find_options_t *__options,
+                action_walk_guard_t *__guard,
+                find_engine_t *__engine,
                 action_find_res_wnd_t *__res_wnd)
 {
-  int i, j, count;
+  int i, k, count, *order, found_count = 0, found_allocated = 0;
   vfs_dirent_t **eps = NULL;
   size_t fn_len;
   wchar_t *format, *full_name;
   vfs_stat_t stat;
   vfs_stat_proc stat_proc;
-  deque_t *dirs;
+  deque_t *dirs = NULL;
   wchar_t **dir_data;
+  BOOL inode_order, follow_symlinks, wanted, *drill = NULL;
+  found_entry_t *found = NULL;
+  find_batch_t *batch = NULL;
+  content_match_t match;
+
+  /* Compare entries by inode numbers */
+  int compar_ino (const void *__a, const void *__b)
+    {
+      ino_t a = eps[*(int*)__a]->ino, b = eps[*(int*)__b]->ino;
+      return a < b ? -1 : a > b;
+    }
+
+  /* Compare found entries by their places in listing */
+  int compar_index (const void *__a, const void *__b)
+    {
+      return ((found_entry_t*)__a)->index - ((found_entry_t*)__b)->index;
+    }
+
+  /* Report about found entry. List of occurred words is taken over. */
+  void found_entry (int __index, vfs_stat_t __stat,
+                    content_match_t *__match)
+    {
+      if (batch)
+        {
+          /* Results of files scanned by workers are shown later, */
+          /* so the rest of results waits for them */
+          submit_found (__engine, batch, __index, eps[__index]->name,
+                        &__stat, __match);
+          return;
+        }
+
+      if (!inode_order)
+        {
+          /* Entries are processed alphabetically, */
+          /* so result could be displayed at once */
+          append_result (__rel_dir, eps[__index]->name, __stat, __match,
+                         __res_wnd);
+          SAFE_FREE (__match->words);
+          return;
+        }
+
+      if (found_count == found_allocated)
+        {
+          found_allocated = MAX (found_allocated * 2, 16);
+          found = realloc (found, found_allocated * sizeof (found_entry_t));
+        }
+
+      found[found_count].index = __index;
+      found[found_count].stat = __stat;
+      found[found_count].match = *__match;
+      ++found_count;
+    }
 
   __res_wnd->dir_opened = FALSE;
 
@@ -853,13 +2170,34 @@ find_iteration (const wchar_t *__dir, const wchar_t *__rel_dir,
       return ACTION_ERR;
     }
 
+  /* Content of files is scanned by workers, all results of */
+  /* directory are shown when the whole batch is scanned */
+  if (__engine->workers_count)
+    {
+      batch = open_batch (__engine, __rel_dir);
+    }
+
+  /* Get order in which entries will be processed */
+  inode_order = action_get_inode_order ();
+  order = malloc (MAX (count, 1) * sizeof (int));
+  for (i = 0; i < count; ++i)
+    {
+      order[i] = i;
+    }
+
+  if (inode_order)
+    {
+      qsort (order, count, sizeof (int), compar_ino);
+    }
+
   if (TEST_FLAG(__options->flags, AFF_FIND_RECURSIVELY))
     {
-      dirs = deque_create ();
+      MALLOC_ZERO (drill, MAX (count, 1) * sizeof (BOOL));
     }
 
   /* Get function for stat'ing */
-  if (TEST_FLAG(__options->flags, AFF_FOLLOW_SYMLINKS))
+  follow_symlinks = TEST_FLAG(__options->flags, AFF_FOLLOW_SYMLINKS);
+  if (follow_symlinks)
     {
       stat_proc = vfs_stat;
     }
@@ -882,87 +2220,175 @@ find_iteration (const wchar_t *__dir, const wchar_t *__rel_dir,
       format = L"%ls/%ls";
     }
 
-  for (i = 0; i < count; ++i)
+  for (k = 0; k < count; ++k)
     {
+      i = order[k];
+
       if (IS_PSEUDODIR (eps[i]->name))
         {
-          vfs_free_dirent (eps[i]);
           continue;
         }
 
       set_searching_status (__res_wnd, L"Searching in", __rel_dir);
 
+      /* Name is checked before getting of status, */
+      /* so most of unwanted entries are skipped without it */
+      if (eps[i]->type == DT_DIR &&
+          !TEST_FLAG(__options->flags, AFF_FIND_DIRECTORIES))
+        {
+          wanted = FALSE;
+        }
+      else
+        {
+          wanted = check_name (eps[i]->name, __options);
+        }
+
+      if (!wanted && eps[i]->type != DT_UNKNOWN)
+        {
+          /* Unwanted entry is interesting only as directory */
+          /* to drill into, and type of entry is known from listing */
+          if (!drill || (eps[i]->type != DT_DIR &&
+                         (eps[i]->type != DT_LNK || !follow_symlinks)))
+            {
+              continue;
+            }
+
+          /* Status of real directory is needed only by guard */
+          /* against cycles and crossing filesystems */
+          if (eps[i]->type == DT_DIR &&
+              !action_walk_guard_need_stat (__guard))
+            {
+              drill[i] = TRUE;
+              continue;
+            }
+        }
+
       /* Get full file name */
       swprintf (full_name, fn_len, format, __dir, eps[i]->name);
 
       /* Stat current node of FS */
-      if (!stat_proc (full_name, &stat) == VFS_OK)
+      if (stat_proc (full_name, &stat) != VFS_OK)
         {
           /* Error getting status of file */
-          vfs_free_dirent (eps[i]);
           continue;
         }
 
+      if (!wanted && !S_ISDIR (stat.st_mode))
+        {
+          /* Type of entry was unknown before getting of its status */
+          continue;
+        }
+
+      memset (&match, 0, sizeof (match));
+
       if (S_ISREG (stat.st_mode))
         {
-          if (check_regular_file (eps[i]->name, full_name,
-                                  __options, __res_wnd))
+          if (batch)
+            {
+              /* Only files which pass pre-filters are opened */
+              if (check_status (&stat, __options))
+                {
+                  submit_job (__engine, batch, i, eps[i]->name,
+                              full_name, &stat);
+                }
+            }
+          else if (check_regular_file (eps[i]->name, full_name, &stat,
+                                       __options, &match, &__engine->ctx))
             {
-              append_result (__rel_dir, eps[i]->name, stat, __res_wnd);
+              found_entry (i, stat, &match);
               ++__res_wnd->found_files;
             }
         }
       else if (S_ISDIR (stat.st_mode))
         {
           /* Of user wants directories to be found... */
-          if (TEST_FLAG(__options->flags, AFF_FIND_DIRECTORIES))
+          if (wanted && TEST_FLAG(__options->flags, AFF_FIND_DIRECTORIES))
             {
-              if (check_directory (eps[i]->name, full_name,
+              if (check_directory (eps[i]->name, full_name, &stat,
                                    __options, __res_wnd))
                 {
-                  append_result (__rel_dir, eps[i]->name, stat, __res_wnd);
+                  found_entry (i, stat, &match);
                   ++__res_wnd->found_dirs;
                 }
             }
 
-          if (TEST_FLAG(__options->flags, AFF_FIND_RECURSIVELY))
+          /* Do not drill into symbolic link to directory which */
+          /* has been visited already and into other filesystems */
+          if (TEST_FLAG(__options->flags, AFF_FIND_RECURSIVELY) &&
+              action_walk_guard_enter (__guard, &stat))
             {
-              dir_data = malloc (2 * sizeof (wchar_t));
-              dir_data[0] = wcsdup (eps[i]->name);
-              dir_data[1] = wcsdup (full_name);
-              deque_push_back (dirs, (void*)dir_data);
+              drill[i] = TRUE;
             }
         }
       else
         {
-          if (check_special_file (eps[i]->name, full_name,
+          if (check_special_file (eps[i]->name, full_name, &stat,
                                   __options, __res_wnd))
             {
-              append_result (__rel_dir, eps[i]->name, stat, __res_wnd);
+              found_entry (i, stat, &match);
               ++__res_wnd->found_files;
             }
         }
 
-      vfs_free_dirent (eps[i]);
+      if (batch)
+        {
+          flush_results (__engine);
+        }
 
       hook_call (L"switch-task-hook", NULL);
 
       if (ACTION_PERFORMED (__res_wnd))
         {
-          /* Free remain dirents */
-          for (j = i + 1; j < count; ++j)
+          break;
+        }
+    }
+
+  if (batch)
+    {
+      close_batch (__engine, batch);
+    }
+
+  /* Display results in alphabetical order */
+  if (found_count)
+    {
+      qsort (found, found_count, sizeof (found_entry_t), compar_index);
+      for (k = 0; k < found_count; ++k)
+        {
+          append_result (__rel_dir, eps[found[k].index]->name,
+                         found[k].stat, &found[k].match, __res_wnd);
+          SAFE_FREE (found[k].match.words);
+        }
+    }
+
+  /* Collect subdirectories to drill into */
+  if (drill)
+    {
+      dirs = deque_create ();
+      for (i = 0; i < count; ++i)
+        {
+          if (drill[i])
             {
-              vfs_free_dirent (eps[j]);
+              swprintf (full_name, fn_len, format, __dir, eps[i]->name);
+              dir_data = malloc (2 * sizeof (wchar_t*));
+              dir_data[0] = wcsdup (eps[i]->name);
+              dir_data[1] = wcsdup (full_name);
+              deque_push_back (dirs, (void*)dir_data);
             }
-          break;
         }
     }
 
+  for (i = 0; i < count; ++i)
+    {
+      vfs_free_dirent (eps[i]);
+    }
+
   SAFE_FREE (eps);
+  SAFE_FREE (found);
+  SAFE_FREE (drill);
+  free (order);
   free (full_name);
 
-  if (TEST_FLAG(__options->flags, AFF_FIND_RECURSIVELY) &&
-      !ACTION_PERFORMED (__res_wnd))
+  if (dirs)
     {
       void *data;
       wchar_t *rel_name;
@@ -986,15 +2412,157 @@ find_iteration (const wchar_t *__dir, const wchar_t *__rel_dir,
         if (!ACTION_PERFORMED (__res_wnd))
           {
             swprintf (rel_name, fn_len, format, __rel_dir, dir_data[0]);
-            find_iteration (dir_data[1], rel_name, __options, __res_wnd);
+            find_iteration (dir_data[1], rel_name, __options,
+                            __guard, __engine, __res_wnd);
           }
+        free (dir_data[0]);
+        free (dir_data[1]);
         free (dir_data);
       deque_foreach_done
+
+      free (rel_name);
+      deque_destroy (dirs, 0);
     }
 
   return ACTION_OK;
 }
 
+/**
+ * Find files by index of file names
+ *
+ * Only names are checked by index, so entries which names match
+ * are checked further by their status.
+ *
+ * @param __dir - directory to search file in
+ * @param __options - finding options
+ * @param __res_wnd - window with results
+ * @return non-zero if search has been done, zero if index can't be used
+ */
+static BOOL
+find_in_index (const wchar_t *__dir, const action_find_options_t *__options,
+               action_find_res_wnd_t *__res_wnd)
+{
+  int i, count = 0, allocated = 0;
+  index_hit_t *hits = NULL;
+  wchar_t *prev_dir = NULL;
+  unsigned int flags = 0;
+  vfs_stat_proc stat_proc;
+  vfs_stat_t stat;
+  content_match_t match;
+  BOOL res, found;
+
+  /* Collect entry which name matches */
+  void collect (const wchar_t *__dir, const wchar_t *__rel_dir,
+                const wchar_t *__name, int __type)
+    {
+      if ((__type == AIT_DIR &&
+           !TEST_FLAG (__options->flags, AFF_FIND_DIRECTORIES)) ||
+          !check_name (__name, __options))
+        {
+          return;
+        }
+
+      if (count == allocated)
+        {
+          allocated = MAX (allocated * 2, 16);
+          hits = realloc (hits, allocated * sizeof (index_hit_t));
+        }
+
+      hits[count].rel_dir = wcsdup (__rel_dir);
+      hits[count].name = wcsdup (__name);
+      hits[count].full_name = wcdircatsubdir (__dir, __name);
+      ++count;
+    }
+
+  if (need_content (__options))
+    {
+      return FALSE;
+    }
+
+  if (TEST_FLAG (__options->flags, AFF_FIND_RECURSIVELY))
+    {
+      SET_FLAG (flags, AIW_RECURSIVE);
+    }
+
+  if (TEST_FLAG (__options->flags, AFF_ONE_FILESYSTEM))
+    {
+      SET_FLAG (flags, AIW_ONE_FILESYSTEM);
+    }
+
+  if (TEST_FLAG (__options->flags, AFF_FOLLOW_SYMLINKS))
+    {
+      SET_FLAG (flags, AIW_FOLLOW_SYMLINKS);
+      stat_proc = vfs_stat;
+    }
+  else
+    {
+      stat_proc = vfs_lstat;
+    }
+
+  res = action_index_walk (__dir, __options->start_at, flags, collect);
+
+  for (i = 0; res && i < count && !ACTION_PERFORMED (__res_wnd); ++i)
+    {
+      /* Index could be a bit behind filesystem */
+      if (stat_proc (hits[i].full_name, &stat) != VFS_OK)
+        {
+          continue;
+        }
+
+      if (S_ISREG (stat.st_mode))
+        {
+          found = check_status (&stat, __options);
+        }
+      else if (S_ISDIR (stat.st_mode))
+        {
+          found = TEST_FLAG (__options->flags, AFF_FIND_DIRECTORIES) &&
+            check_directory (hits[i].name, hits[i].full_name, &stat,
+                             __options, __res_wnd);
+        }
+      else
+        {
+          found = check_special_file (hits[i].name, hits[i].full_name,
+                                      &stat, __options, __res_wnd);
+        }
+
+      if (found)
+        {
+          /* Directory is shown once before its entries */
+          if (!prev_dir || wcscmp (prev_dir, hits[i].rel_dir))
+            {
+              __res_wnd->dir_opened = FALSE;
+              prev_dir = hits[i].rel_dir;
+            }
+
+          memset (&match, 0, sizeof (match));
+          append_result (hits[i].rel_dir, hits[i].name, stat, &match,
+                         __res_wnd);
+
+          if (S_ISDIR (stat.st_mode))
+            {
+              ++__res_wnd->found_dirs;
+            }
+          else
+            {
+              ++__res_wnd->found_files;
+            }
+        }
+
+      hook_call (L"switch-task-hook", NULL);
+    }
+
+  for (i = 0; i < count; ++i)
+    {
+      free (hits[i].rel_dir);
+      free (hits[i].name);
+      free (hits[i].full_name);
+    }
+
+  SAFE_FREE (hits);
+
+  return res;
+}
+
 /**
  * Process modal result of result list window
  *
@@ -1056,6 +2624,9 @@ make_find (file_panel_t *__panel,
            const wchar_t *__cwd, action_find_options_t *__options)
 {
   action_find_res_wnd_t *wnd;
+  action_walk_guard_t guard;
+  find_engine_t engine;
+  vfs_stat_t stat;
   wchar_t *dir;
   int res;
 
@@ -1064,7 +2635,27 @@ make_find (file_panel_t *__panel,
 
   dir = vfs_abs_path (__options->start_at, __cwd);
 
-  find_iteration (dir, __options->start_at, __options, wnd);
+  action_walk_guard_init (&guard,
+                          TEST_FLAG (__options->flags, AFF_ONE_FILESYSTEM),
+                          TEST_FLAG (__options->flags, AFF_FOLLOW_SYMLINKS));
+
+  /* Start directory is the root of walking */
+  if (vfs_stat (dir, &stat) == VFS_OK)
+    {
+      action_walk_guard_enter (&guard, &stat);
+    }
+
+  /* Name-only queries are answered by index if it is possible */
+  if (!find_in_index (dir, __options, wnd))
+    {
+      init_engine (&engine, __options, wnd);
+
+      find_iteration (dir, __options->start_at, __options, &guard,
+                      &engine, wnd);
+      finish_engine (&engine);
+    }
+
+  action_walk_guard_free (&guard);
 
   if (TEST_FLAG (__options->flags, AFF_FIND_DIRECTORIES))
     {
@@ -1096,6 +2687,82 @@ make_find (file_panel_t *__panel,
  * User's backend
  */
 
+/**
+ * Parse range of sizes of files
+ *
+ * Range is written as `min-max', `min-' or `-max', sizes could be
+ * followed by multipliers K, M and G.
+ *
+ * @param __str - string to parse
+ * @param __min - pointer to variable where minimal size will be stored
+ * @param __max - pointer to variable where maximal size will be stored
+ * @return non-zero if string is a valid range, zero otherwise
+ */
+BOOL
+action_find_parse_size (const wchar_t *__str,
+                        __s64_t *__min, __s64_t *__max)
+{
+  return parse_range (__str, TRUE, __min, __max);
+}
+
+/**
+ * Parse range of ages of files in days
+ *
+ * Range is written as `min-max', `min-' or `-max'. Age of files changed
+ * during the last day is zero.
+ *
+ * @param __str - string to parse
+ * @param __min - pointer to variable where minimal age will be stored
+ * @param __max - pointer to variable where maximal age will be stored
+ * @return non-zero if string is a valid range, zero otherwise
+ */
+BOOL
+action_find_parse_age (const wchar_t *__str,
+                       __s64_t *__min, __s64_t *__max)
+{
+  return parse_range (__str, FALSE, __min, __max);
+}
+
+/**
+ * Parse owner of files
+ *
+ * @param __str - name or ID of user, empty string means any user
+ * @param __uid - pointer to variable where ID of user will be stored
+ * (-1 if any user is accepted)
+ * @return non-zero if user exists, zero otherwise
+ */
+BOOL
+action_find_parse_owner (const wchar_t *__str, long *__uid)
+{
+  passwd_t *user;
+  wchar_t *end;
+
+  *__uid = -1;
+
+  if (!__str || !*__str)
+    {
+      return TRUE;
+    }
+
+  if (iswdigit (*__str))
+    {
+      *__uid = wcstol (__str, &end, 10);
+      return *end == 0;
+    }
+
+  user = get_user_info_by_name (__str);
+
+  if (!user)
+    {
+      return FALSE;
+    }
+
+  *__uid = user->uid;
+  free_user_info (user);
+
+  return TRUE;
+}
+
 /**
  * Find file operation
  *
@@ -1105,6 +2772,22 @@ make_find (file_panel_t *__panel,
  */
 int
 action_find (file_panel_t *__panel)
+{
+  return action_find_filtered (__panel, NULL);
+}
+
+/**
+ * Find file operation with initial values of pre-filters
+ *
+ * @param __panel - descriptor of file panel from which find operation
+ * has been called
+ * @param __filter - initial values of pre-filters in dialog,
+ * NULL for empty ones
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_find_filtered (file_panel_t *__panel,
+                      const action_find_filter_t *__filter)
 {
   action_find_options_t options;
   wchar_t *cwd;
@@ -1118,6 +2801,20 @@ action_find (file_panel_t *__panel)
   cwd = file_panel_get_full_cwd (__panel);
 
   memset (&options, 0, sizeof (options));
+
+  if (__filter)
+    {
+      options.size = __filter->size ? wcsdup (__filter->size) : NULL;
+      options.mtime = __filter->mtime ? wcsdup (__filter->mtime) : NULL;
+      options.ctime = __filter->ctime ? wcsdup (__filter->ctime) : NULL;
+      options.owner = __filter->owner ? wcsdup (__filter->owner) : NULL;
+
+      if (__filter->skip_binary)
+        {
+          SET_FLAG (options.flags, AFF_SKIP_BINARY);
+        }
+    }
+
   do
     {
       finito = TRUE;
@@ -18,6 +18,12 @@
 BEGIN_HEADER
 
 #include "regexp.h"
+#include "strsearch.h"
+#include "acsearch.h"
+#include "wglob.h"
+#include "file_panel.h"
+
+#include <time.h>
 
 #define AFF_MASK_REGEXP            0x0001
 #define AFF_MASK_CASE_SENSITIVE    0x0002
@@ -26,6 +32,9 @@ BEGIN_HEADER
 #define AFF_FIND_RECURSIVELY       0x0010
 #define AFF_FOLLOW_SYMLINKS        0x0020
 #define AFF_FIND_DIRECTORIES       0x0040
+#define AFF_ONE_FILESYSTEM         0x0080
+#define AFF_CONTENT_WORDS          0x0100
+#define AFF_SKIP_BINARY            0x0200
 
 typedef struct
 {
@@ -37,6 +46,10 @@ typedef struct
   wchar_t *content;
   wchar_t *start_at;
 
+  /* Pre-filters: ranges of size and of ages (in days) of modification */
+  /* and change of files, and their owner */
+  wchar_t *size, *mtime, *ctime, *owner;
+
   unsigned long flags;
 
   /* Precompiled options */
@@ -44,9 +57,59 @@ typedef struct
   int re_file_count;
   regexp_t *re_content;
 
-  char *mb_content;
+  /* Compiled masks of file names (not in regexp mode) */
+  wglob_t *file_glob;
+
+  /* Matchers of precompiled regular expressions */
+  regexp_matcher_t **file_matcher;
+  regexp_matcher_t *content_matcher;
+
+  strsearch_t *content_search;
+
+  /* Words to search in content in words mode and their automaton */
+  wchar_t **content_words;
+  acsearch_t *content_automaton;
+
+  /* Precompiled pre-filters, negative limits mean absence of limit */
+  __s64_t size_min, size_max;
+  __s64_t mtime_min, mtime_max;
+  __s64_t ctime_min, ctime_max;
+  long owner_uid;
+
+  /* Time from which ages of files are counted */
+  time_t now;
 } action_find_options_t;
 
+/* Initial values of pre-filters in find dialog */
+typedef struct
+{
+  wchar_t *size, *mtime, *ctime, *owner;
+  BOOL skip_binary;
+} action_find_filter_t;
+
+/********
+ *
+ */
+
+/* Parse range of sizes of files */
+BOOL
+action_find_parse_size (const wchar_t *__str,
+                        __s64_t *__min, __s64_t *__max);
+
+/* Parse range of ages of files in days */
+BOOL
+action_find_parse_age (const wchar_t *__str,
+                       __s64_t *__min, __s64_t *__max);
+
+/* Parse owner of files */
+BOOL
+action_find_parse_owner (const wchar_t *__str, long *__uid);
+
+/* Find file operation with initial values of pre-filters */
+int
+action_find_filtered (file_panel_t *__panel,
+                      const action_find_filter_t *__filter);
+
 END_HEADER
 
 #endif
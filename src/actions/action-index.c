@@ -0,0 +1,2011 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Persistent index of file names
+ *
+ * Names of entries of configured directories are kept in memory as a tree
+ * sorted like listings of find, so name-only searches don't touch the
+ * filesystem at all. The tree is built by background thread, which then
+ * keeps it fresh by inotify events while fm is running. Between runs the
+ * tree is stored in user's directory in front-coded form, and when it is
+ * loaded only directories which modification time has been changed are
+ * read again.
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "actions.h"
+#include "action-index.h"
+#include "util.h"
+#include "dir.h"
+#include "file.h"
+#include "hook.h"
+#include "dynstruct.h"
+#include "shared.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/********
+ * Constants
+ */
+
+/* Name of file with saved index in user's directory */
+#define INDEX_FILE L"find-index"
+
+/* Signature of file with saved index */
+#define INDEX_MAGIC     "FMINDEX2"
+#define INDEX_MAGIC_LEN 8
+
+/* Flags of records in saved index */
+#define RECORD_TYPE_MASK 0x03
+#define RECORD_PRUNED    0x04
+#define RECORD_ROOT      0x08
+
+/* Period of checking of inotify queue and aborting (in ms) */
+#define INDEX_POLL_PERIOD 500
+
+/* Period of saving of changed index (in seconds) */
+#define INDEX_SAVE_PERIOD 300
+
+/* Period of revalidation of index when changes */
+/* can't be watched (in seconds) */
+#define INDEX_REVALIDATE_PERIOD 900
+
+#define INOTIFY_MASK \
+  (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+   IN_ONLYDIR | IN_DONT_FOLLOW)
+
+#define INOTIFY_BUF_SIZE 65536
+
+/********
+ * Type definitions
+ */
+
+struct index_dir;
+
+/* Entry of indexed directory */
+typedef struct
+{
+  wchar_t *name;
+  int type;
+
+  /* Content of directory, NULL for other entries */
+  struct index_dir *dir;
+} index_entry_t;
+
+/* Indexed directory */
+typedef struct index_dir
+{
+  struct index_dir *parent;
+
+  /* Name of directory owned by entry of parent, */
+  /* or full name for roots */
+  wchar_t *name;
+
+  /* Device of filesystem of root */
+  dev_t dev;
+
+  /* Modification time of directory at the moment of reading, */
+  /* changes within one second are distinguished by nanoseconds */
+  struct timespec mtime;
+
+  /* Descriptor of inotify watch, -1 if directory isn't watched, */
+  /* so changes of its content could be missed by index */
+  int wd;
+
+  /* Directory is on other filesystem, its content isn't indexed */
+  BOOL pruned;
+
+  /* Content of root has been loaded from saved index */
+  BOOL loaded;
+
+  /* Entries sorted by names */
+  index_entry_t *entries;
+  int count;
+} index_dir_t;
+
+/* Level of tree while loading saved index */
+typedef struct
+{
+  /* Directory, NULL if its content isn't needed */
+  index_dir_t *dir;
+
+  /* Length of path of directory and of prefix of its entries */
+  size_t len, prefix;
+} load_level_t;
+
+/* Context of saving of index */
+typedef struct
+{
+  FILE *file;
+
+  /* Path of the last written entry */
+  char *prev;
+  size_t prev_len, prev_allocated;
+} index_writer_t;
+
+/********
+ * Global variables
+ */
+
+/* Indexed directories */
+static index_dir_t **roots = NULL;
+static int roots_count = 0;
+
+/* Index has been built and could be used by find */
+static BOOL ready = FALSE;
+
+static pthread_t indexer;
+static BOOL indexer_started = FALSE;
+
+/* Indexer should be stopped */
+static volatile BOOL aborted = FALSE;
+
+static BOOL hooks_registered = FALSE;
+
+/* Protects entries, state and watches of directories, */
+/* which are changed by indexer only */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Descriptor of inotify instance of indexer, -1 if there is no one */
+static int inotify_fd = -1;
+
+/* Watched directories by descriptors of watches */
+static index_dir_t **watched = NULL;
+static int watched_count = 0;
+
+/* Limit of watches has been reached */
+static BOOL watches_exhausted = FALSE;
+
+/* Index has been changed since last saving */
+static BOOL dirty = FALSE;
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Get type of entry by type from listing
+ *
+ * @param __d_type - type of entry from listing
+ * @return type of entry
+ */
+static int
+dtype_to_type (unsigned char __d_type)
+{
+  switch (__d_type)
+    {
+    case DT_REG:
+      return AIT_FILE;
+    case DT_DIR:
+      return AIT_DIR;
+    case DT_LNK:
+      return AIT_SYMLINK;
+    default:
+      return AIT_OTHER;
+    }
+}
+
+/**
+ * Get type of entry by its mode
+ *
+ * @param __mode - mode of entry
+ * @return type of entry
+ */
+static int
+mode_to_type (mode_t __mode)
+{
+  if (S_ISREG (__mode))
+    {
+      return AIT_FILE;
+    }
+
+  if (S_ISDIR (__mode))
+    {
+      return AIT_DIR;
+    }
+
+  if (S_ISLNK (__mode))
+    {
+      return AIT_SYMLINK;
+    }
+
+  return AIT_OTHER;
+}
+
+/**
+ * Get status of file without following symbolic link
+ *
+ * @param __path - name of file
+ * @param __stat - pointer to buffer where status will be stored
+ * @return zero on success, non-zero otherwise
+ */
+static int
+lstat_wcs (const wchar_t *__path, struct stat *__stat)
+{
+  char *path;
+  int res;
+
+  wcs2mbs (&path, __path);
+  res = lstat (path, __stat);
+  free (path);
+
+  return res;
+}
+
+/**
+ * Allocate new directory
+ *
+ * @param __parent - parent directory
+ * @param __name - name of directory
+ * @return new directory
+ */
+static index_dir_t*
+alloc_dir (index_dir_t *__parent, wchar_t *__name)
+{
+  index_dir_t *res;
+
+  MALLOC_ZERO (res, sizeof (index_dir_t));
+
+  res->parent = __parent;
+  res->name = __name;
+  res->wd = -1;
+
+  return res;
+}
+
+/**
+ * Get full name of directory
+ *
+ * @param __dir - directory
+ * @return full name of directory
+ * @sideeffect allocate memory for return value
+ */
+static wchar_t*
+dir_path (const index_dir_t *__dir)
+{
+  wchar_t *parent, *res;
+
+  if (!__dir->parent)
+    {
+      return wcsdup (__dir->name);
+    }
+
+  parent = dir_path (__dir->parent);
+  res = wcdircatsubdir (parent, __dir->name);
+  free (parent);
+
+  return res;
+}
+
+/**
+ * Get root of directory
+ *
+ * @param __dir - directory
+ * @return root of directory
+ */
+static index_dir_t*
+root_of (index_dir_t *__dir)
+{
+  while (__dir->parent)
+    {
+      __dir = __dir->parent;
+    }
+
+  return __dir;
+}
+
+/**
+ * Check if directory hasn't been changed since it has been read
+ *
+ * @param __dir - directory to check
+ * @param __stat - current status of directory
+ * @return non-zero if modification time is the same, zero otherwise
+ */
+static BOOL
+same_mtime (const index_dir_t *__dir, const struct stat *__stat)
+{
+  return __dir->mtime.tv_sec == __stat->st_mtim.tv_sec &&
+    __dir->mtime.tv_nsec == __stat->st_mtim.tv_nsec;
+}
+
+/**
+ * Set state of directory, which is checked by find
+ *
+ * @param __dir - directory to update
+ * @param __pruned - directory is on other filesystem
+ * @param __stat - current status of directory, NULL to reset
+ * modification time, so directory is read again by revalidation
+ */
+static void
+set_dir_state (index_dir_t *__dir, BOOL __pruned, const struct stat *__stat)
+{
+  pthread_mutex_lock (&mutex);
+
+  __dir->pruned = __pruned;
+
+  if (__stat)
+    {
+      __dir->mtime = __stat->st_mtim;
+    }
+  else
+    {
+      memset (&__dir->mtime, 0, sizeof (__dir->mtime));
+    }
+
+  pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Set descriptor of watch of directory
+ *
+ * @param __dir - directory
+ * @param __wd - descriptor of watch, -1 if directory isn't watched
+ */
+static void
+set_dir_wd (index_dir_t *__dir, int __wd)
+{
+  pthread_mutex_lock (&mutex);
+  __dir->wd = __wd;
+  pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Start watching of directory
+ *
+ * @param __dir - directory to watch
+ * @param __path - multibyte name of directory
+ */
+static void
+watch_dir (index_dir_t *__dir, const char *__path)
+{
+  int wd;
+
+  if (inotify_fd < 0 || watches_exhausted || __dir->wd >= 0)
+    {
+      return;
+    }
+
+  wd = inotify_add_watch (inotify_fd, __path, INOTIFY_MASK);
+
+  if (wd < 0)
+    {
+      /* Changes of the rest directories are found by revalidation */
+      if (errno == ENOSPC)
+        {
+          watches_exhausted = TRUE;
+        }
+      return;
+    }
+
+  if (wd >= watched_count)
+    {
+      int count = MAX (wd + 1, watched_count * 2);
+      watched = realloc (watched, count * sizeof (index_dir_t*));
+      memset (watched + watched_count, 0,
+              (count - watched_count) * sizeof (index_dir_t*));
+      watched_count = count;
+    }
+
+  watched[wd] = __dir;
+  set_dir_wd (__dir, wd);
+}
+
+/**
+ * Stop watching of directory
+ *
+ * @param __dir - directory to stop watching of
+ */
+static void
+unwatch_dir (index_dir_t *__dir)
+{
+  if (__dir->wd < 0)
+    {
+      return;
+    }
+
+  if (inotify_fd >= 0)
+    {
+      inotify_rm_watch (inotify_fd, __dir->wd);
+    }
+
+  if (__dir->wd < watched_count)
+    {
+      watched[__dir->wd] = NULL;
+    }
+
+  set_dir_wd (__dir, -1);
+}
+
+static void
+free_dir (index_dir_t *__dir);
+
+/**
+ * Free content of entry
+ *
+ * @param __entry - entry to free
+ */
+static void
+free_entry (index_entry_t *__entry)
+{
+  if (__entry->dir)
+    {
+      free_dir (__entry->dir);
+    }
+
+  free (__entry->name);
+}
+
+/**
+ * Free array of entries
+ *
+ * @param __entries - entries to free
+ * @param __count - count of entries
+ */
+static void
+free_entries (index_entry_t *__entries, int __count)
+{
+  int i;
+
+  for (i = 0; i < __count; ++i)
+    {
+      free_entry (&__entries[i]);
+    }
+
+  SAFE_FREE (__entries);
+}
+
+/**
+ * Free directory with its content
+ *
+ * Name of directory is owned by its parent and isn't freed.
+ *
+ * @param __dir - directory to free
+ */
+static void
+free_dir (index_dir_t *__dir)
+{
+  free_entries (__dir->entries, __dir->count);
+  unwatch_dir (__dir);
+  free (__dir);
+}
+
+/**
+ * Find place of entry in directory
+ *
+ * @param __dir - directory to search in
+ * @param __name - name of entry
+ * @return index of the first entry which name isn't less than given one
+ */
+static int
+lower_bound (const index_dir_t *__dir, const wchar_t *__name)
+{
+  int left = 0, right = __dir->count, mid;
+
+  while (left < right)
+    {
+      mid = (left + right) / 2;
+
+      if (wcscmp (__dir->entries[mid].name, __name) < 0)
+        {
+          left = mid + 1;
+        }
+      else
+        {
+          right = mid;
+        }
+    }
+
+  return left;
+}
+
+/**
+ * Find entry in directory
+ *
+ * @param __dir - directory to search in
+ * @param __name - name of entry
+ * @return index of entry or -1 if there is no such entry
+ */
+static int
+find_entry (const index_dir_t *__dir, const wchar_t *__name)
+{
+  int i = lower_bound (__dir, __name);
+
+  if (i < __dir->count && !wcscmp (__dir->entries[i].name, __name))
+    {
+      return i;
+    }
+
+  return -1;
+}
+
+/**
+ * Insert entry to directory
+ *
+ * @param __dir - directory to insert entry to
+ * @param __entry - entry to insert
+ */
+static void
+insert_entry (index_dir_t *__dir, const index_entry_t *__entry)
+{
+  int i = lower_bound (__dir, __entry->name);
+
+  pthread_mutex_lock (&mutex);
+
+  __dir->entries = realloc (__dir->entries,
+                            (__dir->count + 1) * sizeof (index_entry_t));
+  memmove (__dir->entries + i + 1, __dir->entries + i,
+           (__dir->count - i) * sizeof (index_entry_t));
+  __dir->entries[i] = *__entry;
+  ++__dir->count;
+
+  pthread_mutex_unlock (&mutex);
+
+  dirty = TRUE;
+}
+
+/**
+ * Remove entry from directory
+ *
+ * @param __dir - directory to remove entry from
+ * @param __index - index of entry
+ */
+static void
+remove_entry (index_dir_t *__dir, int __index)
+{
+  index_entry_t entry;
+
+  pthread_mutex_lock (&mutex);
+
+  entry = __dir->entries[__index];
+  memmove (__dir->entries + __index, __dir->entries + __index + 1,
+           (__dir->count - __index - 1) * sizeof (index_entry_t));
+  --__dir->count;
+
+  pthread_mutex_unlock (&mutex);
+
+  free_entry (&entry);
+  dirty = TRUE;
+}
+
+/**
+ * Replace all entries of directory
+ *
+ * @param __dir - directory to replace entries of
+ * @param __entries - new entries
+ * @param __count - count of new entries
+ * @return old entries
+ */
+static index_entry_t*
+replace_entries (index_dir_t *__dir, index_entry_t *__entries, int __count)
+{
+  index_entry_t *res;
+
+  pthread_mutex_lock (&mutex);
+
+  res = __dir->entries;
+  __dir->entries = __entries;
+  __dir->count = __count;
+
+  pthread_mutex_unlock (&mutex);
+
+  dirty = TRUE;
+
+  return res;
+}
+
+/**
+ * Read entries of directory
+ *
+ * Entries which names can't be converted to wide characters are skipped.
+ *
+ * @param __path - name of directory
+ * @param __entries - pointer to variable where sorted entries
+ * will be stored
+ * @param __count - pointer to variable where count of entries
+ * will be stored
+ * @return zero on success, non-zero otherwise
+ */
+static int
+read_dir (const wchar_t *__path, index_entry_t **__entries, int *__count)
+{
+  int allocated = 0, type;
+  char *path, *full_name;
+  wchar_t name[MAX_FILENAME_LEN + 1];
+  struct dirent *ep;
+  struct stat stat;
+  DIR *dir;
+
+  /* Compare entries by names */
+  int compar_name (const void *__a, const void *__b)
+    {
+      return wcscmp (((index_entry_t*)__a)->name,
+                     ((index_entry_t*)__b)->name);
+    }
+
+  *__entries = NULL;
+  *__count = 0;
+
+  wcs2mbs (&path, __path);
+  dir = opendir (path);
+
+  if (!dir)
+    {
+      free (path);
+      return -1;
+    }
+
+  while ((ep = readdir (dir)) != NULL)
+    {
+      if (IS_MBPSEUDODIR (ep->d_name) ||
+          mbstowcs (name, ep->d_name, BUF_LEN (name)) == (size_t)-1)
+        {
+          continue;
+        }
+
+      name[MAX_FILENAME_LEN] = 0;
+
+      if (ep->d_type != DT_UNKNOWN)
+        {
+          type = dtype_to_type (ep->d_type);
+        }
+      else
+        {
+          full_name = malloc (strlen (path) + strlen (ep->d_name) + 2);
+          sprintf (full_name, "%s/%s", path, ep->d_name);
+
+          if (lstat (full_name, &stat))
+            {
+              free (full_name);
+              continue;
+            }
+
+          type = mode_to_type (stat.st_mode);
+          free (full_name);
+        }
+
+      if (*__count == allocated)
+        {
+          allocated = MAX (allocated * 2, 16);
+          *__entries = realloc (*__entries,
+                                allocated * sizeof (index_entry_t));
+        }
+
+      (*__entries)[*__count].name = wcsdup (name);
+      (*__entries)[*__count].type = type;
+      (*__entries)[*__count].dir = NULL;
+      ++*__count;
+    }
+
+  closedir (dir);
+  free (path);
+
+  qsort (*__entries, *__count, sizeof (index_entry_t), compar_name);
+
+  return 0;
+}
+
+/**
+ * Read directory and all its subdirectories
+ *
+ * Directory should be new one, so it isn't seen by find yet.
+ * Directories on other filesystems than root's one are pruned.
+ * Modification time is stored only when the whole directory is read,
+ * so unfinished directories are read again by revalidation.
+ *
+ * @param __dir - directory to build
+ * @param __path - name of directory
+ * @param __dev - device of root
+ */
+static void
+build_dir (index_dir_t *__dir, const wchar_t *__path, dev_t __dev)
+{
+  struct stat stat;
+  wchar_t *child_path;
+  char *path;
+  int i;
+
+  if (aborted)
+    {
+      return;
+    }
+
+  wcs2mbs (&path, __path);
+
+  if (lstat (path, &stat) || !S_ISDIR (stat.st_mode))
+    {
+      free (path);
+      return;
+    }
+
+  if (stat.st_dev != __dev)
+    {
+      set_dir_state (__dir, TRUE, &stat);
+      free (path);
+      return;
+    }
+
+  /* Watch is added before reading, so no changes are missed */
+  watch_dir (__dir, path);
+  free (path);
+
+  if (read_dir (__path, &__dir->entries, &__dir->count))
+    {
+      return;
+    }
+
+  for (i = 0; i < __dir->count; ++i)
+    {
+      if (__dir->entries[i].type == AIT_DIR)
+        {
+          __dir->entries[i].dir = alloc_dir (__dir, __dir->entries[i].name);
+          child_path = wcdircatsubdir (__path, __dir->entries[i].name);
+          build_dir (__dir->entries[i].dir, child_path, __dev);
+          free (child_path);
+        }
+    }
+
+  if (!aborted)
+    {
+      set_dir_state (__dir, FALSE, &stat);
+    }
+
+  dirty = TRUE;
+}
+
+/**
+ * Bring directory in accordance with filesystem
+ *
+ * Directory is read again only if its modification time has been
+ * changed, but all subdirectories are checked anyway.
+ *
+ * @param __dir - directory to check
+ * @param __path - name of directory
+ * @param __dev - device of root
+ * @return zero if directory doesn't exist anymore, non-zero otherwise
+ */
+static BOOL
+rescan_dir (index_dir_t *__dir, const wchar_t *__path, dev_t __dev)
+{
+  index_entry_t *entries, *old;
+  int i, j, count, old_count;
+  wchar_t *child_path;
+  struct stat stat;
+  BOOL *reused, *fresh;
+  char *path;
+
+  if (aborted)
+    {
+      return TRUE;
+    }
+
+  wcs2mbs (&path, __path);
+
+  if (lstat (path, &stat) || !S_ISDIR (stat.st_mode))
+    {
+      free (path);
+      return FALSE;
+    }
+
+  if (stat.st_dev != __dev)
+    {
+      /* Other filesystem has been mounted to directory */
+      free (path);
+      if (!__dir->pruned)
+        {
+          unwatch_dir (__dir);
+          old_count = __dir->count;
+          free_entries (replace_entries (__dir, NULL, 0), old_count);
+        }
+      set_dir_state (__dir, TRUE, &stat);
+      return TRUE;
+    }
+
+  watch_dir (__dir, path);
+  free (path);
+
+  if (same_mtime (__dir, &stat) && !__dir->pruned)
+    {
+      /* Entries are the same, but subdirectories could be changed */
+      for (i = 0; i < __dir->count && !aborted; ++i)
+        {
+          if (!__dir->entries[i].dir)
+            {
+              continue;
+            }
+
+          child_path = wcdircatsubdir (__path, __dir->entries[i].name);
+
+          if (!rescan_dir (__dir->entries[i].dir, child_path, __dev))
+            {
+              remove_entry (__dir, i--);
+            }
+
+          free (child_path);
+        }
+
+      return TRUE;
+    }
+
+  if (read_dir (__path, &entries, &count))
+    {
+      return TRUE;
+    }
+
+  /* Subdirectories which are still here are taken from old entries */
+  old = __dir->entries;
+  old_count = __dir->count;
+  MALLOC_ZERO (reused, MAX (old_count, 1) * sizeof (BOOL));
+  MALLOC_ZERO (fresh, MAX (count, 1) * sizeof (BOOL));
+
+  for (i = 0, j = 0; i < count; ++i)
+    {
+      while (j < old_count && wcscmp (old[j].name, entries[i].name) < 0)
+        {
+          ++j;
+        }
+
+      if (j < old_count && old[j].type == entries[i].type &&
+          !wcscmp (old[j].name, entries[i].name))
+        {
+          free (entries[i].name);
+          entries[i] = old[j];
+          reused[j] = TRUE;
+        }
+      else if (entries[i].type == AIT_DIR)
+        {
+          entries[i].dir = alloc_dir (__dir, entries[i].name);
+          child_path = wcdircatsubdir (__path, entries[i].name);
+          build_dir (entries[i].dir, child_path, __dev);
+          free (child_path);
+          fresh[i] = TRUE;
+        }
+    }
+
+  replace_entries (__dir, entries, count);
+  set_dir_state (__dir, FALSE, NULL);
+
+  for (j = 0; j < old_count; ++j)
+    {
+      if (!reused[j])
+        {
+          free_entry (&old[j]);
+        }
+    }
+
+  SAFE_FREE (old);
+  free (reused);
+
+  /* Check subdirectories which were indexed already, */
+  /* removing of entry doesn't move preceding ones */
+  for (i = count - 1; i >= 0 && !aborted; --i)
+    {
+      if (!__dir->entries[i].dir || fresh[i])
+        {
+          continue;
+        }
+
+      child_path = wcdircatsubdir (__path, __dir->entries[i].name);
+
+      if (!rescan_dir (__dir->entries[i].dir, child_path, __dev))
+        {
+          remove_entry (__dir, i);
+        }
+
+      free (child_path);
+    }
+
+  free (fresh);
+
+  if (!aborted)
+    {
+      set_dir_state (__dir, FALSE, &stat);
+    }
+
+  return TRUE;
+}
+
+/**
+ * Bring the whole index in accordance with filesystem
+ */
+static void
+revalidate (void)
+{
+  struct stat stat;
+  int i, count;
+
+  for (i = 0; i < roots_count && !aborted; ++i)
+    {
+      if (lstat_wcs (roots[i]->name, &stat))
+        {
+          /* Root has disappeared */
+          count = roots[i]->count;
+          free_entries (replace_entries (roots[i], NULL, 0), count);
+          set_dir_state (roots[i], FALSE, NULL);
+          continue;
+        }
+
+      roots[i]->dev = stat.st_dev;
+
+      if (roots[i]->loaded)
+        {
+          rescan_dir (roots[i], roots[i]->name, roots[i]->dev);
+        }
+      else
+        {
+          count = roots[i]->count;
+          free_entries (replace_entries (roots[i], NULL, 0), count);
+          build_dir (roots[i], roots[i]->name, roots[i]->dev);
+          roots[i]->loaded = TRUE;
+        }
+    }
+}
+
+/**
+ * Get name of file with saved index
+ *
+ * @param __suffix - suffix of name
+ * @return multibyte name of file or NULL if there is no user's directory
+ * @sideeffect allocate memory for return value
+ */
+static char*
+index_file_name (const wchar_t *__suffix)
+{
+  wchar_t *dir, *name;
+  char *res;
+  size_t len;
+
+  dir = get_user_directory ();
+
+  if (!dir)
+    {
+      return NULL;
+    }
+
+  len = wcslen (dir) + wcslen (INDEX_FILE) + wcslen (__suffix) + 2;
+  name = malloc ((len + 1) * sizeof (wchar_t));
+  swprintf (name, len + 1, L"%ls/%ls%ls", dir, INDEX_FILE, __suffix);
+
+  wcs2mbs (&res, name);
+
+  free (name);
+  free (dir);
+
+  return res;
+}
+
+/**
+ * Write variable-length number
+ *
+ * @param __file - file to write to
+ * @param __value - value to write
+ */
+static void
+write_number (FILE *__file, __u64_t __value)
+{
+  while (__value >= 0x80)
+    {
+      fputc ((__value & 0x7f) | 0x80, __file);
+      __value >>= 7;
+    }
+
+  fputc (__value, __file);
+}
+
+/**
+ * Read variable-length number
+ *
+ * @param __buf - buffer to read from
+ * @param __size - size of buffer
+ * @param __pos - pointer to position in buffer
+ * @param __value - pointer to variable where number will be stored
+ * @return non-zero on success, zero if buffer is broken
+ */
+static BOOL
+read_number (const unsigned char *__buf, size_t __size, size_t *__pos,
+             __u64_t *__value)
+{
+  int shift;
+
+  *__value = 0;
+
+  for (shift = 0; *__pos < __size && shift < 64; shift += 7)
+    {
+      *__value |= (__u64_t)(__buf[*__pos] & 0x7f) << shift;
+
+      if (!(__buf[(*__pos)++] & 0x80))
+        {
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/**
+ * Write record of entry to saved index
+ *
+ * Only the part of path which differs from path of previous record
+ * is written.
+ *
+ * @param __writer - context of saving
+ * @param __path - multibyte full name of entry
+ * @param __len - length of name
+ * @param __type - type of entry
+ * @param __dir - directory of entry, NULL for other entries
+ */
+static void
+write_record (index_writer_t *__writer, const char *__path, size_t __len,
+              int __type, const index_dir_t *__dir)
+{
+  int flags = __type;
+
+  size_t shared = 0;
+
+  while (shared < __len && shared < __writer->prev_len &&
+         __path[shared] == __writer->prev[shared])
+    {
+      ++shared;
+    }
+
+  write_number (__writer->file, shared);
+  write_number (__writer->file, __len - shared);
+  fwrite (__path + shared, 1, __len - shared, __writer->file);
+
+  if (__dir)
+    {
+      if (__dir->pruned)
+        {
+          SET_FLAG (flags, RECORD_PRUNED);
+        }
+
+      /* Roots could be nested, so they are marked explicitly */
+      if (!__dir->parent)
+        {
+          SET_FLAG (flags, RECORD_ROOT);
+        }
+    }
+
+  fputc (flags, __writer->file);
+
+  if (__dir)
+    {
+      write_number (__writer->file, (__u64_t)__dir->mtime.tv_sec);
+      write_number (__writer->file, (__u64_t)__dir->mtime.tv_nsec);
+    }
+
+  if (__len > __writer->prev_allocated)
+    {
+      __writer->prev_allocated = MAX (__len, __writer->prev_allocated * 2);
+      __writer->prev = realloc (__writer->prev, __writer->prev_allocated);
+    }
+
+  memcpy (__writer->prev, __path, __len);
+  __writer->prev_len = __len;
+}
+
+/**
+ * Write records of content of directory
+ *
+ * Each subdirectory is followed by its own content.
+ *
+ * @param __writer - context of saving
+ * @param __dir - directory to write
+ * @param __path - pointer to buffer with multibyte name of directory
+ * @param __allocated - pointer to size of buffer
+ * @param __len - length of name of directory
+ */
+static void
+write_dir (index_writer_t *__writer, const index_dir_t *__dir,
+           char **__path, size_t *__allocated, size_t __len)
+{
+  size_t len, prefix;
+  char *name;
+  int i;
+
+  prefix = __len;
+  if (!__len || (*__path)[__len - 1] != '/')
+    {
+      ++prefix;
+    }
+
+  for (i = 0; i < __dir->count; ++i)
+    {
+      wcs2mbs (&name, __dir->entries[i].name);
+      len = prefix + strlen (name);
+
+      if (len + 1 > *__allocated)
+        {
+          *__allocated = MAX (len + 1, *__allocated * 2);
+          *__path = realloc (*__path, *__allocated);
+        }
+
+      (*__path)[prefix - 1] = '/';
+      memcpy (*__path + prefix, name, len - prefix);
+      free (name);
+
+      write_record (__writer, *__path, len, __dir->entries[i].type,
+                    __dir->entries[i].dir);
+
+      if (__dir->entries[i].dir)
+        {
+          write_dir (__writer, __dir->entries[i].dir, __path,
+                     __allocated, len);
+        }
+    }
+}
+
+/**
+ * Save index to user's directory
+ *
+ * Index is written to temporary file which then replaces saved index,
+ * so saved index is never broken.
+ */
+static void
+save_index (void)
+{
+  index_writer_t writer;
+  char *name, *tmp_name, *path, *dir;
+  size_t len, allocated;
+  int i;
+
+  name = index_file_name (L"");
+  tmp_name = index_file_name (L".tmp");
+
+  if (!name || !tmp_name)
+    {
+      SAFE_FREE (name);
+      SAFE_FREE (tmp_name);
+      return;
+    }
+
+  /* User's directory could be not created yet */
+  dir = strdup (name);
+  *strrchr (dir, '/') = 0;
+  mkdir (dir, 0700);
+  free (dir);
+
+  memset (&writer, 0, sizeof (writer));
+  writer.file = fopen (tmp_name, "wb");
+
+  if (writer.file)
+    {
+      fwrite (INDEX_MAGIC, 1, INDEX_MAGIC_LEN, writer.file);
+
+      for (i = 0; i < roots_count; ++i)
+        {
+          wcs2mbs (&path, roots[i]->name);
+          len = strlen (path);
+          allocated = len + 1;
+
+          write_record (&writer, path, len, AIT_DIR, roots[i]);
+          write_dir (&writer, roots[i], &path, &allocated, len);
+
+          free (path);
+        }
+
+      if (fclose (writer.file) == 0 && rename (tmp_name, name) == 0)
+        {
+          dirty = FALSE;
+        }
+      else
+        {
+          unlink (tmp_name);
+        }
+    }
+
+  SAFE_FREE (writer.prev);
+  free (name);
+  free (tmp_name);
+}
+
+/**
+ * Read the whole file into memory
+ *
+ * @param __name - multibyte name of file
+ * @param __size - pointer to variable where size of file will be stored
+ * @return content of file or NULL on error
+ * @sideeffect allocate memory for return value
+ */
+static unsigned char*
+read_file (const char *__name, size_t *__size)
+{
+  unsigned char *res;
+  struct stat stat;
+  FILE *file;
+
+  file = fopen (__name, "rb");
+
+  if (!file)
+    {
+      return NULL;
+    }
+
+  if (fstat (fileno (file), &stat) || stat.st_size <= 0)
+    {
+      fclose (file);
+      return NULL;
+    }
+
+  *__size = stat.st_size;
+  res = malloc (*__size);
+
+  if (fread (res, 1, *__size, file) != *__size)
+    {
+      SAFE_FREE (res);
+    }
+
+  fclose (file);
+
+  return res;
+}
+
+/**
+ * Load saved index
+ *
+ * Content of configured roots is taken from saved index, other roots
+ * are skipped. If saved index is broken, nothing is loaded.
+ */
+static void
+load_index (void)
+{
+  size_t size, pos, len = 0, allocated = 0, depth = 0, levels_count = 0;
+  __u64_t shared, suffix, mtime, mtime_nsec;
+  load_level_t *levels = NULL, *top;
+  index_dir_t *dir, *parent;
+  index_entry_t entry;
+  wchar_t name[MAX_FILENAME_LEN + 1];
+  unsigned char *buf;
+  char *file_name, *path = NULL, *root;
+  int i, flags;
+
+  /* Find configured root by its multibyte name */
+  index_dir_t* find_root (void)
+    {
+      index_dir_t *res = NULL;
+      int j;
+
+      for (j = 0; j < roots_count && !res; ++j)
+        {
+          wcs2mbs (&root, roots[j]->name);
+
+          if (!strcmp (root, path) && !roots[j]->loaded)
+            {
+              res = roots[j];
+            }
+
+          free (root);
+        }
+
+      return res;
+    }
+
+  file_name = index_file_name (L"");
+
+  if (!file_name)
+    {
+      return;
+    }
+
+  buf = read_file (file_name, &size);
+  free (file_name);
+
+  if (!buf)
+    {
+      return;
+    }
+
+  if (size < INDEX_MAGIC_LEN || memcmp (buf, INDEX_MAGIC, INDEX_MAGIC_LEN))
+    {
+      goto broken;
+    }
+
+  for (pos = INDEX_MAGIC_LEN; pos < size;)
+    {
+      if (!read_number (buf, size, &pos, &shared) ||
+          !read_number (buf, size, &pos, &suffix) ||
+          shared > len || suffix >= size - pos)
+        {
+          goto broken;
+        }
+
+      /* Restore path of entry */
+      len = shared + suffix;
+      if (len + 1 > allocated)
+        {
+          allocated = MAX (len + 1, allocated * 2);
+          path = realloc (path, allocated);
+        }
+
+      memcpy (path + shared, buf + pos, suffix);
+      path[len] = 0;
+      pos += suffix;
+
+      flags = buf[pos++];
+      mtime = mtime_nsec = 0;
+
+      if ((flags & RECORD_TYPE_MASK) == AIT_DIR &&
+          (!read_number (buf, size, &pos, &mtime) ||
+           !read_number (buf, size, &pos, &mtime_nsec) ||
+           mtime_nsec >= 1000000000))
+        {
+          goto broken;
+        }
+
+      if (TEST_FLAG (flags, RECORD_ROOT))
+        {
+          depth = 0;
+        }
+
+      /* Leave directories which path isn't prefix of entry's one */
+      while (depth)
+        {
+          top = &levels[depth - 1];
+
+          if (top->len <= shared && len > top->prefix &&
+              path[top->prefix - 1] == '/')
+            {
+              break;
+            }
+
+          --depth;
+        }
+
+      dir = NULL;
+
+      if (!depth)
+        {
+          /* Root of index */
+          if (!TEST_FLAG (flags, RECORD_ROOT) ||
+              (flags & RECORD_TYPE_MASK) != AIT_DIR)
+            {
+              goto broken;
+            }
+
+          dir = find_root ();
+
+          if (dir)
+            {
+              dir->mtime.tv_sec = mtime;
+              dir->mtime.tv_nsec = mtime_nsec;
+              dir->pruned = FALSE;
+              dir->loaded = TRUE;
+            }
+        }
+      else
+        {
+          parent = levels[depth - 1].dir;
+
+          if (strchr (path + levels[depth - 1].prefix, '/'))
+            {
+              goto broken;
+            }
+
+          if (parent)
+            {
+              if (mbstowcs (name, path + levels[depth - 1].prefix,
+                            BUF_LEN (name)) == (size_t)-1)
+                {
+                  goto broken;
+                }
+              name[MAX_FILENAME_LEN] = 0;
+
+              entry.name = wcsdup (name);
+              entry.type = flags & RECORD_TYPE_MASK;
+              entry.dir = NULL;
+
+              if (entry.type == AIT_DIR)
+                {
+                  dir = entry.dir = alloc_dir (parent, entry.name);
+                  dir->mtime.tv_sec = mtime;
+                  dir->mtime.tv_nsec = mtime_nsec;
+                  dir->pruned = TEST_FLAG (flags, RECORD_PRUNED);
+                }
+
+              /* Entries are saved sorted, so they are only appended */
+              if (!(parent->count & (parent->count - 1)))
+                {
+                  parent->entries =
+                    realloc (parent->entries,
+                             MAX (parent->count * 2, 1) *
+                               sizeof (index_entry_t));
+                }
+              parent->entries[parent->count++] = entry;
+            }
+        }
+
+      if ((flags & RECORD_TYPE_MASK) == AIT_DIR)
+        {
+          if (depth == levels_count)
+            {
+              levels_count = MAX (levels_count * 2, 16);
+              levels = realloc (levels, levels_count * sizeof (load_level_t));
+            }
+
+          levels[depth].dir = dir;
+          levels[depth].len = len;
+          levels[depth].prefix = len && path[len - 1] == '/' ? len : len + 1;
+          ++depth;
+        }
+    }
+
+  goto done;
+
+broken:
+  /* Index is built from scratch */
+  for (i = 0; i < roots_count; ++i)
+    {
+      free_entries (roots[i]->entries, roots[i]->count);
+      roots[i]->entries = NULL;
+      roots[i]->count = 0;
+      memset (&roots[i]->mtime, 0, sizeof (roots[i]->mtime));
+      roots[i]->loaded = FALSE;
+    }
+
+done:
+  SAFE_FREE (levels);
+  SAFE_FREE (path);
+  free (buf);
+}
+
+/**
+ * Apply inotify event to index
+ *
+ * @param __event - event to apply
+ */
+static void
+handle_event (const struct inotify_event *__event)
+{
+  wchar_t name[MAX_FILENAME_LEN + 1], *path, *child_path;
+  index_entry_t entry;
+  index_dir_t *dir;
+  struct stat stat;
+  int i;
+
+  if (TEST_FLAG (__event->mask, IN_Q_OVERFLOW))
+    {
+      /* Some events are lost */
+      revalidate ();
+      return;
+    }
+
+  if (__event->wd < 0 || __event->wd >= watched_count ||
+      !(dir = watched[__event->wd]))
+    {
+      return;
+    }
+
+  if (TEST_FLAG (__event->mask, IN_IGNORED))
+    {
+      /* Directory has been deleted or unmounted */
+      watched[__event->wd] = NULL;
+      set_dir_wd (dir, -1);
+      return;
+    }
+
+  if (!__event->len ||
+      mbstowcs (name, __event->name, BUF_LEN (name)) == (size_t)-1)
+    {
+      return;
+    }
+  name[MAX_FILENAME_LEN] = 0;
+
+  path = dir_path (dir);
+  i = find_entry (dir, name);
+
+  if (__event->mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+      if (i >= 0)
+        {
+          remove_entry (dir, i);
+        }
+    }
+  else if (__event->mask & (IN_CREATE | IN_MOVED_TO))
+    {
+      child_path = wcdircatsubdir (path, name);
+
+      if (!lstat_wcs (child_path, &stat))
+        {
+          entry.name = wcsdup (name);
+          entry.type = mode_to_type (stat.st_mode);
+          entry.dir = NULL;
+
+          /* New directory is built before it becomes visible */
+          if (entry.type == AIT_DIR)
+            {
+              entry.dir = alloc_dir (dir, entry.name);
+              build_dir (entry.dir, child_path, root_of (dir)->dev);
+            }
+
+          if (i >= 0)
+            {
+              remove_entry (dir, i);
+            }
+
+          insert_entry (dir, &entry);
+        }
+
+      free (child_path);
+    }
+
+  /* Index of directory corresponds to its current state */
+  if (!lstat_wcs (path, &stat))
+    {
+      set_dir_state (dir, dir->pruned, &stat);
+    }
+
+  free (path);
+}
+
+/**
+ * Read and apply pending inotify events
+ */
+static void
+handle_events (void)
+{
+  char buf[INOTIFY_BUF_SIZE]
+    __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  const struct inotify_event *event;
+  ssize_t len;
+  char *ptr;
+
+  while (!aborted && (len = read (inotify_fd, buf, sizeof (buf))) > 0)
+    {
+      for (ptr = buf; ptr < buf + len;
+           ptr += sizeof (struct inotify_event) + event->len)
+        {
+          event = (const struct inotify_event*)ptr;
+          handle_event (event);
+        }
+    }
+}
+
+/**
+ * Indexer which builds index and keeps it fresh
+ *
+ * @param __arg - unused
+ * @return NULL
+ */
+static void*
+indexer_proc (void *__arg ATTR_UNUSED)
+{
+  time_t saved, revalidated, now;
+  struct pollfd pfd;
+  sigset_t set;
+
+  /* All signals are handled by the main thread */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+  inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  watches_exhausted = FALSE;
+  dirty = FALSE;
+
+  load_index ();
+  revalidate ();
+
+  if (!aborted)
+    {
+      pthread_mutex_lock (&mutex);
+      ready = TRUE;
+      pthread_mutex_unlock (&mutex);
+    }
+
+  saved = revalidated = time (NULL);
+
+  if (dirty && !aborted)
+    {
+      save_index ();
+    }
+
+  pfd.fd = inotify_fd;
+  pfd.events = POLLIN;
+
+  while (!aborted)
+    {
+      if (inotify_fd >= 0)
+        {
+          if (poll (&pfd, 1, INDEX_POLL_PERIOD) > 0)
+            {
+              handle_events ();
+            }
+        }
+      else
+        {
+          poll (NULL, 0, INDEX_POLL_PERIOD);
+        }
+
+      now = time (NULL);
+
+      /* Changes of directories which aren't watched are found */
+      /* by revalidation only */
+      if ((inotify_fd < 0 || watches_exhausted) &&
+          now - revalidated >= INDEX_REVALIDATE_PERIOD)
+        {
+          revalidate ();
+          revalidated = now;
+        }
+
+      if (dirty && now - saved >= INDEX_SAVE_PERIOD)
+        {
+          save_index ();
+          saved = now;
+        }
+    }
+
+  if (dirty)
+    {
+      save_index ();
+    }
+
+  if (inotify_fd >= 0)
+    {
+      close (inotify_fd);
+      inotify_fd = -1;
+    }
+
+  SAFE_FREE (watched);
+  watched_count = 0;
+
+  return NULL;
+}
+
+/**
+ * Stop indexer and wait for it
+ */
+static void
+stop_indexer (void)
+{
+  if (!indexer_started)
+    {
+      return;
+    }
+
+  aborted = TRUE;
+  pthread_join (indexer, NULL);
+
+  indexer_started = FALSE;
+  aborted = FALSE;
+}
+
+/**
+ * Free all indexed directories
+ */
+static void
+free_roots (void)
+{
+  int i;
+
+  pthread_mutex_lock (&mutex);
+  ready = FALSE;
+  pthread_mutex_unlock (&mutex);
+
+  for (i = 0; i < roots_count; ++i)
+    {
+      free (roots[i]->name);
+      free_dir (roots[i]);
+    }
+
+  SAFE_FREE (roots);
+  roots_count = 0;
+}
+
+/**
+ * Handler for hook "exit-hook"
+ *
+ * @param __call_data - calling context
+ * @return HOOK_SUCCESS
+ */
+static int
+index_exit_hook (dynstruct_t *__call_data ATTR_UNUSED)
+{
+  stop_indexer ();
+  free_roots ();
+
+  return HOOK_SUCCESS;
+}
+
+/**
+ * Find indexed directory
+ *
+ * NOTE: Mutex should be locked.
+ *
+ * @param __path - full name of directory
+ * @return indexed directory or NULL if directory isn't indexed
+ */
+static index_dir_t*
+lookup_dir (const wchar_t *__path)
+{
+  wchar_t *path, *token, *state;
+  index_dir_t *dir = NULL;
+  size_t len;
+  int i;
+
+  if (__path[0] != '/')
+    {
+      return NULL;
+    }
+
+  for (i = 0; i < roots_count; ++i)
+    {
+      len = wcslen (roots[i]->name);
+
+      if (!wcsncmp (__path, roots[i]->name, len) &&
+          (!__path[len] || __path[len] == '/' || len == 1))
+        {
+          dir = roots[i];
+          break;
+        }
+    }
+
+  if (!dir)
+    {
+      return NULL;
+    }
+
+  path = wcsdup (__path + len);
+
+  for (token = wcstok (path, L"/", &state); token && dir;
+       token = wcstok (NULL, L"/", &state))
+    {
+      if (!wcscmp (token, L"."))
+        {
+          continue;
+        }
+
+      i = find_entry (dir, token);
+
+      if (!wcscmp (token, L"..") || i < 0 || !dir->entries[i].dir ||
+          dir->entries[i].dir->pruned)
+        {
+          dir = NULL;
+        }
+      else
+        {
+          dir = dir->entries[i].dir;
+        }
+    }
+
+  free (path);
+
+  return dir;
+}
+
+/**
+ * Walk through indexed directory
+ *
+ * NOTE: Mutex should be locked.
+ *
+ * @param __self - directory to walk through
+ * @param __dir - full name of directory
+ * @param __rel_dir - name of directory relative to start of walking
+ * @param __flags - flags of walking
+ * @param __walker - callback for entries
+ * @return non-zero on success, zero if index isn't enough for walking
+ */
+static BOOL
+walk_dir (const index_dir_t *__self, const wchar_t *__dir,
+          const wchar_t *__rel_dir, unsigned int __flags,
+          action_index_walker __walker)
+{
+  const index_entry_t *entry;
+  wchar_t *full_name, *rel_name;
+  struct stat info;
+  BOOL res = TRUE;
+  char *name;
+  int i, err;
+
+  /* Changes of directory which isn't watched (inotify is unavailable */
+  /* or limit of watches has been reached) are found only by periodic */
+  /* revalidation, so its content should be scanned */
+  if (__self->wd < 0)
+    {
+      return FALSE;
+    }
+
+  for (i = 0; i < __self->count; ++i)
+    {
+      entry = &__self->entries[i];
+
+      if (TEST_FLAG (__flags, AIW_RECURSIVE))
+        {
+          /* Content of other filesystems isn't indexed */
+          if (entry->dir && entry->dir->pruned &&
+              !TEST_FLAG (__flags, AIW_ONE_FILESYSTEM))
+            {
+              return FALSE;
+            }
+
+          /* Neither content of directories behind symbolic links */
+          if (entry->type == AIT_SYMLINK &&
+              TEST_FLAG (__flags, AIW_FOLLOW_SYMLINKS))
+            {
+              full_name = wcdircatsubdir (__dir, entry->name);
+              wcs2mbs (&name, full_name);
+              err = stat (name, &info);
+              free (name);
+              free (full_name);
+
+              if (!err && S_ISDIR (info.st_mode))
+                {
+                  return FALSE;
+                }
+            }
+        }
+
+      __walker (__dir, __rel_dir, entry->name, entry->type);
+    }
+
+  if (!TEST_FLAG (__flags, AIW_RECURSIVE))
+    {
+      return TRUE;
+    }
+
+  for (i = 0; i < __self->count && res; ++i)
+    {
+      entry = &__self->entries[i];
+
+      if (!entry->dir || entry->dir->pruned)
+        {
+          continue;
+        }
+
+      full_name = wcdircatsubdir (__dir, entry->name);
+      rel_name = wcdircatsubdir (__rel_dir, entry->name);
+
+      res = walk_dir (entry->dir, full_name, rel_name, __flags, __walker);
+
+      free (full_name);
+      free (rel_name);
+    }
+
+  return res;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Set directories which are indexed
+ *
+ * Indexer is restarted in background, and until it builds index find
+ * works without it. Empty list of directories disables indexing.
+ *
+ * @param __roots - absolute names of directories
+ * @param __count - count of directories
+ */
+void
+action_index_set_roots (const wchar_t **__roots, int __count)
+{
+  wchar_t *name;
+  size_t len;
+  int i, j;
+
+  stop_indexer ();
+  free_roots ();
+
+  roots = malloc (MAX (__count, 1) * sizeof (index_dir_t*));
+
+  for (i = 0; i < __count; ++i)
+    {
+      if (__roots[i][0] != '/')
+        {
+          continue;
+        }
+
+      name = wcsdup (__roots[i]);
+
+      len = wcslen (name);
+      while (len > 1 && name[len - 1] == '/')
+        {
+          name[--len] = 0;
+        }
+
+      for (j = 0; j < roots_count; ++j)
+        {
+          if (!wcscmp (roots[j]->name, name))
+            {
+              break;
+            }
+        }
+
+      if (j < roots_count)
+        {
+          free (name);
+          continue;
+        }
+
+      roots[roots_count++] = alloc_dir (NULL, name);
+    }
+
+  if (!roots_count)
+    {
+      return;
+    }
+
+  if (!hooks_registered)
+    {
+      hook_register (L"exit-hook", index_exit_hook, 0);
+      hooks_registered = TRUE;
+    }
+
+  indexer_started = pthread_create (&indexer, NULL, indexer_proc, NULL) == 0;
+}
+
+/**
+ * Get directories which are indexed
+ *
+ * @param __roots - pointer to variable where NULL-terminated array
+ * of names of directories will be stored
+ * @return count of directories
+ * @sideeffect allocate memory for array, use free_explode_array()
+ * to free it
+ */
+int
+action_index_get_roots (wchar_t ***__roots)
+{
+  int i;
+
+  *__roots = malloc ((roots_count + 1) * sizeof (wchar_t*));
+
+  for (i = 0; i < roots_count; ++i)
+    {
+      (*__roots)[i] = wcsdup (roots[i]->name);
+    }
+
+  (*__roots)[roots_count] = NULL;
+
+  return roots_count;
+}
+
+/**
+ * Walk through indexed entries of directory
+ *
+ * All entries of directory are passed to walker in alphabetical order,
+ * and then subdirectories are walked through if it is needed, as it is
+ * done by find. Walker is called while index is locked, so it shouldn't
+ * take long.
+ *
+ * @param __dir - full name of directory
+ * @param __rel_dir - name of directory passed to walker
+ * @param __flags - flags of walking
+ * @param __walker - callback for entries
+ * @return non-zero if directory has been walked through, zero if it isn't
+ * indexed or index isn't built yet (walker could be called in this case
+ * as well, so its results should be dropped)
+ */
+BOOL
+action_index_walk (const wchar_t *__dir, const wchar_t *__rel_dir,
+                   unsigned int __flags, action_index_walker __walker)
+{
+  index_dir_t *dir;
+  BOOL res = FALSE;
+
+  pthread_mutex_lock (&mutex);
+
+  if (ready)
+    {
+      dir = lookup_dir (__dir);
+
+      if (dir)
+        {
+          res = walk_dir (dir, __dir, __rel_dir, __flags, __walker);
+        }
+    }
+
+  pthread_mutex_unlock (&mutex);
+
+  return res;
+}
@@ -0,0 +1,63 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Persistent index of file names
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _action_index_h_
+#define _action_index_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+/********
+ * Constants
+ */
+
+/* Types of indexed entries */
+#define AIT_FILE     0
+#define AIT_DIR      1
+#define AIT_SYMLINK  2
+#define AIT_OTHER    3
+
+/* Flags of walking through index */
+#define AIW_RECURSIVE        0x0001
+#define AIW_ONE_FILESYSTEM   0x0002
+#define AIW_FOLLOW_SYMLINKS  0x0004
+
+/********
+ * Type definitions
+ */
+
+/* Callback for entries of index */
+typedef void (*action_index_walker) (const wchar_t *__dir,
+                                     const wchar_t *__rel_dir,
+                                     const wchar_t *__name, int __type);
+
+/********
+ *
+ */
+
+/* Set directories which are indexed */
+void
+action_index_set_roots (const wchar_t **__roots, int __count);
+
+/* Get directories which are indexed */
+int
+action_index_get_roots (wchar_t ***__roots);
+
+/* Walk through indexed entries of directory */
+BOOL
+action_index_walk (const wchar_t *__dir, const wchar_t *__rel_dir,
+                   unsigned int __flags, action_index_walker __walker);
+
+END_HEADER
+
+#endif
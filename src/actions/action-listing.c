@@ -11,15 +11,21 @@
  */
 
 #include <dirent.h>
+#include <signal.h>
 
 #include "actions.h"
+#include "action-walk.h"
 #include "deque.h"
 #include "dir.h"
 #include "i18n.h"
 #include "messages.h"
 
-static void
-free_listing_iter (action_listing_tree_t *__tree);
+/* Length of array in map of shared listings */
+#define SHARED_LISTINGS_LENGTH 16411
+
+/* Minimal count of allocated nodes and characters in listing */
+#define LISTING_MIN_NODES   1024
+#define LISTING_MIN_STRINGS 16384
 
 /*
  * Use ACTION_REPEAT for functions like vfs_scandir() which
@@ -57,107 +63,128 @@ error (const wchar_t *__text, ...)
 #endif
 
 /**
- * Allocate listing tree
+ * Add node to the end of listing
  *
- * @param pointer to new tree
+ * @param __listing - listing where node will be added
+ * @param __name - name of item
+ * @param __type - type of item
+ * @return index of added node
  */
-static action_listing_tree_t*
-allocate_listing_tree ()
+static unsigned long
+listing_add_item (action_listing_t *__listing, const wchar_t *__name,
+                  unsigned char __type)
 {
-  action_listing_tree_t *res;
-  MALLOC_ZERO (res, sizeof (action_listing_tree_t));
-  return res;
-}
+  action_listing_node_t *node;
+  size_t len;
 
-/**
- * Add item to result list
- *
- * @param __res - node of a tree where item will be added
- * @param __item - item to add
- */
-static void
-listing_add_item (action_listing_tree_t *__res, vfs_dirent_t *__item)
-{
-  if (!__res || !__item)
+  /* Grow arrays geometrically, so adding of node is amortized O(1) */
+  if (__listing->nodes_count == __listing->nodes_allocated)
     {
-      return;
+      __listing->nodes_allocated = MAX (__listing->nodes_allocated * 2,
+                                        LISTING_MIN_NODES);
+      __listing->nodes = realloc (__listing->nodes,
+                                  __listing->nodes_allocated *
+                                    sizeof (action_listing_node_t));
+    }
+
+  len = wcslen (__name) + 1;
+  if (__listing->strings_len + len > __listing->strings_allocated)
+    {
+      __listing->strings_allocated = MAX (__listing->strings_allocated * 2,
+                                          __listing->strings_len + len);
+      __listing->strings_allocated = MAX (__listing->strings_allocated,
+                                          LISTING_MIN_STRINGS);
+      __listing->strings = realloc (__listing->strings,
+                                    __listing->strings_allocated *
+                                      sizeof (wchar_t));
     }
 
-  /* Allocate memory for directory entry */
-  __res->dirent = realloc (__res->dirent,
-                          (__res->count + 1) * sizeof (vfs_dirent_t));
-  __res->dirent[__res->count] = __item;
+  node = &__listing->nodes[__listing->nodes_count];
+  memset (node, 0, sizeof (action_listing_node_t));
 
-  /* Allocate memory for child */
-  __res->items = realloc (__res->items,
-                         (__res->count + 1) * sizeof (action_listing_tree_t*));
-  __res->items[__res->count] = NULL;
+  node->name = __listing->strings_len;
+  node->type = __type;
+  node->end = __listing->nodes_count + 1;
 
-  __res->count++;
+  wcscpy (__listing->strings + __listing->strings_len, __name);
+  __listing->strings_len += len;
+
+  return __listing->nodes_count++;
 }
 
 /**
- * Drop last item from tree item
- * Need if user want to ignore subtree
+ * Drop node with its subtree from listing
+ * Need if user want to ignore subtree.
+ *
+ * NOTE: Node should be the last added one at its level, so the whole
+ *       tail of listing is dropped.
  *
- * @param __node - node of tree from where item will be dropped
+ * @param __listing - listing from which node will be dropped
+ * @param __node - index of node to drop
  */
 static void
-listing_drop_item (action_listing_tree_t *__node)
+listing_drop_item (action_listing_t *__listing, unsigned long __node)
 {
-  /* Free used memory */
-  free_listing_iter (__node->items[__node->count - 1]);
-  vfs_free_dirent (__node->dirent[__node->count - 1]);
-
-  /* Re-allocate memory for directory entry */
-  __node->dirent = realloc (__node->dirent,
-                          (__node->count - 1) * sizeof (vfs_dirent_t));
-
-  /* Re-allocate memory for child */
-  __node->items = realloc (__node->items,
-                             (__node->count - 1) *
-                                sizeof (action_listing_tree_t*));
-
-  --__node->count;
+  __listing->strings_len = __listing->nodes[__node].name;
+  __listing->nodes_count = __node;
 }
 
 /**
- * Iterator for action_get_listing()
  * Get listing tree start from specified item
  *
+ * @param __listing - listing where children will be added
  * @param __path - current ditectory
- * @param __res - pointer to a structure, where result will be saved
- * @param __count - total count of files
- * @param __size - total size of files
+ * @param __node - node of current item
  * @param __ignore_errors - ignore error in listing procress
  * @param __count_dirs - count dirs to summary items count
+ * @param __guard - guard against crossing filesystems
  * @return zero on success, non-zero otherwise
  */
 static int
-get_listing_iter (const wchar_t *__path, action_listing_tree_t **__res,
-                  __u64_t *__count, __u64_t *__size, BOOL __ignore_errors,
-                  BOOL __count_dirs)
+get_listing_iter (action_listing_t *__listing, const wchar_t *__path,
+                  unsigned long __node, BOOL __ignore_errors,
+                  BOOL __count_dirs, action_walk_guard_t *__guard)
 {
-  if (isdir (__path, FALSE))
+  int res;
+  vfs_stat_t stat;
+
+  /* Item is stat'ed only once, walkers will use stored information */
+  if ((res = vfs_lstat (__path, &stat)) != VFS_OK)
+    {
+      return res;
+    }
+
+  action_listing_stat_set (&__listing->nodes[__node].stat, &stat);
+
+  if (S_ISDIR (stat.st_mode) && !action_walk_guard_enter (__guard, &stat))
+    {
+      /* Directory is located on another filesystem. It is left */
+      /* unscanned and operation will get its listing by itself. */
+      if (__count_dirs)
+        {
+          ++__listing->count;
+        }
+    }
+  else if (S_ISDIR (stat.st_mode))
     {
       long i, count;
+      unsigned long child;
       vfs_dirent_t **dirent;
       size_t len;
       wchar_t *cur;
-      int res;
 
       /* Scan directory */
 #ifdef USE_ACTION_REPEAT
 
       if (__ignore_errors)
         {
-          count = vfs_scandir (__path, &dirent, 0, vfs_alphasort);
+          count = vfs_scandir (__path, &dirent, 0, action_walk_compar ());
           res = count < 0 ? count : 0;
         }
       else
         {
           ACTION_REPEAT (count = vfs_scandir (__path, &dirent, 0,
-                                              vfs_alphasort);
+                                              action_walk_compar ());
                          res = count < 0 ? count : 0,
                          error, return ACTION_ABORT,
                          _(L"Cannot get listing of directory \"%ls\":\n%ls"),
@@ -171,7 +198,7 @@ get_listing_iter (const wchar_t *__path, action_listing_tree_t **__res,
            return __ignore_errors ? ACTION_OK : ACTION_IGNORE;
          }
 #else
-      count = vfs_scandir (__path, &dirent, 0, vfs_alphasort);
+      count = vfs_scandir (__path, &dirent, 0, action_walk_compar ());
 #endif
 
       if (count < 0)
@@ -180,133 +207,266 @@ get_listing_iter (const wchar_t *__path, action_listing_tree_t **__res,
           return __ignore_errors ? ACTION_OK : count;
         }
 
-      (*__res) = allocate_listing_tree ();
-
-      /* Set fields of tree */
-      (*__res)->count = count;
-      (*__res)->dirent = dirent;
+      __listing->nodes[__node].flags |= ALF_SCANNED;
 
       if (__count_dirs)
         {
-          ++(*__count);
+          ++__listing->count;
         }
 
-      MALLOC_ZERO ((*__res)->items, count * sizeof (action_listing_tree_t*));
-
       len = wcslen (__path) + MAX_FILENAME_LEN + 1;
       cur = malloc ((len + 1) * sizeof (wchar_t));
 
       /* Scan children */
-      i = 0;
-      while (i < count)
+      res = 0;
+      for (i = 0; i < count; ++i)
         {
           /* Do not add pseudo-dirs '.' and '..' */
-          if (!IS_PSEUDODIR (dirent[i]->name))
+          if (res != ACTION_ABORT && !IS_PSEUDODIR (dirent[i]->name))
             {
               swprintf (cur, len, L"%ls/%ls", __path, dirent[i]->name);
-              res = get_listing_iter (cur, &(*__res)->items[i],
-                                      __count, __size, __ignore_errors,
-                                      __count_dirs);
-              if (res == ACTION_ABORT)
-                {
-                  free (cur);
-                  return ACTION_ABORT;
-                }
+
+              child = listing_add_item (__listing, dirent[i]->name,
+                                        dirent[i]->type);
+              res = get_listing_iter (__listing, cur, child,
+                                      __ignore_errors, __count_dirs,
+                                      __guard);
 
               if (res == ACTION_IGNORE)
                 {
-                  unsigned long long j;
-
-                  /* Free memory used by 'invalid item' */
-                  vfs_free_dirent (dirent [i]);
+                  /* Subtree of child is the tail of listing, */
+                  /* so it could be simply cut off */
+                  listing_drop_item (__listing, child);
+                  __listing->nodes[__node].flags |= ALF_IGNORED_ITEMS;
+                }
+            }
 
-                  /* Shift data */
-                  for (j = i; j < count - 1; ++j)
-                    {
-                      dirent[j] = dirent[j + 1];
-                    }
+          vfs_free_dirent (dirent[i]);
+        }
 
-                  /* Make allocated array a bit less */
-                  dirent = realloc (dirent,
-                                    (count - 1) * sizeof (vfs_dirent_t));
-                  (*__res)->dirent = dirent;
+      free (dirent);
+      free (cur);
 
-                  (*__res)->items = realloc ((*__res)->items, (count - 1) *
-                          sizeof (action_listing_tree_t*));
+      __listing->nodes[__node].end = __listing->nodes_count;
 
-                  /* Set ignore flag */
-                  (*__res)->ignored_flag = TRUE;
+      if (res == ACTION_ABORT)
+        {
+          return ACTION_ABORT;
+        }
+    }
+  else
+    {
+      /* There is no children */
+      if (S_ISREG (stat.st_mode) || S_ISLNK (stat.st_mode) ||
+          S_ISCHR (stat.st_mode) || S_ISBLK (stat.st_mode) ||
+          S_ISFIFO (stat.st_mode) || S_ISSOCK (stat.st_mode))
+        {
+          ++__listing->count;
 
-                  /* Update informtion about items count */
-                  --count;
-                  --(*__res)->count;
-                }
-              else
-                {
-                  ++i;
-                }
-            }
-          else
+          /* There is no need to collect sizes of symbolic links */
+          if (S_ISREG (stat.st_mode))
             {
-              ++i;
+              __listing->size += stat.st_size;
             }
         }
+    }
 
-      free (cur);
+  return 0;
+}
+
+/**
+ * Free shared listing of directory
+ *
+ * NOTE: Mutex of shared listing should be locked.
+ *
+ * @param __self - shared listing
+ * @param __dir - listing of directory to free
+ */
+static void
+free_shared_dir (action_shared_listing_t *__self, action_shared_dir_t *__dir)
+{
+  long i;
+
+  for (i = 0; i < __dir->count; ++i)
+    {
+      vfs_free_dirent (__dir->dirent[i]);
+    }
+  SAFE_FREE (__dir->dirent);
+  SAFE_FREE (__dir->stat);
+
+  /* Remove from list of alive listings */
+  if (__dir->prev)
+    {
+      __dir->prev->next = __dir->next;
     }
   else
     {
-      int res;
-      vfs_stat_t stat;
+      __self->alive = __dir->next;
+    }
 
-      /* There is no children */
-      if ((res = vfs_lstat (__path, &stat)) == VFS_OK)
-        {
-          if (S_ISREG (stat.st_mode) || S_ISLNK (stat.st_mode) ||
-              S_ISCHR (stat.st_mode) || S_ISBLK (stat.st_mode) ||
-              S_ISFIFO (stat.st_mode) || S_ISSOCK (stat.st_mode))
-            {
-              (*__count)++;
+  if (__dir->next)
+    {
+      __dir->next->prev = __dir->prev;
+    }
 
-              /* There is no need to collect sizes of symbolic links */
-              if (S_ISREG (stat.st_mode))
-                {
-                  (*__size) += stat.st_size;
-                }
-            }
+  free (__dir);
+}
+
+/**
+ * Get stat information of all entries of directory
+ *
+ * @param __url - URL of directory
+ * @param __dirent - entries of directory
+ * @param __count - count of entries
+ * @return array of stat records. Records of items which can't be
+ * stat'ed are zeroed.
+ */
+static action_listing_stat_t*
+stat_entries (const wchar_t *__url, vfs_dirent_t **__dirent, long __count)
+{
+  action_listing_stat_t *res;
+  vfs_stat_t stat;
+  wchar_t *cur;
+  size_t len;
+  long i;
+
+  MALLOC_ZERO (res, MAX (__count, 1) * sizeof (action_listing_stat_t));
+
+  len = wcslen (__url) + MAX_FILENAME_LEN + 1;
+  cur = malloc ((len + 1) * sizeof (wchar_t));
+
+  for (i = 0; i < __count; ++i)
+    {
+      if (IS_PSEUDODIR (__dirent[i]->name))
+        {
+          continue;
         }
-      else
+
+      swprintf (cur, len, L"%ls/%ls", __url, __dirent[i]->name);
+      if (vfs_lstat (cur, &stat) == VFS_OK)
         {
-          return res;
+          action_listing_stat_set (&res[i], &stat);
         }
     }
 
-  return 0;
+  free (cur);
+
+  return res;
 }
 
 /**
- * Iterator to free listing tree
+ * Iterator for counter of shared listing
  *
- * @param __tree - tree to free
+ * @param __self - shared listing
+ * @param __path - URL of item to count
+ * @param __rec - stored stat information of item (may be NULL)
+ * @param __guard - guard against crossing filesystems
  */
 static void
-free_listing_iter (action_listing_tree_t *__tree)
+shared_count_iter (action_shared_listing_t *__self, const wchar_t *__path,
+                   const action_listing_stat_t *__rec,
+                   action_walk_guard_t *__guard)
 {
+  vfs_stat_t stat;
+  action_shared_dir_t *dir;
+  wchar_t *cur;
+  size_t len;
   long i;
+  int res;
+
+  if (__self->abort)
+    {
+      return;
+    }
 
-  if (!__tree)
+  if (!action_listing_stat_get (__rec, &stat) && vfs_lstat (__path, &stat))
     {
       return;
     }
 
-  for (i = 0; i < __tree->count; ++i)
+  if (!S_ISDIR (stat.st_mode))
     {
-      vfs_free_dirent (__tree->dirent[i]);
-      free_listing_iter (__tree->items[i]);
+      ++__self->count;
+
+      /* There is no need to collect sizes of symbolic links */
+      if (S_ISREG (stat.st_mode))
+        {
+          __self->size += stat.st_size;
+        }
+
+      return;
+    }
+
+  if (__self->count_dirs)
+    {
+      ++__self->count;
+    }
+
+  /* Directories on other filesystems are listed by operation only */
+  if (!action_walk_guard_enter (__guard, &stat))
+    {
+      return;
     }
-  free (__tree->dirent);
-  free (__tree->items);
-  free (__tree);
+
+  dir = action_shared_listing_scandir (__self, __path, &res);
+  if (!dir)
+    {
+      /* Errors are reported by operation itself */
+      return;
+    }
+
+  len = wcslen (__path) + MAX_FILENAME_LEN + 1;
+  cur = malloc ((len + 1) * sizeof (wchar_t));
+
+  for (i = 0; i < dir->count && !__self->abort; ++i)
+    {
+      if (!IS_PSEUDODIR (dir->dirent[i]->name))
+        {
+          /* URLs should be built in the same way as operation does */
+          swprintf (cur, len, L"%ls/%ls", __path, dir->dirent[i]->name);
+          shared_count_iter (__self, cur, &dir->stat[i], __guard);
+        }
+    }
+
+  free (cur);
+
+  action_shared_listing_release (__self, dir);
+}
+
+/**
+ * Thread which counts totals of shared listing
+ *
+ * @param __arg - shared listing
+ * @return NULL
+ */
+static void*
+shared_counter (void *__arg)
+{
+  action_shared_listing_t *self = __arg;
+  action_walk_guard_t guard;
+  unsigned long i;
+  wchar_t *cur;
+  sigset_t set;
+
+  /* All signals are handled by the main thread */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+  for (i = 0; i < self->names_count && !self->abort; ++i)
+    {
+      /* Every item is the root of its own walking */
+      action_walk_guard_init (&guard, action_get_one_filesystem (), FALSE);
+
+      cur = wcdircatsubdir (self->base_dir, self->names[i]);
+      shared_count_iter (self, cur, NULL, &guard);
+      free (cur);
+
+      action_walk_guard_free (&guard);
+    }
+
+  self->done = TRUE;
+
+  return NULL;
 }
 
 /********
@@ -330,20 +490,18 @@ action_get_listing (const wchar_t *__base_dir,
                     unsigned long __count, action_listing_t *__res,
                     BOOL __ignore_errors, BOOL __count_dirs)
 {
-  unsigned long i, ptr;
+  unsigned long i, node;
   wchar_t *cur, *format;
   int res = ACTION_OK;
+  action_walk_guard_t guard;
   size_t len;
-  vfs_dirent_t *dirent;
 
   if (!__base_dir || !__res)
     {
       return -1;
     }
 
-  __res->count = 0;
-  __res->size = 0;
-  __res->tree = allocate_listing_tree ();
+  memset (__res, 0, sizeof (action_listing_t));
 
   len = wcslen (__base_dir) + MAX_FILENAME_LEN + 1;
   cur = malloc ((len + 1) * sizeof (wchar_t));
@@ -358,45 +516,43 @@ action_get_listing (const wchar_t *__base_dir,
       format = L"%ls/%ls";
     }
 
-  ptr = 0;
   for (i = 0; i < __count; ++i)
     {
       /* Get full path of current item */
       swprintf (cur, len, format, __base_dir, __list[i]->file->name);
 
-      /* Make pseudo direcgtory entry  */
-      MALLOC_ZERO (dirent, sizeof (vfs_dirent_t));
-      wcscpy (dirent->name, __list[i]->file->name);
-      dirent->type = IFTODT (__list[i]->file->stat.st_mode);
+      /* Add top-level node to listing */
+      node = listing_add_item (__res, __list[i]->file->name,
+                               IFTODT (__list[i]->file->stat.st_mode));
 
-      /* Add our dirent to list */
-      listing_add_item (__res->tree, dirent);
-
-      /* Get listing of item */
-      res = get_listing_iter (cur, &__res->tree->items[ptr],
-                              &__res->count, &__res->size, __ignore_errors,
-                              __count_dirs);
+      /* Get listing of item, every item is the root of its own walking */
+      action_walk_guard_init (&guard, action_get_one_filesystem (), FALSE);
+      res = get_listing_iter (__res, cur, node, __ignore_errors,
+                              __count_dirs, &guard);
+      action_walk_guard_free (&guard);
 
       /* There is an error while listing */
       if (res)
         {
           if (res == ACTION_IGNORE)
             {
-              listing_drop_item (__res->tree);
+              listing_drop_item (__res, node);
               res = 0;
             }
           else
             {
-              free_listing_iter (__res->tree);
+              action_free_listing (__res);
               break;
             }
         }
       else
         {
-          ptr++;
+          ++__res->top_count;
         }
     }
 
+  free (cur);
+
   return res;
 }
 
@@ -413,5 +569,291 @@ action_free_listing (action_listing_t *__self)
       return;
     }
 
-  free_listing_iter (__self->tree);
+  /* All nodes and names are stored in two arrays */
+  SAFE_FREE (__self->nodes);
+  SAFE_FREE (__self->strings);
+
+  __self->nodes_count = __self->nodes_allocated = 0;
+  __self->strings_len = __self->strings_allocated = 0;
+  __self->top_count = 0;
+}
+
+/**
+ * Store needed fields of stat information in listing record
+ *
+ * @param __self - record where information will be stored
+ * @param __stat - stat information of item
+ */
+void
+action_listing_stat_set (action_listing_stat_t *__self,
+                         const vfs_stat_t *__stat)
+{
+  __self->mode  = __stat->st_mode;
+  __self->nlink = __stat->st_nlink;
+  __self->dev   = __stat->st_dev;
+  __self->ino   = __stat->st_ino;
+  __self->size  = __stat->st_size;
+  __self->mtime = __stat->st_mtime;
+}
+
+/**
+ * Restore stat information from listing record
+ * Fields which are not stored in record are zeroed.
+ *
+ * @param __self - record with stored information
+ * @param __stat - where stat information will be saved
+ * @return TRUE if record contains information, FALSE otherwise
+ */
+BOOL
+action_listing_stat_get (const action_listing_stat_t *__self,
+                         vfs_stat_t *__stat)
+{
+  if (!__self || !__self->mode)
+    {
+      return FALSE;
+    }
+
+  memset (__stat, 0, sizeof (vfs_stat_t));
+
+  __stat->st_mode  = __self->mode;
+  __stat->st_nlink = __self->nlink;
+  __stat->st_dev   = __self->dev;
+  __stat->st_ino   = __self->ino;
+  __stat->st_size  = __self->size;
+  __stat->st_mtime = __self->mtime;
+
+  return TRUE;
+}
+
+/**
+ * Start counting of items in background
+ *
+ * @param __base_dir - base directory
+ * @param __list - list of items
+ * @param __count - count of items in list
+ * @param __count_dirs - count dirs to summary items count
+ * @return descriptor of shared listing. Use action_shared_listing_stop()
+ * to free it.
+ */
+action_shared_listing_t*
+action_shared_listing_start (const wchar_t *__base_dir,
+                             const file_panel_item_t **__list,
+                             unsigned long __count, BOOL __count_dirs)
+{
+  action_shared_listing_t *res;
+  unsigned long i;
+
+  MALLOC_ZERO (res, sizeof (action_shared_listing_t));
+
+  res->base_dir = wcsdup (__base_dir);
+  res->names_count = __count;
+  res->count_dirs = __count_dirs;
+  res->names = malloc (__count * sizeof (wchar_t*));
+
+  for (i = 0; i < __count; ++i)
+    {
+      res->names[i] = wcsdup (__list[i]->file->name);
+    }
+
+  res->listings = hashmap_create_wck (NULL, SHARED_LISTINGS_LENGTH);
+
+  pthread_mutex_init (&res->mutex, NULL);
+  pthread_cond_init (&res->cond, NULL);
+
+  res->started = !pthread_create (&res->thread, NULL, shared_counter, res);
+
+  if (!res->started)
+    {
+      /* Totals will be unknown, but operation still could use */
+      /* shared listing */
+      res->done = TRUE;
+    }
+
+  return res;
+}
+
+/**
+ * Get listing of directory
+ * If another pass has already scanned this directory, its listing
+ * is returned. Otherwise directory is scanned and listing is left
+ * for another pass.
+ *
+ * @param __self - shared listing
+ * @param __url - URL of directory
+ * @param __error - pointer to variable where code of error will be saved
+ * @return listing of directory or NULL in case of error.
+ * Use action_shared_listing_release() when listing is not needed anymore.
+ */
+action_shared_dir_t*
+action_shared_listing_scandir (action_shared_listing_t *__self,
+                               const wchar_t *__url, int *__error)
+{
+  action_shared_dir_t *dir;
+  vfs_dirent_t **dirent = NULL;
+  action_listing_stat_t *stat = NULL;
+  long count;
+
+  pthread_mutex_lock (&__self->mutex);
+
+  dir = hashmap_get (__self->listings, __url);
+
+  if (dir)
+    {
+      /* Directory is scanned by another pass */
+      hashmap_unset (__self->listings, __url);
+      dir->in_map = FALSE;
+      ++dir->users;
+
+      while (dir->pending)
+        {
+          pthread_cond_wait (&__self->cond, &__self->mutex);
+        }
+
+      if (dir->count < 0)
+        {
+          *__error = dir->count;
+          --dir->users;
+          if (!dir->users)
+            {
+              free_shared_dir (__self, dir);
+            }
+          dir = NULL;
+        }
+
+      pthread_mutex_unlock (&__self->mutex);
+
+      return dir;
+    }
+
+  /* Reserve listing for another pass */
+  MALLOC_ZERO (dir, sizeof (action_shared_dir_t));
+  dir->pending = TRUE;
+  dir->in_map = !__self->done;
+  dir->users = 1;
+
+  dir->next = __self->alive;
+  if (__self->alive)
+    {
+      __self->alive->prev = dir;
+    }
+  __self->alive = dir;
+
+  if (dir->in_map)
+    {
+      hashmap_set (__self->listings, __url, dir);
+    }
+
+  pthread_mutex_unlock (&__self->mutex);
+
+  count = vfs_scandir (__url, &dirent, 0, action_walk_compar ());
+
+  if (count >= 0)
+    {
+      /* Entries are stat'ed once for both of passes */
+      stat = stat_entries (__url, dirent, count);
+    }
+
+  pthread_mutex_lock (&__self->mutex);
+
+  dir->pending = FALSE;
+  dir->count = count;
+  dir->dirent = count >= 0 ? dirent : NULL;
+  dir->stat = stat;
+
+  if (count < 0)
+    {
+      /* Another pass should try to scan directory by itself */
+      if (dir->in_map)
+        {
+          hashmap_unset (__self->listings, __url);
+          dir->in_map = FALSE;
+        }
+
+      *__error = count;
+      --dir->users;
+    }
+
+  pthread_cond_broadcast (&__self->cond);
+
+  if (count < 0)
+    {
+      if (!dir->users)
+        {
+          free_shared_dir (__self, dir);
+        }
+      dir = NULL;
+    }
+
+  pthread_mutex_unlock (&__self->mutex);
+
+  return dir;
+}
+
+/**
+ * Release listing of directory got by action_shared_listing_scandir()
+ *
+ * @param __self - shared listing
+ * @param __dir - listing to release
+ */
+void
+action_shared_listing_release (action_shared_listing_t *__self,
+                               action_shared_dir_t *__dir)
+{
+  if (!__dir)
+    {
+      return;
+    }
+
+  pthread_mutex_lock (&__self->mutex);
+
+  --__dir->users;
+  if (!__dir->users && !__dir->in_map)
+    {
+      free_shared_dir (__self, __dir);
+    }
+
+  pthread_mutex_unlock (&__self->mutex);
+}
+
+/**
+ * Stop counting and free shared listing
+ *
+ * @param __self - shared listing to free
+ */
+void
+action_shared_listing_stop (action_shared_listing_t *__self)
+{
+  unsigned long i;
+
+  if (!__self)
+    {
+      return;
+    }
+
+  __self->abort = TRUE;
+
+  if (__self->started)
+    {
+      pthread_join (__self->thread, NULL);
+    }
+
+  /* Free listings which haven't been requested by another pass */
+  while (__self->alive)
+    {
+      free_shared_dir (__self, __self->alive);
+    }
+
+  hashmap_destroy (__self->listings);
+
+  pthread_mutex_destroy (&__self->mutex);
+  pthread_cond_destroy (&__self->cond);
+
+  for (i = 0; i < __self->names_count; ++i)
+    {
+      free (__self->names[i]);
+    }
+
+  free (__self->names);
+  free (__self->base_dir);
+  free (__self);
 }
@@ -13,23 +13,58 @@
 #ifndef _action_listing_h_
 #define _action_listing_h_
 
+#include "hashmap.h"
+
+#include <pthread.h>
+
 /********
  * Type definitions
  */
 
-typedef struct action_tree_node {
-  /* Count of items in node */
-  long count;
+/* Compact stat information of item stored in listing */
+/* (only fields needed by operations walkers) */
+typedef struct {
+  /* Mode of item. Zero means that item hasn't been stat'ed */
+  vfs_mode_t mode;
+  nlink_t nlink;
 
-  /* Will be TRUE when there are any ignored children */
-  BOOL ignored_flag;
+  vfs_dev_t dev;
+  ino_t ino;
 
-  /* Directory entries */
-  vfs_dirent_t **dirent;
+  vfs_offset_t size;
+  time_t mtime;
+} action_listing_stat_t;
 
-  /* Children */
-  struct action_tree_node **items;
-} action_listing_tree_t;
+/* Flags of listing nodes */
+
+/* Children of directory are listed */
+#define ALF_SCANNED       0x0001
+
+/* Some children of directory were ignored by user */
+#define ALF_IGNORED_ITEMS 0x0002
+
+/* Index which doesn't point to any node */
+#define ACTION_LISTING_NONE ((unsigned long)-1)
+
+/* Node of listing */
+/* Nodes are stored in preorder, so subtree of node is a range of */
+/* nodes between node itself and its end */
+typedef struct {
+  /* Offset of name in pool of strings */
+  size_t name;
+
+  /* Index of node next to the last node of subtree */
+  unsigned long end;
+
+  /* Type of item (like d_type in directory entries) */
+  unsigned char type;
+
+  /* Flags of node */
+  unsigned char flags;
+
+  /* Stat information of item (got with lstat) */
+  action_listing_stat_t stat;
+} action_listing_node_t;
 
 typedef struct {
   /* Total count of items */
@@ -38,10 +73,83 @@ typedef struct {
   /* Items' total size */
   __u64_t size;
 
-  /* Tree of items */
-  action_listing_tree_t *tree;
+  /* Count of top-level items */
+  unsigned long top_count;
+
+  /* Nodes of listing in preorder */
+  action_listing_node_t *nodes;
+  unsigned long nodes_count;
+  unsigned long nodes_allocated;
+
+  /* Pool of names of nodes */
+  wchar_t *strings;
+  size_t strings_len;
+  size_t strings_allocated;
 } action_listing_t;
 
+/* Get name of listing's node */
+#define ACTION_LISTING_NAME(_listing, _node) \
+  ((_listing)->strings + (_listing)->nodes[_node].name)
+
+/* Listing of directory shared between several passes */
+typedef struct action_shared_dir {
+  /* Count of entries or code of error */
+  long count;
+
+  /* Directory entries */
+  vfs_dirent_t **dirent;
+
+  /* Stat information of entries (got with lstat) */
+  action_listing_stat_t *stat;
+
+  /* Listing is being made by one of passes */
+  BOOL pending;
+
+  /* Listing is waiting in map for another pass */
+  BOOL in_map;
+
+  /* Count of passes which use listing */
+  int users;
+
+  /* List of all alive listings */
+  struct action_shared_dir *prev, *next;
+} action_shared_dir_t;
+
+/*
+ * Totals of items which are counted in background while
+ * operation is already running. Directory listings made by
+ * the counter and by the operation are shared, so each directory
+ * is scanned only once.
+ */
+typedef struct {
+  /* Total count and size of items counted so far */
+  volatile __u64_t count;
+  volatile __u64_t size;
+
+  /* Counting is finished */
+  volatile BOOL done;
+
+  /* Counting should be stopped */
+  volatile BOOL abort;
+
+  /* Items to count */
+  wchar_t *base_dir;
+  wchar_t **names;
+  unsigned long names_count;
+  BOOL count_dirs;
+
+  /* Listings made by one of passes, keys are URLs of directories */
+  hashmap_t *listings;
+  action_shared_dir_t *alive;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* Thread of counter */
+  pthread_t thread;
+  BOOL started;
+} action_shared_listing_t;
+
 /********
  *
  */
@@ -55,6 +163,30 @@ action_get_listing (const wchar_t *__base_dir,
 void
 action_free_listing (action_listing_t *__self);
 
+void
+action_listing_stat_set (action_listing_stat_t *__self,
+                         const vfs_stat_t *__stat);
+
+BOOL
+action_listing_stat_get (const action_listing_stat_t *__self,
+                         vfs_stat_t *__stat);
+
+action_shared_listing_t*
+action_shared_listing_start (const wchar_t *__base_dir,
+                             const file_panel_item_t **__list,
+                             unsigned long __count, BOOL __count_dirs);
+
+action_shared_dir_t*
+action_shared_listing_scandir (action_shared_listing_t *__self,
+                               const wchar_t *__url, int *__error);
+
+void
+action_shared_listing_release (action_shared_listing_t *__self,
+                               action_shared_dir_t *__dir);
+
+void
+action_shared_listing_stop (action_shared_listing_t *__self);
+
 END_HEADER
 
 #endif
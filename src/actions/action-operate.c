@@ -17,6 +17,10 @@
 #include "messages.h"
 #include "screen.h"
 
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
 /*
  * Free all tail dirents. Helper for chown_dir_rec()
  */
@@ -27,11 +31,17 @@
         int j; \
         for (j = i; j < count; j++) \
           { \
-            vfs_free_dirent (eps[i]); \
+            vfs_free_dirent (eps[j]); \
           } \
       } \
   }
 
+/* Maximal count of workers in parallel operating */
+#define PARALLEL_MAX_WORKERS 8
+
+/* Period of sleeping while waiting for workers */
+#define PARALLEL_IDLE_PERIOD (20 * 1000)
+
 /********
  * Internal datatypes
  */
@@ -45,6 +55,47 @@ typedef struct
   BOOL manual_total_count;
 } process_window_t;
 
+/* Subtree which is operated on by one of workers */
+typedef struct
+{
+  wchar_t *url;
+
+  /* Index of item for which subtree belongs to */
+  unsigned long item;
+
+  /* Result of operating and code of the last error */
+  int result;
+  int last_error;
+} parallel_unit_t;
+
+/* Subtrees shared between workers of parallel operating */
+typedef struct
+{
+  action_tree_operator_t operator;
+  void *user_data;
+
+  /* Directories of items are split into their children, */
+  /* so content of single directory is operated in parallel too */
+  parallel_unit_t *units;
+  unsigned long count, allocated;
+
+  /* Index of the next subtree to be taken by a worker */
+  unsigned long next;
+  pthread_mutex_t mutex;
+} parallel_job_t;
+
+typedef struct
+{
+  parallel_job_t *job;
+
+  /* State of worker's operations. Read by interface without locking. */
+  vfs_tree_state_t state;
+
+  pthread_t thread;
+  BOOL started;
+  volatile BOOL done;
+} parallel_worker_t;
+
 /********
  * Intarface
  */
@@ -233,7 +284,8 @@ destroy_proc_wnd (process_window_t *__window)
  * Make operation on directory
  *
  * @param __full_name - full name of a directory
- * @param __tree - prescanned tree
+ * @param __listing - prescanned listing (may be NULL)
+ * @param __node - node of directory in prescanned listing
  * @param __operation - action which will be called for non-directories
  * in recursively operating and for all objects in non-recursively operating
  * @param __before_rec_op - action which will be called before
@@ -248,16 +300,18 @@ destroy_proc_wnd (process_window_t *__window)
  */
 static int
 process_directory (const wchar_t *__full_name,
-                   const action_listing_tree_t *__tree,
+                   const action_listing_t *__listing, unsigned long __node,
                    action_operator_t __operation,
                    action_operator_t __before_rec_op,
                    action_operator_t __after_rec_op,
                    vfs_stat_t __stat, process_window_t *__proc_wnd,
                    void *__user_data)
 {
-  int i, res, count, global_res, ignored_items = 0;
+  int i, res, count = 0, global_res, ignored_items = 0;
   vfs_dirent_t **eps = NULL;
   BOOL prescanned = FALSE;
+  unsigned long node = 0, end = 0, child;
+  const wchar_t *name;
   wchar_t *full_name;
   size_t len;
 
@@ -274,24 +328,21 @@ process_directory (const wchar_t *__full_name,
     }
 
   /* Get listing of a directory */
-  if (__tree)
+  if (__listing && __node != ACTION_LISTING_NONE &&
+      __listing->nodes[__node].flags & ALF_SCANNED)
     {
-      /* Get listing from prescanned data */
-      count = __tree->count;
-      eps = __tree->dirent;
+      /* Children are the nodes of subtree, */
+      /* next sibling of child starts at the end of its subtree */
+      node = __node + 1;
+      end = __listing->nodes[__node].end;
 
       prescanned = TRUE;
-
-      /*
-       * NOTE: If we use prescanned data, we shouldn't free()
-       *       directory entries from it. They will be freed while
-       *       the whole prescanned tree will be destroying
-       */
     }
   else
     {
       /* Scan directory */
-      ACTION_REPEAT (count = vfs_scandir (__full_name, &eps, 0, vfs_alphasort);
+      ACTION_REPEAT (count = vfs_scandir (__full_name, &eps, 0,
+                                        action_walk_compar ());
                     res = count < 0 ? count : 0,
                     action_error_retryskipcancel_ign,
                     return ACTION_CANCEL_TO_ABORT (__dlg_res_),
@@ -304,28 +355,51 @@ process_directory (const wchar_t *__full_name,
 
   /* Process children */
   global_res = ACTION_OK;
-  for (i = 0; i < count; ++i)
+  for (i = 0; prescanned ? node < end : i < count; ++i)
     {
-      if (!IS_PSEUDODIR (eps[i]->name))
+      child = ACTION_LISTING_NONE;
+      res = 0;
+
+      if (prescanned)
+        {
+          child = node;
+          node = __listing->nodes[node].end;
+          name = ACTION_LISTING_NAME (__listing, child);
+        }
+      else
+        {
+          name = eps[i]->name;
+        }
+
+      if (!IS_PSEUDODIR (name))
         {
           vfs_stat_t stat;
 
           /* Get full filename of current file or directory */
-          swprintf (full_name, len, L"%ls/%ls", __full_name, eps[i]->name);
+          swprintf (full_name, len, L"%ls/%ls", __full_name, name);
 
           /* Stat file or directory */
-          ACTION_REPEAT (res = vfs_stat (full_name, &stat),
-                    action_error_retryskipcancel,
-                    res = ACTION_CANCEL_TO_ABORT (__dlg_res_),
-                    _(L"Cannot stat file or directory \"%ls\":\n%ls"),
-                    full_name, vfs_get_error (res));
+          /* Prescanned listing already knows stat information of */
+          /* everything except targets of symbolic links */
+          if (prescanned && __listing->nodes[child].stat.mode &&
+              !S_ISLNK (__listing->nodes[child].stat.mode))
+            {
+              action_listing_stat_get (&__listing->nodes[child].stat, &stat);
+            }
+          else
+            {
+              ACTION_REPEAT (res = vfs_stat (full_name, &stat),
+                        action_error_retryskipcancel,
+                        res = ACTION_CANCEL_TO_ABORT (__dlg_res_),
+                        _(L"Cannot stat file or directory \"%ls\":\n%ls"),
+                        full_name, vfs_get_error (res));
+            }
 
           if (!res)
             {
               if (S_ISDIR (stat.st_mode))
                 {
-                  res = process_directory (full_name,
-                                           prescanned ? __tree->items[i]:NULL,
+                  res = process_directory (full_name, __listing, child,
                                            __operation, __before_rec_op,
                                            __after_rec_op, stat, __proc_wnd,
                                            __user_data);
@@ -364,6 +438,8 @@ process_directory (const wchar_t *__full_name,
       if (__proc_wnd->abort)
         {
           /* Free allocated memory */
+          /* Current entry is already freed */
+          ++i;
           FREE_REMAIN_DIRENT ();
           global_res = ACTION_ABORT;
           break;
@@ -395,6 +471,8 @@ process_directory (const wchar_t *__full_name,
  * Call user's handlers in case of recursively operating
  *
  * @param __full_name - name of file to operate with
+ * @param __listing - prescanned listing (may be NULL)
+ * @param __node - node of item in prescanned listing
  * @param __operation - action which will be called for non-directories
  * in recursively operating and for all objects in non-recursively operating
  * @param __before_rec_op - action which will be called before
@@ -408,6 +486,8 @@ process_directory (const wchar_t *__full_name,
  */
 static int
 make_recursively_call (const wchar_t *__full_name,
+                       const action_listing_t *__listing,
+                       unsigned long __node,
                        action_operator_t __operation,
                        action_operator_t __before_rec_op,
                        action_operator_t __after_rec_op, vfs_stat_t __stat,
@@ -418,8 +498,8 @@ make_recursively_call (const wchar_t *__full_name,
 
   if (S_ISDIR (__stat.st_mode))
     {
-      res = process_directory (__full_name, NULL, __operation, __before_rec_op,
-                               __after_rec_op, __stat,
+      res = process_directory (__full_name, __listing, __node, __operation,
+                               __before_rec_op, __after_rec_op, __stat,
                                __proc_wnd,  __user_data);
     }
   else
@@ -432,6 +512,163 @@ make_recursively_call (const wchar_t *__full_name,
   return res;
 }
 
+/**
+ * Worker of parallel operating
+ * Takes subtrees one by one until all of them are taken or operation
+ * is aborted.
+ *
+ * @param __arg - descriptor of worker
+ * @return NULL
+ */
+static void*
+parallel_worker (void *__arg)
+{
+  parallel_worker_t *worker = __arg;
+  parallel_job_t *job = worker->job;
+  parallel_unit_t *unit;
+  unsigned long i;
+  __u64_t errors;
+  sigset_t set;
+
+  /* All signals are handled by the main thread */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+  while (!worker->state.abort)
+    {
+      pthread_mutex_lock (&job->mutex);
+      i = job->next;
+      if (i < job->count)
+        {
+          ++job->next;
+        }
+      pthread_mutex_unlock (&job->mutex);
+
+      if (i >= job->count)
+        {
+          break;
+        }
+
+      unit = &job->units[i];
+      errors = worker->state.errors;
+
+      unit->result = job->operator (unit->url, &worker->state,
+                                    job->user_data);
+
+      if (unit->result)
+        {
+          unit->last_error = worker->state.errors != errors ?
+            worker->state.last_error : unit->result;
+        }
+    }
+
+  worker->done = TRUE;
+
+  return NULL;
+}
+
+/**
+ * Add subtree to job of parallel operating
+ *
+ * @param __job - job of parallel operating
+ * @param __item - index of item for which subtree belongs to
+ * @param __url - URL of subtree, it's taken over by job
+ */
+static void
+add_parallel_unit (parallel_job_t *__job, unsigned long __item,
+                   wchar_t *__url)
+{
+  parallel_unit_t *unit;
+
+  if (__job->count == __job->allocated)
+    {
+      __job->allocated = MAX (__job->allocated * 2, 16);
+      __job->units = realloc (__job->units,
+                              __job->allocated * sizeof (parallel_unit_t));
+    }
+
+  unit = &__job->units[__job->count++];
+  unit->url = __url;
+  unit->item = __item;
+
+  /* Subtrees which are not taken by workers are not processed */
+  unit->result = VFS_METHOD_NOT_FOUND;
+  unit->last_error = 0;
+}
+
+/**
+ * Split directory into subtrees of its children
+ *
+ * @param __job - job of parallel operating
+ * @param __item - index of item of directory
+ * @param __url - URL of directory
+ * @return non-zero if directory has been split, zero if it couldn't
+ * be listed
+ */
+static BOOL
+split_parallel_item (parallel_job_t *__job, unsigned long __item,
+                     const wchar_t *__url)
+{
+  vfs_dirent_t **eps;
+  int i, count;
+
+  count = vfs_scandir (__url, &eps, 0, action_walk_compar ());
+
+  if (count < 0)
+    {
+      return FALSE;
+    }
+
+  for (i = 0; i < count; ++i)
+    {
+      if (!IS_PSEUDODIR (eps[i]->name))
+        {
+          add_parallel_unit (__job, __item,
+                             wcdircatsubdir (__url, eps[i]->name));
+        }
+
+      vfs_free_dirent (eps[i]);
+    }
+
+  SAFE_FREE (eps);
+
+  return TRUE;
+}
+
+/**
+ * Ask user what to do with subtree which hasn't been operated on
+ * by worker, and operate on it again if user wants so
+ *
+ * @param __job - job of parallel operating
+ * @param __unit - failed subtree
+ * @return ACTION_OK if subtree has been operated on, ACTION_SKIP if user
+ * skipped it and ACTION_ABORT if user cancelled operation
+ */
+static int
+retry_parallel_unit (parallel_job_t *__job, parallel_unit_t *__unit)
+{
+  vfs_tree_state_t state;
+  int res = __unit->result, error = __unit->last_error, dlg_res;
+
+  while (res)
+    {
+      dlg_res = action_error_retryskipcancel (
+                               _(L"Cannot operate on \"%ls\":\n%ls"),
+                               __unit->url, vfs_get_error (error));
+
+      if (dlg_res != MR_RETRY)
+        {
+          return dlg_res == MR_SKIP ? ACTION_SKIP : ACTION_ABORT;
+        }
+
+      memset (&state, 0, sizeof (state));
+      res = __job->operator (__unit->url, &state, __job->user_data);
+      error = state.errors ? state.last_error : res;
+    }
+
+  return ACTION_OK;
+}
+
 /********
  * User's backend
  */
@@ -469,7 +706,7 @@ action_operate (const wchar_t *__caption, const wchar_t *__desc,
 {
   int res;
   vfs_stat_t stat;
-  unsigned long i, j, source_count = __count, count = 0;
+  unsigned long i, j, node, source_count = __count, count = 0;
   BOOL scanned = FALSE;
   action_listing_t listing;
   wchar_t *name, *full_name;
@@ -498,7 +735,7 @@ action_operate (const wchar_t *__caption, const wchar_t *__desc,
         {
           /* User can ignore some subtrees, so we need */
           /* get count of source elements from prescanned data */
-          source_count = listing.tree->count;
+          source_count = listing.top_count;
           scanned = TRUE;
 
            w_progress_set_max (proc_wnd->progress, listing.count);
@@ -517,11 +754,12 @@ action_operate (const wchar_t *__caption, const wchar_t *__desc,
 
   item = NULL;
   j = 0;
+  node = 0;
   for (i = 0; i < source_count; ++i)
     {
       if (scanned)
         {
-          name = listing.tree->dirent[i]->name;
+          name = ACTION_LISTING_NAME (&listing, node);
 
           /* Search file panel item with specified name */
           item = (file_panel_item_t*)__list[j++];
@@ -568,7 +806,9 @@ action_operate (const wchar_t *__caption, const wchar_t *__desc,
 
       if (__recursively)
         {
-          res = make_recursively_call (full_name, __operation, __before_rec_op,
+          res = make_recursively_call (full_name,
+                                       scanned ? &listing : NULL, node,
+                                       __operation, __before_rec_op,
                                        __after_rec_op, stat,
                                        proc_wnd, __user_data);
         }
@@ -583,6 +823,12 @@ action_operate (const wchar_t *__caption, const wchar_t *__desc,
         }
       free (full_name);
 
+      if (scanned)
+        {
+          /* Next top-level item starts after subtree of current one */
+          node = listing.nodes[node].end;
+        }
+
       if (res == ACTION_OK)
         {
           if (item)
@@ -622,3 +868,289 @@ action_operate (const wchar_t *__caption, const wchar_t *__desc,
 
   return ACTION_OK;
 }
+
+/**
+ * Operate on whole subtrees of items in parallel
+ *
+ * Directories of items are split into subtrees of their children, and
+ * every subtree is passed to operator in one of worker threads, so
+ * operator must not touch the interface. Progress is taken from
+ * workers' states and displayed in process window. User is asked what
+ * to do with every subtree which failed, and directory is passed to
+ * its own operator in the main thread after its children.
+ *
+ * @param __caption - caption of process window
+ * @param __desc - description of operation on process window
+ * @param __base_dir - base directory of items
+ * @param __list - list of items to operate with
+ * @param __count - count of items
+ * @param __operator - operator which is called for every subtree
+ * @param __dir_operator - operator which is called for directory after
+ * its children (if it's NULL, directories are not split)
+ * @param __user_data - user defined data which will be send to operators
+ * @param __results - array where results of items will be stored.
+ * Items which haven't been processed get VFS_METHOD_NOT_FOUND.
+ * @return ACTION_ABORT if operation has been aborted, ACTION_OK otherwise
+ */
+int
+action_operate_parallel (const wchar_t *__caption, const wchar_t *__desc,
+                         const wchar_t *__base_dir,
+                         const file_panel_item_t **__list,
+                         unsigned long __count,
+                         action_tree_operator_t __operator,
+                         action_operator_t __dir_operator,
+                         void *__user_data, int *__results)
+{
+  parallel_job_t job;
+  parallel_worker_t *workers;
+  parallel_unit_t *unit;
+  process_window_t *proc_wnd;
+  unsigned long i, workers_count;
+  long cpus;
+  __u64_t processed, prev_processed = -1;
+  int res;
+  BOOL running, aborted, *split;
+  wchar_t buf[1024], *url;
+  vfs_stat_t stat;
+
+  if (!__count)
+    {
+      return ACTION_OK;
+    }
+
+  memset (&job, 0, sizeof (job));
+  job.operator = __operator;
+  job.user_data = __user_data;
+  pthread_mutex_init (&job.mutex, NULL);
+
+  MALLOC_ZERO (split, __count * sizeof (BOOL));
+
+  for (i = 0; i < __count; ++i)
+    {
+      url = wcdircatsubdir (__base_dir, __list[i]->file->name);
+      stat = __list[i]->file->lstat;
+
+      if (__dir_operator && S_ISDIR (stat.st_mode) &&
+          split_parallel_item (&job, i, url))
+        {
+          split[i] = TRUE;
+          __results[i] = ACTION_OK;
+          free (url);
+        }
+      else
+        {
+          add_parallel_unit (&job, i, url);
+          __results[i] = VFS_METHOD_NOT_FOUND;
+        }
+    }
+
+  /* Operations on trees are mostly waiting for metadata, */
+  /* so at least two workers are useful even on single CPU */
+  cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  workers_count = MIN (MAX (cpus, 2), PARALLEL_MAX_WORKERS);
+  workers_count = MIN (workers_count, MAX (job.count, 1));
+
+  MALLOC_ZERO (workers, workers_count * sizeof (parallel_worker_t));
+
+  proc_wnd = create_proc_wnd (__caption, __desc, FALSE);
+  w_window_show (proc_wnd->window);
+
+  for (i = 0; i < workers_count; ++i)
+    {
+      workers[i].job = &job;
+      workers[i].started = !pthread_create (&workers[i].thread, NULL,
+                                            parallel_worker, &workers[i]);
+    }
+
+  do
+    {
+      /* Process accumulated queue */
+      hook_call (L"switch-task-hook", NULL);
+
+      running = FALSE;
+      processed = 0;
+
+      for (i = 0; i < workers_count; ++i)
+        {
+          if (proc_wnd->abort)
+            {
+              workers[i].state.abort = TRUE;
+            }
+
+          if (workers[i].started && !workers[i].done)
+            {
+              running = TRUE;
+            }
+
+          processed += workers[i].state.processed;
+        }
+
+      if (processed != prev_processed)
+        {
+          swprintf (buf, BUF_LEN (buf), _(L"%llu items processed"),
+                    processed);
+          w_text_set (proc_wnd->text, buf);
+          prev_processed = processed;
+        }
+
+      if (running)
+        {
+          usleep (PARALLEL_IDLE_PERIOD);
+        }
+    } while (running);
+
+  for (i = 0; i < workers_count; ++i)
+    {
+      if (workers[i].started)
+        {
+          pthread_join (workers[i].thread, NULL);
+        }
+    }
+
+  aborted = proc_wnd->abort;
+  destroy_proc_wnd (proc_wnd);
+
+  /* Failed subtrees are retried or skipped as user wants */
+  for (i = 0; i < job.count && !aborted; ++i)
+    {
+      unit = &job.units[i];
+      res = unit->result;
+
+      if (res && res != VFS_METHOD_NOT_FOUND)
+        {
+          res = retry_parallel_unit (&job, unit);
+
+          if (res == ACTION_ABORT)
+            {
+              aborted = TRUE;
+              break;
+            }
+        }
+
+      if (!split[unit->item])
+        {
+          __results[unit->item] = res;
+        }
+      else if (__results[unit->item] != VFS_METHOD_NOT_FOUND &&
+               (res == VFS_METHOD_NOT_FOUND || !__results[unit->item]))
+        {
+          /* Plugin which can't operate on trees makes the whole */
+          /* directory to be passed to action_operate() */
+          __results[unit->item] = res;
+        }
+    }
+
+  /* Directories are operated on after their children */
+  for (i = 0; i < __count && !aborted; ++i)
+    {
+      if (!split[i] || __results[i] == VFS_METHOD_NOT_FOUND)
+        {
+          continue;
+        }
+
+      url = wcdircatsubdir (__base_dir, __list[i]->file->name);
+      res = __dir_operator (url, __list[i]->file->lstat, __user_data,
+                            __results[i] ? AOF_DIR_IGNORED_ITEMS : 0);
+      free (url);
+
+      if (res == ACTION_ABORT)
+        {
+          aborted = TRUE;
+        }
+
+      if (!__results[i])
+        {
+          __results[i] = res;
+        }
+    }
+
+  for (i = 0; i < job.count; ++i)
+    {
+      free (job.units[i].url);
+    }
+  SAFE_FREE (job.units);
+  free (split);
+  free (workers);
+  pthread_mutex_destroy (&job.mutex);
+
+  return aborted ? ACTION_ABORT : ACTION_OK;
+}
+
+/**
+ * Operate on whole subtrees of items in parallel
+ * Items on VFS plugins which can't operate on whole trees are passed
+ * to action_operate().
+ *
+ * @param __caption - caption of process window
+ * @param __desc - description of operation on process window
+ * @param __panel - panel for which items are belong to
+ * @param __base_dir - base directory of items
+ * @param __list - list of items to operate with. Items which have to be
+ * passed to action_operate() are moved to its beginning.
+ * @param __count - count of items
+ * @param __prescan - is prescanning allowed in action_operate()?
+ * @param __follow_symlinks - follow symbolic links in action_operate()
+ * @param __tree_operator - operator on whole subtree
+ * @param __operation - action which will be called for non-directories
+ * by action_operate()
+ * @param __before_rec_op - action which will be called before
+ * recursively sinking by action_operate()
+ * @param __after_rec_op - action which will be called after
+ * recursively sinking by action_operate() and for directories which
+ * content has been operated on in parallel
+ * @param __user_data - user defined data which will be send to operators
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_operate_trees (const wchar_t *__caption, const wchar_t *__desc,
+                      file_panel_t *__panel, const wchar_t *__base_dir,
+                      file_panel_item_t **__list, unsigned long __count,
+                      BOOL __prescan, BOOL __follow_symlinks,
+                      action_tree_operator_t __tree_operator,
+                      action_operator_t __operation,
+                      action_operator_t __before_rec_op,
+                      action_operator_t __after_rec_op,
+                      void *__user_data)
+{
+  int res, *results;
+  unsigned long i, rest_count = 0, done = 0;
+
+  results = malloc (__count * sizeof (int));
+
+  res = action_operate_parallel (__caption, __desc, __base_dir,
+                                 (const file_panel_item_t**)__list, __count,
+                                 __tree_operator, __after_rec_op,
+                                 __user_data, results);
+
+  for (i = 0; i < __count; ++i)
+    {
+      if (!results[i])
+        {
+          __list[i]->selected = FALSE;
+          ++done;
+        }
+      else if (results[i] == VFS_METHOD_NOT_FOUND)
+        {
+          /* Plugin can't operate on trees */
+          __list[rest_count++] = __list[i];
+        }
+    }
+
+  free (results);
+
+  if (__panel->items.selected_count >= done)
+    {
+      __panel->items.selected_count -= done;
+    }
+
+  if (res == ACTION_ABORT || !rest_count)
+    {
+      return res;
+    }
+
+  return action_operate (__caption, __desc, __panel, __base_dir,
+                         (const file_panel_item_t**)__list, rest_count,
+                         TRUE, __prescan, __follow_symlinks,
+                         __operation, __before_rec_op, __after_rec_op,
+                         __user_data);
+}
@@ -0,0 +1,441 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Interface part of queue of background file operations
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "action-queue-iface.h"
+#include "action-queue.h"
+#include "action-trash.h"
+#include "i18n.h"
+#include "util.h"
+#include "hook.h"
+
+#include <unistd.h>
+
+/* Period of refreshing information about jobs */
+#define REFRESH_PERIOD 200 * 1000
+
+/* Period of sleeping between processing of user's input */
+#define IDLE_PERIOD 20 * 1000
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Handler for window's button clicked
+ *
+ * @param __button - descriptor of button which has been clicked
+ * @return non-zero if action has been handled, zero otherwise
+ */
+static int
+on_button_click (w_button_t *__button)
+{
+  w_window_t *wnd;
+
+  wnd = WIDGET_USER_DATA (__button);
+
+  /* We shouldn't use w_window_end_modal() because window */
+  /* is not modal and it stays opened after some buttons */
+  wnd->modal_result = WIDGET_BUTTON_MODALRESULT (__button);
+
+  return TRUE;
+}
+
+/**
+ * Handler of keydown message for widgets on window
+ *
+ * @param __widget - widget on which key was pressed
+ * @param __ch - code of pressed key
+ */
+static int
+on_keydown (widget_t *__widget, wint_t __ch)
+{
+  w_window_t *wnd;
+
+  if (!__widget || !WIDGET_USER_DATA (__widget))
+    {
+      return 0;
+    }
+
+  wnd = WIDGET_USER_DATA (__widget);
+
+  if (__ch == KEY_ESC)
+    {
+      wnd->modal_result = MR_CANCEL;
+      return TRUE;
+    }
+
+  return 0;
+}
+
+/**
+ * Get description of job's state
+ *
+ * @param __state - state of job
+ * @return description of state
+ */
+static wchar_t*
+state_name (int __state)
+{
+  switch (__state)
+    {
+    case AQS_WAITING:
+      return _(L"Waiting");
+    case AQS_SCANNING:
+      return _(L"Scanning");
+    case AQS_RUNNING:
+      return _(L"Running");
+    case AQS_DONE:
+      return _(L"Done");
+    case AQS_FAILED:
+      return _(L"Failed");
+    case AQS_ABORTED:
+      return _(L"Aborted");
+    case AQS_RESTORED:
+      return _(L"Restored");
+    }
+
+  return L"";
+}
+
+/**
+ * Get description of job's type
+ *
+ * @param __type - type of job
+ * @return description of type
+ */
+static wchar_t*
+type_name (int __type)
+{
+  switch (__type)
+    {
+    case AQ_COPY:
+      return _(L"Copy");
+    case AQ_MOVE:
+      return _(L"Move");
+    case AQ_DELETE:
+      return _(L"Delete");
+    case AQ_PURGE:
+      return _(L"Purge");
+    }
+
+  return L"";
+}
+
+/**
+ * Format line of list for job
+ *
+ * @param __job - job to format line for
+ * @param __width - width of line
+ * @param __buf - buffer where line will be stored
+ * @param __buf_size - size of buffer
+ */
+static void
+format_job (const action_queue_job_t *__job, size_t __width,
+            wchar_t *__buf, size_t __buf_size)
+{
+  wchar_t what[1024], progress[128], *fit;
+  int percent = 0;
+  size_t width;
+  __u64_t files_done = action_queue_files_done (__job);
+
+  if (__job->count == 1)
+    {
+      swprintf (what, BUF_LEN (what), L"%ls", __job->items[0]);
+    }
+  else
+    {
+      swprintf (what, BUF_LEN (what), _(L"%lu items"), __job->count);
+    }
+
+  if (__job->dst)
+    {
+      size_t len = wcslen (what);
+      swprintf (what + len, BUF_LEN (what) - len, _(L" to %ls"), __job->dst);
+    }
+
+  /* Bytes are not counted when trash is purged by VFS plugin */
+  if (__job->bytes_total && __job->type != AQ_PURGE)
+    {
+      percent = __job->bytes_done * 100 / __job->bytes_total;
+    }
+  else if (__job->files_total)
+    {
+      percent = files_done * 100 / __job->files_total;
+    }
+
+  if (__job->state == AQS_WAITING || __job->state == AQS_SCANNING)
+    {
+      progress[0] = 0;
+    }
+  else
+    {
+      swprintf (progress, BUF_LEN (progress), _(L"%3d%% (%llu of %llu)"),
+                MIN (percent, 100), files_done, __job->files_total);
+    }
+
+  /* Width of type and state columns and of progress */
+  width = 20 + wcslen (progress) + 1;
+  fit = wcsfit (what, __width > width ? __width - width : 0, L"...");
+
+  swprintf (__buf, __buf_size, L"%-9ls %-9ls %-*ls %ls",
+            state_name (__job->state), type_name (__job->type),
+            (int)(__width > width ? __width - width : 0), fit, progress);
+
+  free (fit);
+}
+
+/**
+ * Refresh information about jobs
+ *
+ * @param __wnd - window with queue
+ * @return count of finished jobs
+ */
+static unsigned long
+refresh_jobs (queue_window_t *__wnd)
+{
+  action_queue_job_t *job, *current = NULL;
+  unsigned long index = 0, finished = 0, cur_index;
+  size_t width;
+  wchar_t buf[1024];
+
+  width = __wnd->list->position.width - 3;
+  cur_index = __wnd->list->items.current;
+
+  action_queue_lock ();
+
+  deque_foreach (action_queue_get_jobs (), job);
+    format_job (job, width, buf, BUF_LEN (buf));
+
+    if (index < w_list_items_count (__wnd->list))
+      {
+        w_list_set_item_text (__wnd->list, index, buf);
+      }
+    else
+      {
+        w_list_append_item (__wnd->list, buf, 0);
+      }
+
+    w_list_get_item (__wnd->list, index)->data = job;
+
+    if (index == cur_index)
+      {
+        current = job;
+      }
+
+    if (AQS_FINISHED (job->state))
+      {
+        ++finished;
+      }
+
+    ++index;
+  deque_foreach_done;
+
+  /* Remove lines of removed jobs */
+  while (w_list_items_count (__wnd->list) > index)
+    {
+      w_list_remove_item (__wnd->list, index);
+    }
+
+  /* Information about current job */
+  if (current && current->errors)
+    {
+      swprintf (buf, BUF_LEN (buf), _(L"Errors: %llu. Last error: %ls"),
+                current->errors, current->last_error_desc);
+    }
+  else if (current && current->state == AQS_SCANNING)
+    {
+      swprintf (buf, BUF_LEN (buf), _(L"Scanning: %llu files, %lldKb"),
+                current->files_total, current->bytes_total / 1024);
+    }
+  else if (current && current->type == AQ_PURGE)
+    {
+      __u64_t done = action_queue_files_done (current);
+
+      swprintf (buf, BUF_LEN (buf),
+                _(L"Trash: %llu files, %lldKb. Left to purge: %llu files"),
+                current->files_total, current->bytes_total / 1024,
+                done < current->files_total ?
+                  current->files_total - done : 0);
+    }
+  else if (current)
+    {
+      swprintf (buf, BUF_LEN (buf), _(L"%lldKb of %lldKb"),
+                current->bytes_done / 1024, current->bytes_total / 1024);
+    }
+  else
+    {
+      wcscpy (buf, _(L"Queue is empty"));
+    }
+
+  action_queue_unlock ();
+
+  w_text_set (__wnd->status, buf);
+
+  return finished;
+}
+
+/**
+ * Rescan all file panels
+ */
+static void
+rescan_panels (void)
+{
+  file_panel_t *panel;
+
+  deque_foreach (file_panel_get_list (), panel);
+    file_panel_rescan (panel);
+  deque_foreach_done;
+}
+
+/**
+ * Create window with queue
+ *
+ * @return descriptor of window
+ */
+static queue_window_t*
+create_window (void)
+{
+  queue_window_t *res;
+  w_container_t *cnt;
+  w_button_t *buttons_desc[4];
+  int i, count;
+
+  static action_button_t buttons[] = {
+    {L"_Abort job",       MR_QUEUE_ABORT_JOB,       FALSE},
+    {L"Res_tore",         MR_QUEUE_RESTORE_JOB,     FALSE},
+    {L"_Remove finished", MR_QUEUE_REMOVE_FINISHED, FALSE},
+    {L"_Close",           MR_CANCEL,                TRUE}
+  };
+
+  MALLOC_ZERO (res, sizeof (queue_window_t));
+
+  res->window = widget_create_window (NULL, _(L"Operation queue"), 0, 0,
+                                      SCREEN_WIDTH - 4, SCREEN_HEIGHT / 2,
+                                      WMS_CENTERED);
+  cnt = WIDGET_CONTAINER (res->window);
+
+  res->list = widget_create_list (NULL, cnt, _(L"Jobs"), 1, 1,
+                                  cnt->position.width - 2,
+                                  cnt->position.height - 5);
+
+  res->status = widget_create_text (NULL, cnt, L"",
+                                    1, cnt->position.height - 4);
+
+  count = sizeof (buttons) / sizeof (action_button_t);
+  action_create_buttons (res->window, buttons, count, buttons_desc);
+
+  WIDGET_USER_DATA (res->list) = res->window;
+  WIDGET_USER_CALLBACK (res->list, keydown) = (widget_keydown_proc)on_keydown;
+
+  for (i = 0; i < count; ++i)
+    {
+      WIDGET_USER_DATA (buttons_desc[i]) = res->window;
+      WIDGET_USER_CALLBACK (buttons_desc[i], clicked) =
+        (widget_action)on_button_click;
+      WIDGET_USER_CALLBACK (buttons_desc[i], keydown) =
+        (widget_keydown_proc)on_keydown;
+    }
+
+  return res;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Show window with queue of operations
+ * Window is not modal, jobs are processed in background while it is opened
+ *
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_queue_show_window (void)
+{
+  queue_window_t *wnd;
+  unsigned long finished;
+  timeval_t timestamp;
+  w_list_item_t *item;
+
+  wnd = create_window ();
+  w_window_show (wnd->window);
+
+  wnd->finished = refresh_jobs (wnd);
+  timestamp = now ();
+
+  for (;;)
+    {
+      hook_call (L"switch-task-hook", NULL);
+
+      switch (wnd->window->modal_result)
+        {
+        case MR_NONE:
+          break;
+
+        case MR_QUEUE_ABORT_JOB:
+          item = w_list_get_current_item (wnd->list);
+          if (item)
+            {
+              action_queue_lock ();
+              action_queue_abort_job (item->data);
+              action_queue_unlock ();
+            }
+          break;
+
+        case MR_QUEUE_RESTORE_JOB:
+          item = w_list_get_current_item (wnd->list);
+          if (item && !action_trash_restore (item->data))
+            {
+              /* Restored items appeared on panels */
+              rescan_panels ();
+            }
+          break;
+
+        case MR_QUEUE_REMOVE_FINISHED:
+          action_queue_lock ();
+          action_queue_remove_finished ();
+          action_queue_unlock ();
+
+          /* Forget about removed jobs */
+          wnd->finished = 0;
+          break;
+
+        default:
+          goto done;
+        }
+
+      if (wnd->window->modal_result ||
+          tv_usec_cmp (timedist (timestamp, now ()), REFRESH_PERIOD) >= 0)
+        {
+          wnd->window->modal_result = MR_NONE;
+
+          finished = refresh_jobs (wnd);
+
+          /* New items appeared or disappeared on panels */
+          if (finished > wnd->finished)
+            {
+              rescan_panels ();
+            }
+
+          wnd->finished = finished;
+          timestamp = now ();
+        }
+
+      usleep (IDLE_PERIOD);
+    }
+
+done:
+  widget_destroy (WIDGET (wnd->window));
+  free (wnd);
+
+  return ACTION_OK;
+}
@@ -0,0 +1,60 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Interface part of queue of background file operations
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _action_queue_iface_h_
+#define _action_queue_iface_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include "actions.h"
+#include <widget.h>
+
+/********
+ * Constants
+ */
+
+/* Modal results of window with queue */
+#define MR_QUEUE_ABORT_JOB       (MR_CUSTOM+1)
+#define MR_QUEUE_REMOVE_FINISHED (MR_CUSTOM+2)
+#define MR_QUEUE_RESTORE_JOB     (MR_CUSTOM+3)
+
+/********
+ * Type definitions
+ */
+
+typedef struct
+{
+  w_window_t *window;
+
+  /* List of jobs */
+  w_list_t *list;
+
+  /* Information about current job */
+  w_text_t *status;
+
+  /* Count of finished jobs at last refreshing */
+  unsigned long finished;
+} queue_window_t;
+
+/********
+ *
+ */
+
+/* Show window with queue of operations */
+int
+action_queue_show_window (void);
+
+END_HEADER
+
+#endif
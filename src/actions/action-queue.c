@@ -0,0 +1,1707 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Queue of background file operations
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "action-queue.h"
+#include "action-queue-iface.h"
+#include "action-copymove-iface.h"
+#include "action-copyfile.h"
+#include "action-walk.h"
+#include "messages.h"
+#include "i18n.h"
+#include "dir.h"
+#include "util.h"
+#include "hook.h"
+#include "dynstruct.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <wchar.h>
+#include <unistd.h>
+
+/********
+ * Constants and other definitions
+ */
+
+/* Maximal size of content of symbolic link */
+#define MAX_SYMLINK_CONTENT 4096
+
+/* Period of waiting for worker of aborted job */
+#define WAIT_PERIOD (20 * 1000)
+
+/* Check if job has been aborted */
+/* Flag is set by the main thread while worker is running */
+#define JOB_ABORTED(_job) \
+  __atomic_load_n (&(_job)->abort, __ATOMIC_ACQUIRE)
+
+/* Return from function if job has been aborted */
+#define CHECK_ABORT(_job) \
+  if (JOB_ABORTED (_job)) \
+    { \
+      return ACTION_ABORT; \
+    }
+
+/* List of all jobs */
+static deque_t *jobs = NULL;
+
+/* Mutex which protects list of jobs and their states */
+static pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Condition which is signalled when user answers worker's question */
+static pthread_cond_t answer_cond = PTHREAD_COND_INITIALIZER;
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Register errors in job
+ * Description of error is built by worker, because context of VFS
+ * errors is kept per thread.
+ *
+ * NOTE: List of jobs should be locked.
+ *
+ * @param __job - job in which errors occurred
+ * @param __count - count of errors
+ * @param __error - code of the last error
+ * @param __desc - description of the last error, NULL to use
+ * description of code
+ */
+static void
+register_errors (action_queue_job_t *__job, __u64_t __count, int __error,
+                 const wchar_t *__desc)
+{
+  if (!__desc)
+    {
+      __desc = vfs_get_error (__error);
+    }
+
+  __job->errors += __count;
+  __job->last_error = __error;
+
+  SAFE_FREE (__job->last_error_desc);
+  __job->last_error_desc = wcsdup (__desc ? __desc : _(L"Unknown error"));
+}
+
+/**
+ * Register an error in job
+ *
+ * @param __job - job in which error occurred
+ * @param __error - code of error
+ */
+static void
+job_error (action_queue_job_t *__job, int __error)
+{
+  pthread_mutex_lock (&jobs_mutex);
+  register_errors (__job, 1, __error, NULL);
+  pthread_mutex_unlock (&jobs_mutex);
+}
+
+/**
+ * Add processed files and bytes to progress of job
+ * Progress is read by interface, so it's changed under lock.
+ *
+ * @param __job - job which is being processed
+ * @param __files - count of processed files
+ * @param __bytes - count of processed bytes
+ */
+static void
+job_progress (action_queue_job_t *__job, __u64_t __files, __u64_t __bytes)
+{
+  pthread_mutex_lock (&jobs_mutex);
+  __job->files_done += __files;
+  __job->bytes_done += __bytes;
+  pthread_mutex_unlock (&jobs_mutex);
+}
+
+/**
+ * Set flags which make worker of job stop
+ *
+ * @param __job - job to abort
+ */
+static void
+set_abort (action_queue_job_t *__job)
+{
+  __atomic_store_n (&__job->abort, TRUE, __ATOMIC_RELEASE);
+  __atomic_store_n (&__job->tree.abort, TRUE, __ATOMIC_RELEASE);
+}
+
+/**
+ * Take tokens from throttle of job and wait if job is too fast
+ *
+ * @param __job - job which is being processed
+ * @param __throttle - throttle of job
+ * @param __count - count of tokens
+ */
+static void
+throttle_job (action_queue_job_t *__job, throttle_t *__throttle,
+              __u64_t __count)
+{
+  __u64_t delay;
+
+  throttle_consume (__throttle, __count);
+
+  while (!JOB_ABORTED (__job) &&
+         (delay = throttle_delay (__throttle)) > 0)
+    {
+      usleep (MIN (delay, WAIT_PERIOD));
+    }
+}
+
+/**
+ * Ask user what to do with existing target
+ * Question is asked by the main thread, worker waits for the answer.
+ *
+ * @param __job - job which is being processed
+ * @param __src - URL of source item
+ * @param __dst - URL of existing target
+ * @return answer of user
+ */
+static int
+ask_conflict (action_queue_job_t *__job,
+              const wchar_t *__src, const wchar_t *__dst)
+{
+  int res;
+
+  if (__job->owr_all_rule)
+    {
+      return __job->owr_all_rule;
+    }
+
+  pthread_mutex_lock (&jobs_mutex);
+
+  __job->conflict_src = __src;
+  __job->conflict_dst = __dst;
+  __job->answer = 0;
+
+  while (!__job->answer && !JOB_ABORTED (__job))
+    {
+      pthread_cond_wait (&answer_cond, &jobs_mutex);
+    }
+
+  res = JOB_ABORTED (__job) ? MR_ABORT : __job->answer;
+
+  __job->conflict_src = NULL;
+  __job->conflict_dst = NULL;
+
+  if (res == MR_CANCEL || res == MR_ABORT)
+    {
+      set_abort (__job);
+    }
+
+  pthread_mutex_unlock (&jobs_mutex);
+
+  return res;
+}
+
+/**
+ * Get device on which specified URL is located
+ * If URL doesn't exist, device of the nearest existing parent is used.
+ *
+ * @param __url - URL to get device of
+ * @return device of URL
+ */
+static vfs_dev_t
+get_device (const wchar_t *__url)
+{
+  vfs_stat_t stat;
+  wchar_t *url, *parent;
+
+  url = wcsdup (__url);
+
+  while (vfs_stat (url, &stat))
+    {
+      parent = wcdirname (url);
+
+      if (!parent || !wcscmp (parent, url))
+        {
+          SAFE_FREE (parent);
+          free (url);
+          return 0;
+        }
+
+      free (url);
+      url = parent;
+    }
+
+  free (url);
+
+  return stat.st_dev;
+}
+
+/**
+ * Calculate count of files and bytes to be processed
+ *
+ * @param __job - job for which prescanning is made
+ * @param __url - URL of item to scan
+ */
+static void
+prescan (action_queue_job_t *__job, const wchar_t *__url)
+{
+  int i, count;
+  vfs_stat_t stat;
+  vfs_dirent_t **dirent;
+  wchar_t *cur;
+
+  if (JOB_ABORTED (__job) || vfs_lstat (__url, &stat))
+    {
+      return;
+    }
+
+  /* Totals are displayed while job is scanning */
+  pthread_mutex_lock (&jobs_mutex);
+  ++__job->files_total;
+  if (S_ISREG (stat.st_mode))
+    {
+      __job->bytes_total += stat.st_size;
+    }
+  pthread_mutex_unlock (&jobs_mutex);
+
+  if (!S_ISDIR (stat.st_mode))
+    {
+      return;
+    }
+
+  count = vfs_scandir (__url, &dirent, 0, action_walk_compar ());
+
+  if (count < 0)
+    {
+      return;
+    }
+
+  for (i = 0; i < count; ++i)
+    {
+      if (!IS_PSEUDODIR (dirent[i]->name))
+        {
+          cur = wcdircatsubdir (__url, dirent[i]->name);
+          prescan (__job, cur);
+          free (cur);
+        }
+
+      vfs_free_dirent (dirent[i]);
+    }
+
+  SAFE_FREE (dirent);
+}
+
+/**
+ * Register error of copying of file in job
+ *
+ * @param __url - URL of file on which error occurred
+ * @param __op - failed operation
+ * @param __error - code of error
+ * @param __job - job which is being processed
+ * @return ACTION_ERR, failed operations are not retried
+ */
+static int
+copy_error (const wchar_t *__url, int __op, int __error,
+            action_queue_job_t *__job)
+{
+  wchar_t desc[1024];
+
+  if (__op != ACF_VERIFY)
+    {
+      job_error (__job, __error);
+      return ACTION_ERR;
+    }
+
+  swprintf (desc, BUF_LEN (desc),
+            _(L"Verification of target file \"%ls\" failed"), __url);
+
+  pthread_mutex_lock (&jobs_mutex);
+  register_errors (__job, 1, __error, desc);
+  pthread_mutex_unlock (&jobs_mutex);
+
+  return ACTION_ERR;
+}
+
+/**
+ * Count copied data in progress of job and wait if job is too fast
+ *
+ * @param __count - count of copied bytes
+ * @param __done - count of bytes copied from file
+ * @param __job - job which is being processed
+ * @return non-zero if job has been aborted, zero otherwise
+ */
+static int
+copy_progress (vfs_size_t __count, vfs_size_t __done ATTR_UNUSED,
+               action_queue_job_t *__job)
+{
+  job_progress (__job, 0, __count);
+  throttle_job (__job, &__job->bytes_throttle, __count);
+
+  return JOB_ABORTED (__job);
+}
+
+/**
+ * Wait if re-reading of target is too fast
+ *
+ * @param __count - count of re-read bytes
+ * @param __done - count of bytes re-read from file
+ * @param __job - job which is being processed
+ * @return non-zero if job has been aborted, zero otherwise
+ */
+static int
+verify_progress (vfs_size_t __count, vfs_size_t __done ATTR_UNUSED,
+                 action_queue_job_t *__job)
+{
+  /* Re-reading of target is limited by the same throttle */
+  throttle_job (__job, &__job->bytes_throttle, __count);
+
+  return JOB_ABORTED (__job);
+}
+
+/**
+ * Copy regular file
+ *
+ * @param __job - job which is being processed
+ * @param __src - URL of source file
+ * @param __dst - URL of destination file
+ * @param __stat - stat information of source file
+ * @param __append - append content of source to existing target
+ * @param __complete - set to TRUE if target has been created from
+ * the whole content of source (could be NULL)
+ * @return zero on success, non-zero otherwise
+ */
+static int
+copy_regular_file (action_queue_job_t *__job,
+                   const wchar_t *__src, const wchar_t *__dst,
+                   vfs_stat_t __stat, BOOL __append, BOOL *__complete)
+{
+  int res = 0, flags = O_WRONLY | O_CREAT | O_TRUNC;
+  vfs_file_t fd_src, fd_dst;
+  vfs_size_t copied;
+  struct utimbuf times;
+  checksum_t sum;
+  action_copyfile_callbacks_t callbacks;
+  BOOL verify;
+
+  if (__complete)
+    {
+      *__complete = FALSE;
+    }
+
+  if (__append)
+    {
+      flags = O_WRONLY | O_APPEND;
+    }
+
+  fd_src = vfs_open (__src, O_RDONLY, &res, 0);
+  if (!fd_src)
+    {
+      job_error (__job, res);
+      return ACTION_ERR;
+    }
+
+  fd_dst = vfs_open (__dst, flags, &res, __stat.st_mode & 07777);
+  if (!fd_dst)
+    {
+      vfs_close (fd_src);
+      job_error (__job, res);
+      return ACTION_ERR;
+    }
+
+  /*
+   * NOTE: When file is appended only tail of target came from source,
+   *       so there is nothing to compare with.
+   */
+  verify = __job->options.verify && !__append;
+  if (verify)
+    {
+      checksum_init (&sum, __job->options.checksum);
+    }
+
+  callbacks.error = (action_copyfile_error_proc)copy_error;
+  callbacks.progress = (action_copyfile_progress_proc)copy_progress;
+  callbacks.user_data = __job;
+
+  res = action_copyfile_data (fd_src, fd_dst, __src, __dst, __stat.st_size,
+                              verify ? &sum : NULL, &callbacks, &copied);
+
+  /* Target should be flushed to the media before it will be re-read */
+  if (verify && res == ACTION_OK)
+    {
+      vfs_fsync (fd_dst);
+    }
+
+  vfs_close (fd_src);
+  vfs_close (fd_dst);
+
+  if (res != ACTION_OK)
+    {
+      /* Do not leave incomplete files, but keep appended target */
+      if (!__append)
+        {
+          vfs_unlink (__dst);
+        }
+
+      /* Error has been registered by callback */
+      return JOB_ABORTED (__job) ? ACTION_ABORT : ACTION_ERR;
+    }
+
+  if (!__append)
+    {
+      action_copyfile_keep_owner (__dst, &__stat);
+    }
+
+  times.actime  = __stat.st_atime;
+  times.modtime = __stat.st_mtime;
+  vfs_utime (__dst, &times);
+
+  if (verify)
+    {
+      callbacks.progress = (action_copyfile_progress_proc)verify_progress;
+
+      res = action_copyfile_verify (__dst, &sum, &callbacks);
+      if (res != ACTION_OK)
+        {
+          return JOB_ABORTED (__job) ? ACTION_ABORT : ACTION_ERR;
+        }
+    }
+
+  /* Appended target and target of truncated source differ from source */
+  if (__complete)
+    {
+      *__complete = !__append && copied == __stat.st_size;
+    }
+
+  return ACTION_OK;
+}
+
+/**
+ * Copy regular file which may have several hard links
+ * The first name of such file is copied as usual, all other names
+ * are created as hard links to the first target.
+ *
+ * @param __job - job which is being processed
+ * @param __src - URL of source file
+ * @param __dst - URL of destination file
+ * @param __stat - stat information of source file
+ * @param __append - append content of source to existing target
+ * @return zero on success, non-zero otherwise
+ */
+static int
+copy_hardlinked_file (action_queue_job_t *__job,
+                      const wchar_t *__src, const wchar_t *__dst,
+                      vfs_stat_t __stat, BOOL __append)
+{
+  int res;
+  BOOL complete;
+
+  if (__stat.st_nlink < 2 || __append)
+    {
+      return copy_regular_file (__job, __src, __dst, __stat, __append,
+                                NULL);
+    }
+
+  if (action_copyfile_link (&__job->hardlinks, &__stat, __dst))
+    {
+      /* Content of file is not copied */
+      job_progress (__job, 0, __stat.st_size);
+      return ACTION_OK;
+    }
+
+  res = copy_regular_file (__job, __src, __dst, __stat, FALSE, &complete);
+
+  /* Other names are linked only to exact copy of file */
+  if (res == ACTION_OK && complete)
+    {
+      action_copyfile_remember_link (&__job->hardlinks, &__stat, __dst);
+    }
+
+  return res;
+}
+
+/**
+ * Decide what to do with existing target of non-directory item
+ *
+ * @param __job - job which is being processed
+ * @param __src - URL of source item
+ * @param __dst - URL of existing target
+ * @param __stat - stat information of source item
+ * @param __dst_stat - stat information of target
+ * @param __append - set to TRUE if source should be appended to target
+ * @return ACTION_OK if target should be replaced, ACTION_SKIP if item
+ * should be skipped, ACTION_ERR or ACTION_ABORT otherwise
+ */
+static int
+resolve_conflict (action_queue_job_t *__job,
+                  const wchar_t *__src, const wchar_t *__dst,
+                  const vfs_stat_t *__stat, const vfs_stat_t *__dst_stat,
+                  BOOL *__append)
+{
+  *__append = FALSE;
+
+  if (S_ISDIR (__dst_stat->st_mode))
+    {
+      job_error (__job, -EISDIR);
+      return ACTION_ERR;
+    }
+
+  return action_copyfile_resolve (ask_conflict (__job, __src, __dst),
+                                  __stat, __dst_stat, &__job->owr_all_rule,
+                                  __append);
+}
+
+/**
+ * Check if item is copied or moved to itself
+ * Error is registered in job in this case.
+ *
+ * @param __job - job which is being processed
+ * @param __src - URL of source item
+ * @param __dst - URL of destination item
+ * @return non-zero if destination is source itself or is located
+ * inside source, zero otherwise
+ */
+static BOOL
+check_itself (action_queue_job_t *__job,
+              const wchar_t *__src, const wchar_t *__dst)
+{
+  wchar_t desc[1024];
+
+  if (!action_copyfile_to_itself (__src, __dst))
+    {
+      return FALSE;
+    }
+
+  swprintf (desc, BUF_LEN (desc), _(L"Cannot copy \"%ls\" to itself"),
+            __src);
+
+  pthread_mutex_lock (&jobs_mutex);
+  register_errors (__job, 1, -EINVAL, desc);
+  pthread_mutex_unlock (&jobs_mutex);
+
+  return TRUE;
+}
+
+/**
+ * Copy item recursively
+ * User is asked what to do with existing targets.
+ *
+ * @param __job - job which is being processed
+ * @param __src - URL of source item
+ * @param __dst - URL of destination item
+ * @return zero on success, non-zero otherwise
+ */
+static int
+copy_tree (action_queue_job_t *__job,
+           const wchar_t *__src, const wchar_t *__dst)
+{
+  int i, count, res, result = ACTION_OK;
+  vfs_stat_t stat, dst_stat;
+  vfs_dirent_t **dirent;
+  wchar_t *src, *dst;
+  BOOL append = FALSE;
+
+  CHECK_ABORT (__job);
+
+  if (check_itself (__job, __src, __dst))
+    {
+      return ACTION_ERR;
+    }
+
+  res = vfs_lstat (__src, &stat);
+  if (res)
+    {
+      job_error (__job, res);
+      return ACTION_ERR;
+    }
+
+  if (S_ISDIR (stat.st_mode))
+    {
+      res = vfs_mkdir (__dst, stat.st_mode & 07777);
+      if (res && (res != -EEXIST || vfs_stat (__dst, &dst_stat) ||
+                  !S_ISDIR (dst_stat.st_mode)))
+        {
+          job_error (__job, res);
+          return ACTION_ERR;
+        }
+
+      if (!res)
+        {
+          action_copyfile_keep_owner (__dst, &stat);
+        }
+
+      job_progress (__job, 1, 0);
+      throttle_job (__job, &__job->files_throttle, 1);
+
+      count = vfs_scandir (__src, &dirent, 0, action_walk_compar ());
+      if (count < 0)
+        {
+          job_error (__job, count);
+          return ACTION_ERR;
+        }
+
+      for (i = 0; i < count; ++i)
+        {
+          if (result != ACTION_ABORT && !IS_PSEUDODIR (dirent[i]->name))
+            {
+              src = wcdircatsubdir (__src, dirent[i]->name);
+              dst = wcdircatsubdir (__dst, dirent[i]->name);
+
+              res = copy_tree (__job, src, dst);
+              if (res)
+                {
+                  result = res;
+                }
+
+              free (src);
+              free (dst);
+            }
+
+          vfs_free_dirent (dirent[i]);
+        }
+
+      SAFE_FREE (dirent);
+
+      return result;
+    }
+
+  if (!vfs_lstat (__dst, &dst_stat))
+    {
+      res = resolve_conflict (__job, __src, __dst, &stat, &dst_stat,
+                              &append);
+
+      if (res == ACTION_SKIP)
+        {
+          /* Skipped item is processed as well */
+          job_progress (__job, 1, S_ISREG (stat.st_mode) ? stat.st_size : 0);
+        }
+
+      if (res)
+        {
+          return res;
+        }
+
+      /* Content of regular target is replaced when it's opened, */
+      /* other targets are replaced by new items */
+      if (!S_ISREG (stat.st_mode) || !S_ISREG (dst_stat.st_mode))
+        {
+          res = vfs_unlink (__dst);
+          if (res)
+            {
+              job_error (__job, res);
+              return ACTION_ERR;
+            }
+        }
+    }
+
+  if (S_ISREG (stat.st_mode))
+    {
+      res = copy_hardlinked_file (__job, __src, __dst, stat, append);
+      if (res)
+        {
+          return res;
+        }
+    }
+  else if (S_ISLNK (stat.st_mode))
+    {
+      wchar_t content[MAX_SYMLINK_CONTENT];
+
+      /* Length of content is returned on success */
+      res = vfs_readlink (__src, content, MAX_SYMLINK_CONTENT);
+      if (res >= 0)
+        {
+          res = vfs_symlink (content, __dst);
+        }
+
+      if (res)
+        {
+          job_error (__job, res);
+          return ACTION_ERR;
+        }
+    }
+  else
+    {
+      res = vfs_mknod (__dst, stat.st_mode, stat.st_rdev);
+      if (res)
+        {
+          job_error (__job, res);
+          return ACTION_ERR;
+        }
+
+      action_copyfile_keep_owner (__dst, &stat);
+    }
+
+  job_progress (__job, 1, 0);
+  throttle_job (__job, &__job->files_throttle, 1);
+
+  return ACTION_OK;
+}
+
+/**
+ * Delete item recursively
+ *
+ * @param __job - job which is being processed
+ * @param __url - URL of item to delete
+ * @param __progress - count deleted items in progress of job
+ * @return zero on success, non-zero otherwise
+ */
+static int
+delete_tree (action_queue_job_t *__job, const wchar_t *__url,
+             BOOL __progress)
+{
+  int i, count, res, result = ACTION_OK;
+  vfs_stat_t stat;
+  vfs_dirent_t **dirent;
+  wchar_t *cur;
+
+  CHECK_ABORT (__job);
+
+  res = vfs_lstat (__url, &stat);
+  if (res)
+    {
+      job_error (__job, res);
+      return ACTION_ERR;
+    }
+
+  if (S_ISDIR (stat.st_mode))
+    {
+      count = vfs_scandir (__url, &dirent, 0, action_walk_compar ());
+      if (count < 0)
+        {
+          job_error (__job, count);
+          return ACTION_ERR;
+        }
+
+      for (i = 0; i < count; ++i)
+        {
+          if (result != ACTION_ABORT && !IS_PSEUDODIR (dirent[i]->name))
+            {
+              cur = wcdircatsubdir (__url, dirent[i]->name);
+
+              res = delete_tree (__job, cur, __progress);
+              if (res)
+                {
+                  result = res;
+                }
+
+              free (cur);
+            }
+
+          vfs_free_dirent (dirent[i]);
+        }
+
+      SAFE_FREE (dirent);
+
+      if (result)
+        {
+          /* Directory is not empty */
+          return result;
+        }
+
+      res = vfs_rmdir (__url);
+    }
+  else
+    {
+      res = vfs_unlink (__url);
+    }
+
+  if (res)
+    {
+      job_error (__job, res);
+      return ACTION_ERR;
+    }
+
+  if (__progress)
+    {
+      job_progress (__job, 1, S_ISREG (stat.st_mode) ? stat.st_size : 0);
+    }
+
+  return ACTION_OK;
+}
+
+/**
+ * Purge item from trash
+ * Whole tree is removed by VFS plugin if it is able to do this.
+ *
+ * @param __job - job which is being processed
+ * @param __url - URL of item in trash
+ * @return zero on success, non-zero otherwise
+ */
+static int
+purge_tree (action_queue_job_t *__job, const wchar_t *__url)
+{
+  int res;
+  __u64_t errors;
+
+  CHECK_ABORT (__job);
+
+  errors = __job->tree.errors;
+  res = vfs_remove_tree (__url, &__job->tree);
+
+  if (res == VFS_METHOD_NOT_FOUND)
+    {
+      return delete_tree (__job, __url, TRUE);
+    }
+
+  if (__job->tree.errors != errors)
+    {
+      pthread_mutex_lock (&jobs_mutex);
+      register_errors (__job, __job->tree.errors - errors,
+                       __job->tree.last_error, NULL);
+      pthread_mutex_unlock (&jobs_mutex);
+    }
+
+  CHECK_ABORT (__job);
+
+  return res ? ACTION_ERR : ACTION_OK;
+}
+
+/**
+ * Move item
+ * Rename is tried at first. If it fails, item is copied and
+ * source is deleted. Existing directories are merged, user is asked
+ * what to do with other existing targets.
+ *
+ * @param __job - job which is being processed
+ * @param __src - URL of source item
+ * @param __dst - URL of destination item
+ * @return zero on success, non-zero otherwise
+ */
+static int
+move_tree (action_queue_job_t *__job,
+           const wchar_t *__src, const wchar_t *__dst)
+{
+  int i, count, res, result = ACTION_OK;
+  vfs_stat_t stat, dst_stat;
+  vfs_dirent_t **dirent;
+  wchar_t *src, *dst;
+
+  CHECK_ABORT (__job);
+
+  if (check_itself (__job, __src, __dst))
+    {
+      return ACTION_ERR;
+    }
+
+  /* Rename would replace existing target silently */
+  if (!vfs_lstat (__dst, &dst_stat))
+    {
+      res = vfs_lstat (__src, &stat);
+      if (res)
+        {
+          job_error (__job, res);
+          return ACTION_ERR;
+        }
+
+      if (!S_ISDIR (stat.st_mode) || !S_ISDIR (dst_stat.st_mode))
+        {
+          res = copy_tree (__job, __src, __dst);
+          if (res)
+            {
+              /* Skipped source is kept as well */
+              return res;
+            }
+
+          return delete_tree (__job, __src, FALSE);
+        }
+
+      job_progress (__job, 1, 0);
+
+      count = vfs_scandir (__src, &dirent, 0, action_walk_compar ());
+      if (count < 0)
+        {
+          job_error (__job, count);
+          return ACTION_ERR;
+        }
+
+      for (i = 0; i < count; ++i)
+        {
+          if (result != ACTION_ABORT && !IS_PSEUDODIR (dirent[i]->name))
+            {
+              src = wcdircatsubdir (__src, dirent[i]->name);
+              dst = wcdircatsubdir (__dst, dirent[i]->name);
+
+              res = move_tree (__job, src, dst);
+              if (res)
+                {
+                  result = res;
+                }
+
+              free (src);
+              free (dst);
+            }
+
+          vfs_free_dirent (dirent[i]);
+        }
+
+      SAFE_FREE (dirent);
+
+      if (result)
+        {
+          /* Source directory is not empty */
+          return result;
+        }
+
+      res = vfs_rmdir (__src);
+      if (res)
+        {
+          job_error (__job, res);
+          return ACTION_ERR;
+        }
+
+      return ACTION_OK;
+    }
+
+  res = vfs_rename (__src, __dst);
+  if (!res)
+    {
+      /* Count progress of renamed subtree */
+      action_queue_job_t dummy;
+
+      memset (&dummy, 0, sizeof (dummy));
+      prescan (&dummy, __dst);
+
+      job_progress (__job, dummy.files_total, dummy.bytes_total);
+
+      return ACTION_OK;
+    }
+
+  if (res != -EXDEV && res != -ENOTEMPTY && res != -EEXIST)
+    {
+      job_error (__job, res);
+      return ACTION_ERR;
+    }
+
+  res = copy_tree (__job, __src, __dst);
+  if (res)
+    {
+      /* Do not delete source if it hasn't been copied completely */
+      return res;
+    }
+
+  return delete_tree (__job, __src, FALSE);
+}
+
+/**
+ * Get destination URL for specified item of job
+ *
+ * @param __job - job which is being processed
+ * @param __name - name of source item
+ * @return URL of destination
+ * @sideeffect allocate memory for return value
+ */
+static wchar_t*
+get_destination (action_queue_job_t *__job, const wchar_t *__name)
+{
+  wchar_t *dst, *res;
+
+  /* Expand possible '*' characters */
+  dst = pattern_rename (__job->dst, __name);
+
+  if (isdir (dst, TRUE))
+    {
+      res = wcdircatsubdir (dst, __name);
+      free (dst);
+      return res;
+    }
+
+  return dst;
+}
+
+/**
+ * Add device to list of devices of job
+ * Devices are kept distinct.
+ *
+ * @param __job - job to add device to
+ * @param __dev - device to add
+ */
+static void
+add_device (action_queue_job_t *__job, vfs_dev_t __dev)
+{
+  unsigned long i;
+
+  for (i = 0; i < __job->dev_count; ++i)
+    {
+      if (__job->devices[i] == __dev)
+        {
+          return;
+        }
+    }
+
+  __job->devices = realloc (__job->devices,
+                            (__job->dev_count + 1) * sizeof (vfs_dev_t));
+  __job->devices[__job->dev_count++] = __dev;
+}
+
+/**
+ * Collect devices on which job makes input/output
+ * Every item is stat'ed, because it may be a mount point or be located
+ * on other device than directory of items.
+ *
+ * @param __job - job to collect devices of
+ */
+static void
+collect_devices (action_queue_job_t *__job)
+{
+  unsigned long i;
+  vfs_stat_t stat;
+  wchar_t *url;
+
+  add_device (__job, get_device (__job->base_dir));
+
+  for (i = 0; i < __job->count; ++i)
+    {
+      url = wcdircatsubdir (__job->base_dir, __job->items[i]);
+
+      /* Symbolic links are processed without following them */
+      if (!vfs_lstat (url, &stat))
+        {
+          add_device (__job, stat.st_dev);
+        }
+
+      free (url);
+    }
+
+  if (__job->dst)
+    {
+      add_device (__job, get_device (__job->dst));
+    }
+}
+
+/**
+ * Check if any of devices of job is in list of busy devices
+ *
+ * @param __devices - list of busy devices
+ * @param __count - count of busy devices
+ * @param __job - job to check devices of
+ * @return non-zero if some device of job is busy, zero otherwise
+ */
+static BOOL
+devices_busy (const vfs_dev_t *__devices, unsigned long __count,
+              const action_queue_job_t *__job)
+{
+  unsigned long i, j;
+
+  for (i = 0; i < __count; ++i)
+    {
+      for (j = 0; j < __job->dev_count; ++j)
+        {
+          if (__devices[i] == __job->devices[j])
+            {
+              return TRUE;
+            }
+        }
+    }
+
+  return FALSE;
+}
+
+static void*
+worker (void *__arg);
+
+/**
+ * Start jobs which don't share devices with running ones
+ * Jobs which use the same device are started in order of adding
+ * to the queue, while jobs on disjoint devices run in parallel.
+ *
+ * NOTE: List of jobs should be locked.
+ */
+static void
+schedule (void)
+{
+  action_queue_job_t *job;
+  vfs_dev_t *busy;
+  unsigned long count = 0, size;
+  pthread_attr_t attr;
+
+  if (!jobs)
+    {
+      return;
+    }
+
+  size = 16;
+  busy = malloc (size * sizeof (vfs_dev_t));
+
+  pthread_attr_init (&attr);
+  pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+  deque_foreach (jobs, job);
+    if (AQS_FINISHED (job->state))
+      {
+        deque_foreach_continue;
+      }
+
+    /* Purging of trash is made with idle I/O priority, so it */
+    /* doesn't make devices busy and doesn't wait for them */
+    if (job->type == AQ_PURGE)
+      {
+        if (job->state == AQS_WAITING)
+          {
+            job->state = AQS_SCANNING;
+
+            if (pthread_create (&job->thread, &attr, worker, job))
+              {
+                job->state = AQS_FAILED;
+                register_errors (job, 1, -EAGAIN, NULL);
+              }
+          }
+
+        deque_foreach_continue;
+      }
+
+    if (job->state == AQS_WAITING && !devices_busy (busy, count, job))
+      {
+        job->state = AQS_SCANNING;
+
+        if (pthread_create (&job->thread, &attr, worker, job))
+          {
+            job->state = AQS_FAILED;
+            register_errors (job, 1, -EAGAIN, NULL);
+            deque_foreach_continue;
+          }
+      }
+
+    /* Devices of running jobs and of jobs waiting before others */
+    /* are busy, so order of jobs on the same device is kept */
+    if (count + job->dev_count > size)
+      {
+        size = MAX (size * 2, count + job->dev_count);
+        busy = realloc (busy, size * sizeof (vfs_dev_t));
+      }
+
+    memcpy (busy + count, job->devices, job->dev_count * sizeof (vfs_dev_t));
+    count += job->dev_count;
+  deque_foreach_done;
+
+  pthread_attr_destroy (&attr);
+  free (busy);
+}
+
+/**
+ * Worker thread of job
+ *
+ * NOTE: Worker shouldn't touch the interface, because it isn't
+ *       thread-safe.
+ *
+ * @param __arg - job to process
+ * @return NULL
+ */
+static void*
+worker (void *__arg)
+{
+  action_queue_job_t *job = __arg;
+  unsigned long i;
+  int res = ACTION_OK;
+  wchar_t *src, *dst;
+  __u64_t removed;
+  sigset_t set;
+  BOOL failed = FALSE;
+
+  /* All signals are handled by the main thread */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+  if (job->type == AQ_PURGE || job->options.idle_priority)
+    {
+      /* Priority is set for calling thread only */
+      io_priority_set_idle (NULL);
+    }
+
+  for (i = 0; i < job->count; ++i)
+    {
+      src = wcdircatsubdir (job->base_dir, job->items[i]);
+      prescan (job, src);
+      free (src);
+    }
+
+  pthread_mutex_lock (&jobs_mutex);
+  job->state = AQS_RUNNING;
+  pthread_mutex_unlock (&jobs_mutex);
+
+  for (i = 0; i < job->count && !JOB_ABORTED (job); ++i)
+    {
+      src = wcdircatsubdir (job->base_dir, job->items[i]);
+
+      switch (job->type)
+        {
+        case AQ_COPY:
+          dst = get_destination (job, job->items[i]);
+          res = copy_tree (job, src, dst);
+          free (dst);
+          break;
+
+        case AQ_MOVE:
+          dst = get_destination (job, job->items[i]);
+          res = move_tree (job, src, dst);
+          free (dst);
+          break;
+
+        case AQ_DELETE:
+          res = delete_tree (job, src, TRUE);
+          break;
+
+        case AQ_PURGE:
+          removed = action_queue_files_done (job);
+          job->item_states[i] = AQI_PURGING;
+
+          res = purge_tree (job, src);
+
+          if (!res)
+            {
+              job->item_states[i] = AQI_PURGED;
+            }
+          else if (action_queue_files_done (job) == removed)
+            {
+              /* Nothing has been removed from item */
+              job->item_states[i] = AQI_WAITING;
+            }
+          break;
+        }
+
+      /* Skipped items are not failures */
+      if (res == ACTION_ERR)
+        {
+          failed = TRUE;
+        }
+
+      free (src);
+    }
+
+  /* Errors are registered by this worker only */
+  if (job->type == AQ_PURGE && job->dst && !JOB_ABORTED (job) &&
+      !job->errors)
+    {
+      /* Directory of deletion in trash is empty now */
+      vfs_rmdir (job->base_dir);
+    }
+
+  /* Context of VFS errors of this thread */
+  vfs_context_done ();
+
+  pthread_mutex_lock (&jobs_mutex);
+
+  if (JOB_ABORTED (job))
+    {
+      job->state = AQS_ABORTED;
+    }
+  else
+    {
+      job->state = failed || job->errors ? AQS_FAILED : AQS_DONE;
+    }
+
+  /* Devices of this job are free now */
+  schedule ();
+
+  pthread_mutex_unlock (&jobs_mutex);
+
+  return NULL;
+}
+
+/**
+ * Handler for hook "idle-hook"
+ * Questions of workers about existing targets are asked here,
+ * because workers shouldn't touch the interface.
+ *
+ * @param __call_data - calling context
+ * @return HOOK_SUCCESS
+ */
+static int
+queue_idle_hook (dynstruct_t *__call_data ATTR_UNUSED)
+{
+  static BOOL asking = FALSE;
+  action_queue_job_t *job, *asked = NULL;
+  wchar_t *src = NULL, *dst = NULL;
+  int answer;
+
+  /* Hook is called from loop of dialog as well */
+  if (asking || !jobs)
+    {
+      return HOOK_SUCCESS;
+    }
+
+  pthread_mutex_lock (&jobs_mutex);
+
+  deque_foreach (jobs, job);
+    if (job->conflict_dst && !job->answer)
+      {
+        asked = job;
+        src = wcsdup (job->conflict_src);
+        dst = wcsdup (job->conflict_dst);
+        deque_foreach_break;
+      }
+  deque_foreach_done;
+
+  pthread_mutex_unlock (&jobs_mutex);
+
+  if (!asked)
+    {
+      return HOOK_SUCCESS;
+    }
+
+  asking = TRUE;
+  answer = action_copy_exists_dialog (src, dst, TRUE);
+  asking = FALSE;
+
+  pthread_mutex_lock (&jobs_mutex);
+
+  /* Job could be aborted and removed while user was thinking */
+  deque_foreach (jobs, job);
+    if (job == asked && job->conflict_dst && !job->answer)
+      {
+        job->answer = answer;
+        pthread_cond_broadcast (&answer_cond);
+        deque_foreach_break;
+      }
+  deque_foreach_done;
+
+  pthread_mutex_unlock (&jobs_mutex);
+
+  free (src);
+  free (dst);
+
+  return HOOK_SUCCESS;
+}
+
+/**
+ * Destroy job
+ *
+ * @param __job - job to destroy
+ */
+static void
+destroy_job (action_queue_job_t *__job)
+{
+  unsigned long i;
+
+  for (i = 0; i < __job->count; ++i)
+    {
+      free (__job->items[i]);
+    }
+
+  SAFE_FREE (__job->items);
+  SAFE_FREE (__job->item_states);
+  SAFE_FREE (__job->base_dir);
+  SAFE_FREE (__job->dst);
+  SAFE_FREE (__job->devices);
+  SAFE_FREE (__job->last_error_desc);
+
+  if (__job->hardlinks)
+    {
+      hashmap_destroy (__job->hardlinks);
+    }
+
+  free (__job);
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Add new job to queue
+ * Job is started immediately if there are no running jobs
+ * on the same devices.
+ *
+ * @param __type - type of operation
+ * @param __base_dir - directory of source items
+ * @param __list - list of source items
+ * @param __count - count of source items
+ * @param __dst - URL of destination (unused for deletion)
+ * @param __options - options of copy and move operations,
+ * NULL for defaults
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_queue_add (int __type, const wchar_t *__base_dir,
+                  const file_panel_item_t **__list, unsigned long __count,
+                  const wchar_t *__dst,
+                  const action_queue_options_t *__options)
+{
+  const wchar_t **names;
+  unsigned long i;
+  int res;
+
+  if (!__list || !__count)
+    {
+      return ACTION_ERR;
+    }
+
+  names = malloc (__count * sizeof (wchar_t*));
+
+  for (i = 0; i < __count; ++i)
+    {
+      names[i] = __list[i]->file->name;
+    }
+
+  res = action_queue_add_names (__type, __base_dir, names, __count, __dst,
+                                __options);
+
+  free (names);
+
+  return res;
+}
+
+/**
+ * Add new job for items specified by names to queue
+ *
+ * @param __type - type of operation
+ * @param __base_dir - directory of source items
+ * @param __names - names of source items
+ * @param __count - count of source items
+ * @param __dst - URL of destination (unused for deletion, optional
+ * for purging of trash)
+ * @param __options - options of copy and move operations,
+ * NULL for defaults
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_queue_add_names (int __type, const wchar_t *__base_dir,
+                        const wchar_t **__names, unsigned long __count,
+                        const wchar_t *__dst,
+                        const action_queue_options_t *__options)
+{
+  static BOOL hook_registered = FALSE;
+  action_queue_job_t *job;
+  unsigned long i;
+
+  if (!__base_dir || !__names || !__count ||
+      (__type != AQ_DELETE && __type != AQ_PURGE && !__dst))
+    {
+      return ACTION_ERR;
+    }
+
+  MALLOC_ZERO (job, sizeof (action_queue_job_t));
+
+  job->type = __type;
+  job->state = AQS_WAITING;
+  job->base_dir = wcsdup (__base_dir);
+  job->count = __count;
+  job->items = malloc (__count * sizeof (wchar_t*));
+
+  for (i = 0; i < __count; ++i)
+    {
+      job->items[i] = wcsdup (__names[i]);
+    }
+
+  if (__type == AQ_PURGE)
+    {
+      MALLOC_ZERO (job->item_states, __count * sizeof (int));
+    }
+
+  if (__options)
+    {
+      job->options = *__options;
+    }
+
+  throttle_init (&job->bytes_throttle, job->options.bytes_rate);
+  throttle_init (&job->files_throttle, job->options.files_rate);
+
+  if (__dst)
+    {
+      job->dst = vfs_abs_path (__dst, __base_dir);
+    }
+
+  collect_devices (job);
+
+  pthread_mutex_lock (&jobs_mutex);
+
+  if (!jobs)
+    {
+      jobs = deque_create ();
+    }
+
+  deque_push_back (jobs, job);
+  schedule ();
+
+  pthread_mutex_unlock (&jobs_mutex);
+
+  if (!hook_registered)
+    {
+      hook_register (L"idle-hook", queue_idle_hook, 0);
+      hook_registered = TRUE;
+    }
+
+  return ACTION_OK;
+}
+
+/**
+ * Lock list of jobs
+ * States of jobs couldn't be changed while list is locked.
+ */
+void
+action_queue_lock (void)
+{
+  pthread_mutex_lock (&jobs_mutex);
+}
+
+/**
+ * Unlock list of jobs
+ */
+void
+action_queue_unlock (void)
+{
+  pthread_mutex_unlock (&jobs_mutex);
+}
+
+/**
+ * Get list of jobs
+ *
+ * NOTE: List should be locked.
+ *
+ * @return list of jobs
+ */
+deque_t*
+action_queue_get_jobs (void)
+{
+  if (!jobs)
+    {
+      jobs = deque_create ();
+    }
+
+  return jobs;
+}
+
+/**
+ * Abort job
+ * Waiting job is aborted immediately, running job will be stopped
+ * by its worker.
+ *
+ * NOTE: List should be locked.
+ *
+ * @param __job - job to abort
+ */
+void
+action_queue_abort_job (action_queue_job_t *__job)
+{
+  if (!__job || AQS_FINISHED (__job->state))
+    {
+      return;
+    }
+
+  set_abort (__job);
+
+  /* Worker may wait for answer about existing target */
+  pthread_cond_broadcast (&answer_cond);
+
+  if (__job->state == AQS_WAITING)
+    {
+      __job->state = AQS_ABORTED;
+
+      /* Jobs waited for this one could be started now */
+      schedule ();
+    }
+}
+
+/**
+ * Remove finished jobs from queue
+ *
+ * NOTE: List should be locked.
+ */
+void
+action_queue_remove_finished (void)
+{
+  action_queue_job_t *job;
+
+  if (!jobs)
+    {
+      return;
+    }
+
+  deque_foreach (jobs, job);
+    if (AQS_FINISHED (job->state))
+      {
+        deque_remove (jobs, deque_foreach_iterator, NULL);
+        destroy_job (job);
+      }
+  deque_foreach_done;
+}
+
+/**
+ * Get count of processed files of job
+ * Items removed by VFS plugin are counted in state of tree removing.
+ *
+ * @param __job - job to get count of processed files of
+ * @return count of processed files
+ */
+__u64_t
+action_queue_files_done (const action_queue_job_t *__job)
+{
+  return __job->files_done +
+         __atomic_load_n (&__job->tree.processed, __ATOMIC_RELAXED);
+}
+
+/**
+ * Wait until worker of aborted job finishes
+ *
+ * NOTE: List should be locked. It is unlocked while waiting.
+ *
+ * @param __job - aborted job
+ */
+void
+action_queue_wait_job (action_queue_job_t *__job)
+{
+  while (!AQS_FINISHED (__job->state))
+    {
+      pthread_mutex_unlock (&jobs_mutex);
+      usleep (WAIT_PERIOD);
+      pthread_mutex_lock (&jobs_mutex);
+    }
+}
+
+/**
+ * Show window with queue of operations
+ *
+ * @param __panel - panel which will be rescanned when jobs finish
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_queue (file_panel_t *__panel ATTR_UNUSED)
+{
+  return action_queue_show_window ();
+}
+
+/**
+ * Delete list of files from specified panel in background
+ *
+ * @param __panel - determines panel from which files will be deleted
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_queue_delete (file_panel_t *__panel)
+{
+  unsigned long count;
+  file_panel_item_t **list = NULL;
+  int res = ACTION_ERR;
+  wchar_t *message, *cwd;
+
+  count = file_panel_get_selected_items (__panel, &list);
+
+  if (!action_check_no_pseydodir ((const file_panel_item_t**)list, count))
+    {
+      wchar_t msg[1024];
+      swprintf (msg, BUF_LEN (msg), _(L"Cannot operate on \"%ls\""),
+                list[0]->file->name);
+      MESSAGE_ERROR (msg);
+      SAFE_FREE (list);
+      return ACTION_ERR;
+    }
+
+  message = malloc (1024 * sizeof (wchar_t));
+  action_message_formatting ((const file_panel_item_t**)list, count,
+                             L"Delete %ls in background?", message, 1024);
+
+  if (message_box (_(L"Delete"), message,
+                   MB_YESNO | MB_DEFBUTTON_1 | MB_CRITICAL) == MR_YES)
+    {
+      cwd = file_panel_get_full_cwd (__panel);
+      res = action_queue_add (AQ_DELETE, cwd,
+                              (const file_panel_item_t**)list, count, NULL,
+                              NULL);
+      free (cwd);
+    }
+
+  free (message);
+  SAFE_FREE (list);
+
+  return res;
+}
@@ -0,0 +1,196 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Queue of background file operations
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _action_queue_h_
+#define _action_queue_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include "actions.h"
+#include "hashmap.h"
+#include "throttle.h"
+
+#include <pthread.h>
+
+/********
+ * Constants
+ */
+
+/* Types of queued operations */
+#define AQ_COPY   0
+#define AQ_MOVE   1
+#define AQ_DELETE 2
+#define AQ_PURGE  3
+
+/* States of jobs */
+#define AQS_WAITING  0
+#define AQS_SCANNING 1
+#define AQS_RUNNING  2
+#define AQS_DONE     3
+#define AQS_FAILED   4
+#define AQS_ABORTED  5
+#define AQS_RESTORED 6
+
+#define AQS_FINISHED(_state) ((_state) >= AQS_DONE)
+
+/* States of items of purging job */
+#define AQI_WAITING 0
+#define AQI_PURGING 1
+#define AQI_PURGED  2
+
+/********
+ * Type definitions
+ */
+
+/* Options of copy and move jobs */
+typedef struct
+{
+  /* Verify copied files by checksums of specified algorithm */
+  BOOL verify;
+  int checksum;
+
+  /* Limits of copying speed (zero means no limit) */
+  __u64_t bytes_rate;
+  __u64_t files_rate;
+
+  /* Use idle I/O scheduling class while copying */
+  BOOL idle_priority;
+} action_queue_options_t;
+
+typedef struct
+{
+  /* Type of operation */
+  int type;
+
+  /* Current state of job */
+  int state;
+
+  /* Directory of source items and names of these items */
+  wchar_t *base_dir;
+  wchar_t **items;
+  unsigned long count;
+
+  /* Destination of copy and move operations, */
+  /* original directory of items for purging of trash */
+  /* (NULL if it's unknown, so items couldn't be restored) */
+  wchar_t *dst;
+
+  /* Options of copy and move operations */
+  action_queue_options_t options;
+
+  /* States of items of purging job, items which have been */
+  /* purged partly couldn't be restored */
+  int *item_states;
+
+  /* Distinct devices on which job makes input/output */
+  /* (items of job may be located on other devices than their directory) */
+  vfs_dev_t *devices;
+  unsigned long dev_count;
+
+  /*
+   * NOTE: Progress information and state are written by worker thread
+   *       under lock of list of jobs, so interface reads them
+   *       consistently while it holds the lock.
+   */
+
+  /* Count of total bytes and files to process */
+  __u64_t bytes_total;
+  __u64_t files_total;
+
+  /* Count of processed bytes and files */
+  __u64_t bytes_done;
+  __u64_t files_done;
+
+  /* Count of errors, code and description of the last one */
+  /* (description is changed under lock of list of jobs) */
+  __u64_t errors;
+  int last_error;
+  wchar_t *last_error_desc;
+
+  /* Existing target about which worker waits for answer of user */
+  /* (answer is zero until user answers) */
+  const wchar_t *conflict_src;
+  const wchar_t *conflict_dst;
+  int answer;
+
+  /* Answer which is applied to all existing targets */
+  int owr_all_rule;
+
+  /* Limits of copying speed */
+  throttle_t bytes_throttle;
+  throttle_t files_throttle;
+
+  /* First targets of source files with several hard links */
+  hashmap_t *hardlinks;
+
+  /* Job should be aborted */
+  /* (flag is set and checked by atomic operations) */
+  BOOL abort;
+
+  /* State of removing of trees made by VFS plugin */
+  vfs_tree_state_t tree;
+
+  /* Worker thread of job */
+  pthread_t thread;
+} action_queue_job_t;
+
+/********
+ *
+ */
+
+/* Add new job to queue */
+int
+action_queue_add (int __type, const wchar_t *__base_dir,
+                  const file_panel_item_t **__list, unsigned long __count,
+                  const wchar_t *__dst,
+                  const action_queue_options_t *__options);
+
+/* Add new job for items specified by names to queue */
+int
+action_queue_add_names (int __type, const wchar_t *__base_dir,
+                        const wchar_t **__names, unsigned long __count,
+                        const wchar_t *__dst,
+                        const action_queue_options_t *__options);
+
+/* Lock list of jobs */
+void
+action_queue_lock (void);
+
+/* Unlock list of jobs */
+void
+action_queue_unlock (void);
+
+/* Get list of jobs. List should be locked. */
+deque_t*
+action_queue_get_jobs (void);
+
+/* Abort job */
+void
+action_queue_abort_job (action_queue_job_t *__job);
+
+/* Remove finished jobs from queue */
+void
+action_queue_remove_finished (void);
+
+/* Get count of processed files of job */
+__u64_t
+action_queue_files_done (const action_queue_job_t *__job);
+
+/* Wait until worker of aborted job finishes */
+void
+action_queue_wait_job (action_queue_job_t *__job);
+
+END_HEADER
+
+#endif
@@ -0,0 +1,755 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Deletion through trash directory
+ *
+ * Items are renamed to hidden trash directory on the same filesystem,
+ * so deletion takes constant time for user. Trash is purged by job in
+ * queue of background operations and items could be restored until
+ * this job finishes. Items left in trash by sessions which have been
+ * finished before purging are purged at startup. Trash directories
+ * are listed in user's directory when they are used, so only these
+ * filesystems are visited at startup.
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "action-trash.h"
+#include "messages.h"
+#include "i18n.h"
+#include "dir.h"
+#include "shared.h"
+#include "util.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Count of deletions made through trash, used to make unique */
+/* names of directories in trash */
+static unsigned long deletions = 0;
+
+/* Name of file in user's directory with list of trash directories */
+#define TRASH_LIST_FILE L"trash-list"
+
+/* Trash directories which are already listed in file */
+static wchar_t **listed_trashes = NULL;
+static unsigned long listed_count = 0;
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Get root of filesystem on which directory is located
+ *
+ * @param __dir - URL of directory
+ * @param __dev - device of directory
+ * @return URL of root of filesystem
+ * @sideeffect allocate memory for return value
+ */
+static wchar_t*
+get_fs_root (const wchar_t *__dir, vfs_dev_t __dev)
+{
+  vfs_stat_t stat;
+  wchar_t *dir, *parent;
+
+  dir = wcsdup (__dir);
+
+  for (;;)
+    {
+      parent = wcdirname (dir);
+
+      if (!wcscmp (parent, dir) ||
+          vfs_stat (parent, &stat) || stat.st_dev != __dev)
+        {
+          free (parent);
+          return dir;
+        }
+
+      free (dir);
+      dir = parent;
+    }
+}
+
+/**
+ * Create trash directory if it doesn't exist and check it
+ *
+ * @param __url - URL of trash directory
+ * @param __dev - device on which trash should be located
+ * @return zero on success, non-zero otherwise
+ */
+static int
+prepare_trash (const wchar_t *__url, vfs_dev_t __dev)
+{
+  int res;
+  vfs_stat_t stat;
+
+  res = vfs_mkdir (__url, 0700);
+  if (res && res != -EEXIST)
+    {
+      return res;
+    }
+
+  res = vfs_lstat (__url, &stat);
+  if (res)
+    {
+      return res;
+    }
+
+  /* Trash could be located in directory shared with other users */
+  /* so it must be owned by current user */
+  if (!S_ISDIR (stat.st_mode) || stat.st_uid != getuid () ||
+      stat.st_dev != __dev)
+    {
+      return -EPERM;
+    }
+
+  return 0;
+}
+
+/**
+ * Get name of trash directory
+ *
+ * @param __buf - buffer where name will be stored
+ * @param __size - size of buffer
+ */
+static void
+trash_name (wchar_t *__buf, size_t __size)
+{
+  swprintf (__buf, __size, L".%s-trash-%d", PACKAGE, (int)getuid ());
+}
+
+/**
+ * Get name of file with list of trash directories
+ *
+ * @return multibyte name of file or NULL if there is no user's directory
+ * @sideeffect allocate memory for return value
+ */
+static char*
+trash_list_name (void)
+{
+  wchar_t *dir, *name;
+  char *res;
+
+  dir = get_user_directory ();
+
+  if (!dir)
+    {
+      return NULL;
+    }
+
+  name = wcdircatsubdir (dir, TRASH_LIST_FILE);
+  wcs2mbs (&res, name);
+
+  free (name);
+  free (dir);
+
+  return res;
+}
+
+/**
+ * Remember that trash directory is listed in file
+ *
+ * @param __trash - URL of trash directory
+ * @return zero if trash has been remembered, non-zero if it
+ * was already known
+ */
+static int
+remember_trash (const wchar_t *__trash)
+{
+  unsigned long i;
+
+  for (i = 0; i < listed_count; ++i)
+    {
+      if (!wcscmp (listed_trashes[i], __trash))
+        {
+          return -1;
+        }
+    }
+
+  listed_trashes = realloc (listed_trashes,
+                            (listed_count + 1) * sizeof (wchar_t*));
+  listed_trashes[listed_count++] = wcsdup (__trash);
+
+  return 0;
+}
+
+/**
+ * Add trash directory to list, so its leftovers are purged at startup
+ *
+ * @param __trash - URL of trash directory
+ */
+static void
+list_trash (const wchar_t *__trash)
+{
+  char *name, *trash;
+  FILE *file;
+
+  if (remember_trash (__trash))
+    {
+      return;
+    }
+
+  name = trash_list_name ();
+  if (!name)
+    {
+      return;
+    }
+
+  wcs2mbs (&trash, __trash);
+
+  /* List is line-based, so such names couldn't be stored */
+  if (!strchr (trash, '\n'))
+    {
+      /* Other sessions could append to list at the same time */
+      /* and file could contain duplicates, which are harmless */
+      file = fopen (name, "a");
+      if (file)
+        {
+          fprintf (file, "%s\n", trash);
+          fclose (file);
+        }
+    }
+
+  free (trash);
+  free (name);
+}
+
+/**
+ * Get trash directory on filesystem of specified directory
+ * Trash is located in root of filesystem or in home directory
+ * if root is not writable.
+ *
+ * @param __dir - URL of directory
+ * @param __dev - device of directory
+ * @return URL of trash directory or NULL if there is no place for trash
+ * @sideeffect allocate memory for return value
+ */
+static wchar_t*
+get_trash (const wchar_t *__dir, vfs_dev_t __dev)
+{
+  wchar_t name[128], *root, *home, *res;
+  vfs_stat_t stat;
+  char *env;
+
+  trash_name (name, BUF_LEN (name));
+
+  root = get_fs_root (__dir, __dev);
+  res = wcdircatsubdir (root, name);
+  free (root);
+
+  if (!prepare_trash (res, __dev))
+    {
+      return res;
+    }
+
+  free (res);
+  res = NULL;
+
+  env = getenv ("HOME");
+  if (!env)
+    {
+      return NULL;
+    }
+
+  MBS2WCS (home, env);
+
+  if (!vfs_stat (home, &stat) && stat.st_dev == __dev)
+    {
+      res = wcdircatsubdir (home, name);
+
+      if (prepare_trash (res, __dev))
+        {
+          SAFE_FREE (res);
+        }
+    }
+
+  free (home);
+
+  return res;
+}
+
+/**
+ * Create directory in trash for items of one deletion
+ *
+ * @param __trash - URL of trash directory
+ * @return URL of created directory or NULL in case of error
+ * @sideeffect allocate memory for return value
+ */
+static wchar_t*
+create_deletion_dir (const wchar_t *__trash)
+{
+  wchar_t name[128], *res;
+
+  swprintf (name, BUF_LEN (name), L"%ld.%d.%lu",
+            (long)time (NULL), (int)getpid (), deletions++);
+
+  res = wcdircatsubdir (__trash, name);
+
+  if (vfs_mkdir (res, 0700))
+    {
+      free (res);
+      return NULL;
+    }
+
+  return res;
+}
+
+/**
+ * Check if process which made deletion is still running
+ *
+ * @param __name - name of directory of deletion in trash
+ * @return non-zero if process is running or name of directory
+ * is unknown, zero otherwise
+ */
+static BOOL
+deletion_alive (const wchar_t *__name)
+{
+  long pid;
+
+  /* Name is made by create_deletion_dir() */
+  if (swscanf (__name, L"%*ld.%ld.%*lu", &pid) != 1)
+    {
+      return TRUE;
+    }
+
+  return pid == getpid () || !kill (pid, 0) || errno == EPERM;
+}
+
+/**
+ * Queue purging of deletions made by finished processes in trash
+ *
+ * @param __trash - URL of trash directory
+ */
+static void
+purge_trash_leftovers (const wchar_t *__trash)
+{
+  vfs_dirent_t **dirent;
+  const wchar_t **names;
+  unsigned long count = 0;
+  int i, res;
+
+  res = vfs_scandir (__trash, &dirent, 0, vfs_alphasort);
+  if (res < 0)
+    {
+      return;
+    }
+
+  names = malloc (MAX (res, 1) * sizeof (wchar_t*));
+
+  for (i = 0; i < res; ++i)
+    {
+      if (!IS_PSEUDODIR (dirent[i]->name) &&
+          !deletion_alive (dirent[i]->name))
+        {
+          names[count++] = dirent[i]->name;
+        }
+    }
+
+  if (count)
+    {
+      /* Original directories of items are unknown, */
+      /* so they couldn't be restored */
+      action_queue_add_names (AQ_PURGE, __trash, names, count, NULL,
+                              NULL);
+    }
+
+  for (i = 0; i < res; ++i)
+    {
+      vfs_free_dirent (dirent[i]);
+    }
+
+  free (names);
+  SAFE_FREE (dirent);
+}
+
+/**
+ * Confirm moving items to trash
+ *
+ * @param __list - list of selected items
+ * @param __count - count of items in list
+ * @return non-zero if user confirmed deletion, zero otherwise
+ */
+static BOOL
+confirm_trash (const file_panel_item_t **__list, unsigned long __count)
+{
+  int res;
+  wchar_t *message;
+
+  message = malloc (1024 * sizeof (wchar_t));
+  action_message_formatting (__list, __count, L"Move %ls to trash?",
+                             message, 1024);
+
+  res = message_box (_(L"Delete"), message, MB_YESNO | MB_DEFBUTTON_1);
+
+  free (message);
+
+  return res == MR_YES;
+}
+
+/**
+ * Move items to directory in trash
+ *
+ * @param __panel - panel for which items are belong to
+ * @param __cwd - full CWD of panel
+ * @param __dir - URL of directory in trash
+ * @param __list - list of items. Moved items are left at its beginning.
+ * @param __count - count of items
+ * @return count of moved items
+ */
+static unsigned long
+move_items (file_panel_t *__panel, const wchar_t *__cwd,
+            const wchar_t *__dir, file_panel_item_t **__list,
+            unsigned long __count)
+{
+  unsigned long i, moved = 0;
+  int res;
+  wchar_t *src, *dst;
+  BOOL aborted = FALSE;
+
+  for (i = 0; i < __count && !aborted; ++i)
+    {
+      src = wcdircatsubdir (__cwd, __list[i]->file->name);
+      dst = wcdircatsubdir (__dir, __list[i]->file->name);
+
+      ACTION_REPEAT (res = vfs_rename (src, dst),
+                     action_error_retryskipcancel,
+                     aborted = __dlg_res_ != MR_SKIP,
+                     _(L"Cannot move \"%ls\" to trash:\n%ls"),
+                     src, vfs_get_error (res));
+
+      if (!res)
+        {
+          __list[i]->selected = FALSE;
+          __list[moved++] = __list[i];
+        }
+
+      free (src);
+      free (dst);
+    }
+
+  if (__panel->items.selected_count >= moved)
+    {
+      __panel->items.selected_count -= moved;
+    }
+
+  return moved;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Move list of files from specified panel to trash
+ * Trash is purged in background.
+ *
+ * @param __panel - determines panel from which files will be deleted
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_trash (file_panel_t *__panel)
+{
+  unsigned long count, moved;
+  file_panel_item_t **list = NULL;
+  int res = ACTION_ERR;
+  wchar_t *cwd, *trash = NULL, *dir = NULL;
+  vfs_stat_t stat;
+
+  count = file_panel_get_selected_items (__panel, &list);
+
+  if (!action_check_no_pseydodir ((const file_panel_item_t**)list, count))
+    {
+      wchar_t msg[1024];
+      swprintf (msg, BUF_LEN (msg), _(L"Cannot operate on \"%ls\""),
+                list[0]->file->name);
+      MESSAGE_ERROR (msg);
+      SAFE_FREE (list);
+      return ACTION_ERR;
+    }
+
+  if (!confirm_trash ((const file_panel_item_t**)list, count))
+    {
+      SAFE_FREE (list);
+      return ACTION_ABORT;
+    }
+
+  cwd = file_panel_get_full_cwd (__panel);
+
+  /* Trash must be located on the same filesystem, */
+  /* so items are only renamed */
+  if (!vfs_stat (cwd, &stat))
+    {
+      trash = get_trash (cwd, stat.st_dev);
+    }
+
+  if (trash)
+    {
+      list_trash (trash);
+      dir = create_deletion_dir (trash);
+    }
+
+  if (!dir)
+    {
+      MESSAGE_ERROR (_(L"Cannot create trash directory "
+                       L"on filesystem of items"));
+    }
+  else
+    {
+      moved = move_items (__panel, cwd, dir, list, count);
+
+      if (moved)
+        {
+          res = action_queue_add (AQ_PURGE, dir,
+                                  (const file_panel_item_t**)list, moved,
+                                  cwd, NULL);
+        }
+      else
+        {
+          vfs_rmdir (dir);
+        }
+    }
+
+  SAFE_FREE (trash);
+  SAFE_FREE (dir);
+  free (cwd);
+  SAFE_FREE (list);
+
+  file_panel_rescan (__panel);
+
+  return res;
+}
+
+/**
+ * Check if items of job could be restored from trash
+ *
+ * NOTE: List of jobs should be locked.
+ *
+ * @param __job - job to check
+ * @return non-zero if items could be restored, zero otherwise
+ */
+BOOL
+action_trash_restorable (const action_queue_job_t *__job)
+{
+  return __job && __job->type == AQ_PURGE && __job->dst &&
+    __job->state != AQS_DONE && __job->state != AQS_RESTORED;
+}
+
+/**
+ * Restore items of purging job from trash
+ * Purging is stopped and items which haven't been purged yet are
+ * moved back to their original directory. Items which have been
+ * purged partly are not restored, their purging is queued again.
+ *
+ * @param __job - purging job
+ * @return zero on success, non-zero otherwise
+ */
+int
+action_trash_restore (action_queue_job_t *__job)
+{
+  unsigned long i, failed = 0, partly = 0;
+  int res, last_error = 0;
+  wchar_t *src, *dst;
+  const wchar_t **purged;
+  vfs_stat_t stat;
+
+  action_queue_lock ();
+
+  if (!action_trash_restorable (__job))
+    {
+      action_queue_unlock ();
+      return ACTION_ERR;
+    }
+
+  /* Worker shouldn't remove items which are being restored */
+  action_queue_abort_job (__job);
+  action_queue_wait_job (__job);
+
+  action_queue_unlock ();
+
+  purged = malloc (__job->count * sizeof (wchar_t*));
+
+  for (i = 0; i < __job->count; ++i)
+    {
+      if (__job->item_states[i] == AQI_PURGED)
+        {
+          continue;
+        }
+
+      if (__job->item_states[i] == AQI_PURGING)
+        {
+          /* Restored item would miss some of its files */
+          purged[partly++] = __job->items[i];
+          continue;
+        }
+
+      src = wcdircatsubdir (__job->base_dir, __job->items[i]);
+
+      if (vfs_lstat (src, &stat))
+        {
+          /* Item has been purged already */
+          free (src);
+          continue;
+        }
+
+      dst = wcdircatsubdir (__job->dst, __job->items[i]);
+
+      /* Do not replace items created after deletion */
+      if (!vfs_lstat (dst, &stat))
+        {
+          res = -EEXIST;
+        }
+      else
+        {
+          res = vfs_rename (src, dst);
+        }
+
+      if (res)
+        {
+          ++failed;
+          last_error = res;
+        }
+
+      free (src);
+      free (dst);
+    }
+
+  if (partly)
+    {
+      /* Rest of partly purged items is purged by new job, */
+      /* which is created before job of deletion is finished, */
+      /* so its directory isn't removed */
+      action_queue_add_names (AQ_PURGE, __job->base_dir, purged, partly,
+                              __job->dst, NULL);
+    }
+  else if (!failed)
+    {
+      vfs_rmdir (__job->base_dir);
+    }
+
+  free (purged);
+
+  action_queue_lock ();
+  __job->state = AQS_RESTORED;
+  action_queue_unlock ();
+
+  if (partly)
+    {
+      wchar_t msg[1024];
+      swprintf (msg, BUF_LEN (msg),
+                _(L"%lu items have been partly purged from trash "
+                  L"and are not restored"), partly);
+      MESSAGE_ERROR (msg);
+    }
+
+  if (failed)
+    {
+      wchar_t msg[1024];
+      swprintf (msg, BUF_LEN (msg),
+                _(L"Cannot restore %lu items from trash:\n%ls"),
+                failed, vfs_get_error (last_error));
+      MESSAGE_ERROR (msg);
+    }
+
+  return partly || failed ? ACTION_ERR : ACTION_OK;
+}
+
+/**
+ * Purge items left in trash by finished sessions
+ *
+ * Only trash directories listed in user's directory and trash in
+ * home directory are looked at, so mount points of other filesystems
+ * (which could be stale or mounted on demand) are not touched.
+ * Deletions of running processes are not touched, so they still
+ * could be restored.
+ */
+void
+action_trash_purge_leftovers (void)
+{
+  wchar_t name[128], *dir, *trash;
+  vfs_stat_t stat, *seen = NULL;
+  unsigned long i, count = 0, allocated = 0;
+  char *list_name, *line = NULL, *env;
+  size_t line_size = 0;
+  ssize_t len;
+  FILE *file;
+
+  /* Check trash directory */
+  void check_trash (const wchar_t *__trash)
+    {
+      if (!vfs_lstat (__trash, &stat) && S_ISDIR (stat.st_mode) &&
+          stat.st_uid == getuid ())
+        {
+          /* Trash could be listed several times or be reachable */
+          /* through different paths */
+          for (i = 0; i < count; ++i)
+            {
+              if (seen[i].st_dev == stat.st_dev &&
+                  seen[i].st_ino == stat.st_ino)
+                {
+                  break;
+                }
+            }
+
+          if (i == count)
+            {
+              if (count == allocated)
+                {
+                  allocated = MAX (allocated * 2, 16);
+                  seen = realloc (seen, allocated * sizeof (vfs_stat_t));
+                }
+              seen[count++] = stat;
+
+              purge_trash_leftovers (__trash);
+            }
+        }
+    }
+
+  trash_name (name, BUF_LEN (name));
+
+  list_name = trash_list_name ();
+  file = list_name ? fopen (list_name, "r") : NULL;
+  if (file)
+    {
+      while ((len = getline (&line, &line_size, file)) > 0)
+        {
+          if (line[len - 1] == '\n')
+            {
+              line[--len] = 0;
+            }
+
+          if (!len)
+            {
+              continue;
+            }
+
+          MBS2WCS (trash, line);
+          remember_trash (trash);
+          check_trash (trash);
+          free (trash);
+        }
+
+      fclose (file);
+    }
+
+  env = getenv ("HOME");
+  if (env)
+    {
+      MBS2WCS (dir, env);
+      trash = wcdircatsubdir (dir, name);
+      check_trash (trash);
+      free (trash);
+      free (dir);
+    }
+
+  SAFE_FREE (line);
+  SAFE_FREE (list_name);
+  SAFE_FREE (seen);
+}
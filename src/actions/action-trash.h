@@ -0,0 +1,40 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Deletion through trash directory
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _action_trash_h_
+#define _action_trash_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include "action-queue.h"
+
+/********
+ *
+ */
+
+/* Check if items of job could be restored from trash */
+BOOL
+action_trash_restorable (const action_queue_job_t *__job);
+
+/* Restore items of purging job from trash */
+int
+action_trash_restore (action_queue_job_t *__job);
+
+/* Purge items left in trash by finished sessions */
+void
+action_trash_purge_leftovers (void);
+
+END_HEADER
+
+#endif
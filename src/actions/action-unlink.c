@@ -0,0 +1,293 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Deferred unlinking of items
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "actions.h"
+#include "action-unlink.h"
+#include "dir.h"
+
+/********
+ * Constants
+ */
+
+/* Initial sizes of arrays of list */
+#define UNLINK_MIN_ITEMS   1024
+#define UNLINK_MIN_DIRS    64
+#define UNLINK_MIN_STRINGS 16384
+
+/* Length of map of directories */
+#define UNLINK_DIRS_MAP_LENGTH 1024
+
+/* Maximal count of items unlinked in one batch */
+#define UNLINK_BATCH_SIZE 1024
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Add string to pool of strings of list
+ *
+ * @param __list - list where string will be added
+ * @param __str - string to add
+ * @param __len - length of string
+ * @return offset of string in pool
+ */
+static size_t
+add_string (action_unlink_list_t *__list, const wchar_t *__str, size_t __len)
+{
+  size_t res;
+
+  /* Grow pool geometrically, so adding is amortized O(1) */
+  if (__list->strings_len + __len + 1 > __list->strings_allocated)
+    {
+      __list->strings_allocated = MAX (__list->strings_allocated * 2,
+                                       __list->strings_len + __len + 1);
+      __list->strings_allocated = MAX (__list->strings_allocated,
+                                       UNLINK_MIN_STRINGS);
+      __list->strings = realloc (__list->strings,
+                                 __list->strings_allocated *
+                                   sizeof (wchar_t));
+    }
+
+  res = __list->strings_len;
+
+  wcsncpy (__list->strings + res, __str, __len);
+  __list->strings[res + __len] = 0;
+  __list->strings_len += __len + 1;
+
+  return res;
+}
+
+/**
+ * Get index of directory in list
+ * Directory is added to list if it hasn't been added yet.
+ *
+ * @param __list - list of items
+ * @param __dir - name of directory
+ * @return index of directory
+ */
+static unsigned long
+get_dir (action_unlink_list_t *__list, const wchar_t *__dir)
+{
+  unsigned long *index;
+
+  /* Items of one directory are usually added one after another */
+  if (__list->count &&
+      !wcscmp (__list->strings +
+                 __list->dirs[__list->items[__list->count - 1].dir],
+               __dir))
+    {
+      return __list->items[__list->count - 1].dir;
+    }
+
+  index = hashmap_get (__list->dirs_map, __dir);
+  if (index)
+    {
+      return *index;
+    }
+
+  if (__list->dirs_count == __list->dirs_allocated)
+    {
+      __list->dirs_allocated = MAX (__list->dirs_allocated * 2,
+                                    UNLINK_MIN_DIRS);
+      __list->dirs = realloc (__list->dirs,
+                              __list->dirs_allocated * sizeof (size_t));
+    }
+
+  __list->dirs[__list->dirs_count] = add_string (__list, __dir,
+                                                 wcslen (__dir));
+
+  index = malloc (sizeof (unsigned long));
+  *index = __list->dirs_count;
+  hashmap_set (__list->dirs_map, __dir, index);
+
+  return __list->dirs_count++;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Create list of items to be unlinked
+ *
+ * @return created list. Use action_unlink_list_destroy() to free it.
+ */
+action_unlink_list_t*
+action_unlink_list_create (void)
+{
+  action_unlink_list_t *res;
+
+  MALLOC_ZERO (res, sizeof (action_unlink_list_t));
+
+  res->dirs_map = hashmap_create_wck (free, UNLINK_DIRS_MAP_LENGTH);
+
+  return res;
+}
+
+/**
+ * Destroy list of items to be unlinked
+ *
+ * @param __list - list to destroy
+ */
+void
+action_unlink_list_destroy (action_unlink_list_t *__list)
+{
+  if (!__list)
+    {
+      return;
+    }
+
+  hashmap_destroy (__list->dirs_map);
+
+  SAFE_FREE (__list->items);
+  SAFE_FREE (__list->dirs);
+  SAFE_FREE (__list->strings);
+
+  free (__list);
+}
+
+/**
+ * Add item to list
+ * Items are unlinked in order of adding, so children of directory
+ * should be added before it.
+ *
+ * @param __list - list where item will be added
+ * @param __url - URL of item
+ * @param __is_dir - item is a directory
+ */
+void
+action_unlink_list_add (action_unlink_list_t *__list, const wchar_t *__url,
+                        BOOL __is_dir)
+{
+  action_unlink_item_t *item;
+  wchar_t *dir;
+  const wchar_t *name;
+  unsigned long dir_index;
+
+  dir = wcdirname (__url);
+  name = wcsrchr (__url, '/');
+  name = name ? name + 1 : __url;
+
+  dir_index = get_dir (__list, dir);
+  free (dir);
+
+  if (__list->count == __list->allocated)
+    {
+      __list->allocated = MAX (__list->allocated * 2, UNLINK_MIN_ITEMS);
+      __list->items = realloc (__list->items,
+                               __list->allocated *
+                                 sizeof (action_unlink_item_t));
+    }
+
+  item = &__list->items[__list->count++];
+
+  item->dir = dir_index;
+  item->name = add_string (__list, name, wcslen (name));
+  item->is_dir = __is_dir;
+}
+
+/**
+ * Unlink all items from list
+ *
+ * Consecutive items of the same directory are unlinked in one batch
+ * relative to this directory. Items on VFS plugins which can't unlink
+ * batches are unlinked one by one by full names.
+ *
+ * @param __list - list of items
+ * @param __error_proc - callback for items which couldn't be unlinked
+ * @param __progress_proc - callback which is called after every batch
+ * @param __user_data - user's data passed to callbacks
+ * @return ACTION_ABORT if unlinking has been aborted by error callback,
+ * ACTION_OK otherwise
+ */
+int
+action_unlink_list_run (const action_unlink_list_t *__list,
+                        action_unlink_error_proc __error_proc,
+                        action_unlink_progress_proc __progress_proc,
+                        void *__user_data)
+{
+  unsigned long i, j, k, count, done = 0;
+  const wchar_t **names, *dir;
+  BOOL *dirs;
+  int *results, res = ACTION_OK;
+  wchar_t *url;
+
+  if (!__list || !__list->count)
+    {
+      return ACTION_OK;
+    }
+
+  names = malloc (UNLINK_BATCH_SIZE * sizeof (wchar_t*));
+  dirs = malloc (UNLINK_BATCH_SIZE * sizeof (BOOL));
+  results = malloc (UNLINK_BATCH_SIZE * sizeof (int));
+
+  for (i = 0; i < __list->count && res != ACTION_ABORT; i = j)
+    {
+      dir = __list->strings + __list->dirs[__list->items[i].dir];
+
+      /* Collect batch of items of the same directory */
+      for (j = i, count = 0;
+           j < __list->count && count < UNLINK_BATCH_SIZE &&
+             __list->items[j].dir == __list->items[i].dir;
+           ++j, ++count)
+        {
+          names[count] = __list->strings + __list->items[j].name;
+          dirs[count] = __list->items[j].is_dir;
+        }
+
+      res = vfs_unlink_batch (dir, names, dirs, count, results);
+
+      if (res == VFS_METHOD_NOT_FOUND)
+        {
+          for (k = 0; k < count; ++k)
+            {
+              url = wcdircatsubdir (dir, names[k]);
+              results[k] = dirs[k] ? vfs_rmdir (url) : vfs_unlink (url);
+              free (url);
+            }
+        }
+      else if (res)
+        {
+          /* Directory itself couldn't be opened */
+          for (k = 0; k < count; ++k)
+            {
+              results[k] = res;
+            }
+        }
+
+      res = ACTION_OK;
+
+      for (k = 0; k < count && res != ACTION_ABORT; ++k)
+        {
+          if (results[k] && __error_proc)
+            {
+              url = wcdircatsubdir (dir, names[k]);
+              res = __error_proc (url, dirs[k], results[k], __user_data);
+              free (url);
+            }
+        }
+
+      done += count;
+
+      if (__progress_proc)
+        {
+          __progress_proc (dir, done, __user_data);
+        }
+    }
+
+  free (names);
+  free (dirs);
+  free (results);
+
+  return res == ACTION_ABORT ? ACTION_ABORT : ACTION_OK;
+}
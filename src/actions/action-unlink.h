@@ -0,0 +1,93 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Deferred unlinking of items
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _action_unlink_h_
+#define _action_unlink_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include "hashmap.h"
+
+/********
+ * Type definitions
+ */
+
+/* Item to be unlinked */
+typedef struct
+{
+  /* Index of parent directory and offset of name in pool of strings */
+  unsigned long dir;
+  size_t name;
+
+  /* Item is a directory */
+  BOOL is_dir;
+} action_unlink_item_t;
+
+/* List of items to be unlinked */
+/* Names of items and of their directories are stored in one pool */
+/* of strings, every directory is stored only once. */
+typedef struct
+{
+  action_unlink_item_t *items;
+  unsigned long count, allocated;
+
+  /* Offsets of names of directories in pool of strings */
+  size_t *dirs;
+  unsigned long dirs_count, dirs_allocated;
+
+  /* Indexes of directories by their names */
+  hashmap_t *dirs_map;
+
+  wchar_t *strings;
+  size_t strings_len, strings_allocated;
+} action_unlink_list_t;
+
+/* Callback for items which couldn't be unlinked in batch */
+/* Returns ACTION_ABORT to stop unlinking */
+typedef int (*action_unlink_error_proc) (const wchar_t *__url,
+                                         BOOL __is_dir, int __error,
+                                         void *__user_data);
+
+/* Callback for progress of unlinking */
+typedef void (*action_unlink_progress_proc) (const wchar_t *__dir,
+                                             unsigned long __done,
+                                             void *__user_data);
+
+/********
+ *
+ */
+
+/* Create list of items to be unlinked */
+action_unlink_list_t*
+action_unlink_list_create (void);
+
+/* Destroy list of items to be unlinked */
+void
+action_unlink_list_destroy (action_unlink_list_t *__list);
+
+/* Add item to list */
+void
+action_unlink_list_add (action_unlink_list_t *__list, const wchar_t *__url,
+                        BOOL __is_dir);
+
+/* Unlink all items from list */
+int
+action_unlink_list_run (const action_unlink_list_t *__list,
+                        action_unlink_error_proc __error_proc,
+                        action_unlink_progress_proc __progress_proc,
+                        void *__user_data);
+
+END_HEADER
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Guards of recursive walkers
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "actions.h"
+#include "action-walk.h"
+
+/********
+ * Constants
+ */
+
+/* Initial length of map of visited directories */
+#define VISITED_MAP_LENGTH 1021
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Calculate hash of key in map of inodes
+ *
+ * @param __hashmap - hash map for which hash is calculating
+ * @param __key - key to calculate hash for
+ * @return hash of key
+ */
+static hash_t
+inode_hash (const hashmap_t *__hashmap, const void *__key)
+{
+  const action_inode_key_t *key = __key;
+
+  return (key->ino * 31 + key->dev) % __hashmap->data_length;
+}
+
+/**
+ * Compare two keys of map of inodes
+ *
+ * @param __key1, __key2 - keys to compare
+ * @return zero if keys are equal, non-zero otherwise
+ */
+static short
+inode_keycmp (const void *__key1, const void *__key2)
+{
+  const action_inode_key_t *a = __key1, *b = __key2;
+
+  return a->dev != b->dev || a->ino != b->ino;
+}
+
+/**
+ * Duplicate key of map of inodes
+ *
+ * @param __key - key to be duplicated
+ * @return clone of key
+ */
+static void*
+inode_keydup (const void *__key)
+{
+  action_inode_key_t *res = malloc (sizeof (action_inode_key_t));
+  *res = *(action_inode_key_t*)__key;
+  return res;
+}
+
+/**
+ * Make map of visited directories longer
+ *
+ * Hash maps don't grow by themselves, so map is rebuilt when there are
+ * more directories than its length, to keep lookups constant-time.
+ *
+ * @param __guard - guard which map should be grown
+ */
+static void
+grow_visited (action_walk_guard_t *__guard)
+{
+  hashmap_t *map;
+  void *key, *value;
+
+  map = action_inode_map_create (NULL,
+                                 __guard->visited->data_length * 2 + 1);
+
+  hashmap_foreach (__guard->visited, key, value);
+    hashmap_set (map, key, value);
+  hashmap_foreach_done;
+
+  hashmap_destroy (__guard->visited);
+  __guard->visited = map;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Create map with keys of type action_inode_key_t
+ *
+ * @param __deleter - deleter of values
+ * @param __length - length of map
+ * @return created map
+ */
+hashmap_t*
+action_inode_map_create (hashmap_deleter __deleter, __u32_t __length)
+{
+  return hashmap_create (inode_hash, __deleter, free,
+                         inode_keycmp, inode_keydup, __length);
+}
+
+/**
+ * Initialize guard of recursive walker
+ *
+ * @param __guard - guard to initialize
+ * @param __one_fs - walker should stay on filesystem of root of walking
+ * @param __follow_symlinks - walker follows symbolic links to directories,
+ * so visited directories should be remembered to break cycles
+ */
+void
+action_walk_guard_init (action_walk_guard_t *__guard, BOOL __one_fs,
+                        BOOL __follow_symlinks)
+{
+  memset (__guard, 0, sizeof (action_walk_guard_t));
+
+  __guard->one_fs = __one_fs;
+
+  if (__follow_symlinks)
+    {
+      __guard->visited = action_inode_map_create (NULL, VISITED_MAP_LENGTH);
+    }
+}
+
+/**
+ * Free memory used by guard of recursive walker
+ *
+ * @param __guard - guard to free
+ */
+void
+action_walk_guard_free (action_walk_guard_t *__guard)
+{
+  if (__guard->visited)
+    {
+      hashmap_destroy (__guard->visited);
+      __guard->visited = NULL;
+    }
+}
+
+/**
+ * Check if guard needs status of directories to decide
+ * if walker could enter them
+ *
+ * @param __guard - guard of walker
+ * @return non-zero if status is needed, zero if any directory
+ * could be entered
+ */
+BOOL
+action_walk_guard_need_stat (const action_walk_guard_t *__guard)
+{
+  return __guard->one_fs || __guard->visited;
+}
+
+/**
+ * Check if walker could enter directory
+ *
+ * The first entered directory is treated as root of walking.
+ *
+ * @param __guard - guard of walker
+ * @param __stat - status of directory (after following symbolic link)
+ * @return non-zero if directory could be entered, zero if it is located
+ * on another filesystem or it has been entered already
+ */
+BOOL
+action_walk_guard_enter (action_walk_guard_t *__guard,
+                         const vfs_stat_t *__stat)
+{
+  action_inode_key_t key;
+
+  if (!__guard->root_entered)
+    {
+      __guard->dev = __stat->st_dev;
+      __guard->root_entered = TRUE;
+    }
+  else if (__guard->one_fs && __stat->st_dev != __guard->dev)
+    {
+      return FALSE;
+    }
+
+  if (__guard->visited)
+    {
+      key.dev = __stat->st_dev;
+      key.ino = __stat->st_ino;
+
+      if (hashmap_isset (__guard->visited, &key))
+        {
+          return FALSE;
+        }
+
+      hashmap_set (__guard->visited, &key, NULL);
+
+      if (++__guard->visited_count > __guard->visited->data_length)
+        {
+          grow_visited (__guard);
+        }
+    }
+
+  return TRUE;
+}
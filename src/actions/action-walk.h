@@ -0,0 +1,79 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Guards of recursive walkers
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _action_walk_h_
+#define _action_walk_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include "hashmap.h"
+#include <vfs/vfs.h>
+
+/********
+ * Type definitions
+ */
+
+/* Key in maps of inodes */
+typedef struct
+{
+  vfs_dev_t dev;
+  ino_t ino;
+} action_inode_key_t;
+
+/* Guard of recursive walker against cycles of symbolic links */
+/* and crossing boundaries of filesystem */
+typedef struct
+{
+  /* Device of root of walking */
+  vfs_dev_t dev;
+  BOOL root_entered;
+
+  /* Stay on filesystem of root of walking */
+  BOOL one_fs;
+
+  /* Directories entered by walker, NULL if symbolic links */
+  /* aren't followed and cycles are impossible */
+  hashmap_t *visited;
+  unsigned long visited_count;
+} action_walk_guard_t;
+
+/********
+ *
+ */
+
+/* Create map with keys of type action_inode_key_t */
+hashmap_t*
+action_inode_map_create (hashmap_deleter __deleter, __u32_t __length);
+
+/* Initialize guard of recursive walker */
+void
+action_walk_guard_init (action_walk_guard_t *__guard, BOOL __one_fs,
+                        BOOL __follow_symlinks);
+
+/* Free memory used by guard of recursive walker */
+void
+action_walk_guard_free (action_walk_guard_t *__guard);
+
+/* Check if guard needs status of directories */
+BOOL
+action_walk_guard_need_stat (const action_walk_guard_t *__guard);
+
+/* Check if walker could enter directory */
+BOOL
+action_walk_guard_enter (action_walk_guard_t *__guard,
+                         const vfs_stat_t *__stat);
+
+END_HEADER
+
+#endif
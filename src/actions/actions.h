@@ -83,6 +83,12 @@ BEGIN_HEADER
 typedef int (*action_operator_t) (const wchar_t *__name, vfs_stat_t __stat,
                                   void *__user_data, unsigned int __flags);
 
+/* Operator on whole subtree for parallel operating */
+/* It is called from worker threads and must not touch the interface */
+typedef int (*action_tree_operator_t) (const wchar_t *__url,
+                                       vfs_tree_state_t *__state,
+                                       void *__user_data);
+
 typedef struct
 {
   wchar_t *caption;
@@ -153,6 +159,26 @@ action_find (file_panel_t *__panel);
 int
 action_create_file (file_panel_t *__panel);
 
+/* Show window with queue of operations */
+int
+action_queue (file_panel_t *__panel);
+
+/* Move list of files from specified panel to trash */
+int
+action_trash (file_panel_t *__panel);
+
+/* Delete list of files from specified panel in background */
+int
+action_queue_delete (file_panel_t *__panel);
+
+/* Compute sizes of selected directories of specified panel */
+int
+action_du (file_panel_t *__panel);
+
+/* Get computed size of directory */
+BOOL
+action_du_get_cached (const vfs_stat_t *__stat, __u64_t *__size);
+
 /* Chooses file panel for action */
 file_panel_t*
 action_choose_file_panel (const wchar_t *__caption,
@@ -200,6 +226,29 @@ action_operate (const wchar_t *__caption, const wchar_t *__desc,
                 action_operator_t __after_rec_op,
                 void *__user_data);
 
+/* Operate on whole subtrees of items in parallel */
+int
+action_operate_parallel (const wchar_t *__caption, const wchar_t *__desc,
+                         const wchar_t *__base_dir,
+                         const file_panel_item_t **__list,
+                         unsigned long __count,
+                         action_tree_operator_t __operator,
+                         action_operator_t __dir_operator,
+                         void *__user_data, int *__results);
+
+/* Operate on whole subtrees of items in parallel with fallback */
+/* to action_operate() */
+int
+action_operate_trees (const wchar_t *__caption, const wchar_t *__desc,
+                      file_panel_t *__panel, const wchar_t *__base_dir,
+                      file_panel_item_t **__list, unsigned long __count,
+                      BOOL __prescan, BOOL __follow_symlinks,
+                      action_tree_operator_t __tree_operator,
+                      action_operator_t __operation,
+                      action_operator_t __before_rec_op,
+                      action_operator_t __after_rec_op,
+                      void *__user_data);
+
 /* Check are there any selected directories */
 BOOL
 action_is_directory_selected (const file_panel_item_t **__list,
@@ -209,6 +258,26 @@ action_is_directory_selected (const file_panel_item_t **__list,
 void
 action_centre_to_item (file_panel_t *__panel, const wchar_t *__item_name);
 
+/* Set order in which recursive walkers process directory entries */
+void
+action_set_inode_order (BOOL __inode_order);
+
+/* Get order in which recursive walkers process directory entries */
+BOOL
+action_get_inode_order (void);
+
+/* Get comparator for scanning directories by recursive walkers */
+vfs_cmp_proc
+action_walk_compar (void);
+
+/* Set whether recursive walkers stay on one filesystem */
+void
+action_set_one_filesystem (BOOL __one_filesystem);
+
+/* Get whether recursive walkers stay on one filesystem */
+BOOL
+action_get_one_filesystem (void);
+
 END_HEADER
 
 #endif
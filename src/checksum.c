@@ -0,0 +1,473 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Streaming checksums (CRC32C and SHA-256)
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "checksum.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/********
+ * Constants and macro definitions
+ */
+
+/* Reversed Castagnoli polynomial */
+#define CRC32C_POLY 0x82f63b78
+
+#if defined (__GNUC__) && defined (__x86_64__)
+#  define CRC32C_HW
+#endif
+
+#define ROR32(_x, _n) (((_x) >> (_n)) | ((_x) << (32 - (_n))))
+
+#define SHA_CH(_x, _y, _z)  (((_x) & (_y)) ^ (~(_x) & (_z)))
+#define SHA_MAJ(_x, _y, _z) (((_x) & (_y)) ^ ((_x) & (_z)) ^ ((_y) & (_z)))
+#define SHA_EP0(_x) (ROR32 (_x, 2) ^ ROR32 (_x, 13) ^ ROR32 (_x, 22))
+#define SHA_EP1(_x) (ROR32 (_x, 6) ^ ROR32 (_x, 11) ^ ROR32 (_x, 25))
+#define SHA_SIG0(_x) (ROR32 (_x, 7) ^ ROR32 (_x, 18) ^ ((_x) >> 3))
+#define SHA_SIG1(_x) (ROR32 (_x, 17) ^ ROR32 (_x, 19) ^ ((_x) >> 10))
+
+/********
+ * Global variables
+ */
+
+/* Tables for slicing-by-8 CRC32C */
+static uint32_t crc32c_table[8][256];
+
+/* Implementation of CRC32C selected at first use, checksums */
+/* could be initialized by several threads at the same time */
+static uint32_t (*crc32c_proc) (uint32_t, const unsigned char*, size_t) = 0;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static const uint32_t sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/********
+ * CRC32C stuff
+ */
+
+/**
+ * Build tables for slicing-by-8 implementation
+ */
+static void
+crc32c_build_table (void)
+{
+  uint32_t crc;
+  int i, j;
+
+  for (i = 0; i < 256; ++i)
+    {
+      crc = i;
+      for (j = 0; j < 8; ++j)
+        {
+          crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+      crc32c_table[0][i] = crc;
+    }
+
+  for (i = 0; i < 256; ++i)
+    {
+      crc = crc32c_table[0][i];
+      for (j = 1; j < 8; ++j)
+        {
+          crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+          crc32c_table[j][i] = crc;
+        }
+    }
+}
+
+/**
+ * Portable slicing-by-8 implementation of CRC32C
+ *
+ * @param __crc - current value of CRC
+ * @param __buf - buffer to process
+ * @param __len - length of buffer
+ * @return new value of CRC
+ */
+static uint32_t
+crc32c_sw (uint32_t __crc, const unsigned char *__buf, size_t __len)
+{
+  uint32_t lo, hi;
+
+  /* Align pointer to eight bytes */
+  while (__len && ((uintptr_t)__buf & 7))
+    {
+      __crc = crc32c_table[0][(__crc ^ *__buf++) & 0xff] ^ (__crc >> 8);
+      --__len;
+    }
+
+  while (__len >= 8)
+    {
+      memcpy (&lo, __buf, 4);
+      memcpy (&hi, __buf + 4, 4);
+      lo ^= __crc;
+
+      __crc = crc32c_table[7][lo & 0xff] ^
+              crc32c_table[6][(lo >> 8) & 0xff] ^
+              crc32c_table[5][(lo >> 16) & 0xff] ^
+              crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xff] ^
+              crc32c_table[2][(hi >> 8) & 0xff] ^
+              crc32c_table[1][(hi >> 16) & 0xff] ^
+              crc32c_table[0][hi >> 24];
+
+      __buf += 8;
+      __len -= 8;
+    }
+
+  while (__len--)
+    {
+      __crc = crc32c_table[0][(__crc ^ *__buf++) & 0xff] ^ (__crc >> 8);
+    }
+
+  return __crc;
+}
+
+#ifdef CRC32C_HW
+/**
+ * SSE4.2 implementation of CRC32C
+ *
+ * @param __crc - current value of CRC
+ * @param __buf - buffer to process
+ * @param __len - length of buffer
+ * @return new value of CRC
+ */
+__attribute__ ((target ("sse4.2"))) static uint32_t
+crc32c_hw (uint32_t __crc, const unsigned char *__buf, size_t __len)
+{
+  uint64_t crc = __crc, word;
+
+  while (__len && ((uintptr_t)__buf & 7))
+    {
+      crc = __builtin_ia32_crc32qi (crc, *__buf++);
+      --__len;
+    }
+
+  while (__len >= 8)
+    {
+      memcpy (&word, __buf, 8);
+      crc = __builtin_ia32_crc32di (crc, word);
+      __buf += 8;
+      __len -= 8;
+    }
+
+  while (__len--)
+    {
+      crc = __builtin_ia32_crc32qi (crc, *__buf++);
+    }
+
+  return crc;
+}
+#endif
+
+/**
+ * Choose the fastest implementation of CRC32C supported by CPU
+ */
+static void
+crc32c_select (void)
+{
+#ifdef CRC32C_HW
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("sse4.2"))
+    {
+      crc32c_proc = crc32c_hw;
+      return;
+    }
+#endif
+
+  crc32c_build_table ();
+  crc32c_proc = crc32c_sw;
+}
+
+/********
+ * SHA-256 stuff
+ */
+
+/**
+ * Process single 64-byte block of SHA-256
+ *
+ * @param __sum - checksum context
+ * @param __block - block to process
+ */
+static void
+sha256_transform (checksum_t *__sum, const unsigned char *__block)
+{
+  uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+  uint32_t *state = __sum->ctx.sha256.state;
+  int i;
+
+  for (i = 0; i < 16; ++i)
+    {
+      w[i] = ((uint32_t)__block[i * 4] << 24) |
+             ((uint32_t)__block[i * 4 + 1] << 16) |
+             ((uint32_t)__block[i * 4 + 2] << 8) |
+             ((uint32_t)__block[i * 4 + 3]);
+    }
+
+  for (i = 16; i < 64; ++i)
+    {
+      w[i] = SHA_SIG1 (w[i - 2]) + w[i - 7] + SHA_SIG0 (w[i - 15]) + w[i - 16];
+    }
+
+  a = state[0]; b = state[1]; c = state[2]; d = state[3];
+  e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+  for (i = 0; i < 64; ++i)
+    {
+      t1 = h + SHA_EP1 (e) + SHA_CH (e, f, g) + sha256_k[i] + w[i];
+      t2 = SHA_EP0 (a) + SHA_MAJ (a, b, c);
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/**
+ * Feed buffer to SHA-256 context
+ *
+ * @param __sum - checksum context
+ * @param __buf - buffer to process
+ * @param __len - length of buffer
+ */
+static void
+sha256_update (checksum_t *__sum, const unsigned char *__buf, size_t __len)
+{
+  size_t n;
+
+  __sum->ctx.sha256.length += __len;
+
+  /* Fill partially filled block */
+  if (__sum->ctx.sha256.used)
+    {
+      n = 64 - __sum->ctx.sha256.used;
+      n = __len < n ? __len : n;
+
+      memcpy (__sum->ctx.sha256.block + __sum->ctx.sha256.used, __buf, n);
+      __sum->ctx.sha256.used += n;
+      __buf += n;
+      __len -= n;
+
+      if (__sum->ctx.sha256.used < 64)
+        {
+          return;
+        }
+
+      sha256_transform (__sum, __sum->ctx.sha256.block);
+      __sum->ctx.sha256.used = 0;
+    }
+
+  /* Process whole blocks directly from buffer */
+  while (__len >= 64)
+    {
+      sha256_transform (__sum, __buf);
+      __buf += 64;
+      __len -= 64;
+    }
+
+  if (__len)
+    {
+      memcpy (__sum->ctx.sha256.block, __buf, __len);
+      __sum->ctx.sha256.used = __len;
+    }
+}
+
+/**
+ * Finish evaluating of SHA-256
+ *
+ * @param __sum - checksum context
+ */
+static void
+sha256_final (checksum_t *__sum)
+{
+  uint64_t bits = __sum->ctx.sha256.length * 8;
+  unsigned char pad[72];
+  size_t pad_len;
+  int i;
+
+  memset (pad, 0, sizeof (pad));
+  pad[0] = 0x80;
+
+  pad_len = (__sum->ctx.sha256.used < 56 ? 56 : 120) -
+            __sum->ctx.sha256.used;
+
+  for (i = 0; i < 8; ++i)
+    {
+      pad[pad_len + i] = bits >> (56 - i * 8);
+    }
+
+  sha256_update (__sum, pad, pad_len + 8);
+
+  for (i = 0; i < 8; ++i)
+    {
+      __sum->digest[i * 4]     = __sum->ctx.sha256.state[i] >> 24;
+      __sum->digest[i * 4 + 1] = __sum->ctx.sha256.state[i] >> 16;
+      __sum->digest[i * 4 + 2] = __sum->ctx.sha256.state[i] >> 8;
+      __sum->digest[i * 4 + 3] = __sum->ctx.sha256.state[i];
+    }
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Initialize checksum context
+ *
+ * @param __sum - context to initialize
+ * @param __type - algorithm to use (CHECKSUM_CRC32C or CHECKSUM_SHA256)
+ */
+void
+checksum_init (checksum_t *__sum, int __type)
+{
+  static const uint32_t sha256_init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+  memset (__sum, 0, sizeof (checksum_t));
+  __sum->type = __type;
+
+  if (__type == CHECKSUM_SHA256)
+    {
+      memcpy (__sum->ctx.sha256.state, sha256_init, sizeof (sha256_init));
+    }
+  else
+    {
+      pthread_once (&crc32c_once, crc32c_select);
+
+      __sum->ctx.crc = 0xffffffff;
+    }
+}
+
+/**
+ * Feed buffer to checksum
+ *
+ * @param __sum - checksum context
+ * @param __buf - buffer to process
+ * @param __len - length of buffer
+ */
+void
+checksum_update (checksum_t *__sum, const void *__buf, size_t __len)
+{
+  if (__sum->type == CHECKSUM_SHA256)
+    {
+      sha256_update (__sum, __buf, __len);
+    }
+  else
+    {
+      __sum->ctx.crc = crc32c_proc (__sum->ctx.crc, __buf, __len);
+    }
+}
+
+/**
+ * Finish evaluating of checksum
+ * Digest will be stored in field digest of context
+ *
+ * @param __sum - checksum context
+ */
+void
+checksum_final (checksum_t *__sum)
+{
+  if (__sum->type == CHECKSUM_SHA256)
+    {
+      sha256_final (__sum);
+    }
+  else
+    {
+      uint32_t crc = ~__sum->ctx.crc;
+
+      __sum->digest[0] = crc >> 24;
+      __sum->digest[1] = crc >> 16;
+      __sum->digest[2] = crc >> 8;
+      __sum->digest[3] = crc;
+    }
+}
+
+/**
+ * Get length of binary digest
+ *
+ * @param __type - algorithm of checksum
+ * @return length of digest in bytes
+ */
+size_t
+checksum_digest_len (int __type)
+{
+  return __type == CHECKSUM_SHA256 ? 32 : 4;
+}
+
+/**
+ * Get name of algorithm of checksum
+ *
+ * @param __type - algorithm of checksum
+ * @return name of algorithm
+ */
+const char*
+checksum_name (int __type)
+{
+  return __type == CHECKSUM_SHA256 ? "SHA256" : "CRC32C";
+}
+
+/**
+ * Compare digests of two finished checksums
+ *
+ * @param __a - first checksum
+ * @param __b - second checksum
+ * @return zero if digests are equal, non-zero otherwise
+ */
+int
+checksum_compare (const checksum_t *__a, const checksum_t *__b)
+{
+  if (__a->type != __b->type)
+    {
+      return -1;
+    }
+
+  return memcmp (__a->digest, __b->digest, checksum_digest_len (__a->type));
+}
+
+/**
+ * Format finished digest as hexadecimal string
+ *
+ * @param __sum - finished checksum
+ * @param __buf - buffer where string will be stored
+ * @param __buf_size - size of buffer
+ */
+void
+checksum_to_hex (const checksum_t *__sum, char *__buf, size_t __buf_size)
+{
+  size_t i, len = checksum_digest_len (__sum->type);
+
+  if (!__buf_size)
+    {
+      return;
+    }
+
+  for (i = 0; i < len && i * 2 + 2 < __buf_size; ++i)
+    {
+      sprintf (__buf + i * 2, "%02x", __sum->digest[i]);
+    }
+
+  __buf[i * 2] = 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Streaming checksums (CRC32C and SHA-256)
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _checksum_h_
+#define _checksum_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include <stdint.h>
+#include <wchar.h>
+
+/********
+ * Constants
+ */
+
+/* Supported algorithms */
+#define CHECKSUM_CRC32C 0
+#define CHECKSUM_SHA256 1
+
+/* Maximal length of binary digest */
+#define CHECKSUM_MAX_DIGEST_LEN 32
+
+/********
+ * Type definitions
+ */
+
+typedef struct
+{
+  /* Used algorithm */
+  int type;
+
+  union
+  {
+    uint32_t crc;
+
+    struct
+    {
+      uint32_t state[8];
+      uint64_t length;
+      unsigned char block[64];
+      size_t used;
+    } sha256;
+  } ctx;
+
+  /* Final digest (valid after checksum_final()) */
+  unsigned char digest[CHECKSUM_MAX_DIGEST_LEN];
+} checksum_t;
+
+/********
+ *
+ */
+
+/* Initialize checksum context */
+void
+checksum_init (checksum_t *__sum, int __type);
+
+/* Feed buffer to checksum */
+void
+checksum_update (checksum_t *__sum, const void *__buf, size_t __len);
+
+/* Finish evaluating of checksum */
+void
+checksum_final (checksum_t *__sum);
+
+/* Get length of binary digest */
+size_t
+checksum_digest_len (int __type);
+
+/* Get name of algorithm of checksum */
+const char*
+checksum_name (int __type);
+
+/* Compare digests of two finished checksums */
+int
+checksum_compare (const checksum_t *__a, const checksum_t *__b);
+
+/* Format finished digest as hexadecimal string */
+void
+checksum_to_hex (const checksum_t *__sum, char *__buf, size_t __buf_size);
+
+END_HEADER
+
+#endif
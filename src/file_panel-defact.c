@@ -252,6 +252,7 @@ draw_full_row (const file_panel_t *__panel, unsigned long __index,
   file_panel_column_t *column;
   scr_window_t layout;
   file_panel_item_t *item = NULL;
+  __u64_t dir_size;
 
   /* Invalid pointers */
   if (!__panel || !__panel->widget || !__panel->widget->layout)
@@ -296,7 +297,10 @@ draw_full_row (const file_panel_t *__panel, unsigned long __index,
               fit_filename (item->file->name, column->width, pchar);
             break;
           case COLUMN_SIZE:
-            if (S_ISDIR (item->file->stat.st_mode))
+            /* Directories are shown with sizes if they are computed */
+            if (S_ISDIR (item->file->stat.st_mode) &&
+                (!wcscmp (item->file->name, L"..") ||
+                 !action_du_get_cached (&item->file->lstat, &dir_size)))
               {
                 flags = CF_ALIGN_CENTER;
                 if (wcscmp (item->file->name, L".."))
@@ -321,7 +325,9 @@ draw_full_row (const file_panel_t *__panel, unsigned long __index,
 
                 flags = CF_ALIGN_RIGHT;
 
-                size = fsizetohuman (item->file->lstat.st_size, &suffix);
+                size = fsizetohuman (S_ISDIR (item->file->stat.st_mode) ?
+                                       dir_size : item->file->lstat.st_size,
+                                     &suffix);
                 swprintf (pchar, MAX_SCREEN_WIDTH, format, size, suffix);
               }
             break;
@@ -1191,6 +1197,7 @@ fpd_create (file_panel_t *__panel)
       _REGISTER_HOTKEY (L"C-x o",   action_chown);
       _REGISTER_HOTKEY (L"C-x c",   action_chmod);
       _REGISTER_HOTKEY (L"M-?",     action_find);
+      _REGISTER_HOTKEY (L"C-x q",   action_queue);
 
       /* This hotkeys are for debug actions */
       _REGISTER_HOTKEY (L"C-d C-n",     action_create_file);
@@ -204,6 +204,9 @@ fill_menu_items (void)
     DEFINE_MENU_CURRENT_PANEL_ACTION (L"_Rename/move",  action_move);
     DEFINE_MENU_CURRENT_PANEL_ACTION (L"_Mkdir",        action_mkdir);
     DEFINE_MENU_CURRENT_PANEL_ACTION (L"_Delete",       action_delete);
+    DEFINE_MENU_CURRENT_PANEL_ACTION (L"Delete in _background",
+                                      action_queue_delete);
+    DEFINE_MENU_CURRENT_PANEL_ACTION (L"Move to _trash", action_trash);
     DEFINE_MENU_SEPARATOR
     DEFINE_MENU_ITEM (L"_Exit", menu_exit_clicked);
 
@@ -211,6 +214,8 @@ fill_menu_items (void)
     DEFINE_MENU_ENTRY (L"_Command");
 
     DEFINE_MENU_CURRENT_PANEL_ACTION (L"_Find file", action_find);
+    DEFINE_MENU_CURRENT_PANEL_ACTION (L"Operation _queue", action_queue);
+    DEFINE_MENU_CURRENT_PANEL_ACTION (L"Directory _sizes", action_du);
 
     /* Creating of submenu 'Options' */
     DEFINE_MENU_ENTRY (L"_Options");
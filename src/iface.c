@@ -17,6 +17,7 @@
 #include "messages.h"
 #include "i18n.h"
 #include "shared.h"
+#include "action-trash.h"
 
 #include <signal.h>
 
@@ -234,6 +235,9 @@ iface_init (void)
 
   file_panels_init (WIDGET (w_box_item (main_box, 1)));
 
+  /* Items left in trash by previous sessions are purged in background */
+  action_trash_purge_leftovers ();
+
   /* Create menu */
   _INIT_ITERATOR (iface_create_menu);
 
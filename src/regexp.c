@@ -30,8 +30,17 @@
 #ifdef USE_PCRE
 /* It's quite too dangerous */
 #  define REGEXP_REPLACE_GLOBAL 0x10000000
+
+/* Explicit JIT stacks could be passed to matching since 8.32 */
+#  if PCRE_MAJOR > 8 || (PCRE_MAJOR == 8 && PCRE_MINOR >= 32)
+#    define REGEXP_USE_JIT
+#  endif
 #endif
 
+/* Sizes of stacks of JIT-compiled matchers */
+#define REGEXP_JIT_STACK_START 32768
+#define REGEXP_JIT_STACK_MAX   1048576
+
 /********
  * Type definitions
  */
@@ -40,6 +49,26 @@ struct regexp
 {
   void *handle;
   int modifiers;
+
+  /* Result of studying of compiled pattern */
+  void *extra;
+
+  /* Pattern has been compiled to machine code */
+  BOOL jit;
+
+  /* Size of output vectors which hold whole match and all */
+  /* sub-patterns (the last third is used by PCRE as workspace) */
+  int ovector_size;
+};
+
+struct regexp_matcher
+{
+  const regexp_t *re;
+
+  /* Stack used by JIT-compiled code */
+  void *jit_stack;
+
+  int *ovector;
 };
 
 typedef struct
@@ -315,6 +344,46 @@ parse_regexp (const char *__s, char **__regexp, int *__modifiers)
   return 0;
 }
 
+/**
+ * Execute compiled regular expression
+ *
+ * @param __re - descriptor of regular expression
+ * @param __buf - buffer to search occurrence in
+ * @param __len - length of buffer
+ * @param __ovector - pointer to buffer, where occurrences will be stored
+ * @param __ovector_size - maximal size of output vector
+ * @param __jit_stack - stack for JIT-compiled code,
+ * NULL to use the default one
+ * @return count of occurrences, or zero if vector is too small to hold
+ * all of them, or negative value if there is no match
+ */
+static int
+regexp_exec (const regexp_t *__re, const char *__buf, size_t __len,
+             int *__ovector, int __ovector_size, void *__jit_stack)
+{
+  int result = -1;
+
+  if (!__re || !__buf || !__ovector)
+    {
+      return -1;
+    }
+
+#ifdef USE_PCRE
+#  ifdef REGEXP_USE_JIT
+  if (__re->jit && __jit_stack)
+    {
+      return pcre_jit_exec (__re->handle, __re->extra, __buf, __len, 0, 0,
+                            __ovector, __ovector_size, __jit_stack);
+    }
+#  endif
+
+  result = pcre_exec (__re->handle, __re->extra, __buf, __len, 0, 0,
+                      __ovector, __ovector_size);
+#endif
+
+  return result;
+}
+
 /**
  * Get vector of occurrences
  *
@@ -328,17 +397,21 @@ static int
 regexp_get_vector (const regexp_t *__re, const char *__str,
                    int *__ovector, int __ovector_size)
 {
-  int result = 0;
+  int result;
 
-  if (!__re || !__str || !__ovector)
+  if (!__str)
     {
       return 0;
     }
 
-#ifdef USE_PCRE
-  result = pcre_exec (__re->handle, NULL, __str, strlen (__str), 0, 0,
-                      __ovector, __ovector_size);
-#endif
+  result = regexp_exec (__re, __str, strlen (__str),
+                        __ovector, __ovector_size, NULL);
+
+  if (result == 0)
+    {
+      /* Vector is full, only the first sub-patterns are stored */
+      result = __ovector_size / 3;
+    }
 
   return result;
 }
@@ -367,17 +440,23 @@ regexp_replace_iterator (const regexp_t *__re,
 
   size_t len, cur_size = 0;
 
-  int ovector_size = (strlen (__s) + 1) * 2;
-  int *ovector = malloc (sizeof (int) * ovector_size);
+  int *ovector;
   int flags, errno;
 
   (*__l) = (*__r) = 0;
 
+  if (!__re)
+    {
+      return NULL;
+    }
+
   /* Get the vector of matches */
-  vector_count = regexp_get_vector (__re, __s, ovector, ovector_size);
+  ovector = malloc (__re->ovector_size * sizeof (int));
+  vector_count = regexp_get_vector (__re, __s, ovector, __re->ovector_size);
   if (vector_count <= 0)
     {
       /* No matched sub-strings */
+      free (ovector);
       return NULL;
     }
 
@@ -474,6 +553,9 @@ regexp_compile (const char *__regexp)
     {
       void *re;
 
+      void *extra = NULL;
+      int jit = 0, count = 0;
+
 #ifdef USE_PCRE
       const char *err;
       int pos;
@@ -482,6 +564,23 @@ regexp_compile (const char *__regexp)
       int pcre_options = modifiers & ~REGEXP_REPLACE_GLOBAL;
 
       re = pcre_compile (parsed_regexp, pcre_options, &err, &pos, NULL);
+
+      /* Patterns are usually applied to lots of strings, */
+      /* so it's worth to spend some time for studying them */
+      if (re)
+        {
+#  ifdef REGEXP_USE_JIT
+          extra = pcre_study (re, PCRE_STUDY_JIT_COMPILE, &err);
+          if (extra)
+            {
+              pcre_fullinfo (re, extra, PCRE_INFO_JIT, &jit);
+            }
+#  else
+          extra = pcre_study (re, 0, &err);
+#  endif
+
+          pcre_fullinfo (re, extra, PCRE_INFO_CAPTURECOUNT, &count);
+        }
 #else
 #  error Regular expression engine to use is not defined
 #endif
@@ -497,6 +596,9 @@ regexp_compile (const char *__regexp)
       MALLOC_ZERO (result, sizeof (struct regexp));
       result->handle = re;
       result->modifiers = modifiers;
+      result->extra = extra;
+      result->jit = jit;
+      result->ovector_size = (count + 1) * 3;
     }
 
   free (parsed_regexp);
@@ -517,6 +619,15 @@ regexp_free (regexp_t *__regexp)
       return;
     }
 
+  if (__regexp->extra)
+    {
+#ifdef REGEXP_USE_JIT
+      pcre_free_study (__regexp->extra);
+#else
+      free (__regexp->extra);
+#endif
+    }
+
   free (__regexp->handle);
   free (__regexp);
 }
@@ -531,22 +642,128 @@ regexp_free (regexp_t *__regexp)
 BOOL
 regexp_match (const regexp_t *__re, const char *__str)
 {
-  /* Assume maximal count of elements in vector to each element of string */
-  /* and the whole string. */
-  /* Multiplying by 2 is needed because vector will store beginning */
-  /* and ending of occurrence */
-  int ovector_size = (strlen (__str) + 1) * 2;
+  int *ovector, res;
 
-  int *ovector = malloc (sizeof (int) * ovector_size);
-  int res;
-
-  res = regexp_get_vector (__re, __str, ovector, ovector_size);
+  if (!__re)
+    {
+      return FALSE;
+    }
 
+  ovector = malloc (__re->ovector_size * sizeof (int));
+  res = regexp_get_vector (__re, __str, ovector, __re->ovector_size);
   free (ovector);
 
   return res > 0;
 }
 
+/**
+ * Create matcher for compiled regular expression
+ *
+ * Matcher owns vector of occurrences and stack for JIT-compiled code,
+ * so it could be used for lots of buffers without allocating memory.
+ * Each thread should use its own matcher.
+ *
+ * @param __re - compiled regular expression
+ * @return created matcher
+ * @sideeffect allocate memory for return value.
+ * Use regexp_matcher_free() to free.
+ */
+regexp_matcher_t*
+regexp_matcher_create (const regexp_t *__re)
+{
+  regexp_matcher_t *result;
+
+  if (!__re)
+    {
+      return NULL;
+    }
+
+  MALLOC_ZERO (result, sizeof (regexp_matcher_t));
+  result->re = __re;
+  result->ovector = malloc (__re->ovector_size * sizeof (int));
+
+#ifdef REGEXP_USE_JIT
+  if (__re->jit)
+    {
+      result->jit_stack = pcre_jit_stack_alloc (REGEXP_JIT_STACK_START,
+                                                REGEXP_JIT_STACK_MAX);
+    }
+#endif
+
+  return result;
+}
+
+/**
+ * Free matcher of regular expression
+ *
+ * @param __matcher - matcher to free
+ */
+void
+regexp_matcher_free (regexp_matcher_t *__matcher)
+{
+  if (!__matcher)
+    {
+      return;
+    }
+
+#ifdef REGEXP_USE_JIT
+  if (__matcher->jit_stack)
+    {
+      pcre_jit_stack_free (__matcher->jit_stack);
+    }
+#endif
+
+  free (__matcher->ovector);
+  free (__matcher);
+}
+
+/**
+ * Find the first occurrence of regular expression anywhere in buffer
+ *
+ * Buffer could contain zero characters.
+ *
+ * @param __matcher - matcher of regular expression
+ * @param __buf - buffer to search occurrence in
+ * @param __len - length of buffer
+ * @param __start - pointer to variable where offset of the beginning
+ * of occurrence will be stored (could be NULL)
+ * @param __end - pointer to variable where offset of the ending
+ * of occurrence will be stored (could be NULL)
+ * @return non-zero if occurrence has been found, zero otherwise
+ */
+BOOL
+regexp_matcher_exec (regexp_matcher_t *__matcher,
+                     const char *__buf, size_t __len,
+                     size_t *__start, size_t *__end)
+{
+  int res;
+
+  if (!__matcher)
+    {
+      return FALSE;
+    }
+
+  res = regexp_exec (__matcher->re, __buf, __len, __matcher->ovector,
+                     __matcher->re->ovector_size, __matcher->jit_stack);
+
+  if (res < 0)
+    {
+      return FALSE;
+    }
+
+  if (__start)
+    {
+      *__start = __matcher->ovector[0];
+    }
+
+  if (__end)
+    {
+      *__end = __matcher->ovector[1];
+    }
+
+  return TRUE;
+}
+
 /**
  * Make sub-string replacing by regular compiled expression matching
  *
@@ -756,6 +973,31 @@ wregexp_match (const regexp_t *__re, const wchar_t *__str)
   return FALSE;
 }
 
+/**
+ * Check is string matches to regular expression using matcher
+ *
+ * @param __matcher - matcher of regular expression
+ * @param __str - string to check
+ * @return non-zero if string matches to regular expression, zero otherwise
+ */
+BOOL
+wregexp_matcher_match (regexp_matcher_t *__matcher, const wchar_t *__str)
+{
+  BOOL result;
+  char *mb_str;
+
+  wcs2mbs (&mb_str, __str);
+  if (mb_str != NULL)
+    {
+      result = regexp_matcher_exec (__matcher, mb_str, strlen (mb_str),
+                                    NULL, NULL);
+      free (mb_str);
+      return result;
+    }
+
+  return FALSE;
+}
+
 /**
  * Check is string matches to regular expression
  *
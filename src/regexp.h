@@ -24,6 +24,9 @@ BEGIN_HEADER
 struct regexp;
 typedef struct regexp regexp_t;
 
+struct regexp_matcher;
+typedef struct regexp_matcher regexp_matcher_t;
+
 /********
  *
  */
@@ -40,6 +43,20 @@ regexp_free (regexp_t *__regexp);
 BOOL
 regexp_match (const regexp_t *__re, const char *__str);
 
+/* Create matcher for compiled regular expression */
+regexp_matcher_t*
+regexp_matcher_create (const regexp_t *__re);
+
+/* Free matcher of regular expression */
+void
+regexp_matcher_free (regexp_matcher_t *__matcher);
+
+/* Find the first occurrence of regular expression anywhere in buffer */
+BOOL
+regexp_matcher_exec (regexp_matcher_t *__matcher,
+                     const char *__buf, size_t __len,
+                     size_t *__start, size_t *__end);
+
 /* Make sub-string replacing by compiled regular expression matching */
 char*
 regexp_replace (const regexp_t *__re, const char *__s, const char *__mask);
@@ -64,6 +81,10 @@ wregexp_compile (const wchar_t *__regexp);
 BOOL
 wregexp_match (const regexp_t *__re, const wchar_t *__str);
 
+/* Check is string matches to regular expression using matcher */
+BOOL
+wregexp_matcher_match (regexp_matcher_t *__matcher, const wchar_t *__str);
+
 /* Check is string matches to regular expression */
 BOOL
 wpreg_match (const wchar_t *__regexp, const wchar_t *__str);
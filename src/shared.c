@@ -414,3 +414,19 @@ get_shared_files (const wchar_t *__relative_name,
 
   return count;
 }
+
+/**
+ * Get directory with user's configuration and data
+ *
+ * @return directory with user's data or NULL if it can't be determined
+ * @sideeffect allocate memory for return value
+ */
+wchar_t*
+get_user_directory (void)
+{
+#ifndef NOINST_DEBUG
+  return get_home_directory ();
+#else
+  return wcsdup (FAKE_HOME);
+#endif
+}
@@ -29,6 +29,10 @@ int
 get_shared_files (const wchar_t *__relative_name,
                   const wchar_t *__home_replacer, wchar_t ***__list);
 
+/* Get directory with user's configuration and data */
+wchar_t*
+get_user_directory (void);
+
 END_HEADER
 
 #endif
@@ -0,0 +1,351 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Searching of substrings in binary buffers
+ *
+ * Candidates are found by comparing the first and the last characters
+ * of pattern with whole vectors of buffer, so most of buffer is skipped
+ * without any branching. Boyer-Moore-Horspool algorithm is used for
+ * tails of buffers and on CPUs without vector extensions.
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "strsearch.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/********
+ * Constants and macro definitions
+ */
+
+#if defined (__GNUC__) && defined (__x86_64__)
+#  define STRSEARCH_SIMD
+#  include <immintrin.h>
+#endif
+
+/********
+ * Global variables
+ */
+
+/* Implementation selected at first use */
+static const char* (*find_proc) (const strsearch_t*, const char*,
+                                 size_t) = 0;
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Check if pattern is located at specified position
+ *
+ * @param __self - compiled pattern
+ * @param __pos - position in buffer
+ * @return non-zero if pattern is located at position, zero otherwise
+ */
+static inline int
+match_at (const strsearch_t *__self, const unsigned char *__pos)
+{
+  size_t i;
+
+  for (i = 0; i < __self->len; ++i)
+    {
+      if (__self->fold[__pos[i]] != __self->pattern[i])
+        {
+          return 0;
+        }
+    }
+
+  return 1;
+}
+
+/**
+ * Boyer-Moore-Horspool implementation of searching
+ *
+ * @param __self - compiled pattern
+ * @param __buf - buffer to search in
+ * @param __len - length of buffer
+ * @return pointer to first occurrence or NULL if there is no occurrence
+ */
+static const char*
+find_bmh (const strsearch_t *__self, const char *__buf, size_t __len)
+{
+  const unsigned char *buf = (const unsigned char*)__buf;
+  size_t i, last = __self->len - 1;
+
+  for (i = 0; i + __self->len <= __len; i += __self->shift[buf[i + last]])
+    {
+      if (__self->fold[buf[i + last]] == __self->pattern[last] &&
+          match_at (__self, buf + i))
+        {
+          return __buf + i;
+        }
+    }
+
+  return NULL;
+}
+
+#ifdef STRSEARCH_SIMD
+/**
+ * SSE2 implementation of searching
+ *
+ * @param __self - compiled pattern
+ * @param __buf - buffer to search in
+ * @param __len - length of buffer
+ * @return pointer to first occurrence or NULL if there is no occurrence
+ */
+static const char*
+find_sse2 (const strsearch_t *__self, const char *__buf, size_t __len)
+{
+  const unsigned char *buf = (const unsigned char*)__buf;
+  size_t i = 0, last = __self->len - 1;
+  __m128i f0, f1, l0, l1, a, b;
+  unsigned int mask;
+
+  f0 = _mm_set1_epi8 (__self->first[0]);
+  f1 = _mm_set1_epi8 (__self->first[1]);
+  l0 = _mm_set1_epi8 (__self->last[0]);
+  l1 = _mm_set1_epi8 (__self->last[1]);
+
+  for (; i + last + 16 <= __len; i += 16)
+    {
+      a = _mm_loadu_si128 ((const __m128i*)(buf + i));
+      b = _mm_loadu_si128 ((const __m128i*)(buf + i + last));
+
+      a = _mm_or_si128 (_mm_cmpeq_epi8 (a, f0), _mm_cmpeq_epi8 (a, f1));
+      b = _mm_or_si128 (_mm_cmpeq_epi8 (b, l0), _mm_cmpeq_epi8 (b, l1));
+
+      mask = _mm_movemask_epi8 (_mm_and_si128 (a, b));
+
+      while (mask)
+        {
+          if (match_at (__self, buf + i + __builtin_ctz (mask)))
+            {
+              return __buf + i + __builtin_ctz (mask);
+            }
+          mask &= mask - 1;
+        }
+    }
+
+  return find_bmh (__self, __buf + i, __len - i);
+}
+
+/**
+ * AVX2 implementation of searching
+ *
+ * @param __self - compiled pattern
+ * @param __buf - buffer to search in
+ * @param __len - length of buffer
+ * @return pointer to first occurrence or NULL if there is no occurrence
+ */
+__attribute__ ((target ("avx2"))) static const char*
+find_avx2 (const strsearch_t *__self, const char *__buf, size_t __len)
+{
+  const unsigned char *buf = (const unsigned char*)__buf;
+  size_t i = 0, last = __self->len - 1;
+  __m256i f0, f1, l0, l1, a, b;
+  unsigned int mask;
+
+  f0 = _mm256_set1_epi8 (__self->first[0]);
+  f1 = _mm256_set1_epi8 (__self->first[1]);
+  l0 = _mm256_set1_epi8 (__self->last[0]);
+  l1 = _mm256_set1_epi8 (__self->last[1]);
+
+  for (; i + last + 32 <= __len; i += 32)
+    {
+      a = _mm256_loadu_si256 ((const __m256i*)(buf + i));
+      b = _mm256_loadu_si256 ((const __m256i*)(buf + i + last));
+
+      a = _mm256_or_si256 (_mm256_cmpeq_epi8 (a, f0),
+                           _mm256_cmpeq_epi8 (a, f1));
+      b = _mm256_or_si256 (_mm256_cmpeq_epi8 (b, l0),
+                           _mm256_cmpeq_epi8 (b, l1));
+
+      mask = _mm256_movemask_epi8 (_mm256_and_si256 (a, b));
+
+      while (mask)
+        {
+          if (match_at (__self, buf + i + __builtin_ctz (mask)))
+            {
+              return __buf + i + __builtin_ctz (mask);
+            }
+          mask &= mask - 1;
+        }
+    }
+
+  /* Rest of buffer is shorter than two vectors */
+  return find_sse2 (__self, __buf + i, __len - i);
+}
+#endif
+
+/**
+ * Choose the fastest implementation of searching supported by CPU
+ */
+static void
+find_select (void)
+{
+#ifdef STRSEARCH_SIMD
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      find_proc = find_avx2;
+      return;
+    }
+
+  /* SSE2 is a part of x86-64 */
+  find_proc = find_sse2;
+#else
+  find_proc = find_bmh;
+#endif
+}
+
+/**
+ * Get characters which are folded to specified one
+ *
+ * @param __self - compiled pattern
+ * @param __ch - folded character
+ * @param __res - array where two characters will be stored
+ * @return non-zero if there are at most two such characters,
+ * zero otherwise
+ */
+static int
+get_preimage (const strsearch_t *__self, unsigned char __ch,
+              unsigned char *__res)
+{
+  int i, count = 0;
+
+  for (i = 0; i < 256; ++i)
+    {
+      if (__self->fold[i] == __ch)
+        {
+          if (count == 2)
+            {
+              return 0;
+            }
+          __res[count++] = i;
+        }
+    }
+
+  if (count == 1)
+    {
+      __res[1] = __res[0];
+    }
+
+  return count > 0;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Compile pattern for searching
+ *
+ * @param __pattern - pattern to search
+ * @param __len - length of pattern
+ * @param __case_insens - search case-insensitively
+ * @return compiled pattern. Use strsearch_free() to free it.
+ */
+strsearch_t*
+strsearch_compile (const char *__pattern, size_t __len, int __case_insens)
+{
+  strsearch_t *res;
+  size_t i;
+  int j;
+
+  if (!find_proc)
+    {
+      find_select ();
+    }
+
+  res = calloc (1, sizeof (strsearch_t));
+
+  for (j = 0; j < 256; ++j)
+    {
+      res->fold[j] = __case_insens ? tolower (j) : j;
+    }
+
+  res->len = __len;
+  res->pattern = malloc (__len + 1);
+
+  for (i = 0; i < __len; ++i)
+    {
+      res->pattern[i] = res->fold[(unsigned char)__pattern[i]];
+    }
+  res->pattern[__len] = 0;
+
+  if (!__len)
+    {
+      return res;
+    }
+
+  /* Shift by the last character of window is the distance from */
+  /* its last occurrence in pattern (except the last position) */
+  for (j = 0; j < 256; ++j)
+    {
+      res->shift[j] = __len;
+    }
+
+  for (i = 0; i + 1 < __len; ++i)
+    {
+      for (j = 0; j < 256; ++j)
+        {
+          if (res->fold[j] == res->pattern[i])
+            {
+              res->shift[j] = __len - 1 - i;
+            }
+        }
+    }
+
+  res->filter = get_preimage (res, res->pattern[0], res->first) &&
+                get_preimage (res, res->pattern[__len - 1], res->last);
+
+  return res;
+}
+
+/**
+ * Free compiled pattern
+ *
+ * @param __self - pattern to free
+ */
+void
+strsearch_free (strsearch_t *__self)
+{
+  if (!__self)
+    {
+      return;
+    }
+
+  free (__self->pattern);
+  free (__self);
+}
+
+/**
+ * Find first occurrence of pattern in buffer
+ *
+ * @param __self - compiled pattern
+ * @param __buf - buffer to search in
+ * @param __len - length of buffer
+ * @return pointer to first occurrence or NULL if there is no occurrence
+ */
+const char*
+strsearch_find (const strsearch_t *__self, const char *__buf, size_t __len)
+{
+  if (!__self->len)
+    {
+      return __buf;
+    }
+
+  if (!__self->filter)
+    {
+      return find_bmh (__self, __buf, __len);
+    }
+
+  return find_proc (__self, __buf, __len);
+}
@@ -0,0 +1,63 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Searching of substrings in binary buffers
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _strsearch_h_
+#define _strsearch_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include <stddef.h>
+
+/********
+ * Type definitions
+ */
+
+typedef struct
+{
+  /* Pattern in folded case */
+  unsigned char *pattern;
+  size_t len;
+
+  /* Map of characters to the case in which they are compared */
+  unsigned char fold[256];
+
+  /* Characters which are folded to the first and the last characters */
+  /* of pattern. Used by vectorized filters, zero if there are more */
+  /* than two such characters. */
+  unsigned char first[2], last[2];
+  int filter;
+
+  /* Shifts of Boyer-Moore-Horspool algorithm */
+  size_t shift[256];
+} strsearch_t;
+
+/********
+ *
+ */
+
+/* Compile pattern for searching */
+strsearch_t*
+strsearch_compile (const char *__pattern, size_t __len, int __case_insens);
+
+/* Free compiled pattern */
+void
+strsearch_free (strsearch_t *__self);
+
+/* Find first occurrence of pattern in buffer */
+const char*
+strsearch_find (const strsearch_t *__self, const char *__buf, size_t __len);
+
+END_HEADER
+
+#endif
@@ -2,6 +2,10 @@
 
 #include <file_panel.h>
 #include <actions/actions.h>
+#include <actions/action-copymove.h>
+#include <actions/action-find.h>
+#include <actions/action-index.h>
+#include <util.h>
 
 #include "commands_list.h"
 
@@ -91,7 +95,123 @@ TCL_DEFUN(_tcl_actions_chmod_cmd)
  */
 TCL_DEFUN(_tcl_actions_find_cmd)
 {
-  action_find (file_panel_get_current_panel());
+  action_find_filter_t filter;
+  wchar_t **value;
+  __s64_t min, max;
+  long uid;
+  int i = 0, cindex, skip_binary, res = TCL_OK;
+
+  static const char *options[] = {
+    "-size",
+    "-mtime",
+    "-ctime",
+    "-owner",
+    "-skip_binary",
+    NULL
+  };
+
+  memset (&filter, 0, sizeof (filter));
+
+  while (++i < objc)
+    {
+      /* Detecting command options */
+      if (Tcl_GetIndexFromObj (interp, objv[i],
+                               options, "option", 0, &cindex) != TCL_OK)
+        {
+          res = TCL_ERROR;
+          break;
+        }
+
+      if (++i >= objc)
+        {
+          Tcl_WrongNumArgs (interp, 1, objv, "?option value ...?");
+          res = TCL_ERROR;
+          break;
+        }
+
+      /* Proccesing options value */
+      if (cindex == 4) /* -skip_binary */
+        {
+          if (Tcl_GetBooleanFromObj (interp, objv[i],
+                                     &skip_binary) != TCL_OK)
+            {
+              res = TCL_ERROR;
+              break;
+            }
+
+          filter.skip_binary = skip_binary;
+          continue;
+        }
+
+      value = cindex == 0 ? &filter.size :
+              cindex == 1 ? &filter.mtime :
+              cindex == 2 ? &filter.ctime : &filter.owner;
+
+      SAFE_FREE (*value);
+      mbs2wcs (value, Tcl_GetString (objv[i]));
+
+      if ((cindex == 0 && !action_find_parse_size (*value, &min, &max)) ||
+          ((cindex == 1 || cindex == 2) &&
+           !action_find_parse_age (*value, &min, &max)) ||
+          (cindex == 3 && !action_find_parse_owner (*value, &uid)))
+        {
+          Tcl_AppendResult (interp, "invalid value of ", options[cindex],
+                            ": \"", Tcl_GetString (objv[i]), "\"", NULL);
+          res = TCL_ERROR;
+          break;
+        }
+    }
+
+  if (res == TCL_OK)
+    {
+      action_find_filtered (file_panel_get_current_panel(), &filter);
+    }
+
+  SAFE_FREE (filter.size);
+  SAFE_FREE (filter.mtime);
+  SAFE_FREE (filter.ctime);
+  SAFE_FREE (filter.owner);
+
+  return res;
+}
+
+/**
+ * This function implements the "queue" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_actions_queue_cmd)
+{
+  action_queue (file_panel_get_current_panel());
+  return TCL_OK;
+}
+
+/**
+ * This function implements the "queue_delete" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_actions_queue_delete_cmd)
+{
+  action_queue_delete (file_panel_get_current_panel());
+  return TCL_OK;
+}
+
+/**
+ * This function implements the "trash" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_actions_trash_cmd)
+{
+  action_trash (file_panel_get_current_panel());
+  return TCL_OK;
+}
+
+/**
+ * This function implements the "du" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_actions_du_cmd)
+{
+  action_du (file_panel_get_current_panel());
   return TCL_OK;
 }
 
@@ -105,6 +225,218 @@ TCL_DEFUN(_tcl_actions_create_file_cmd)
   return TCL_OK;
 }
 
+/**
+ * This function implements the "throttle" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_config_throttle_cmd)
+{
+  action_copy_throttle_t *throttle = action_copy_get_throttle ();
+  Tcl_Obj *result;
+  Tcl_WideInt rate;
+  int i = 0, cindex, idle;
+
+  static const char *options[] = {
+    "-bytes",
+    "-files",
+    "-idle",
+    NULL
+  };
+
+  while (++i < objc)
+    {
+      /* Detecting command options */
+      if (Tcl_GetIndexFromObj (interp, objv[i],
+                               options, "option", 0, &cindex) != TCL_OK)
+        {
+          return TCL_ERROR;
+        }
+
+      if (++i >= objc)
+        {
+          Tcl_WrongNumArgs (interp, 1, objv, "?option value ...?");
+          return TCL_ERROR;
+        }
+
+      /* Proccesing options value */
+      switch (cindex) {
+        case 0: /* -bytes */
+        case 1: /* -files */
+          if (Tcl_GetWideIntFromObj (interp, objv[i], &rate) != TCL_OK)
+            {
+              return TCL_ERROR;
+            }
+
+          if (rate < 0)
+            {
+              rate = 0;
+            }
+
+          if (cindex == 0)
+            {
+              throttle->bytes_rate = rate;
+            }
+          else
+            {
+              throttle->files_rate = rate;
+            }
+          break;
+        case 2: /* -idle */
+          if (Tcl_GetBooleanFromObj (interp, objv[i], &idle) != TCL_OK)
+            {
+              return TCL_ERROR;
+            }
+
+          throttle->idle_priority = idle;
+          break;
+      }
+    }
+
+  /* Return current settings */
+  result = Tcl_NewListObj (0, NULL);
+  Tcl_ListObjAppendElement (interp, result, Tcl_NewStringObj ("-bytes", -1));
+  Tcl_ListObjAppendElement (interp, result,
+                            Tcl_NewWideIntObj (throttle->bytes_rate));
+  Tcl_ListObjAppendElement (interp, result, Tcl_NewStringObj ("-files", -1));
+  Tcl_ListObjAppendElement (interp, result,
+                            Tcl_NewWideIntObj (throttle->files_rate));
+  Tcl_ListObjAppendElement (interp, result, Tcl_NewStringObj ("-idle", -1));
+  Tcl_ListObjAppendElement (interp, result,
+                            Tcl_NewBooleanObj (throttle->idle_priority));
+  Tcl_SetObjResult (interp, result);
+
+  return TCL_OK;
+}
+
+/**
+ * This function implements the "inode_order" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_config_inode_order_cmd)
+{
+  int inode_order;
+
+  if (objc > 2)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "?boolean?");
+      return TCL_ERROR;
+    }
+
+  if (objc == 2)
+    {
+      if (Tcl_GetBooleanFromObj (interp, objv[1], &inode_order) != TCL_OK)
+        {
+          return TCL_ERROR;
+        }
+
+      action_set_inode_order (inode_order);
+    }
+
+  /* Return current setting */
+  Tcl_SetObjResult (interp, Tcl_NewBooleanObj (action_get_inode_order ()));
+
+  return TCL_OK;
+}
+
+/**
+ * This function implements the "one_filesystem" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_config_one_filesystem_cmd)
+{
+  int one_filesystem;
+
+  if (objc > 2)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "?boolean?");
+      return TCL_ERROR;
+    }
+
+  if (objc == 2)
+    {
+      if (Tcl_GetBooleanFromObj (interp, objv[1],
+                                 &one_filesystem) != TCL_OK)
+        {
+          return TCL_ERROR;
+        }
+
+      action_set_one_filesystem (one_filesystem);
+    }
+
+  /* Return current setting */
+  Tcl_SetObjResult (interp,
+                    Tcl_NewBooleanObj (action_get_one_filesystem ()));
+
+  return TCL_OK;
+}
+
+/**
+ * This function implements the "find_index" Tcl command
+ * See the ${project-name} user documentation for details on what it does
+ */
+TCL_DEFUN(_tcl_config_find_index_cmd)
+{
+  Tcl_Obj **elements, *result;
+  wchar_t **roots;
+  char *root;
+  int i, count;
+
+  if (objc > 2)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "?directories?");
+      return TCL_ERROR;
+    }
+
+  if (objc == 2)
+    {
+      if (Tcl_ListObjGetElements (interp, objv[1], &count,
+                                  &elements) != TCL_OK)
+        {
+          return TCL_ERROR;
+        }
+
+      for (i = 0; i < count; ++i)
+        {
+          if (Tcl_GetString (elements[i])[0] != '/')
+            {
+              Tcl_AppendResult (interp, "directory should be absolute: ",
+                                Tcl_GetString (elements[i]), NULL);
+              return TCL_ERROR;
+            }
+        }
+
+      roots = malloc (MAX (count, 1) * sizeof (wchar_t*));
+      for (i = 0; i < count; ++i)
+        {
+          mbs2wcs (&roots[i], Tcl_GetString (elements[i]));
+        }
+
+      action_index_set_roots ((const wchar_t**)roots, count);
+
+      for (i = 0; i < count; ++i)
+        {
+          free (roots[i]);
+        }
+      free (roots);
+    }
+
+  /* Return current setting */
+  count = action_index_get_roots (&roots);
+  result = Tcl_NewListObj (0, NULL);
+
+  for (i = 0; i < count; ++i)
+    {
+      wcs2mbs (&root, roots[i]);
+      Tcl_ListObjAppendElement (interp, result, Tcl_NewStringObj (root, -1));
+      free (root);
+    }
+
+  free_explode_array (roots);
+  Tcl_SetObjResult (interp, result);
+
+  return TCL_OK;
+}
+
 /**
  * Initialize Tcl commands for actions
  *
@@ -128,6 +460,14 @@ _tcl_actions_init_commands (Tcl_Interp *__interp)
     TCL_DEFSYM("::actions::chmod", _tcl_actions_chmod_cmd),
     TCL_DEFSYM("::actions::find", _tcl_actions_find_cmd),
     TCL_DEFSYM("::actions::create_file", _tcl_actions_create_file_cmd),
+    TCL_DEFSYM("::actions::queue", _tcl_actions_queue_cmd),
+    TCL_DEFSYM("::actions::queue_delete", _tcl_actions_queue_delete_cmd),
+    TCL_DEFSYM("::actions::trash", _tcl_actions_trash_cmd),
+    TCL_DEFSYM("::actions::du", _tcl_actions_du_cmd),
+    TCL_DEFSYM("::config::throttle", _tcl_config_throttle_cmd),
+    TCL_DEFSYM("::config::inode_order", _tcl_config_inode_order_cmd),
+    TCL_DEFSYM("::config::one_filesystem", _tcl_config_one_filesystem_cmd),
+    TCL_DEFSYM("::config::find_index", _tcl_config_find_index_cmd),
   TCL_DEFSYM_END
 
   TCL_DEFCREATE(__interp);
@@ -0,0 +1,189 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Token bucket rate limiter and I/O priority helpers
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "throttle.h"
+#include "util.h"
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/********
+ * Constants
+ */
+
+/* Values from linux/ioprio.h */
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_WHO_PROCESS 1
+
+/* Capacity of bucket in seconds of rate */
+#define THROTTLE_BURST 1.0
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Add tokens accumulated since last refill
+ *
+ * @param __throttle - token bucket to refill
+ */
+static void
+refill (throttle_t *__throttle)
+{
+  timeval_t cur = now (), dist;
+  double elapsed, capacity;
+
+  dist = timedist (__throttle->timestamp, cur);
+  elapsed = dist.tv_sec + dist.tv_usec / 1000000.0;
+
+  capacity = __throttle->rate * THROTTLE_BURST;
+
+  __throttle->tokens += elapsed * __throttle->rate;
+  if (__throttle->tokens > capacity)
+    {
+      __throttle->tokens = capacity;
+    }
+
+  __throttle->timestamp = cur;
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Initialize token bucket
+ *
+ * @param __throttle - token bucket to initialize
+ * @param __rate - count of tokens per second (zero means no limit)
+ */
+void
+throttle_init (throttle_t *__throttle, __u64_t __rate)
+{
+  __throttle->rate = __rate;
+  __throttle->tokens = __rate * THROTTLE_BURST;
+  __throttle->timestamp = now ();
+}
+
+/**
+ * Change rate of token bucket
+ *
+ * @param __throttle - token bucket
+ * @param __rate - new count of tokens per second (zero means no limit)
+ */
+void
+throttle_set_rate (throttle_t *__throttle, __u64_t __rate)
+{
+  if (__throttle->rate == __rate)
+    {
+      return;
+    }
+
+  /* Debt made with previous rate is forgiven */
+  throttle_init (__throttle, __rate);
+}
+
+/**
+ * Take tokens from bucket
+ * If there is not enough tokens, bucket goes into debt, which should
+ * be waited out with throttle_delay().
+ *
+ * @param __throttle - token bucket
+ * @param __count - count of tokens to take
+ */
+void
+throttle_consume (throttle_t *__throttle, __u64_t __count)
+{
+  if (!__throttle->rate)
+    {
+      return;
+    }
+
+  refill (__throttle);
+  __throttle->tokens -= __count;
+}
+
+/**
+ * Get delay until debt of bucket will be paid off
+ *
+ * @param __throttle - token bucket
+ * @return count of microseconds to wait
+ */
+__u64_t
+throttle_delay (throttle_t *__throttle)
+{
+  if (!__throttle->rate)
+    {
+      return 0;
+    }
+
+  refill (__throttle);
+
+  if (__throttle->tokens >= 0)
+    {
+      return 0;
+    }
+
+  return -__throttle->tokens * 1000000.0 / __throttle->rate;
+}
+
+/**
+ * Set idle I/O scheduling class for current process
+ * With this class process gets disk time only when no other
+ * process needs it.
+ *
+ * @param __old_priority - pointer to buffer where previous priority
+ * will be stored
+ * @return zero on success, non-zero otherwise
+ */
+int
+io_priority_set_idle (int *__old_priority)
+{
+#ifdef SYS_ioprio_set
+  int old;
+
+  old = syscall (SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+  if (old < 0)
+    {
+      return -1;
+    }
+
+  if (syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+               IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT))
+    {
+      return -1;
+    }
+
+  if (__old_priority)
+    {
+      *__old_priority = old;
+    }
+
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+/**
+ * Restore I/O priority of current process
+ *
+ * @param __priority - priority returned by io_priority_set_idle()
+ */
+void
+io_priority_restore (int __priority)
+{
+#ifdef SYS_ioprio_set
+  syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, __priority);
+#endif
+}
@@ -0,0 +1,66 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Token bucket rate limiter and I/O priority helpers
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _throttle_h_
+#define _throttle_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+/********
+ * Type definitions
+ */
+
+typedef struct
+{
+  /* Count of tokens added per second. Zero means no limit. */
+  __u64_t rate;
+
+  /* Count of available tokens. Negative value is a debt. */
+  double tokens;
+
+  /* Time of last refill */
+  timeval_t timestamp;
+} throttle_t;
+
+/********
+ *
+ */
+
+/* Initialize token bucket */
+void
+throttle_init (throttle_t *__throttle, __u64_t __rate);
+
+/* Change rate of token bucket */
+void
+throttle_set_rate (throttle_t *__throttle, __u64_t __rate);
+
+/* Take tokens from bucket */
+void
+throttle_consume (throttle_t *__throttle, __u64_t __count);
+
+/* Get delay until debt of bucket will be paid off */
+__u64_t
+throttle_delay (throttle_t *__throttle);
+
+/* Set idle I/O scheduling class for current process */
+int
+io_priority_set_idle (int *__old_priority);
+
+/* Restore I/O priority of current process */
+void
+io_priority_restore (int __priority);
+
+END_HEADER
+
+#endif
@@ -629,93 +629,6 @@ wtol (const wchar_t *__str)
   return res;
 }
 
-/**
- * Convert file mask to regular expression
- *
- * @param __mask - file mask to be converted
- * @return non-compiled regular expression on success, NULL otherwise
- * @sideeffect allocate memory for return value
- */
-wchar_t*
-file_mask_to_regexp (wchar_t *__mask, BOOL __case_insens)
-{
-  wchar_t *regexp;
-  size_t regexp_len;
-  const wchar_t *special = L"^$+[]()/.";
-  wchar_t *in = __mask, *out;
-  wchar_t modifiers[8] = {0};
-
-  /* Calculate how much memory we should allocate for regexp */
-
-  /* 4 because of starting and finishing slashes and */
-  /* string beginning and finishing matchers */
-  regexp_len = 4;
-  while (*in != L'\0')
-    {
-      /* `*` will be replaced with `.*` */
-      if (*in == '*')
-        {
-          regexp_len += 2;
-          ++in;
-          continue;
-        }
-
-      if (wcschr (special, *in))
-        {
-          ++regexp_len;
-        }
-
-      ++regexp_len;
-      ++in;
-    }
-
-  if (__case_insens)
-    {
-      wcscat (modifiers, L"i");
-      ++regexp_len;
-    }
-
-  /* Build regexp string */
-  regexp = malloc ((regexp_len + 1) * sizeof (wchar_t));
-  wcscpy (regexp, L"/^");
-
-  in  = __mask;
-  out = regexp + 2;
-
-  while (*in != L'\0')
-    {
-      /* Replace `*` with `.*` */
-      if (*in == '*')
-        {
-          *out++ = L'.';
-          *out++ = L'*';
-          ++in;
-          continue;
-        }
-
-      /* Replace `?` with `.` */
-      if (*in == '?')
-        {
-          *out++ = L'.';
-          ++in;
-          continue;
-        }
-
-      /* Escape regexp special characters */
-      if (wcschr (special, *in))
-        {
-          *out++ = L'\\';
-        }
-      *out++ = *in++;
-    }
-
-  *out = L'\0';
-  wcscat (out, L"$/");
-  wcscat (out, modifiers);
-
-  return regexp;
-}
-
 /**
  * Split string by separator
  *
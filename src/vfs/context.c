@@ -27,7 +27,9 @@ typedef struct
   wchar_t *value;
 } vfs_context_opt_t;
 
-vfs_context_opt_t *context = NULL;
+/* Context is kept per thread, so errors of background workers */
+/* don't overwrite context of errors of the interface */
+static __thread vfs_context_opt_t *context = NULL;
 
 #define MAX_VARIABLE_LEBGTH 1024
 
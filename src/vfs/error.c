@@ -16,6 +16,7 @@
 
 #include <wchar.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 /*******
  *
@@ -47,8 +48,8 @@ static error_t errors[] = {
 
 #define MAX_ERROR_LENGTH 1024
 
-/*  Maybe big troubles with this */
-static wchar_t current_error[MAX_ERROR_LENGTH];
+/* Description is built in buffer of calling thread */
+static __thread wchar_t current_error[MAX_ERROR_LENGTH];
 
 /********
  * Internal stuff
@@ -84,15 +85,11 @@ init (void)
 wchar_t*
 vfs_get_error (int __errcode)
 {
-  static BOOL initialized = FALSE;
+  static pthread_once_t initialized = PTHREAD_ONCE_INIT;
   static int n = sizeof (errors) / sizeof (error_t);
   BOOL found = FALSE;
 
-  if (!initialized)
-    {
-      init ();
-      initialized = TRUE;
-    }
+  pthread_once (&initialized, init);
 
   /* Try to get error's description from VFS's errors list */
   int l = 0, r = n - 1, m;
@@ -107,6 +107,22 @@ typedef struct
   vfs_mknod_proc mknod;
 
   vfs_move_strategy_proc move_strategy;
+
+  /****
+   * Optional procedures
+   */
+
+  vfs_fsync_proc fsync;
+  vfs_fadvise_proc fadvise;
+  vfs_physical_offset_proc physical_offset;
+  vfs_remove_tree_proc remove_tree;
+  vfs_unlink_batch_proc unlink_batch;
+  vfs_chmod_tree_proc chmod_tree;
+  vfs_chown_tree_proc chown_tree;
+  vfs_disk_usage_proc disk_usage;
+  vfs_mmap_proc mmap;
+  vfs_munmap_proc munmap;
+  vfs_fstat_proc fstat;
 } vfs_plugin_info_t;
 
 struct _vfs_plugin_t
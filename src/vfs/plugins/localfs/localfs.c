@@ -19,10 +19,15 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wchar.h>
 
 /*******
@@ -74,6 +79,37 @@
   if (__error) \
     (*__error)=(_errno);
 
+/* Depth of removed tree up to which descriptors of directories */
+/* are kept open while their children are removed */
+#define REMOVE_TREE_MAX_DEPTH 32
+
+/********
+ * Type definitions
+ */
+
+/* Attributes which are set by walker of tree */
+typedef struct
+{
+  /* Change mode of items */
+  BOOL chmod;
+  mode_t mode;
+
+  /* Bits of mode which are kept unchanged */
+  mode_t keep_mask;
+
+  /* Change owner of items */
+  BOOL chown;
+  uid_t owner;
+  gid_t group;
+} tree_attr_t;
+
+/* Entry of directory which is removed after directory is closed */
+typedef struct
+{
+  char *name;
+  unsigned char type;
+} tree_entry_t;
+
 /********
  * Helpers
  */
@@ -365,6 +401,7 @@ localfs_scandir (const wchar_t *__path, vfs_dirent_t ***__name_list,
             {
               /* Fill coomon part */
               tmp.type = eps[i]->d_type;
+              tmp.ino = eps[i]->d_ino;
 
               /* Convert file name */
               if (mbstowcs (tmp.name, eps[i]->d_name,
@@ -651,6 +688,776 @@ localfs_move_strategy (const wchar_t *__src_path, const wchar_t *__dst_path)
   return res;
 }
 
+/**
+ * Synchronize file's state with storage device.
+ * Wrapper for POSIX function fsync()
+ *
+ * @param __fd - descriptor of file to be synchronized
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_fsync (vfs_plugin_fd_t __fd)
+{
+  return ACTUAL_ERRCODE (fsync (FD (__fd)));
+}
+
+/**
+ * Predeclare an access pattern for file data.
+ * Wrapper for POSIX function posix_fadvise()
+ *
+ * @param __fd - descriptor of file
+ * @param __offset - start of region for which advice is given
+ * @param __len - length of region (zero means until the end of file)
+ * @param __advice - advice (POSIX_FADV_* constant)
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_fadvise (vfs_plugin_fd_t __fd, vfs_offset_t __offset,
+                 vfs_offset_t __len, int __advice)
+{
+  /* posix_fadvise() returns error number instead of setting errno */
+  return -posix_fadvise (FD (__fd), __offset, __len, __advice);
+}
+
+/**
+ * Map region of file into memory for sequential reading
+ *
+ * @param __fd - descriptor of file
+ * @param __offset - start of region (multiple of page size)
+ * @param __len - length of region
+ * @param __addr - pointer to variable where address of mapped region
+ * will be stored
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_mmap (vfs_plugin_fd_t __fd, vfs_offset_t __offset,
+              vfs_size_t __len, void **__addr)
+{
+  void *addr;
+
+  addr = mmap (NULL, __len, PROT_READ, MAP_PRIVATE, FD (__fd), __offset);
+
+  if (addr == MAP_FAILED)
+    {
+      return -errno;
+    }
+
+  /* Read-ahead more aggressively and drop pages behind */
+  madvise (addr, __len, MADV_SEQUENTIAL);
+
+  *__addr = addr;
+
+  return 0;
+}
+
+/**
+ * Unmap region of file
+ *
+ * @param __addr - address of mapped region
+ * @param __len - length of region
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_munmap (void *__addr, vfs_size_t __len)
+{
+  return ACTUAL_ERRCODE (munmap (__addr, __len));
+}
+
+/**
+ * Get status of opened file. Wrapper for POSIX function fstat()
+ *
+ * @param __fd - descriptor of file
+ * @param __stat - pointer to buffer where status will be stored
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_fstat (vfs_plugin_fd_t __fd, vfs_stat_t *__stat)
+{
+  return ACTUAL_ERRCODE (fstat (FD (__fd), __stat));
+}
+
+/**
+ * Remove item relative to descriptor of its parent directory
+ * Descriptors of directories are kept open while their children are
+ * removed up to depth REMOVE_TREE_MAX_DEPTH. Deeper children are
+ * removed by paths relative to the deepest kept descriptor, so count
+ * of opened descriptors is limited.
+ *
+ * @param __dirfd - descriptor of parent directory
+ * @param __name - name of item in parent directory (or path relative
+ * to it in deep trees)
+ * @param __type - type of item from directory entry (may be DT_UNKNOWN)
+ * @param __depth - depth of item in removed tree
+ * @param __state - state of removing
+ * @return zero on success, non-zero otherwise
+ */
+static int
+remove_tree_at (int __dirfd, const char *__name, unsigned char __type,
+                int __depth, vfs_tree_state_t *__state)
+{
+  int fd, res = 0, unlink_error = 0;
+  unsigned long i, count = 0, allocated = 0;
+  tree_entry_t *entries = NULL;
+  DIR *dir;
+  struct dirent *ep;
+  char *path;
+
+  if (__state->abort)
+    {
+      return -EINTR;
+    }
+
+  if (__type != DT_DIR)
+    {
+      /* If type is unknown, try to unlink item as a file at first, */
+      /* so item is stat'ed only if it is a directory */
+      if (!unlinkat (__dirfd, __name, 0))
+        {
+          __atomic_add_fetch (&__state->processed, 1, __ATOMIC_RELAXED);
+          return 0;
+        }
+
+      if (__type != DT_UNKNOWN || (errno != EISDIR && errno != EPERM))
+        {
+          res = -errno;
+          goto error;
+        }
+
+      /* EPERM is returned for directories as well as for files */
+      /* which couldn't be removed */
+      unlink_error = errno;
+    }
+
+  fd = openat (__dirfd, __name,
+               O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    {
+      /* Item is not a directory, so error of unlinking is the real one */
+      res = (errno == ENOTDIR && unlink_error) ? -unlink_error : -errno;
+      goto error;
+    }
+
+  dir = fdopendir (fd);
+  if (!dir)
+    {
+      res = -errno;
+      close (fd);
+      goto error;
+    }
+
+  while ((ep = readdir (dir)))
+    {
+      if (!strcmp (ep->d_name, ".") || !strcmp (ep->d_name, ".."))
+        {
+          continue;
+        }
+
+      if (__depth >= REMOVE_TREE_MAX_DEPTH)
+        {
+          /* Children are removed when directory is closed */
+          if (count == allocated)
+            {
+              allocated = allocated ? allocated * 2 : 16;
+              entries = realloc (entries, allocated * sizeof (tree_entry_t));
+            }
+
+          entries[count].name = strdup (ep->d_name);
+          entries[count].type = ep->d_type;
+          ++count;
+          continue;
+        }
+
+      /* Errors of children are already counted */
+      if (remove_tree_at (fd, ep->d_name, ep->d_type, __depth + 1, __state))
+        {
+          res = -ENOTEMPTY;
+        }
+
+      if (__state->abort)
+        {
+          break;
+        }
+    }
+
+  /* Also closes descriptor of directory */
+  closedir (dir);
+
+  for (i = 0; i < count; ++i)
+    {
+      if (!__state->abort)
+        {
+          path = malloc (strlen (__name) + strlen (entries[i].name) + 2);
+          sprintf (path, "%s/%s", __name, entries[i].name);
+
+          if (remove_tree_at (__dirfd, path, entries[i].type, __depth,
+                              __state))
+            {
+              res = -ENOTEMPTY;
+            }
+
+          free (path);
+        }
+
+      free (entries[i].name);
+    }
+
+  SAFE_FREE (entries);
+
+  if (__state->abort)
+    {
+      return -EINTR;
+    }
+
+  if (res)
+    {
+      /* Directory can't be removed while it has children */
+      return res;
+    }
+
+  if (unlinkat (__dirfd, __name, AT_REMOVEDIR))
+    {
+      res = -errno;
+      goto error;
+    }
+
+  __atomic_add_fetch (&__state->processed, 1, __ATOMIC_RELAXED);
+
+  return 0;
+
+error:
+  ++__state->errors;
+  __state->last_error = res;
+
+  return res;
+}
+
+/**
+ * Remove item with all its children
+ * Children are removed relative to descriptors of their parents,
+ * types of children are taken from directory entries.
+ *
+ * @param __fn - name of item
+ * @param __state - state of removing
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_remove_tree (const wchar_t *__fn, vfs_tree_state_t *__state)
+{
+  size_t len;
+  char *fn;
+  int res;
+
+  if (!__fn || !__state)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  len = wcslen (__fn);
+  fn = malloc ((len + 1) * MB_CUR_MAX);
+
+  if (wcstombs (fn, __fn, (len + 1) * MB_CUR_MAX) == -1)
+    {
+      free (fn);
+      return VFS_ERROR;
+    }
+
+  res = remove_tree_at (AT_FDCWD, fn, DT_UNKNOWN, 0, __state);
+
+  free (fn);
+
+  return res;
+}
+
+/**
+ * Unlink batch of items of one directory
+ * Items are unlinked relative to descriptor of directory.
+ *
+ * @param __fn - name of directory
+ * @param __names - names of items in directory
+ * @param __dirs - flags of items which are directories
+ * @param __count - count of items
+ * @param __results - array where results of unlinking of every item
+ * will be stored
+ * @return zero if directory has been opened, non-zero otherwise
+ */
+static int
+localfs_unlink_batch (const wchar_t *__fn, const wchar_t **__names,
+                      const BOOL *__dirs, unsigned long __count,
+                      int *__results)
+{
+  size_t len, size = 0;
+  char *fn, *name = NULL;
+  unsigned long i;
+  int fd;
+
+  if (!__fn || !__names || !__dirs || !__results)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  len = wcslen (__fn);
+  fn = malloc ((len + 1) * MB_CUR_MAX);
+
+  if (wcstombs (fn, __fn, (len + 1) * MB_CUR_MAX) == -1)
+    {
+      free (fn);
+      return VFS_ERROR;
+    }
+
+  fd = open (fn, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  free (fn);
+
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  for (i = 0; i < __count; ++i)
+    {
+      len = (wcslen (__names[i]) + 1) * MB_CUR_MAX;
+      if (len > size)
+        {
+          size = len;
+          name = realloc (name, size);
+        }
+
+      if (wcstombs (name, __names[i], size) == -1)
+        {
+          __results[i] = VFS_ERROR;
+          continue;
+        }
+
+      __results[i] = ACTUAL_ERRCODE (unlinkat (fd, name,
+                                               __dirs[i] ? AT_REMOVEDIR : 0));
+    }
+
+  free (name);
+  close (fd);
+
+  return 0;
+}
+
+/**
+ * Change attributes of item and all its children relative to
+ * descriptor of its parent directory
+ * Symbolic links are followed. Directory is changed after its children.
+ *
+ * @param __dirfd - descriptor of parent directory
+ * @param __name - name of item in parent directory
+ * @param __type - type of item from directory entry (may be DT_UNKNOWN)
+ * @param __attr - attributes to set
+ * @param __state - state of changing
+ * @return zero on success, non-zero otherwise
+ */
+static int
+chattr_tree_at (int __dirfd, const char *__name, unsigned char __type,
+                const tree_attr_t *__attr, vfs_tree_state_t *__state)
+{
+  int fd, res = 0, children_res = 0;
+  DIR *dir;
+  struct dirent *ep;
+  struct stat stat;
+  BOOL have_stat = FALSE;
+  mode_t mode;
+
+  if (__state->abort)
+    {
+      return -EINTR;
+    }
+
+  /* Item is stat'ed only if type of it or of target of symbolic link */
+  /* is unknown or if current mode is needed to keep some bits */
+  if (__type == DT_UNKNOWN || __type == DT_LNK ||
+      (__attr->chmod && __attr->keep_mask))
+    {
+      if (fstatat (__dirfd, __name, &stat, 0))
+        {
+          res = -errno;
+          goto error;
+        }
+
+      have_stat = TRUE;
+      __type = S_ISDIR (stat.st_mode) ? DT_DIR : DT_REG;
+    }
+
+  if (__type == DT_DIR)
+    {
+      fd = openat (__dirfd, __name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (fd < 0)
+        {
+          res = -errno;
+          goto error;
+        }
+
+      dir = fdopendir (fd);
+      if (!dir)
+        {
+          res = -errno;
+          close (fd);
+          goto error;
+        }
+
+      while ((ep = readdir (dir)))
+        {
+          if (!strcmp (ep->d_name, ".") || !strcmp (ep->d_name, ".."))
+            {
+              continue;
+            }
+
+          /* Errors of children are already counted */
+          res = chattr_tree_at (fd, ep->d_name, ep->d_type, __attr, __state);
+          if (res)
+            {
+              children_res = res;
+            }
+
+          if (__state->abort)
+            {
+              break;
+            }
+        }
+
+      /* Also closes descriptor of directory */
+      closedir (dir);
+
+      if (__state->abort)
+        {
+          return -EINTR;
+        }
+    }
+
+  if (__attr->chmod)
+    {
+      mode = __attr->mode;
+
+      if (have_stat)
+        {
+          mode = (stat.st_mode & __attr->keep_mask) |
+                 (mode & ~__attr->keep_mask);
+        }
+
+      /* Mode isn't changed if it is known already */
+      if ((!have_stat || mode != (stat.st_mode & 07777)) &&
+          fchmodat (__dirfd, __name, mode, 0))
+        {
+          res = -errno;
+          goto error;
+        }
+    }
+
+  if (__attr->chown && fchownat (__dirfd, __name,
+                                 __attr->owner, __attr->group, 0))
+    {
+      res = -errno;
+      goto error;
+    }
+
+  __atomic_add_fetch (&__state->processed, 1, __ATOMIC_RELAXED);
+
+  return children_res;
+
+error:
+  ++__state->errors;
+  __state->last_error = res;
+
+  return res;
+}
+
+/**
+ * Change attributes of item and all its children
+ *
+ * @param __fn - name of item
+ * @param __attr - attributes to set
+ * @param __state - state of changing
+ * @return zero on success, non-zero otherwise
+ */
+static int
+chattr_tree (const wchar_t *__fn, const tree_attr_t *__attr,
+             vfs_tree_state_t *__state)
+{
+  size_t len;
+  char *fn;
+  int res;
+
+  if (!__fn || !__state)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  len = wcslen (__fn);
+  fn = malloc ((len + 1) * MB_CUR_MAX);
+
+  if (wcstombs (fn, __fn, (len + 1) * MB_CUR_MAX) == -1)
+    {
+      free (fn);
+      return VFS_ERROR;
+    }
+
+  res = chattr_tree_at (AT_FDCWD, fn, DT_UNKNOWN, __attr, __state);
+
+  free (fn);
+
+  return res;
+}
+
+/**
+ * Change mode of item and all its children
+ * Children are changed relative to descriptors of their parents,
+ * they are stat'ed only if it is really needed.
+ *
+ * @param __fn - name of item
+ * @param __mode - new permissions
+ * @param __keep_mask - bits of permissions which are kept unchanged
+ * @param __state - state of changing
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_chmod_tree (const wchar_t *__fn, vfs_mode_t __mode,
+                    vfs_mode_t __keep_mask, vfs_tree_state_t *__state)
+{
+  tree_attr_t attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.chmod = TRUE;
+  attr.mode = __mode & 07777;
+  attr.keep_mask = __keep_mask & 07777;
+
+  return chattr_tree (__fn, &attr, __state);
+}
+
+/**
+ * Change owner of item and all its children
+ * Children are changed relative to descriptors of their parents,
+ * they are stat'ed only if type of them is unknown.
+ *
+ * @param __fn - name of item
+ * @param __owner - new owner id
+ * @param __group - new group id
+ * @param __state - state of changing
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_chown_tree (const wchar_t *__fn, vfs_uid_t __owner,
+                    vfs_gid_t __group, vfs_tree_state_t *__state)
+{
+  tree_attr_t attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.chown = TRUE;
+  attr.owner = __owner;
+  attr.group = __group;
+
+  return chattr_tree (__fn, &attr, __state);
+}
+
+/**
+ * Get disk usage of item relative to descriptor of its parent directory
+ *
+ * @param __dirfd - descriptor of parent directory
+ * @param __name - name of item in parent directory
+ * @param __dev - device of root of walking (NULL for the root itself)
+ * @param __one_fs - do not descend into directories on other filesystems
+ * @param __state - state of walking
+ * @param __size - counter of bytes occupied on disk
+ * @return zero on success, non-zero otherwise
+ */
+static int
+disk_usage_at (int __dirfd, const char *__name, const dev_t *__dev,
+               BOOL __one_fs, vfs_tree_state_t *__state, __u64_t *__size)
+{
+  int fd, res;
+  DIR *dir;
+  struct dirent *ep;
+  struct stat stat;
+
+  if (__state->abort)
+    {
+      return -EINTR;
+    }
+
+  /* Occupied blocks are needed for every item, */
+  /* so type from directory entry doesn't save stat'ing */
+  if (fstatat (__dirfd, __name, &stat, AT_SYMLINK_NOFOLLOW))
+    {
+      res = -errno;
+      goto error;
+    }
+
+  __atomic_add_fetch (&__state->processed, 1, __ATOMIC_RELAXED);
+
+  if (!S_ISDIR (stat.st_mode))
+    {
+      /* Blocks of file are counted once for all its names */
+      if (stat.st_nlink < 2 || !__state->link_seen ||
+          !__state->link_seen (__state, stat.st_dev, stat.st_ino))
+        {
+          /* st_blocks is counted in 512-byte units on all filesystems */
+          *__size += (__u64_t)stat.st_blocks * 512;
+        }
+
+      return 0;
+    }
+
+  *__size += (__u64_t)stat.st_blocks * 512;
+
+  if (!__dev)
+    {
+      __dev = &stat.st_dev;
+    }
+  else if (__one_fs && stat.st_dev != *__dev)
+    {
+      return 0;
+    }
+
+  fd = openat (__dirfd, __name,
+               O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    {
+      res = -errno;
+      goto error;
+    }
+
+  dir = fdopendir (fd);
+  if (!dir)
+    {
+      res = -errno;
+      close (fd);
+      goto error;
+    }
+
+  while ((ep = readdir (dir)) && !__state->abort)
+    {
+      if (!strcmp (ep->d_name, ".") || !strcmp (ep->d_name, ".."))
+        {
+          continue;
+        }
+
+      /* Errors of children are already counted */
+      disk_usage_at (fd, ep->d_name, __dev, __one_fs, __state, __size);
+    }
+
+  /* Also closes descriptor of directory */
+  closedir (dir);
+
+  return __state->abort ? -EINTR : 0;
+
+error:
+  ++__state->errors;
+  __state->last_error = res;
+
+  return res;
+}
+
+/**
+ * Get disk usage of item and all its children
+ * Children are stat'ed relative to descriptors of their parents.
+ *
+ * @param __fn - name of item
+ * @param __one_fs - do not descend into directories on other filesystems
+ * @param __state - state of walking
+ * @param __size - counter of bytes occupied on disk
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_disk_usage (const wchar_t *__fn, BOOL __one_fs,
+                    vfs_tree_state_t *__state, __u64_t *__size)
+{
+  size_t len;
+  char *fn;
+  int res;
+
+  if (!__fn || !__state || !__size)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  len = wcslen (__fn);
+  fn = malloc ((len + 1) * MB_CUR_MAX);
+
+  if (wcstombs (fn, __fn, (len + 1) * MB_CUR_MAX) == -1)
+    {
+      free (fn);
+      return VFS_ERROR;
+    }
+
+  res = disk_usage_at (AT_FDCWD, fn, NULL, __one_fs, __state, __size);
+
+  free (fn);
+
+  return res;
+}
+
+/**
+ * Get physical offset of the first extent of file on its device
+ * Uses FIEMAP ioctl, which doesn't require any privileges
+ *
+ * @param __fn - name of file
+ * @param __offset - pointer to buffer where offset will be stored
+ * @return zero on success, non-zero otherwise
+ */
+static int
+localfs_physical_offset (const wchar_t *__fn, vfs_offset_t *__offset)
+{
+#ifdef FS_IOC_FIEMAP
+  size_t len;
+  char *fn;
+  int fd, res = VFS_ERROR;
+  struct {
+    struct fiemap map;
+    struct fiemap_extent extent;
+  } buf;
+
+  if (!__fn || !__offset)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  len = wcslen (__fn);
+  fn = malloc ((len + 1) * MB_CUR_MAX);
+
+  if (wcstombs (fn, __fn, (len + 1) * MB_CUR_MAX) == -1)
+    {
+      free (fn);
+      return VFS_ERROR;
+    }
+
+  fd = open (fn, O_RDONLY | O_NOFOLLOW);
+  free (fn);
+
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  /* Only the first extent is needed */
+  memset (&buf, 0, sizeof (buf));
+  buf.map.fm_length = FIEMAP_MAX_OFFSET;
+  buf.map.fm_extent_count = 1;
+
+  if (ioctl (fd, FS_IOC_FIEMAP, &buf.map) < 0)
+    {
+      res = -errno;
+    }
+  else if (!buf.map.fm_mapped_extents ||
+           buf.extent.fe_flags & FIEMAP_EXTENT_UNKNOWN)
+    {
+      /* File is empty or its data has no place on device yet */
+      res = -ENODATA;
+    }
+  else
+    {
+      *__offset = buf.extent.fe_physical;
+      res = 0;
+    }
+
+  close (fd);
+
+  return res;
+#else
+  return VFS_METHOD_NOT_FOUND;
+#endif
+}
+
 /********
  *
  */
@@ -694,7 +1501,19 @@ static vfs_plugin_info_t plugin_info = {
 
   localfs_mknod,
 
-  localfs_move_strategy
+  localfs_move_strategy,
+
+  localfs_fsync,
+  localfs_fadvise,
+  localfs_physical_offset,
+  localfs_remove_tree,
+  localfs_unlink_batch,
+  localfs_chmod_tree,
+  localfs_chown_tree,
+  localfs_disk_usage,
+  localfs_mmap,
+  localfs_munmap,
+  localfs_fstat
 };
 
 /* Initialize plugin */
@@ -25,6 +25,29 @@ BEGIN_HEADER
 typedef int (*vfs_filter_proc) (const vfs_dirent_t*);
 typedef int (*vfs_cmp_proc) (const void*, const void*);
 
+/* State of recursive operation on tree made by plugin */
+/* Plugin updates counters, caller may read them from another thread */
+/* (count of processed items is accessed atomically) */
+typedef struct vfs_tree_state
+{
+  /* Count of processed items */
+  volatile __u64_t processed;
+
+  /* Count of errors and code of the last one */
+  volatile __u64_t errors;
+  volatile int last_error;
+
+  /* Operation should be stopped */
+  volatile BOOL abort;
+
+  /* Check if item with several hard links has been met already, */
+  /* so operations which count sizes count it only once. */
+  /* NULL means that every link is counted. */
+  BOOL (*link_seen) (struct vfs_tree_state *__state, vfs_dev_t __dev,
+                     ino_t __ino);
+  void *link_data;
+} vfs_tree_state_t;
+
 typedef vfs_plugin_fd_t (*vfs_open_proc) (const wchar_t *__fn,
                                           int __flags,
                                           int *__error,
@@ -89,6 +112,51 @@ typedef int (*vfs_mknod_proc) (const wchar_t *__fn,
 typedef int (*vfs_move_strategy_proc) (const wchar_t *__src_path,
                                        const wchar_t *__dst_path);
 
+typedef int (*vfs_fsync_proc) (vfs_plugin_fd_t __fd);
+
+typedef int (*vfs_fadvise_proc) (vfs_plugin_fd_t __fd,
+                                 vfs_offset_t __offset,
+                                 vfs_offset_t __len,
+                                 int __advice);
+
+typedef int (*vfs_physical_offset_proc) (const wchar_t *__fn,
+                                         vfs_offset_t *__offset);
+
+typedef int (*vfs_remove_tree_proc) (const wchar_t *__fn,
+                                     vfs_tree_state_t *__state);
+
+typedef int (*vfs_unlink_batch_proc) (const wchar_t *__dir,
+                                      const wchar_t **__names,
+                                      const BOOL *__dirs,
+                                      unsigned long __count,
+                                      int *__results);
+
+typedef int (*vfs_chmod_tree_proc) (const wchar_t *__fn,
+                                    vfs_mode_t __mode,
+                                    vfs_mode_t __keep_mask,
+                                    vfs_tree_state_t *__state);
+
+typedef int (*vfs_chown_tree_proc) (const wchar_t *__fn,
+                                    vfs_uid_t __owner,
+                                    vfs_gid_t __group,
+                                    vfs_tree_state_t *__state);
+
+typedef int (*vfs_disk_usage_proc) (const wchar_t *__fn,
+                                    BOOL __one_fs,
+                                    vfs_tree_state_t *__state,
+                                    __u64_t *__size);
+
+typedef int (*vfs_mmap_proc) (vfs_plugin_fd_t __fd,
+                              vfs_offset_t __offset,
+                              vfs_size_t __len,
+                              void **__addr);
+
+typedef int (*vfs_munmap_proc) (void *__addr,
+                                vfs_size_t __len);
+
+typedef int (*vfs_fstat_proc) (vfs_plugin_fd_t __fd,
+                               vfs_stat_t *__stat);
+
 END_HEADER
 
 #endif
@@ -590,6 +590,232 @@ vfs_move_strategy (const wchar_t *__src_url, const wchar_t *__dst_url)
   return res;
 }
 
+/**
+ * Abstraction for POSIX function fsync()
+ * Flush all modified data of file to the storage device
+ *
+ * @param __file - descriptor of file to be synchronized
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_fsync (vfs_file_t __file)
+{
+  if (!__file)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  return VFS_CALL_POSIX (__file->plugin, fsync, __file->plugin_data);
+}
+
+/**
+ * Abstraction for POSIX function posix_fadvise()
+ * Announce an intention to access file data in a specific pattern
+ *
+ * NOTE: This is only a hint, so plugins are not required
+ *       to implement it
+ *
+ * @param __file - descriptor of file
+ * @param __offset - start of region for which advice is given
+ * @param __len - length of region (zero means until the end of file)
+ * @param __advice - advice (POSIX_FADV_* constant)
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_fadvise (vfs_file_t __file, vfs_offset_t __offset,
+             vfs_offset_t __len, int __advice)
+{
+  if (!__file)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  return VFS_CALL_POSIX (__file->plugin, fadvise, __file->plugin_data,
+                         __offset, __len, __advice);
+}
+
+/**
+ * Get physical offset of the first extent of file on its device
+ *
+ * NOTE: This is only a hint for scheduling of input/output,
+ *       so plugins are not required to implement it
+ *
+ * @param __url - URL of file
+ * @param __offset - pointer to buffer where offset will be stored
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_physical_offset (const wchar_t *__url, vfs_offset_t *__offset)
+{
+  _FILEOP (physical_offset, __offset);
+}
+
+/**
+ * Remove item with all its children
+ *
+ * Removing doesn't stop on errors, they are counted in state.
+ * Plugins are not required to implement it, callers should
+ * fall back to item-by-item removing if it returns
+ * VFS_METHOD_NOT_FOUND.
+ *
+ * @param __url - URL of item to remove
+ * @param __state - state of removing
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_remove_tree (const wchar_t *__url, vfs_tree_state_t *__state)
+{
+  _FILEOP (remove_tree, __state);
+}
+
+/**
+ * Unlink batch of items of one directory
+ *
+ * Plugins are not required to implement it, callers should
+ * fall back to unlinking by full names if it returns
+ * VFS_METHOD_NOT_FOUND.
+ *
+ * @param __url - URL of directory
+ * @param __names - names of items in directory
+ * @param __dirs - flags of items which are directories
+ * @param __count - count of items
+ * @param __results - array where results of unlinking of every item
+ * will be stored
+ * @return zero if directory has been opened, non-zero otherwise
+ */
+int
+vfs_unlink_batch (const wchar_t *__url, const wchar_t **__names,
+                  const BOOL *__dirs, unsigned long __count, int *__results)
+{
+  _FILEOP (unlink_batch, __names, __dirs, __count, __results);
+}
+
+/**
+ * Change mode of item and all its children
+ * Symbolic links are followed. Errors are counted in state.
+ * Callers should fall back to item-by-item changing if it returns
+ * VFS_METHOD_NOT_FOUND.
+ *
+ * @param __url - URL of item
+ * @param __mode - new permissions
+ * @param __keep_mask - bits of permissions which are kept unchanged
+ * @param __state - state of changing
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_chmod_tree (const wchar_t *__url, vfs_mode_t __mode,
+                vfs_mode_t __keep_mask, vfs_tree_state_t *__state)
+{
+  _FILEOP (chmod_tree, __mode, __keep_mask, __state);
+}
+
+/**
+ * Change owner of item and all its children
+ * Symbolic links are followed. Errors are counted in state.
+ * Callers should fall back to item-by-item changing if it returns
+ * VFS_METHOD_NOT_FOUND.
+ *
+ * @param __url - URL of item
+ * @param __owner - new owner id
+ * @param __group - new group id
+ * @param __state - state of changing
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_chown_tree (const wchar_t *__url, vfs_uid_t __owner, vfs_gid_t __group,
+                vfs_tree_state_t *__state)
+{
+  _FILEOP (chown_tree, __owner, __group, __state);
+}
+
+/**
+ * Get disk usage of item and all its children
+ * Symbolic links are not followed. Errors are counted in state.
+ * Callers should fall back to walking by themselves if it returns
+ * VFS_METHOD_NOT_FOUND.
+ *
+ * @param __url - URL of item
+ * @param __one_fs - do not descend into directories on other filesystems
+ * @param __state - state of walking
+ * @param __size - pointer to counter of bytes occupied on disk,
+ * usage of item is added to it
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_disk_usage (const wchar_t *__url, BOOL __one_fs,
+                vfs_tree_state_t *__state, __u64_t *__size)
+{
+  _FILEOP (disk_usage, __one_fs, __state, __size);
+}
+
+/**
+ * Map region of file into memory for reading
+ *
+ * Mapped region is expected to be read sequentially.
+ * Plugins are not required to implement it, callers should
+ * fall back to vfs_read() if it returns non-zero.
+ *
+ * @param __file - descriptor of file
+ * @param __offset - start of region (multiple of page size)
+ * @param __len - length of region
+ * @param __addr - pointer to variable where address of mapped region
+ * will be stored
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_mmap (vfs_file_t __file, vfs_offset_t __offset, vfs_size_t __len,
+          void **__addr)
+{
+  if (!__file)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  return VFS_CALL_POSIX (__file->plugin, mmap, __file->plugin_data,
+                         __offset, __len, __addr);
+}
+
+/**
+ * Unmap region of file mapped by vfs_mmap()
+ *
+ * @param __file - descriptor of file
+ * @param __addr - address of mapped region
+ * @param __len - length of region
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_munmap (vfs_file_t __file, void *__addr, vfs_size_t __len)
+{
+  if (!__file)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  return VFS_CALL_POSIX (__file->plugin, munmap, __addr, __len);
+}
+
+/**
+ * Abstraction for POSIX function fstat()
+ * Get status of opened file
+ *
+ * NOTE: Plugins are not required to implement it
+ *
+ * @param __file - descriptor of file
+ * @param __stat - pointer to buffer where status will be stored
+ * @return zero on success, non-zero otherwise
+ */
+int
+vfs_fstat (vfs_file_t __file, vfs_stat_t *__stat)
+{
+  if (!__file)
+    {
+      return VFS_ERR_INVLAID_ARGUMENT;
+    }
+
+  return VFS_CALL_POSIX (__file->plugin, fstat, __file->plugin_data,
+                         __stat);
+}
+
 /**
  * Get absolutely path by relative and current working directory
  *
@@ -46,6 +46,10 @@ typedef struct stat vfs_stat_t;
 typedef struct
 {
   unsigned char type;
+
+  /* Inode number of entry (zero if it is unknown) */
+  ino_t ino;
+
   wchar_t name[VFS_MAX_FILENAME_LEN];
 } vfs_dirent_t;
 
@@ -160,6 +164,45 @@ vfs_mknod (const wchar_t *__url, vfs_mode_t __mode, vfs_dev_t __dev);
 int
 vfs_move_strategy (const wchar_t *__src_url, const wchar_t *__dst_url);
 
+int
+vfs_fsync (vfs_file_t __file);
+
+int
+vfs_fadvise (vfs_file_t __file, vfs_offset_t __offset,
+             vfs_offset_t __len, int __advice);
+
+int
+vfs_physical_offset (const wchar_t *__url, vfs_offset_t *__offset);
+
+int
+vfs_remove_tree (const wchar_t *__url, vfs_tree_state_t *__state);
+
+int
+vfs_unlink_batch (const wchar_t *__url, const wchar_t **__names,
+                  const BOOL *__dirs, unsigned long __count, int *__results);
+
+int
+vfs_chmod_tree (const wchar_t *__url, vfs_mode_t __mode,
+                vfs_mode_t __keep_mask, vfs_tree_state_t *__state);
+
+int
+vfs_chown_tree (const wchar_t *__url, vfs_uid_t __owner, vfs_gid_t __group,
+                vfs_tree_state_t *__state);
+
+int
+vfs_disk_usage (const wchar_t *__url, BOOL __one_fs,
+                vfs_tree_state_t *__state, __u64_t *__size);
+
+int
+vfs_mmap (vfs_file_t __file, vfs_offset_t __offset, vfs_size_t __len,
+          void **__addr);
+
+int
+vfs_munmap (vfs_file_t __file, void *__addr, vfs_size_t __len);
+
+int
+vfs_fstat (vfs_file_t __file, vfs_stat_t *__stat);
+
 /********
  * Different utilities
  */
@@ -167,6 +210,9 @@ vfs_move_strategy (const wchar_t *__src_url, const wchar_t *__dst_url);
 int
 vfs_alphasort (const void *__a, const void *__b);
 
+int
+vfs_inosort (const void *__a, const void *__b);
+
 wchar_t*
 vfs_normalize_full (const wchar_t *__fn, BOOL __read_sumlinks);
 
@@ -0,0 +1,781 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Matching of wide-character strings against file masks
+ *
+ * Masks support `*', `?', classes of characters like `[a-z]' or `[!0-9]'
+ * and lists of alternatives like `{c,h}'. Lists are expanded when masks
+ * are compiled. Masks which consist of literal part and leading or
+ * trailing stars (like `*.c') are matched by comparing of literal part
+ * only, the rest ones are compiled into single automaton which is run
+ * once over matched string for all masks at once.
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "wglob.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+
+/********
+ * Constants and macro definitions
+ */
+
+/* Kinds of simple masks */
+enum
+{
+  SIMPLE_EXACT = 0,
+  SIMPLE_PREFIX,
+  SIMPLE_SUFFIX,
+  SIMPLE_INFIX,
+  SIMPLE_ALL
+};
+
+/* Types of elements of masks */
+enum
+{
+  ELEM_CHAR = 0,
+  ELEM_ANY,
+  ELEM_STAR,
+  ELEM_CLASS,
+  ELEM_END
+};
+
+/* Maximal count of masks produced by expanding of lists */
+/* of alternatives, the rest lists are treated literally */
+#define MAX_ALTERNATIVES 1024
+
+#define WORD_BITS (sizeof (unsigned long) * 8)
+
+#define SET_STATE(__set, __state) \
+  ((__set)[(__state) / WORD_BITS] |= 1UL << ((__state) % WORD_BITS))
+
+/********
+ * Internal stuff
+ */
+
+/**
+ * Fold case of character
+ *
+ * @param __ch - character to fold
+ * @param __case_insens - case of character should be folded
+ * @return folded character
+ */
+static inline wchar_t
+fold_char (wchar_t __ch, int __case_insens)
+{
+  if (!__case_insens)
+    {
+      return __ch;
+    }
+
+  /* Names of files are mostly ASCII */
+  if (__ch < 128)
+    {
+      return __ch >= L'A' && __ch <= L'Z' ? __ch + (L'a' - L'A') : __ch;
+    }
+
+  return towlower (__ch);
+}
+
+/**
+ * Get end of class of characters
+ *
+ * @param __ptr - pointer to opening bracket of class
+ * @return pointer to closing bracket, or NULL if class isn't closed
+ */
+static const wchar_t*
+class_end (const wchar_t *__ptr)
+{
+  const wchar_t *ptr = __ptr + 1;
+
+  if (*ptr == L'!' || *ptr == L'^')
+    {
+      ++ptr;
+    }
+
+  /* Closing bracket right after opening one is a member of class */
+  if (*ptr == L']')
+    {
+      ++ptr;
+    }
+
+  while (*ptr && *ptr != L']')
+    {
+      if (*ptr == L'\\' && ptr[1])
+        {
+          ++ptr;
+        }
+      ++ptr;
+    }
+
+  return *ptr ? ptr : NULL;
+}
+
+/**
+ * Find the first list of alternatives in mask
+ *
+ * @param __mask - mask to search list in
+ * @param __close - pointer to variable where pointer to closing brace
+ * will be stored
+ * @return pointer to opening brace, or NULL if there is no list
+ */
+static const wchar_t*
+find_list (const wchar_t *__mask, const wchar_t **__close)
+{
+  const wchar_t *ptr, *end;
+  int depth, commas;
+
+  for (ptr = __mask; *ptr; ++ptr)
+    {
+      if (*ptr == L'\\' && ptr[1])
+        {
+          ++ptr;
+          continue;
+        }
+
+      if (*ptr == L'[' && (end = class_end (ptr)))
+        {
+          ptr = end;
+          continue;
+        }
+
+      if (*ptr != L'{')
+        {
+          continue;
+        }
+
+      /* Braces without commas on the top level are literal */
+      depth = 1;
+      commas = 0;
+
+      for (end = ptr + 1; *end && depth; ++end)
+        {
+          if (*end == L'\\' && end[1])
+            {
+              ++end;
+            }
+          else if (*end == L'{')
+            {
+              ++depth;
+            }
+          else if (*end == L'}')
+            {
+              --depth;
+            }
+          else if (*end == L',' && depth == 1)
+            {
+              ++commas;
+            }
+        }
+
+      if (!depth && commas)
+        {
+          *__close = end - 1;
+          return ptr;
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * Expand lists of alternatives in mask
+ *
+ * @param __mask - mask to expand
+ * @param __list - pointer to array where expanded masks are collected
+ * @param __count - count of collected masks
+ * @param __allocated - count of allocated items of array
+ */
+static void
+expand_lists (const wchar_t *__mask, wchar_t ***__list,
+              size_t *__count, size_t *__allocated)
+{
+  const wchar_t *open, *close, *alt, *ptr;
+  size_t prefix, suffix, len;
+  wchar_t *mask;
+  int depth = 0;
+
+  open = *__count < MAX_ALTERNATIVES ? find_list (__mask, &close) : NULL;
+
+  if (!open)
+    {
+      if (*__count == *__allocated)
+        {
+          *__allocated = *__allocated ? *__allocated * 2 : 16;
+          *__list = realloc (*__list, *__allocated * sizeof (wchar_t*));
+        }
+
+      (*__list)[(*__count)++] = wcsdup (__mask);
+      return;
+    }
+
+  prefix = open - __mask;
+  suffix = wcslen (close + 1);
+
+  /* Alternatives are separated by commas on the top level */
+  for (alt = ptr = open + 1; ptr <= close; ++ptr)
+    {
+      if (*ptr == L'\\' && ptr < close - 1)
+        {
+          ++ptr;
+          continue;
+        }
+
+      if (*ptr == L'{')
+        {
+          ++depth;
+          continue;
+        }
+
+      if (*ptr == L'}' && depth)
+        {
+          --depth;
+          continue;
+        }
+
+      if ((*ptr != L',' || depth) && ptr != close)
+        {
+          continue;
+        }
+
+      len = ptr - alt;
+      mask = malloc ((prefix + len + suffix + 1) * sizeof (wchar_t));
+      wmemcpy (mask, __mask, prefix);
+      wmemcpy (mask + prefix, alt, len);
+      wmemcpy (mask + prefix + len, close + 1, suffix + 1);
+
+      expand_lists (mask, __list, __count, __allocated);
+
+      free (mask);
+      alt = ptr + 1;
+    }
+}
+
+/**
+ * Parse class of characters
+ *
+ * @param __self - masks which class belongs to
+ * @param __begin - pointer to opening bracket
+ * @param __end - pointer to closing bracket
+ * @return index of class
+ */
+static size_t
+parse_class (wglob_t *__self, const wchar_t *__begin, const wchar_t *__end)
+{
+  const wchar_t *ptr = __begin + 1;
+  wglob_class_t *cls;
+  wchar_t first, last;
+
+  __self->classes = realloc (__self->classes, (__self->classes_count + 1) *
+                             sizeof (wglob_class_t));
+  cls = &__self->classes[__self->classes_count];
+  memset (cls, 0, sizeof (wglob_class_t));
+
+  if (*ptr == L'!' || *ptr == L'^')
+    {
+      cls->negate = 1;
+      ++ptr;
+    }
+
+  /* There are at most as many ranges as characters in class */
+  cls->ranges = malloc ((__end - ptr + 1) * 2 * sizeof (wchar_t));
+
+  for (; ptr < __end; ++ptr)
+    {
+      if (*ptr == L'\\' && ptr + 1 < __end)
+        {
+          ++ptr;
+        }
+
+      first = last = *ptr;
+
+      if (ptr[1] == L'-' && ptr + 2 < __end)
+        {
+          last = ptr[2];
+          ptr += 2;
+
+          if (last == L'\\' && ptr + 1 < __end)
+            {
+              last = *++ptr;
+            }
+        }
+
+      cls->ranges[cls->count * 2] = first;
+      cls->ranges[cls->count * 2 + 1] = last;
+      ++cls->count;
+    }
+
+  return __self->classes_count++;
+}
+
+/**
+ * Check if character belongs to class
+ *
+ * @param __cls - class of characters
+ * @param __ch - character to check
+ * @param __case_insens - case of characters is ignored
+ * @return non-zero if character belongs to class, zero otherwise
+ */
+static int
+class_match (const wglob_class_t *__cls, wchar_t __ch, int __case_insens)
+{
+  wchar_t variants[3];
+  size_t i, j, count = 1;
+
+  variants[0] = __ch;
+
+  if (__case_insens)
+    {
+      variants[count++] = towlower (__ch);
+      variants[count++] = towupper (__ch);
+    }
+
+  for (i = 0; i < __cls->count; ++i)
+    {
+      for (j = 0; j < count; ++j)
+        {
+          if (variants[j] >= __cls->ranges[i * 2] &&
+              variants[j] <= __cls->ranges[i * 2 + 1])
+            {
+              return !__cls->negate;
+            }
+        }
+    }
+
+  return __cls->negate;
+}
+
+/**
+ * Parse mask without lists of alternatives
+ *
+ * @param __self - masks which mask belongs to
+ * @param __mask - mask to parse
+ * @param __elems - array where elements of mask will be stored,
+ * should be large enough to store element per character and end element
+ * @return count of stored elements
+ */
+static size_t
+parse_mask (wglob_t *__self, const wchar_t *__mask, wglob_elem_t *__elems)
+{
+  const wchar_t *ptr, *end;
+  size_t count = 0;
+
+  for (ptr = __mask; *ptr; ++ptr)
+    {
+      memset (&__elems[count], 0, sizeof (wglob_elem_t));
+
+      if (*ptr == L'*')
+        {
+          /* Several stars are the same as single one */
+          if (count && __elems[count - 1].type == ELEM_STAR)
+            {
+              continue;
+            }
+          __elems[count].type = ELEM_STAR;
+        }
+      else if (*ptr == L'?')
+        {
+          __elems[count].type = ELEM_ANY;
+        }
+      else if (*ptr == L'[' && (end = class_end (ptr)))
+        {
+          __elems[count].type = ELEM_CLASS;
+          __elems[count].class_index = parse_class (__self, ptr, end);
+          ptr = end;
+        }
+      else
+        {
+          if (*ptr == L'\\' && ptr[1])
+            {
+              ++ptr;
+            }
+          __elems[count].type = ELEM_CHAR;
+          __elems[count].ch = fold_char (*ptr, __self->case_insens);
+        }
+
+      ++count;
+    }
+
+  memset (&__elems[count], 0, sizeof (wglob_elem_t));
+  __elems[count].type = ELEM_END;
+
+  return count + 1;
+}
+
+/**
+ * Store mask as simple one if it is possible
+ *
+ * @param __self - masks which mask belongs to
+ * @param __elems - elements of mask
+ * @param __count - count of elements including end element
+ * @return non-zero if mask is stored as simple one, zero otherwise
+ */
+static int
+add_simple (wglob_t *__self, const wglob_elem_t *__elems, size_t __count)
+{
+  size_t first = 0, last = __count - 1, i;
+  wglob_simple_t *simple;
+  int kind;
+
+  if (__elems[first].type == ELEM_STAR)
+    {
+      ++first;
+    }
+
+  if (last > first && __elems[last - 1].type == ELEM_STAR)
+    {
+      --last;
+    }
+
+  /* Only literal characters could be between stars */
+  for (i = first; i < last; ++i)
+    {
+      if (__elems[i].type != ELEM_CHAR)
+        {
+          return 0;
+        }
+    }
+
+  if (first == last)
+    {
+      kind = first ? SIMPLE_ALL : SIMPLE_EXACT;
+    }
+  else if (first)
+    {
+      kind = last < __count - 1 ? SIMPLE_INFIX : SIMPLE_SUFFIX;
+    }
+  else
+    {
+      kind = last < __count - 1 ? SIMPLE_PREFIX : SIMPLE_EXACT;
+    }
+
+  __self->simple = realloc (__self->simple, (__self->simple_count + 1) *
+                            sizeof (wglob_simple_t));
+  simple = &__self->simple[__self->simple_count++];
+
+  simple->kind = kind;
+  simple->len = last - first;
+  simple->literal = malloc ((simple->len + 1) * sizeof (wchar_t));
+
+  for (i = first; i < last; ++i)
+    {
+      simple->literal[i - first] = __elems[i].ch;
+    }
+  simple->literal[simple->len] = 0;
+
+  return 1;
+}
+
+/**
+ * Compare beginning of string with literal
+ *
+ * @param __str - string to compare
+ * @param __literal - literal in folded case
+ * @param __len - length of literal
+ * @param __case_insens - case of characters is ignored
+ * @return non-zero if string begins with literal, zero otherwise
+ */
+static inline int
+literal_equal (const wchar_t *__str, const wchar_t *__literal,
+               size_t __len, int __case_insens)
+{
+  size_t i;
+
+  if (!__case_insens)
+    {
+      return !wmemcmp (__str, __literal, __len);
+    }
+
+  for (i = 0; i < __len; ++i)
+    {
+      if (fold_char (__str[i], 1) != __literal[i])
+        {
+          return 0;
+        }
+    }
+
+  return 1;
+}
+
+/**
+ * Check if string matches simple mask
+ *
+ * @param __self - compiled masks
+ * @param __simple - simple mask
+ * @param __str - string to check
+ * @param __len - length of string
+ * @return non-zero if string matches mask, zero otherwise
+ */
+static int
+simple_match (const wglob_t *__self, const wglob_simple_t *__simple,
+              const wchar_t *__str, size_t __len)
+{
+  size_t i;
+
+  if (__simple->kind == SIMPLE_ALL)
+    {
+      return 1;
+    }
+
+  if (__len < __simple->len ||
+      (__simple->kind == SIMPLE_EXACT && __len != __simple->len))
+    {
+      return 0;
+    }
+
+  switch (__simple->kind)
+    {
+    case SIMPLE_EXACT:
+    case SIMPLE_PREFIX:
+      return literal_equal (__str, __simple->literal, __simple->len,
+                            __self->case_insens);
+
+    case SIMPLE_SUFFIX:
+      return literal_equal (__str + __len - __simple->len,
+                            __simple->literal, __simple->len,
+                            __self->case_insens);
+    }
+
+  for (i = 0; i + __simple->len <= __len; ++i)
+    {
+      if (literal_equal (__str + i, __simple->literal, __simple->len,
+                         __self->case_insens))
+        {
+          return 1;
+        }
+    }
+
+  return 0;
+}
+
+/**
+ * Put state of automaton and states reachable from it
+ * without consuming of characters into set
+ *
+ * @param __self - compiled masks
+ * @param __set - set of states
+ * @param __state - state to put
+ */
+static inline void
+activate (const wglob_t *__self, unsigned long *__set, size_t __state)
+{
+  /* Star could match empty string, so the next element */
+  /* is reachable as well */
+  while (__self->elems[__state].type == ELEM_STAR)
+    {
+      SET_STATE (__set, __state);
+      ++__state;
+    }
+
+  SET_STATE (__set, __state);
+}
+
+/********
+ * User's backend
+ */
+
+/**
+ * Compile masks
+ *
+ * @param __masks - masks to compile
+ * @param __count - count of masks
+ * @param __case_insens - case of characters is ignored
+ * @return compiled masks. Use wglob_free() to free them.
+ */
+wglob_t*
+wglob_compile (const wchar_t **__masks, size_t __count, int __case_insens)
+{
+  wglob_t *res;
+  wchar_t **list = NULL;
+  wglob_elem_t *elems;
+  size_t i, count = 0, allocated = 0, len;
+
+  res = calloc (1, sizeof (wglob_t));
+  res->case_insens = __case_insens;
+
+  for (i = 0; i < __count; ++i)
+    {
+      expand_lists (__masks[i], &list, &count, &allocated);
+    }
+
+  for (i = 0; i < count; ++i)
+    {
+      elems = malloc ((wcslen (list[i]) + 1) * sizeof (wglob_elem_t));
+      len = parse_mask (res, list[i], elems);
+
+      if (!add_simple (res, elems, len))
+        {
+          res->elems = realloc (res->elems, (res->elems_count + len) *
+                                sizeof (wglob_elem_t));
+          memcpy (res->elems + res->elems_count, elems,
+                  len * sizeof (wglob_elem_t));
+
+          res->starts = realloc (res->starts, (res->starts_count + 1) *
+                                 sizeof (size_t));
+          res->starts[res->starts_count++] = res->elems_count;
+
+          res->elems_count += len;
+        }
+
+      free (elems);
+      free (list[i]);
+    }
+
+  free (list);
+
+  return res;
+}
+
+/**
+ * Free compiled masks
+ *
+ * @param __self - masks to free
+ */
+void
+wglob_free (wglob_t *__self)
+{
+  size_t i;
+
+  if (!__self)
+    {
+      return;
+    }
+
+  for (i = 0; i < __self->simple_count; ++i)
+    {
+      free (__self->simple[i].literal);
+    }
+
+  for (i = 0; i < __self->classes_count; ++i)
+    {
+      free (__self->classes[i].ranges);
+    }
+
+  free (__self->simple);
+  free (__self->elems);
+  free (__self->starts);
+  free (__self->classes);
+  free (__self);
+}
+
+/**
+ * Check if string matches any of masks
+ *
+ * @param __self - compiled masks
+ * @param __str - string to check
+ * @return non-zero if string matches some mask, zero otherwise
+ */
+int
+wglob_match (const wglob_t *__self, const wchar_t *__str)
+{
+  size_t i, w, state, len = wcslen (__str);
+  size_t words = (__self->elems_count + WORD_BITS - 1) / WORD_BITS;
+  const wglob_elem_t *elem;
+  unsigned long bits;
+  wchar_t ch;
+  int alive;
+
+  for (i = 0; i < __self->simple_count; ++i)
+    {
+      if (simple_match (__self, &__self->simple[i], __str, len))
+        {
+          return 1;
+        }
+    }
+
+  if (!__self->starts_count)
+    {
+      return 0;
+    }
+
+  {
+    /* Sets of active states before and after current character */
+    unsigned long sets[2][words], *cur = sets[0], *next = sets[1], *tmp;
+
+    memset (cur, 0, words * sizeof (unsigned long));
+
+    for (i = 0; i < __self->starts_count; ++i)
+      {
+        activate (__self, cur, __self->starts[i]);
+      }
+
+    for (i = 0; i < len; ++i)
+      {
+        ch = fold_char (__str[i], __self->case_insens);
+        memset (next, 0, words * sizeof (unsigned long));
+        alive = 0;
+
+        for (w = 0; w < words; ++w)
+          {
+            for (bits = cur[w]; bits; bits &= bits - 1)
+              {
+                state = w * WORD_BITS + __builtin_ctzl (bits);
+                elem = &__self->elems[state];
+
+                switch (elem->type)
+                  {
+                  case ELEM_STAR:
+                    /* Star consumes character and stays active */
+                    activate (__self, next, state);
+                    alive = 1;
+                    break;
+
+                  case ELEM_CHAR:
+                    if (elem->ch == ch)
+                      {
+                        activate (__self, next, state + 1);
+                        alive = 1;
+                      }
+                    break;
+
+                  case ELEM_ANY:
+                    activate (__self, next, state + 1);
+                    alive = 1;
+                    break;
+
+                  case ELEM_CLASS:
+                    if (class_match (&__self->classes[elem->class_index],
+                                     __str[i], __self->case_insens))
+                      {
+                        activate (__self, next, state + 1);
+                        alive = 1;
+                      }
+                    break;
+                  }
+              }
+          }
+
+        if (!alive)
+          {
+            return 0;
+          }
+
+        tmp = cur;
+        cur = next;
+        next = tmp;
+      }
+
+    /* String matches if end of some mask is reached */
+    for (w = 0; w < words; ++w)
+      {
+        for (bits = cur[w]; bits; bits &= bits - 1)
+          {
+            state = w * WORD_BITS + __builtin_ctzl (bits);
+
+            if (__self->elems[state].type == ELEM_END)
+              {
+                return 1;
+              }
+          }
+      }
+  }
+
+  return 0;
+}
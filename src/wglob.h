@@ -0,0 +1,100 @@
+/**
+ * ${project-name} - a GNU/Linux console-based file manager
+ *
+ * Matching of wide-character strings against file masks
+ *
+ * Copyright 2008 Sergey I. Sharybin <g.ulairi@gmail.com>
+ * Copyright 2008 Alex A. Smirnov <sceptic13@gmail.com>
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#ifndef _wglob_h_
+#define _wglob_h_
+
+#include "smartinclude.h"
+
+BEGIN_HEADER
+
+#include <stddef.h>
+#include <wchar.h>
+
+/********
+ * Type definitions
+ */
+
+/* Mask which is matched by comparing of literal part only */
+typedef struct
+{
+  /* Kind of mask (exact name, prefix, suffix, infix or any name) */
+  int kind;
+
+  /* Literal part of mask in folded case */
+  wchar_t *literal;
+  size_t len;
+} wglob_simple_t;
+
+/* Element of mask in automaton */
+typedef struct
+{
+  /* Type of element (character, any character, any string, */
+  /* class of characters or end of mask) */
+  int type;
+
+  /* Character in folded case or index of class */
+  wchar_t ch;
+  size_t class_index;
+} wglob_elem_t;
+
+/* Class of characters */
+typedef struct
+{
+  /* Pairs of the first and the last characters of ranges */
+  wchar_t *ranges;
+  size_t count;
+
+  int negate;
+} wglob_class_t;
+
+/* Compiled masks */
+typedef struct
+{
+  int case_insens;
+
+  /* Masks which don't need automaton */
+  wglob_simple_t *simple;
+  size_t simple_count;
+
+  /* Elements of the rest masks, each one ends with end element. */
+  /* States of automaton are positions in this array. */
+  wglob_elem_t *elems;
+  size_t elems_count;
+
+  /* Positions of the first elements of masks */
+  size_t *starts;
+  size_t starts_count;
+
+  wglob_class_t *classes;
+  size_t classes_count;
+} wglob_t;
+
+/********
+ *
+ */
+
+/* Compile masks */
+wglob_t*
+wglob_compile (const wchar_t **__masks, size_t __count, int __case_insens);
+
+/* Free compiled masks */
+void
+wglob_free (wglob_t *__self);
+
+/* Check if string matches any of masks */
+int
+wglob_match (const wglob_t *__self, const wchar_t *__str);
+
+END_HEADER
+
+#endif
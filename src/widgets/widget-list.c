@@ -514,3 +514,86 @@ w_list_set_selected (w_list_t *__list, __u32_t __index)
 
   return 0;
 }
+
+/**
+ * Replace text of item
+ *
+ * @param __list - list which contains item
+ * @param __index - index of item
+ * @param __text - new text of item
+ * @return zero on succes, non-zero otherwise
+ */
+int
+w_list_set_item_text (w_list_t *__list, __u32_t __index,
+                      const wchar_t *__text)
+{
+  w_list_item_t *item;
+
+  item = w_list_get_item (__list, __index);
+
+  if (!item || !__text)
+    {
+      return -1;
+    }
+
+  if (item->text && !wcscmp (item->text, __text))
+    {
+      /* Nothing to change */
+      return 0;
+    }
+
+  SAFE_FREE (item->text);
+  item->text = wcsdup (__text);
+
+  widget_redraw (WIDGET (__list));
+
+  return 0;
+}
+
+/**
+ * Remove item from list
+ *
+ * @param __list - list from which item will be removed
+ * @param __index - index of item to remove
+ * @return zero on succes, non-zero otherwise
+ */
+int
+w_list_remove_item (w_list_t *__list, __u32_t __index)
+{
+  __u32_t i;
+
+  if (__list == NULL || __index >= __list->items.count)
+    {
+      return -1;
+    }
+
+  SAFE_FREE (__list->items.data[__index].text);
+
+  /* Shift array */
+  for (i = __index; i < __list->items.count - 1; ++i)
+    {
+      __list->items.data[i] = __list->items.data[i + 1];
+    }
+
+  --__list->items.count;
+
+  if (__list->items.current >= __list->items.count)
+    {
+      __list->items.current = __list->items.count ?
+                                __list->items.count - 1 : 0;
+    }
+
+  if (__list->scroll_top > __list->items.current)
+    {
+      __list->scroll_top = __list->items.current;
+    }
+
+  /* Update size of scrollbar */
+  update_scrollbar_visibility (__list);
+  w_scrollbar_set_size ((w_scrollbar_t*)__list->scrollbar,
+                        __list->items.count);
+
+  widget_redraw (WIDGET (__list));
+
+  return 0;
+}
@@ -100,4 +100,13 @@ w_list_get_item (w_list_t *__list, __u32_t __index);
 int
 w_list_set_selected (w_list_t *__list, __u32_t __index);
 
+/* Replace text of item */
+int
+w_list_set_item_text (w_list_t *__list, __u32_t __index,
+                      const wchar_t *__text);
+
+/* Remove item from list */
+int
+w_list_remove_item (w_list_t *__list, __u32_t __index);
+
 #endif
@@ -13,6 +13,7 @@
 #include "widget.h"
 #include "deque.h"
 #include "hook.h"
+#include "timer.h"
 #include "messages.h"
 
 #include <malloc.h>
@@ -29,6 +30,9 @@
 
 #define DELAY (0.2*1000*10)
 
+/* Period of calling of "idle-hook" while there is no input (in usecs) */
+#define IDLE_HOOK_PERIOD 100000
+
 /* List of root widgets */
 static deque_t *root_widgets = NULL;
 
@@ -485,6 +489,7 @@ wint_t
 widget_get_char (void)
 {
   struct timespec timestruc = {0, DELAY};
+  static timeval_t last_idle = {0, 0};
   wint_t ch;
 
   while (!stop_main_loop)
@@ -497,6 +502,10 @@ widget_get_char (void)
         }
       else
         {
+          /* Let background tasks show their results */
+          CALL_DELAYED (last_idle, IDLE_HOOK_PERIOD,
+                        hook_call, L"idle-hook", NULL);
+
           nanosleep (&timestruc, 0);
         }
     }